@@ -18,6 +18,7 @@ limitations under the License.
 #include <stddef.h>
 #include <string.h>
 
+#include "ahocorasick.h"
 #include "arena.h"
 #include "atoms.h"
 #include "mem.h"
@@ -577,6 +578,7 @@ int yr_ac_add_string(
     if (result == ERROR_SUCCESS)
     {
       new_match->backtrack = state->depth + atom->backtrack;
+      new_match->flags = atom->flags;
       new_match->string = string;
       new_match->forward_code = atom->forward_code;
       new_match->backward_code = atom->backward_code;
@@ -595,6 +597,68 @@ int yr_ac_add_string(
 }
 
 
+//
+// _yr_ac_walk_state_matches
+//
+// Invokes the callback for every match in the given state and its
+// descendants. This function is invoked by yr_ac_walk_matches, is not
+// intended to be used stand-alone.
+//
+
+int _yr_ac_walk_state_matches(
+    YR_AC_STATE* state,
+    YR_AC_MATCH_CALLBACK_FUNC callback,
+    void* args)
+{
+  YR_AC_STATE_TRANSITION transition;
+  YR_AC_MATCH* match;
+  YR_AC_STATE* child_state;
+
+  match = state->matches;
+
+  while (match != NULL)
+  {
+    FAIL_ON_ERROR(callback(match, args));
+    match = match->next;
+  }
+
+  child_state = _yr_ac_first_transition(state, &transition);
+
+  while (child_state != NULL)
+  {
+    FAIL_ON_ERROR(_yr_ac_walk_state_matches(child_state, callback, args));
+    child_state = _yr_ac_next_transition(state, &transition);
+  }
+
+  return ERROR_SUCCESS;
+}
+
+
+//
+// yr_ac_walk_matches
+//
+// Invokes a callback function for each match in the automaton. Once failure
+// links are created the match lists are shared between states, so the same
+// match can be passed to the callback more than once.
+//
+// Args:
+//    YR_AC_AUTOMATON* automaton          - Automaton
+//    YR_AC_MATCH_CALLBACK_FUNC callback  - Function called for each match
+//    void* args                          - Arguments passed to the callback
+//
+// Returns:
+//    ERROR_SUCCESS if succeed or the first error returned by the callback.
+//
+
+int yr_ac_walk_matches(
+    YR_AC_AUTOMATON* automaton,
+    YR_AC_MATCH_CALLBACK_FUNC callback,
+    void* args)
+{
+  return _yr_ac_walk_state_matches(automaton->root, callback, args);
+}
+
+
 //
 // _yr_ac_print_automaton_state
 //
@@ -19,6 +19,12 @@ limitations under the License.
 
 #include "yara.h"
 
+
+typedef int YR_AC_MATCH_CALLBACK_FUNC(
+    YR_AC_MATCH* match,
+    void* args);
+
+
 int yr_ac_create_automaton(
     YR_ARENA* arena,
     YR_AC_AUTOMATON** automaton);
@@ -41,6 +47,12 @@ void yr_ac_create_failure_links(
     YR_AC_AUTOMATON* automaton);
 
 
+int yr_ac_walk_matches(
+    YR_AC_AUTOMATON* automaton,
+    YR_AC_MATCH_CALLBACK_FUNC callback,
+    void* args);
+
+
 void yr_ac_print_automaton(
     YR_AC_AUTOMATON* automaton);
 
@@ -37,7 +37,7 @@ from files.
 #include "yara.h"
 
 
-#define ARENA_FILE_VERSION      1
+#define ARENA_FILE_VERSION      7
 
 
 typedef struct _ARENA_FILE_HEADER
@@ -818,11 +818,13 @@ int yr_arena_duplicate(
     reloc_address = (uint8_t**) (new_page->address + new_reloc->offset);
     reloc_target = *reloc_address;
 
-    if (reloc_target != NULL)
-    {
-      assert(reloc_target >= page->address);
-      assert(reloc_target < page->address + page->used);
+    // Relocatable pointers can be set to memory outside the arena after it
+    // was created, like the values of string external variables defined
+    // with yr_rules_define_string_variable. Those are copied as they are.
 
+    if (reloc_target >= page->address &&
+        reloc_target < page->address + page->used)
+    {
       *reloc_address = reloc_target - \
                        page->address + \
                        new_page->address;
@@ -833,7 +835,7 @@ int yr_arena_duplicate(
 
   new_arena->page_list_head = new_page;
   new_arena->current_page = new_page;
-  new_arena->flags |= ARENA_FLAGS_COALESCED;
+  new_arena->flags = ARENA_FLAGS_COALESCED;
 
   *duplicated = new_arena;
 
@@ -994,7 +996,7 @@ int yr_arena_load(
     return ERROR_CORRUPT_FILE;
   }
 
-  if (header.version > ARENA_FILE_VERSION)
+  if (header.version != ARENA_FILE_VERSION)
   {
     fclose(fh);
     return ERROR_UNSUPPORTED_FILE_VERSION;
@@ -1017,6 +1019,7 @@ int yr_arena_load(
   if (new_address != NULL)
   {
     page->address = new_address;
+    page->size = header.size;
   }
   else
   {
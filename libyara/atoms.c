@@ -518,6 +518,7 @@ int _yr_atoms_case_insentive(
       new_atom->forward_code = atom->forward_code;
       new_atom->backward_code = atom->backward_code;
       new_atom->backtrack = atom->backtrack;
+      new_atom->flags = atom->flags;
       new_atom->next = *case_insensitive_atoms;
 
       *case_insensitive_atoms = new_atom;
@@ -576,6 +577,7 @@ int _yr_atoms_wide(
     new_atom->forward_code = atom->forward_code;
     new_atom->backward_code = atom->backward_code;
     new_atom->backtrack = atom->backtrack * 2;
+    new_atom->flags = STRING_GFLAGS_WIDE;
     new_atom->next = *wide_atoms;
 
     *wide_atoms = new_atom;
@@ -950,6 +952,7 @@ int yr_atoms_extract_from_re(
 {
   ATOM_TREE* atom_tree = yr_malloc(sizeof(ATOM_TREE));
   ATOM_TREE_NODE* temp;
+  YR_ATOM_LIST_ITEM* atom;
   YR_ATOM_LIST_ITEM* wide_atoms;
   YR_ATOM_LIST_ITEM* case_insentive_atoms;
   YR_ATOM_LIST_ITEM* triplet_atoms;
@@ -999,6 +1002,13 @@ int yr_atoms_extract_from_re(
     }
   }
 
+  // Atoms extracted so far are ASCII, the wide ones are tagged as such when
+  // created. This way the scanner knows which encoding must be verified
+  // when an atom is found.
+
+  for (atom = *atoms; atom != NULL; atom = atom->next)
+    atom->flags = STRING_GFLAGS_ASCII;
+
   if (flags & STRING_GFLAGS_WIDE)
   {
     FAIL_ON_ERROR(_yr_atoms_wide(
@@ -1056,6 +1066,7 @@ int yr_atoms_extract_from_string(
   item->backward_code = NULL;
   item->next = NULL;
   item->backtrack = 0;
+  item->flags = STRING_GFLAGS_ASCII;
 
   length = min(string_length, MAX_ATOM_LENGTH);
 
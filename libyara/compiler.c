@@ -25,6 +25,8 @@ limitations under the License.
 #include "hash.h"
 #include "lexer.h"
 #include "mem.h"
+#include "optimizer.h"
+#include "re_jit.h"
 #include "utils.h"
 #include "yara.h"
 
@@ -50,9 +52,20 @@ int yr_compiler_create(
   new_compiler->current_rule_flags = 0;
   new_compiler->allow_includes = 1;
   new_compiler->loop_depth = 0;
+  new_compiler->last_instruction = NULL;
+  new_compiler->pending_jumps_count = 0;
+  new_compiler->current_rule_init = NULL;
+  new_compiler->current_rule_skip = NULL;
+  new_compiler->string_set = NULL;
+  new_compiler->string_set_count = 0;
+  new_compiler->string_set_size = 0;
   new_compiler->compiled_rules_arena = NULL;
   new_compiler->externals_count = 0;
   new_compiler->namespaces_count = 0;
+  new_compiler->rules_count = 0;
+  new_compiler->strings_count = 0;
+  new_compiler->code_stats.size = 0;
+  new_compiler->code_stats.optimized_size = 0;
 
   result = yr_hash_table_create(10007, &new_compiler->rules_table);
 
@@ -138,6 +151,9 @@ void yr_compiler_destroy(
 
   yr_hash_table_destroy(compiler->rules_table);
 
+  if (compiler->string_set != NULL)
+    yr_free(compiler->string_set);
+
   for (i = 0; i < compiler->file_name_stack_ptr; i++)
     yr_free(compiler->file_name_stack[i]);
 
@@ -280,9 +296,7 @@ int _yr_compiler_set_namespace(
       return result;
 
     ns->name = ns_name;
-
-    for (i = 0; i < MAX_THREADS; i++)
-      ns->t_flags[i] = 0;
+    ns->idx = compiler->namespaces_count;
 
     compiler->namespaces_count++;
   }
@@ -323,18 +337,38 @@ int _yr_compiler_compile_rules(
 {
   YARA_RULES_FILE_HEADER* rules_file_header = NULL;
   YR_ARENA* arena;
+  YR_ARENA* optimized_code_arena;
   YR_RULE null_rule;
   YR_EXTERNAL_VARIABLE null_external;
 
   int8_t halt = HALT;
+  int8_t* halt_address;
   int result;
+  int i;
 
-  // Write halt instruction at the end of code.
+  // Write halt instruction at the end of code. The last rule's INIT_RULE
+  // is still waiting for its skip target, which is the halt itself.
   yr_arena_write_data(
       compiler->code_arena,
       &halt,
       sizeof(int8_t),
-      NULL);
+      (void**) &halt_address);
+
+  for (i = 0; i < compiler->pending_jumps_count; i++)
+    *compiler->pending_jumps[i] = halt_address;
+
+  compiler->pending_jumps_count = 0;
+
+  result = yr_optimizer_optimize_code(
+      compiler->code_arena,
+      &optimized_code_arena,
+      &compiler->code_stats);
+
+  if (result != ERROR_SUCCESS)
+    return result;
+
+  yr_arena_destroy(compiler->code_arena);
+  compiler->code_arena = optimized_code_arena;
 
   // Write a null rule indicating the end.
   memset(&null_rule, 0xFA, sizeof(YR_RULE));
@@ -376,6 +410,11 @@ int _yr_compiler_compile_rules(
 
   if (result == ERROR_SUCCESS)
   {
+    rules_file_header->rules_count = compiler->rules_count;
+    rules_file_header->strings_count = compiler->strings_count;
+    rules_file_header->namespaces_count = compiler->namespaces_count;
+    rules_file_header->externals_count = compiler->externals_count;
+
     rules_file_header->rules_list_head = yr_arena_base_address(
         compiler->rules_arena);
 
@@ -465,6 +504,15 @@ int _yr_compiler_compile_rules(
     result = yr_arena_coalesce(arena);
   }
 
+  if (result == ERROR_SUCCESS)
+  {
+    // Code is contiguous only after coalescing the arena.
+    rules_file_header = (YARA_RULES_FILE_HEADER*) yr_arena_base_address(
+        arena);
+
+    yr_execute_analyze_code(rules_file_header->code_start);
+  }
+
   return result;
 }
 
@@ -498,12 +546,36 @@ int yr_compiler_get_rules(
     rules_file_header = (YARA_RULES_FILE_HEADER*) yr_arena_base_address(
         yara_rules->arena);
 
+    result = yr_re_jit_create(
+        rules_file_header->automaton,
+        &yara_rules->re_jit);
+
+    if (result != ERROR_SUCCESS)
+      yr_arena_destroy(yara_rules->arena);
+  }
+
+  if (result == ERROR_SUCCESS)
+  {
     yara_rules->externals_list_head = NULL;
     yara_rules->rules_list_head = rules_file_header->rules_list_head;
     yara_rules->externals_list_head = rules_file_header->externals_list_head;
     yara_rules->automaton = rules_file_header->automaton;
     yara_rules->code_start = rules_file_header->code_start;
-    yara_rules->threads_count = 0;
+    yara_rules->re_limits.scan_limit = RE_DEFAULT_SCAN_LIMIT;
+    yara_rules->re_limits.cost_budget = 0;
+    yara_rules->strings_re_limits = NULL;
+    yara_rules->scan_threads = 1;
+    yara_rules->rules_count = rules_file_header->rules_count;
+    yara_rules->strings_count = rules_file_header->strings_count;
+    yara_rules->namespaces_count = rules_file_header->namespaces_count;
+    yara_rules->externals_count = rules_file_header->externals_count;
+    yara_rules->profiling_enabled = FALSE;
+    yara_rules->profiling_info = NULL;
+
+    memset(
+        yara_rules->thread_contexts,
+        0,
+        sizeof(yara_rules->thread_contexts));
 
     #if WIN32
     yara_rules->mutex = CreateMutex(NULL, FALSE, NULL);
@@ -523,6 +595,19 @@ int yr_compiler_get_rules(
 }
 
 
+//
+// Returns the size of the condition code before and after being optimized.
+// Sizes are zero until the rules are obtained with yr_compiler_get_rules.
+//
+
+void yr_compiler_get_code_stats(
+    YR_COMPILER* compiler,
+    YR_CODE_STATS* stats)
+{
+  *stats = compiler->code_stats;
+}
+
+
 int yr_compiler_define_integer_variable(
     YR_COMPILER* compiler,
     const char* identifier,
@@ -553,9 +638,9 @@ int yr_compiler_define_integer_variable(
     external->identifier = id;
     external->integer = value;
     external->string = NULL;
+    compiler->externals_count++;
   }
 
-  compiler->externals_count++;
   compiler->last_result = result;
   return result;
 }
@@ -591,9 +676,9 @@ int yr_compiler_define_boolean_variable(
     external->identifier = id;
     external->integer = value;
     external->string = NULL;
+    compiler->externals_count++;
   }
 
-  compiler->externals_count++;
   compiler->last_result = result;
 
   return result;
@@ -638,9 +723,9 @@ int yr_compiler_define_string_variable(
     external->identifier = id;
     external->integer = 0;
     external->string = val;
+    compiler->externals_count++;
   }
 
-  compiler->externals_count++;
   compiler->last_result = result;
 
   return result;
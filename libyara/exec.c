@@ -14,15 +14,48 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
+#include "arena.h"
 #include "exec.h"
 #include "re.h"
 
 #define STACK_SIZE 16384
 #define MEM_SIZE   MAX_LOOP_NESTING * LOOP_LOCAL_VARS
 
+// Strings with fewer matches than this are looked up by walking their
+// list of matches, an index is built for the others.
+
+#define MATCH_INDEX_THRESHOLD  16
+
+// Same for memory blocks, reads from memory walk the list of blocks unless
+// there are at least this number of them.
+
+#define MEM_BLOCKS_INDEX_THRESHOLD  8
+
+
+// With GCC and compatible compilers instructions are dispatched with
+// computed gotos, each instruction jumps directly to the next one through
+// a table of label addresses. Otherwise, or if NO_COMPUTED_GOTO is
+// defined, the usual switch inside a loop is used. Either way executed
+// instructions are counted, the count is used for profiling.
+
+#if defined(__GNUC__) && !defined(NO_COMPUTED_GOTO)
+#define USE_COMPUTED_GOTO
+#endif
+
+#ifdef USE_COMPUTED_GOTO
+#define opcode(x)   op_##x
+#define dispatch()  { instructions++; goto *dispatch_table[*ip]; }
+#else
+#define opcode(x)   case x
+#define dispatch()  continue
+#endif
+
+#define next()  { ip++; dispatch(); }
+
 
 #define push(x)  \
     do { \
@@ -42,20 +75,174 @@ limitations under the License.
     (IS_UNDEFINED(op1) || IS_UNDEFINED(op2)) ? (0) : (op1 operator op2)
 
 
+// The value of an external variable in the current scan is the one set in
+// the scan context, if any, or otherwise the one defined in the rules.
+
+#define EXTERNAL_VALUE(external) \
+    (scan_context->externals[(external) - rules->externals_list_head].type != \
+        EXTERNAL_VARIABLE_TYPE_NULL ? \
+     &scan_context->externals[(external) - rules->externals_list_head] : \
+     (external))
+
+
+#define block_contains(block, offset, length) \
+    ((offset) >= (block)->base && \
+     (block)->size >= (length) && \
+     (offset) <= (block)->base + (block)->size - (length))
+
+
+int _yr_execute_compare_blocks(
+    const void* a,
+    const void* b)
+{
+  YR_MEMORY_BLOCK* block_a = *(YR_MEMORY_BLOCK**) a;
+  YR_MEMORY_BLOCK* block_b = *(YR_MEMORY_BLOCK**) b;
+
+  if (block_a->base < block_b->base)
+    return -1;
+
+  if (block_a->base > block_b->base)
+    return 1;
+
+  return 0;
+}
+
+
+//
+// _yr_execute_index_mem_blocks
+//
+// Builds the index of memory blocks sorted by base address in the matches
+// arena. The index is left NULL if there are few blocks, if some of them
+// overlap, or if it can't be allocated, the list is walked in those cases.
+//
+
+void _yr_execute_index_mem_blocks(
+    EVALUATION_CONTEXT* context)
+{
+  YR_MEMORY_BLOCK** index;
+  YR_MEMORY_BLOCK* block = context->mem_block;
+
+  int count = 0;
+  int i;
+
+  while (block != NULL)
+  {
+    count++;
+    block = block->next;
+  }
+
+  context->mem_blocks_count = count;
+
+  if (count < MEM_BLOCKS_INDEX_THRESHOLD || context->matches_arena == NULL)
+    return;
+
+  if (yr_arena_allocate_memory(
+          context->matches_arena,
+          count * sizeof(YR_MEMORY_BLOCK*),
+          (void**) &index) != ERROR_SUCCESS)
+    return;
+
+  block = context->mem_block;
+
+  for (i = 0; i < count; i++)
+  {
+    index[i] = block;
+    block = block->next;
+  }
+
+  qsort(index, count, sizeof(YR_MEMORY_BLOCK*), _yr_execute_compare_blocks);
+
+  // With overlapping blocks the first one in the list containing the data
+  // must be used, which the index can't tell.
+
+  for (i = 1; i < count; i++)
+  {
+    if (index[i]->base < index[i - 1]->base + index[i - 1]->size)
+      return;
+  }
+
+  context->mem_blocks_index = index;
+}
+
+
+//
+// _yr_execute_find_mem_block
+//
+// Returns the memory block containing length bytes at offset, or NULL if
+// no block contains them.
+//
+
+YR_MEMORY_BLOCK* _yr_execute_find_mem_block(
+    EVALUATION_CONTEXT* context,
+    size_t offset,
+    size_t length)
+{
+  YR_MEMORY_BLOCK* block;
+
+  int lo;
+  int hi;
+  int mid;
+
+  block = context->last_mem_block;
+
+  if (block != NULL && block_contains(block, offset, length))
+    return block;
+
+  if (context->mem_blocks_count == 0)
+    _yr_execute_index_mem_blocks(context);
+
+  if (context->mem_blocks_index == NULL)
+  {
+    block = context->mem_block;
+
+    while (block != NULL)
+    {
+      if (block_contains(block, offset, length))
+        return block;
+
+      block = block->next;
+    }
+
+    return NULL;
+  }
+
+  // Look for the last block starting at offset or before.
+
+  lo = 0;
+  hi = context->mem_blocks_count;
+
+  while (lo < hi)
+  {
+    mid = lo + (hi - lo) / 2;
+
+    if (context->mem_blocks_index[mid]->base <= offset)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  if (lo == 0)
+    return NULL;
+
+  block = context->mem_blocks_index[lo - 1];
+
+  if (!block_contains(block, offset, length))
+    return NULL;
+
+  context->last_mem_block = block;
+
+  return block;
+}
+
+
 #define function_read(type) \
-    int64_t read_##type(YR_MEMORY_BLOCK* block, size_t offset) \
+    int64_t read_##type(EVALUATION_CONTEXT* context, size_t offset) \
     { \
-      while (block != NULL) \
-      { \
-        if (offset >= block->base && \
-            block->size >= sizeof(type) && \
-            offset <= block->base + block->size - sizeof(type)) \
-        { \
-          return *((type *) (block->data + offset - block->base)); \
-        } \
-        block = block->next; \
-      } \
-      return UNDEFINED; \
+      YR_MEMORY_BLOCK* block = _yr_execute_find_mem_block( \
+          context, offset, sizeof(type)); \
+      if (block == NULL) \
+        return UNDEFINED; \
+      return *((type *) (block->data + offset - block->base)); \
     };
 
 function_read(uint8_t)
@@ -66,6 +253,135 @@ function_read(int16_t)
 function_read(int32_t)
 
 
+//
+// _yr_execute_popcount
+//
+// Returns the number of bits set in value.
+//
+
+int _yr_execute_popcount(
+    uint64_t value)
+{
+  #if defined(__GNUC__)
+  return __builtin_popcountll(value);
+  #else
+  int count = 0;
+
+  while (value != 0)
+  {
+    value &= value - 1;
+    count++;
+  }
+
+  return count;
+  #endif
+}
+
+
+//
+// _yr_execute_upper_bound
+//
+// Returns the number of leading elements in array which are lower than
+// or equal to value. The array must be in non-decreasing order.
+//
+
+int _yr_execute_upper_bound(
+    int64_t* array,
+    int count,
+    int64_t value)
+{
+  int lo = 0;
+  int hi = count;
+  int mid;
+
+  while (lo < hi)
+  {
+    mid = lo + (hi - lo) / 2;
+
+    if (array[mid] <= value)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+
+//
+// _yr_execute_match_index
+//
+// Returns the index for the matches of a string, building it in the
+// matches arena the first time it's requested. Returns NULL if the
+// string has too few matches to deserve an index or if the index could
+// not be allocated, in which case the list of matches must be walked.
+//
+
+YR_MATCH_INDEX* _yr_execute_match_index(
+    YR_STRING* string,
+    EVALUATION_CONTEXT* context)
+{
+  YR_MATCH_INDEX* index;
+  YR_MATCH* match;
+  YR_MATCHES* matches = &context->scan_context->matches[string->idx];
+
+  int runs_count = 0;
+  int i;
+
+  if (matches->index != NULL)
+    return matches->index;
+
+  if (matches->count < MATCH_INDEX_THRESHOLD ||
+      context->matches_arena == NULL)
+    return NULL;
+
+  match = matches->head;
+
+  while (match != NULL)
+  {
+    runs_count++;
+    match = match->next;
+  }
+
+  if (yr_arena_allocate_memory(
+          context->matches_arena,
+          sizeof(YR_MATCH_INDEX) + (4 * runs_count + 1) * sizeof(int64_t),
+          (void**) &index) != ERROR_SUCCESS)
+    return NULL;
+
+  index->runs_count = runs_count;
+  index->first_offset = (int64_t*) (index + 1);
+  index->max_first_offset = index->first_offset + runs_count;
+  index->max_last_offset = index->max_first_offset + runs_count;
+  index->preceding_matches = index->max_last_offset + runs_count;
+  index->preceding_matches[0] = 0;
+
+  match = matches->head;
+
+  for (i = 0; i < runs_count; i++)
+  {
+    index->first_offset[i] = match->first_offset;
+    index->max_first_offset[i] = match->first_offset;
+    index->max_last_offset[i] = match->last_offset;
+
+    if (i > 0 && index->max_first_offset[i - 1] > match->first_offset)
+      index->max_first_offset[i] = index->max_first_offset[i - 1];
+
+    if (i > 0 && index->max_last_offset[i - 1] > match->last_offset)
+      index->max_last_offset[i] = index->max_last_offset[i - 1];
+
+    index->preceding_matches[i + 1] = index->preceding_matches[i] +
+        match->last_offset - match->first_offset + 1;
+
+    match = match->next;
+  }
+
+  matches->index = index;
+
+  return index;
+}
+
+
 int yr_execute_code(
     YR_RULES* rules,
     EVALUATION_CONTEXT* context)
@@ -81,66 +397,167 @@ int yr_execute_code(
   YR_RULE* rule;
   YR_STRING* string;
   YR_MATCH* match;
+  YR_MATCH_INDEX* index;
+  YR_STRING_SET* string_set;
   YR_EXTERNAL_VARIABLE* external;
+  YR_PROFILING_INFO* profiling_info;
+  YR_RULE_PROFILE* rule_profile;
+
+  YR_SCAN_CONTEXT* scan_context = context->scan_context;
+  YR_MATCHES* matches = scan_context->matches;
+
+  int32_t* rules_flags = scan_context->rules_flags;
+  int32_t* namespaces_flags = scan_context->namespaces_flags;
+
+  uint64_t* matched_strings;
+  uint64_t instructions = 0;
+  uint64_t rule_instructions = 0;
+  uint64_t rule_start_clock = 0;
 
   int i;
   int found;
   int count;
   int result;
   int flags;
-  int tidx = yr_get_tidx();
+  int skip;
+
+  profiling_info = scan_context->profiling_info;
+
+  #ifdef USE_COMPUTED_GOTO
+
+  // Every opcode is first set to op_UNKNOWN and then overridden by the
+  // actual ones, which is intended.
+
+  #pragma GCC diagnostic push
+  #pragma GCC diagnostic ignored "-Woverride-init"
+
+  static const void* dispatch_table[256] = {
+      [0 ... 255] = &&op_UNKNOWN,
+      [HALT] = &&op_HALT,
+      [AND] = &&op_AND,
+      [OR] = &&op_OR,
+      [XOR] = &&op_XOR,
+      [NOT] = &&op_NOT,
+      [LT] = &&op_LT,
+      [GT] = &&op_GT,
+      [LE] = &&op_LE,
+      [GE] = &&op_GE,
+      [EQ] = &&op_EQ,
+      [NEQ] = &&op_NEQ,
+      [ADD] = &&op_ADD,
+      [SUB] = &&op_SUB,
+      [MUL] = &&op_MUL,
+      [DIV] = &&op_DIV,
+      [MOD] = &&op_MOD,
+      [NEG] = &&op_NEG,
+      [SHL] = &&op_SHL,
+      [SHR] = &&op_SHR,
+      [PUSH] = &&op_PUSH,
+      [POP] = &&op_POP,
+      [RULE_PUSH] = &&op_RULE_PUSH,
+      [RULE_POP] = &&op_RULE_POP,
+      [SCOUNT] = &&op_SCOUNT,
+      [SFOUND] = &&op_SFOUND,
+      [SFOUND_AT] = &&op_SFOUND_AT,
+      [SFOUND_IN] = &&op_SFOUND_IN,
+      [SOFFSET] = &&op_SOFFSET,
+      [OF] = &&op_OF,
+      [EXT_BOOL] = &&op_EXT_BOOL,
+      [EXT_INT] = &&op_EXT_INT,
+      [EXT_STR] = &&op_EXT_STR,
+      [INCR_M] = &&op_INCR_M,
+      [CLEAR_M] = &&op_CLEAR_M,
+      [ADD_M] = &&op_ADD_M,
+      [POP_M] = &&op_POP_M,
+      [PUSH_M] = &&op_PUSH_M,
+      [SWAPUNDEF] = &&op_SWAPUNDEF,
+      [JNUNDEF] = &&op_JNUNDEF,
+      [JLE] = &&op_JLE,
+      [SIZE] = &&op_SIZE,
+      [ENTRYPOINT] = &&op_ENTRYPOINT,
+      [INT8] = &&op_INT8,
+      [INT16] = &&op_INT16,
+      [INT32] = &&op_INT32,
+      [UINT8] = &&op_UINT8,
+      [UINT16] = &&op_UINT16,
+      [UINT32] = &&op_UINT32,
+      [CONTAINS] = &&op_CONTAINS,
+      [MATCHES] = &&op_MATCHES,
+      [SFOUND_S] = &&op_SFOUND_S,
+      [SFOUND_AT_S] = &&op_SFOUND_AT_S,
+      [SFOUND_AT_N] = &&op_SFOUND_AT_N,
+      [SFOUND_IN_S] = &&op_SFOUND_IN_S,
+      [SCOUNT_S] = &&op_SCOUNT_S,
+      [SOFFSET_S] = &&op_SOFFSET_S,
+      [RULE_AND] = &&op_RULE_AND,
+      [JFALSE] = &&op_JFALSE,
+      [JTRUE] = &&op_JTRUE,
+      [INIT_RULE] = &&op_INIT_RULE,
+      [OF_MASK] = &&op_OF_MASK,
+  };
+
+  #pragma GCC diagnostic pop
+
+  dispatch();
+
+  #else
 
   while(1)
   {
+    instructions++;
+
     switch(*ip)
     {
-      case HALT:
+
+  #endif
+
+      opcode(HALT):
         // When the halt instruction is reached the stack should be empty.
         assert(sp == 0);
         return ERROR_SUCCESS;
 
-      case PUSH:
+      opcode(PUSH):
         r1 = *(uint64_t*)(ip + 1);
         ip += sizeof(uint64_t);
         push(r1);
-        break;
+        next();
 
-      case POP:
+      opcode(POP):
         pop(r1);
-        break;
+        next();
 
-      case CLEAR_M:
+      opcode(CLEAR_M):
         r1 = *(uint64_t*)(ip + 1);
         ip += sizeof(uint64_t);
         mem[r1] = 0;
-        break;
+        next();
 
-      case ADD_M:
+      opcode(ADD_M):
         r1 = *(uint64_t*)(ip + 1);
         ip += sizeof(uint64_t);
         pop(r2);
         mem[r1] += r2;
-        break;
+        next();
 
-      case INCR_M:
+      opcode(INCR_M):
         r1 = *(uint64_t*)(ip + 1);
         ip += sizeof(uint64_t);
         mem[r1]++;
-        break;
+        next();
 
-      case PUSH_M:
+      opcode(PUSH_M):
         r1 = *(uint64_t*)(ip + 1);
         ip += sizeof(uint64_t);
         push(mem[r1]);
-        break;
+        next();
 
-      case POP_M:
+      opcode(POP_M):
         r1 = *(uint64_t*)(ip + 1);
         ip += sizeof(uint64_t);
         pop(mem[r1]);
-        break;
+        next();
 
-      case SWAPUNDEF:
+      opcode(SWAPUNDEF):
         r1 = *(uint64_t*)(ip + 1);
         ip += sizeof(uint64_t);
         pop(r2);
@@ -148,9 +565,9 @@ int yr_execute_code(
           push(r2);
         else
           push(mem[r1]);
-        break;
+        next();
 
-      case JNUNDEF:
+      opcode(JNUNDEF):
         pop(r1);
         push(r1);
 
@@ -165,9 +582,9 @@ int yr_execute_code(
         {
           ip += sizeof(uint64_t);
         }
-        break;
+        next();
 
-      case JLE:
+      opcode(JLE):
         pop(r2);
         pop(r1);
         push(r1);
@@ -184,168 +601,293 @@ int yr_execute_code(
         {
           ip += sizeof(uint64_t);
         }
-        break;
+        next();
 
-      case AND:
+      opcode(JFALSE):
+        pop(r1);
+        push(r1);
+
+        if (!r1)
+        {
+          ip = *(uint8_t**)(ip + 1);
+          // ip will be incremented by next(), decrement it here
+          // to compensate.
+          ip--;
+        }
+        else
+        {
+          ip += sizeof(uint64_t);
+        }
+        next();
+
+      opcode(JTRUE):
+        pop(r1);
+        push(r1);
+
+        if (r1)
+        {
+          ip = *(uint8_t**)(ip + 1);
+          // ip will be incremented by next(), decrement it here
+          // to compensate.
+          ip--;
+        }
+        else
+        {
+          ip += sizeof(uint64_t);
+        }
+        next();
+
+      opcode(AND):
         pop(r2);
         pop(r1);
         push(r1 & r2);
-        break;
+        next();
 
-      case OR:
+      opcode(OR):
         pop(r2);
         pop(r1);
         push(r1 | r2);
-        break;
+        next();
 
-      case NOT:
+      opcode(NOT):
         pop(r1);
         push(!r1);
-        break;
+        next();
 
-      case LT:
+      opcode(LT):
         pop(r2);
         pop(r1);
         push(comparison(<, r1, r2));
-        break;
+        next();
 
-      case GT:
+      opcode(GT):
         pop(r2);
         pop(r1);
         push(comparison(>, r1, r2));
-        break;
+        next();
 
-      case LE:
+      opcode(LE):
         pop(r2);
         pop(r1);
         push(comparison(<=, r1, r2));
-        break;
+        next();
 
-      case GE:
+      opcode(GE):
         pop(r2);
         pop(r1);
         push(comparison(>=, r1, r2));
-        break;
+        next();
 
-      case EQ:
+      opcode(EQ):
         pop(r2);
         pop(r1);
         push(comparison(==, r1, r2));
-        break;
+        next();
 
-      case NEQ:
+      opcode(NEQ):
         pop(r2);
         pop(r1);
         push(comparison(!=, r1, r2));
-        break;
+        next();
 
-      case ADD:
+      opcode(ADD):
         pop(r2);
         pop(r1);
         push(operation(+, r1, r2));
-        break;
+        next();
 
-      case SUB:
+      opcode(SUB):
         pop(r2);
         pop(r1);
         push(operation(-, r1, r2));
-        break;
+        next();
 
-      case MUL:
+      opcode(MUL):
         pop(r2);
         pop(r1);
         push(operation(*, r1, r2));
-        break;
+        next();
 
-      case DIV:
+      opcode(DIV):
         pop(r2);
         pop(r1);
         push(operation(/, r1, r2));
-        break;
+        next();
 
-      case MOD:
+      opcode(MOD):
         pop(r2);
         pop(r1);
         push(operation(%, r1, r2));
-        break;
+        next();
 
-      case NEG:
+      opcode(NEG):
         pop(r1);
         push(IS_UNDEFINED(r1) ? UNDEFINED : ~r1);
-        break;
+        next();
 
-      case SHR:
+      opcode(SHR):
         pop(r2);
         pop(r1);
         push(operation(>>, r1, r2));
-        break;
+        next();
 
-      case SHL:
+      opcode(SHL):
         pop(r2);
         pop(r1);
         push(operation(<<, r1, r2));
-        break;
+        next();
 
-      case XOR:
+      opcode(XOR):
         pop(r2);
         pop(r1);
         push(operation(^, r1, r2));
-        break;
+        next();
 
-      case RULE_PUSH:
+      opcode(INIT_RULE):
+        rule = *(YR_RULE**)(ip + 1);
+
+        // Go straight to the next rule if this one belongs to another
+        // stage, if a global rule of its namespace failed, or if none of
+        // its strings matched and its condition is known to be false
+        // without them.
+
+        if (context->stage == EVALUATION_STAGE_EARLY_GLOBALS)
+          skip = !RULE_IS_EARLY_GLOBAL(rule);
+        else
+          skip = RULE_IS_EARLY_GLOBAL(rule) ||
+              (namespaces_flags[rule->ns->idx] &
+                  NAMESPACE_TFLAGS_UNSATISFIED_GLOBAL) ||
+              (RULE_REQUIRES_STRINGS(rule) &&
+               !(rules_flags[rule->idx] & RULE_TFLAGS_DIRTY));
+
+        if (skip)
+        {
+          ip = *(uint8_t**)(ip + 1 + sizeof(uint64_t));
+          dispatch();
+        }
+
+        ip += 2 * sizeof(uint64_t);
+
+        if (profiling_info != NULL)
+        {
+          rule_instructions = instructions;
+          rule_start_clock = PROFILING_CLOCK();
+        }
+
+        next();
+
+      opcode(RULE_PUSH):
         rule = *(YR_RULE**)(ip + 1);
         ip += sizeof(uint64_t);
-        push(rule->t_flags[tidx] & RULE_TFLAGS_MATCH ? 1 : 0);
-        break;
+        push(rules_flags[rule->idx] & RULE_TFLAGS_MATCH ? 1 : 0);
+        next();
 
-      case RULE_POP:
+      opcode(RULE_AND):
+        rule = *(YR_RULE**)(ip + 1);
+        ip += sizeof(uint64_t);
+        pop(r1);
+        push(r1 & (rules_flags[rule->idx] & RULE_TFLAGS_MATCH ? 1 : 0));
+        next();
+
+      opcode(RULE_POP):
         pop(r1);
         rule = *(YR_RULE**)(ip + 1);
         ip += sizeof(uint64_t);
         if (r1)
-          rule->t_flags[tidx] |= RULE_TFLAGS_MATCH;
-        break;
+        {
+          if (rules_flags[rule->idx] == 0)
+            scan_context->dirty_rules[scan_context->dirty_rules_count++] =
+                rule->idx;
 
-      case EXT_INT:
+          rules_flags[rule->idx] |= RULE_TFLAGS_MATCH;
+        }
+
+        if (profiling_info != NULL)
+        {
+          rule_profile = &profiling_info->rules[rule->idx];
+          rule_profile->instructions += instructions - rule_instructions;
+          rule_profile->cycles += PROFILING_CLOCK() - rule_start_clock;
+        }
+
+        next();
+
+      opcode(EXT_INT):
         external = *(YR_EXTERNAL_VARIABLE**)(ip + 1);
+        external = EXTERNAL_VALUE(external);
         ip += sizeof(uint64_t);
         push(external->integer);
-        break;
+        next();
 
-      case EXT_STR:
+      opcode(EXT_STR):
         external = *(YR_EXTERNAL_VARIABLE**)(ip + 1);
+        external = EXTERNAL_VALUE(external);
         ip += sizeof(uint64_t);
         push(PTR_TO_UINT64(external->string));
-        break;
+        next();
 
-      case EXT_BOOL:
+      opcode(EXT_BOOL):
         external = *(YR_EXTERNAL_VARIABLE**)(ip + 1);
+        external = EXTERNAL_VALUE(external);
         ip += sizeof(uint64_t);
         if (external->type == EXTERNAL_VARIABLE_TYPE_FIXED_STRING ||
             external->type == EXTERNAL_VARIABLE_TYPE_MALLOC_STRING)
           push(strlen(external->string) > 0);
         else
           push(external->integer);
-        break;
+        next();
 
-      case SFOUND:
+      opcode(SFOUND):
         pop(r1);
         string = UINT64_TO_PTR(YR_STRING*, r1);
-        push(string->matches[tidx].tail != NULL ? 1 : 0);
-        break;
+        push(matches[string->idx].tail != NULL ? 1 : 0);
+        next();
 
-      case SFOUND_AT:
+      opcode(SFOUND_S):
+        string = *(YR_STRING**)(ip + 1);
+        ip += sizeof(uint64_t);
+        push(matches[string->idx].tail != NULL ? 1 : 0);
+        next();
+
+      opcode(SFOUND_AT_S):
+        r2 = *(uint64_t*)(ip + 1);
+        ip += sizeof(uint64_t);
+        pop(r1);
+        goto _sfound_at;
+
+      opcode(SFOUND_AT_N):
+        r1 = *(uint64_t*)(ip + 1);
+        r2 = *(uint64_t*)(ip + 1 + sizeof(uint64_t));
+        ip += 2 * sizeof(uint64_t);
+        goto _sfound_at;
+
+      opcode(SFOUND_AT):
         pop(r2);
         pop(r1);
 
+      _sfound_at:
+
         if (IS_UNDEFINED(r1))
         {
           push(0);
-          break;
+          next();
         }
 
         string = UINT64_TO_PTR(YR_STRING*, r2);
-        match = string->matches[tidx].head;
+        index = _yr_execute_match_index(string, context);
+
+        if (index != NULL)
+        {
+          // Only runs before the first one starting after r1 can contain
+          // it, and any of them does if it ends at r1 or later.
+
+          i = _yr_execute_upper_bound(
+              index->max_first_offset, index->runs_count, r1);
+
+          push(i > 0 && index->max_last_offset[i - 1] >= r1);
+          next();
+        }
+
+        match = matches[string->idx].head;
         found = 0;
 
         while (match != NULL)
@@ -366,21 +908,44 @@ int yr_execute_code(
         if (!found)
           push(0);
 
-        break;
+        next();
 
-      case SFOUND_IN:
-        pop(r3);
+      opcode(SFOUND_IN_S):
+        r3 = *(uint64_t*)(ip + 1);
+        ip += sizeof(uint64_t);
         pop(r2);
         pop(r1);
+        goto _sfound_in;
 
-        if (IS_UNDEFINED(r1) || IS_UNDEFINED(r2))
+      opcode(SFOUND_IN):
+        pop(r3);
+        pop(r2);
+        pop(r1);
+
+      _sfound_in:
+
+        if (IS_UNDEFINED(r1) || IS_UNDEFINED(r2))
         {
           push(0);
-          break;
+          next();
         }
 
         string = UINT64_TO_PTR(YR_STRING*, r3);
-        match = string->matches[tidx].head;
+        index = NULL;
+
+        if (r1 <= r2)
+          index = _yr_execute_match_index(string, context);
+
+        if (index != NULL)
+        {
+          i = _yr_execute_upper_bound(
+              index->max_first_offset, index->runs_count, r2);
+
+          push(i > 0 && index->max_last_offset[i - 1] >= r1);
+          next();
+        }
+
+        match = matches[string->idx].head;
         found = FALSE;
 
         while (match != NULL && !found)
@@ -402,33 +967,63 @@ int yr_execute_code(
         if (!found)
           push(0);
 
-        break;
+        next();
 
-      case SCOUNT:
+      opcode(SCOUNT_S):
+        r1 = *(uint64_t*)(ip + 1);
+        ip += sizeof(uint64_t);
+        goto _scount;
+
+      opcode(SCOUNT):
         pop(r1);
+
+      _scount:
         string = UINT64_TO_PTR(YR_STRING*, r1);
-        match = string->matches[tidx].head;
-        found = 0;
-        while (match != NULL)
-        {
-          found += match->last_offset - match->first_offset + 1;
-          match = match->next;
-        }
-        push(found);
-        break;
+        push(matches[string->idx].count);
+        next();
 
-      case SOFFSET:
+      opcode(SOFFSET_S):
+        r2 = *(uint64_t*)(ip + 1);
+        ip += sizeof(uint64_t);
+        pop(r1);
+        goto _soffset;
+
+      opcode(SOFFSET):
         pop(r2);
         pop(r1);
 
+      _soffset:
+
         if (IS_UNDEFINED(r1))
         {
           push(UNDEFINED);
-          break;
+          next();
         }
 
         string = UINT64_TO_PTR(YR_STRING*, r2);
-        match = string->matches[tidx].head;
+        index = _yr_execute_match_index(string, context);
+
+        if (index != NULL)
+        {
+          // Find the last run preceded by less than r1 matches, the r1-th
+          // match is in that run if the run is long enough.
+
+          i = 0;
+
+          if (r1 >= 1)
+            i = _yr_execute_upper_bound(
+                index->preceding_matches, index->runs_count, r1 - 1);
+
+          if (i > 0 && r1 <= index->preceding_matches[i])
+            push(index->first_offset[i - 1] +
+                 r1 - index->preceding_matches[i - 1] - 1);
+          else
+            push(UNDEFINED);
+
+          next();
+        }
+
+        match = matches[string->idx].head;
         i = 1;
         found = FALSE;
 
@@ -448,9 +1043,9 @@ int yr_execute_code(
         if (!found)
           push(UNDEFINED);
 
-        break;
+        next();
 
-      case OF:
+      opcode(OF):
         found = 0;
         count = 0;
         pop(r1);
@@ -458,7 +1053,7 @@ int yr_execute_code(
         while (r1 != UNDEFINED)
         {
           string = UINT64_TO_PTR(YR_STRING*, r1);
-          if (string->matches[tidx].tail != NULL)
+          if (matches[string->idx].tail != NULL)
             found++;
           count++;
           pop(r1);
@@ -471,54 +1066,75 @@ int yr_execute_code(
         else
           push(found >= count ? 1 : 0);
 
-        break;
+        next();
 
-      case SIZE:
+      opcode(OF_MASK):
+        string_set = *(YR_STRING_SET**)(ip + 1);
+        ip += sizeof(uint64_t);
+        pop(r2);
+
+        matched_strings = scan_context->matched_strings +
+            string_set->first_word;
+
+        found = 0;
+
+        for (i = 0; i < string_set->words; i++)
+          found += _yr_execute_popcount(
+              matched_strings[i] & string_set->mask[i]);
+
+        if (r2 != UNDEFINED)
+          push(found >= r2 ? 1 : 0);
+        else
+          push(found >= string_set->count ? 1 : 0);
+
+        next();
+
+      opcode(SIZE):
         push(context->file_size);
-        break;
+        next();
 
-      case ENTRYPOINT:
+      opcode(ENTRYPOINT):
         push(context->entry_point);
-        break;
+        next();
 
-      case INT8:
+      opcode(INT8):
         pop(r1);
-        push(read_int8_t(context->mem_block, r1));
-        break;
+        push(read_int8_t(context, r1));
+        next();
 
-      case INT16:
+      opcode(INT16):
         pop(r1);
-        push(read_int16_t(context->mem_block, r1));
-        break;
+        push(read_int16_t(context, r1));
+        next();
 
-      case INT32:
+      opcode(INT32):
         pop(r1);
-        push(read_int32_t(context->mem_block, r1));
-        break;
+        push(read_int32_t(context, r1));
+        next();
 
-      case UINT8:
+      opcode(UINT8):
         pop(r1);
-        push(read_uint8_t(context->mem_block, r1));
-        break;
+        push(read_uint8_t(context, r1));
+        next();
 
-      case UINT16:
+      opcode(UINT16):
         pop(r1);
-        push(read_uint16_t(context->mem_block, r1));
-        break;
+        push(read_uint16_t(context, r1));
+        next();
 
-      case UINT32:
+      opcode(UINT32):
         pop(r1);
-        push(read_uint32_t(context->mem_block, r1));
-        break;
+        push(read_uint32_t(context, r1));
+        next();
 
-      case CONTAINS:
+      opcode(CONTAINS):
         pop(r2);
         pop(r1);
         push(strstr(UINT64_TO_PTR(char*, r1),
                     UINT64_TO_PTR(char*, r2)) != NULL);
-        break;
+        next();
 
-      case MATCHES:
+      opcode(MATCHES):
         pop(r3);
         pop(r2);
         pop(r1);
@@ -529,7 +1145,7 @@ int yr_execute_code(
         if (count == 0)
         {
           push(FALSE);
-          break;
+          next();
         }
 
         result = yr_re_exec(
@@ -537,20 +1153,554 @@ int yr_execute_code(
           UINT64_TO_PTR(uint8_t*, r1),
           count,
           flags | RE_FLAGS_SCAN,
+          &rules->re_limits,
+          &scan_context->re_stats,
           NULL,
           NULL);
 
         push(result >= 0);
-        break;
+        next();
 
+  #ifdef USE_COMPUTED_GOTO
+      op_UNKNOWN:
+  #else
       default:
+  #endif
         // Unknown instruction, this shouldn't happen.
         assert(FALSE);
-    }
+        next();
 
-    ip++;
+  #ifndef USE_COMPUTED_GOTO
+    }
   }
+  #endif
 
   // After executing the code the stack should be empty.
   assert(sp == 0);
-}
\ No newline at end of file
+}
+
+
+#define ANALYSIS_STACK_SIZE   64
+#define ANALYSIS_MAX_PATHS    32
+#define ANALYSIS_MAX_STEPS    4096
+
+
+typedef struct _ANALYSIS_VALUE
+{
+  int known;
+  int64_t value;
+
+} ANALYSIS_VALUE;
+
+
+typedef struct _ANALYSIS_PATH
+{
+  uint8_t* ip;
+  int32_t sp;
+  ANALYSIS_VALUE stack[ANALYSIS_STACK_SIZE];
+  ANALYSIS_VALUE mem[MEM_SIZE];
+
+} ANALYSIS_PATH;
+
+
+#define a_push(k, v) \
+    do { \
+      if (path->sp == ANALYSIS_STACK_SIZE) return FALSE; \
+      path->stack[path->sp].known = (k); \
+      path->stack[path->sp].value = (v); \
+      path->sp++; \
+    } while(0)
+
+
+#define a_push_known(v)   a_push(TRUE, v)
+#define a_push_unknown()  a_push(FALSE, 0)
+
+
+#define a_pop(x) \
+    do { \
+      if (path->sp == 0) return FALSE; \
+      x = path->stack[--path->sp]; \
+    } while(0)
+
+
+#define a_mem_index(x) \
+    do { \
+      x = *(uint64_t*)(path->ip + 1); \
+      path->ip += sizeof(uint64_t); \
+      if (x < 0 || x >= MEM_SIZE) return FALSE; \
+    } while(0)
+
+
+#define a_binary(expression) \
+    do { \
+      a_pop(v2); \
+      a_pop(v1); \
+      if (v1.known && v2.known) \
+        a_push_known(expression); \
+      else \
+        a_push_unknown(); \
+    } while(0)
+
+
+#define a_comparison(operator) \
+    do { \
+      a_pop(v2); \
+      a_pop(v1); \
+      if ((v1.known && IS_UNDEFINED(v1.value)) || \
+          (v2.known && IS_UNDEFINED(v2.value))) \
+        a_push_known(0); \
+      else if (v1.known && v2.known) \
+        a_push_known(v1.value operator v2.value); \
+      else \
+        a_push_unknown(); \
+    } while(0)
+
+
+#define a_fork() \
+    do { \
+      if (paths_count == ANALYSIS_MAX_PATHS) return FALSE; \
+      paths[paths_count] = *path; \
+      fork = &paths[paths_count++]; \
+    } while(0)
+
+
+//
+// _yr_execute_analyze_rule
+//
+// Evaluates the code of a rule condition, starting at code, as if none of
+// the rule's strings had matched. Values not depending on strings, like
+// filesize or external variables, are unknown. Returns TRUE only if the
+// condition is false through every possible path, FALSE if it could be
+// true or the analysis gave up.
+//
+
+int _yr_execute_analyze_rule(
+    uint8_t* code)
+{
+  ANALYSIS_PATH paths[ANALYSIS_MAX_PATHS];
+  ANALYSIS_PATH* path;
+  ANALYSIS_PATH* fork;
+  ANALYSIS_VALUE v1;
+  ANALYSIS_VALUE v2;
+
+  int64_t r1;
+  int paths_count = 1;
+  int steps = 0;
+  int count;
+  int i;
+
+  paths[0].ip = code;
+  paths[0].sp = 0;
+
+  for (i = 0; i < MEM_SIZE; i++)
+    paths[0].mem[i].known = FALSE;
+
+  while (paths_count > 0)
+  {
+    path = &paths[paths_count - 1];
+
+    if (++steps > ANALYSIS_MAX_STEPS)
+      return FALSE;
+
+    switch(*path->ip)
+    {
+      case PUSH:
+        r1 = *(uint64_t*)(path->ip + 1);
+        path->ip += sizeof(uint64_t);
+        a_push_known(r1);
+        break;
+
+      case POP:
+        a_pop(v1);
+        break;
+
+      case CLEAR_M:
+        a_mem_index(r1);
+        path->mem[r1].known = TRUE;
+        path->mem[r1].value = 0;
+        break;
+
+      case ADD_M:
+        a_mem_index(r1);
+        a_pop(v1);
+        path->mem[r1].known = path->mem[r1].known && v1.known;
+        path->mem[r1].value += v1.value;
+        break;
+
+      case INCR_M:
+        a_mem_index(r1);
+        path->mem[r1].value++;
+        break;
+
+      case PUSH_M:
+        a_mem_index(r1);
+        a_push(path->mem[r1].known, path->mem[r1].value);
+        break;
+
+      case POP_M:
+        a_mem_index(r1);
+        a_pop(path->mem[r1]);
+        break;
+
+      case SWAPUNDEF:
+        a_mem_index(r1);
+        a_pop(v1);
+        if (!v1.known)
+          a_push_unknown();
+        else if (v1.value != UNDEFINED)
+          a_push_known(v1.value);
+        else
+          a_push(path->mem[r1].known, path->mem[r1].value);
+        break;
+
+      case JNUNDEF:
+        if (path->sp < 1)
+          return FALSE;
+
+        v1 = path->stack[path->sp - 1];
+
+        if (!v1.known)
+        {
+          a_fork();
+          fork->ip += 1 + sizeof(uint64_t);
+          path->ip = *(uint8_t**)(path->ip + 1);
+          continue;
+        }
+
+        if (v1.value != UNDEFINED)
+        {
+          path->ip = *(uint8_t**)(path->ip + 1);
+          continue;
+        }
+
+        path->ip += sizeof(uint64_t);
+        break;
+
+      case JLE:
+        if (path->sp < 2)
+          return FALSE;
+
+        v1 = path->stack[path->sp - 2];
+        v2 = path->stack[path->sp - 1];
+
+        if (!v1.known || !v2.known)
+        {
+          a_fork();
+          fork->ip += 1 + sizeof(uint64_t);
+          path->ip = *(uint8_t**)(path->ip + 1);
+          continue;
+        }
+
+        if (v1.value <= v2.value)
+        {
+          path->ip = *(uint8_t**)(path->ip + 1);
+          continue;
+        }
+
+        path->ip += sizeof(uint64_t);
+        break;
+
+      case JFALSE:
+      case JTRUE:
+        if (path->sp < 1)
+          return FALSE;
+
+        v1 = path->stack[path->sp - 1];
+
+        if (!v1.known)
+        {
+          // Both ways are possible. Where the value was tested to be
+          // false it becomes known.
+          a_fork();
+          fork->ip += 1 + sizeof(uint64_t);
+
+          if (*path->ip == JFALSE)
+            path->stack[path->sp - 1].known = TRUE;
+          else
+            fork->stack[fork->sp - 1].known = TRUE;
+
+          path->stack[path->sp - 1].value = 0;
+          fork->stack[fork->sp - 1].value = 0;
+          path->ip = *(uint8_t**)(path->ip + 1);
+          continue;
+        }
+
+        if ((*path->ip == JFALSE) == (v1.value == 0))
+        {
+          path->ip = *(uint8_t**)(path->ip + 1);
+          continue;
+        }
+
+        path->ip += sizeof(uint64_t);
+        break;
+
+      case AND:
+        a_pop(v2);
+        a_pop(v1);
+        if ((v1.known && v1.value == 0) || (v2.known && v2.value == 0))
+          a_push_known(0);
+        else if (v1.known && v2.known)
+          a_push_known(v1.value & v2.value);
+        else
+          a_push_unknown();
+        break;
+
+      case OR:
+        a_binary(v1.value | v2.value);
+        break;
+
+      case NOT:
+        a_pop(v1);
+        a_push(v1.known, !v1.value);
+        break;
+
+      case LT:
+        a_comparison(<);
+        break;
+
+      case GT:
+        a_comparison(>);
+        break;
+
+      case LE:
+        a_comparison(<=);
+        break;
+
+      case GE:
+        a_comparison(>=);
+        break;
+
+      case EQ:
+        a_comparison(==);
+        break;
+
+      case NEQ:
+        a_comparison(!=);
+        break;
+
+      case ADD:
+        a_binary(operation(+, v1.value, v2.value));
+        break;
+
+      case SUB:
+        a_binary(operation(-, v1.value, v2.value));
+        break;
+
+      case MUL:
+        a_binary(operation(*, v1.value, v2.value));
+        break;
+
+      case DIV:
+      case MOD:
+        a_pop(v2);
+        a_pop(v1);
+        // Don't evaluate divisions that would trap.
+        if (v1.known && v2.known && v2.value != 0 && v2.value != -1)
+          a_push_known(*path->ip == DIV ?
+              operation(/, v1.value, v2.value) :
+              operation(%, v1.value, v2.value));
+        else
+          a_push_unknown();
+        break;
+
+      case NEG:
+        a_pop(v1);
+        a_push(v1.known, IS_UNDEFINED(v1.value) ? UNDEFINED : ~v1.value);
+        break;
+
+      case SHR:
+        a_binary(operation(>>, v1.value, v2.value));
+        break;
+
+      case SHL:
+        a_binary(operation(<<, v1.value, v2.value));
+        break;
+
+      case XOR:
+        a_binary(operation(^, v1.value, v2.value));
+        break;
+
+      case RULE_PUSH:
+      case EXT_INT:
+      case EXT_STR:
+      case EXT_BOOL:
+        path->ip += sizeof(uint64_t);
+        a_push_unknown();
+        break;
+
+      case RULE_AND:
+        path->ip += sizeof(uint64_t);
+        a_pop(v1);
+        a_push(v1.known && v1.value == 0, 0);
+        break;
+
+      case RULE_POP:
+        a_pop(v1);
+
+        if (!v1.known || v1.value != 0)
+          return FALSE;
+
+        // This path ends with the rule not matching, continue with
+        // the remaining ones.
+        paths_count--;
+        continue;
+
+      // Without matches strings are never found, their count is zero
+      // and their offsets undefined.
+
+      case SFOUND_S:
+      case SCOUNT_S:
+        path->ip += sizeof(uint64_t);
+        a_push_known(0);
+        break;
+
+      case SFOUND_AT_N:
+        path->ip += 2 * sizeof(uint64_t);
+        a_push_known(0);
+        break;
+
+      case SFOUND_AT_S:
+        path->ip += sizeof(uint64_t);
+        a_pop(v1);
+        a_push_known(0);
+        break;
+
+      case SFOUND_IN_S:
+        path->ip += sizeof(uint64_t);
+        a_pop(v1);
+        a_pop(v1);
+        a_push_known(0);
+        break;
+
+      case SFOUND:
+      case SCOUNT:
+        a_pop(v1);
+        a_push_known(0);
+        break;
+
+      case SFOUND_AT:
+        a_pop(v1);
+        a_pop(v1);
+        a_push_known(0);
+        break;
+
+      case SFOUND_IN:
+        a_pop(v1);
+        a_pop(v1);
+        a_pop(v1);
+        a_push_known(0);
+        break;
+
+      case SOFFSET_S:
+        path->ip += sizeof(uint64_t);
+        a_pop(v1);
+        a_push_known(UNDEFINED);
+        break;
+
+      case SOFFSET:
+        a_pop(v1);
+        a_pop(v1);
+        a_push_known(UNDEFINED);
+        break;
+
+      case OF:
+        count = 0;
+        a_pop(v1);
+
+        while (!v1.known || v1.value != UNDEFINED)
+        {
+          if (!v1.known)
+            return FALSE;
+
+          count++;
+          a_pop(v1);
+        }
+
+        a_pop(v2);
+
+        if (!v2.known)
+          a_push_unknown();
+        else if (v2.value != UNDEFINED)
+          a_push_known(0 >= v2.value ? 1 : 0);
+        else
+          a_push_known(0 >= count ? 1 : 0);
+        break;
+
+      case OF_MASK:
+        count = (*(YR_STRING_SET**)(path->ip + 1))->count;
+        path->ip += sizeof(uint64_t);
+        a_pop(v2);
+
+        if (!v2.known)
+          a_push_unknown();
+        else if (v2.value != UNDEFINED)
+          a_push_known(0 >= v2.value ? 1 : 0);
+        else
+          a_push_known(0 >= count ? 1 : 0);
+        break;
+
+      case SIZE:
+      case ENTRYPOINT:
+        a_push_unknown();
+        break;
+
+      case INT8:
+      case INT16:
+      case INT32:
+      case UINT8:
+      case UINT16:
+      case UINT32:
+        a_pop(v1);
+        a_push_unknown();
+        break;
+
+      case CONTAINS:
+        a_pop(v1);
+        a_pop(v1);
+        a_push_unknown();
+        break;
+
+      case MATCHES:
+        a_pop(v1);
+        a_pop(v1);
+        a_pop(v1);
+        a_push_unknown();
+        break;
+
+      default:
+        return FALSE;
+    }
+
+    path->ip++;
+  }
+
+  return TRUE;
+}
+
+
+//
+// yr_execute_analyze_code
+//
+// Looks for rules whose condition can't be true unless some of their
+// strings matched, and marks them with RULE_GFLAGS_REQUIRE_STRINGS. At
+// scan time the INIT_RULE instruction skips the condition of such rules
+// when none of their strings was found. The code must be contiguous in
+// memory.
+//
+
+void yr_execute_analyze_code(
+    uint8_t* code)
+{
+  YR_RULE* rule;
+  uint8_t* ip = code;
+
+  while (*ip == INIT_RULE)
+  {
+    rule = *(YR_RULE**)(ip + 1);
+
+    if (_yr_execute_analyze_rule(ip + 1 + 2 * sizeof(uint64_t)))
+      rule->g_flags |= RULE_GFLAGS_REQUIRE_STRINGS;
+
+    ip = *(uint8_t**)(ip + 1 + sizeof(uint64_t));
+  }
+}
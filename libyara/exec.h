@@ -23,6 +23,18 @@ limitations under the License.
 #define UNDEFINED           0xFABADAFABADALL
 #define IS_UNDEFINED(x)     ((x) == UNDEFINED)
 
+// Time stamp used for profiling. CPU cycles are counted where the compiler
+// provides a way of reading them, clock ticks are used otherwise.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PROFILING_CLOCK()   ((uint64_t) __builtin_ia32_rdtsc())
+#else
+#include <time.h>
+#define PROFILING_CLOCK()   ((uint64_t) clock())
+#endif
+
+#define STRING_PROFILE(info, string)  (&(info)->strings[(string)->idx])
+
 #define HALT        255
 
 #define AND         4
@@ -75,13 +87,67 @@ limitations under the License.
 #define CONTAINS    51
 #define MATCHES     52
 
+// Superinstructions. These are emitted by the compiler in place of common
+// instruction sequences. The string (and the offset in SFOUND_AT_N) are
+// immediate arguments instead of being pushed in the stack.
+//
+//   SFOUND_S     = PUSH string; SFOUND
+//   SFOUND_AT_S  = PUSH string; SFOUND_AT
+//   SFOUND_AT_N  = PUSH offset; PUSH string; SFOUND_AT
+//   SFOUND_IN_S  = PUSH string; SFOUND_IN
+//   SCOUNT_S     = PUSH string; SCOUNT
+//   SOFFSET_S    = PUSH string; SOFFSET
+//   RULE_AND     = RULE_PUSH rule; AND
+
+#define SFOUND_S    53
+#define SFOUND_AT_S 54
+#define SFOUND_AT_N 55
+#define SFOUND_IN_S 56
+#define SCOUNT_S    57
+#define SOFFSET_S   58
+#define RULE_AND    59
+
+// Conditional jumps used for short-circuit evaluation of "and" and "or".
+// The value at the top of the stack is left untouched.
+
+#define JFALSE      60
+#define JTRUE       61
+
+// First instruction of every rule's condition. Arguments are the rule and
+// the address of the next rule's code, where execution jumps if the rule
+// can't match because none of the strings it requires was found.
+
+#define INIT_RULE   62
+
+// "N of" over a set of strings known at compile time. The argument is a
+// YR_STRING_SET, the quantifier is at the top of the stack.
+
+#define OF_MASK     63
+
+
+// Rules are evaluated in two stages: global rules which can be evaluated
+// before scanning (see RULE_IS_EARLY_GLOBAL) and then all the others.
+
+#define EVALUATION_STAGE_EARLY_GLOBALS    1
+#define EVALUATION_STAGE_REMAINING_RULES  2
+
 
 typedef struct _EVALUATION_CONTEXT
 {
   uint64_t  file_size;
   uint64_t  entry_point;
+  int       stage;
 
+  YR_SCAN_CONTEXT*   scan_context;
   YR_MEMORY_BLOCK*   mem_block;
+  YR_ARENA*          matches_arena;
+
+  // Memory blocks sorted by base address, built on the first read from
+  // memory if there are many of them, and the last block read from.
+
+  YR_MEMORY_BLOCK**  mem_blocks_index;
+  int                mem_blocks_count;
+  YR_MEMORY_BLOCK*   last_mem_block;
 
 } EVALUATION_CONTEXT;
 
@@ -90,5 +156,9 @@ int yr_execute_code(
     YR_RULES* rules,
     EVALUATION_CONTEXT* context);
 
+
+void yr_execute_analyze_code(
+    uint8_t* code);
+
 #endif
 
@@ -1,14 +1,14 @@
-/* A Bison parser, made by GNU Bison 2.3.  */
+/* A Bison parser, made by GNU Bison 3.8.2.  */
 
-/* Skeleton implementation for Bison's Yacc-like parsers in C
+/* Bison implementation for Yacc-like parsers in C
 
-   Copyright (C) 1984, 1989, 1990, 2000, 2001, 2002, 2003, 2004, 2005, 2006
-   Free Software Foundation, Inc.
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
 
-   This program is free software; you can redistribute it and/or modify
+   This program is free software: you can redistribute it and/or modify
    it under the terms of the GNU General Public License as published by
-   the Free Software Foundation; either version 2, or (at your option)
-   any later version.
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
 
    This program is distributed in the hope that it will be useful,
    but WITHOUT ANY WARRANTY; without even the implied warranty of
@@ -16,9 +16,7 @@
    GNU General Public License for more details.
 
    You should have received a copy of the GNU General Public License
-   along with this program; if not, write to the Free Software
-   Foundation, Inc., 51 Franklin Street, Fifth Floor,
-   Boston, MA 02110-1301, USA.  */
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 /* As a special exception, you may create a larger work that contains
    part or all of the Bison parser skeleton and distribute that work
@@ -36,6 +34,10 @@
 /* C LALR(1) parser skeleton written by Richard Stallman, by
    simplifying the original so-called "semantic" parser.  */
 
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
 /* All symbols defined below should begin with yy or YY, to avoid
    infringing on user name space.  This should be done even for local
    variables, as they might otherwise be expanded by user macros.
@@ -43,11 +45,11 @@
    define necessary library symbols; they are noted "INFRINGES ON
    USER NAME SPACE" below.  */
 
-/* Identify Bison output.  */
-#define YYBISON 1
+/* Identify Bison output, and Bison version.  */
+#define YYBISON 30802
 
-/* Bison version.  */
-#define YYBISON_VERSION "2.3"
+/* Bison version string.  */
+#define YYBISON_VERSION "3.8.2"
 
 /* Skeleton name.  */
 #define YYSKELETON_NAME "yacc.c"
@@ -55,155 +57,21 @@
 /* Pure parsers.  */
 #define YYPURE 1
 
-/* Using locations.  */
-#define YYLSP_NEEDED 0
+/* Push parsers.  */
+#define YYPUSH 0
+
+/* Pull parsers.  */
+#define YYPULL 1
+
 
 /* Substitute the variable and function names.  */
-#define yyparse yara_yyparse
-#define yylex   yara_yylex
-#define yyerror yara_yyerror
-#define yylval  yara_yylval
-#define yychar  yara_yychar
-#define yydebug yara_yydebug
-#define yynerrs yara_yynerrs
-
-
-/* Tokens.  */
-#ifndef YYTOKENTYPE
-# define YYTOKENTYPE
-   /* Put the tokens into the symbol table, so that GDB and other debuggers
-      know about them.  */
-   enum yytokentype {
-     _RULE_ = 258,
-     _PRIVATE_ = 259,
-     _GLOBAL_ = 260,
-     _META_ = 261,
-     _STRINGS_ = 262,
-     _CONDITION_ = 263,
-     _END_ = 264,
-     _IDENTIFIER_ = 265,
-     _STRING_IDENTIFIER_ = 266,
-     _STRING_COUNT_ = 267,
-     _STRING_OFFSET_ = 268,
-     _STRING_IDENTIFIER_WITH_WILDCARD_ = 269,
-     _ANONYMOUS_STRING_ = 270,
-     _NUMBER_ = 271,
-     _UNKNOWN_ = 272,
-     _TEXTSTRING_ = 273,
-     _HEXSTRING_ = 274,
-     _REGEXP_ = 275,
-     _ASCII_ = 276,
-     _WIDE_ = 277,
-     _NOCASE_ = 278,
-     _FULLWORD_ = 279,
-     _AT_ = 280,
-     _SIZE_ = 281,
-     _ENTRYPOINT_ = 282,
-     _ALL_ = 283,
-     _ANY_ = 284,
-     _RVA_ = 285,
-     _OFFSET_ = 286,
-     _FILE_ = 287,
-     _IN_ = 288,
-     _OF_ = 289,
-     _FOR_ = 290,
-     _THEM_ = 291,
-     _SECTION_ = 292,
-     _INT8_ = 293,
-     _INT16_ = 294,
-     _INT32_ = 295,
-     _UINT8_ = 296,
-     _UINT16_ = 297,
-     _UINT32_ = 298,
-     _MATCHES_ = 299,
-     _CONTAINS_ = 300,
-     _INDEX_ = 301,
-     _MZ_ = 302,
-     _PE_ = 303,
-     _DLL_ = 304,
-     _TRUE_ = 305,
-     _FALSE_ = 306,
-     _OR_ = 307,
-     _AND_ = 308,
-     _IS_ = 309,
-     _NEQ_ = 310,
-     _EQ_ = 311,
-     _GE_ = 312,
-     _GT_ = 313,
-     _LE_ = 314,
-     _LT_ = 315,
-     _SHIFT_RIGHT_ = 316,
-     _SHIFT_LEFT_ = 317,
-     _NOT_ = 318
-   };
-#endif
-/* Tokens.  */
-#define _RULE_ 258
-#define _PRIVATE_ 259
-#define _GLOBAL_ 260
-#define _META_ 261
-#define _STRINGS_ 262
-#define _CONDITION_ 263
-#define _END_ 264
-#define _IDENTIFIER_ 265
-#define _STRING_IDENTIFIER_ 266
-#define _STRING_COUNT_ 267
-#define _STRING_OFFSET_ 268
-#define _STRING_IDENTIFIER_WITH_WILDCARD_ 269
-#define _ANONYMOUS_STRING_ 270
-#define _NUMBER_ 271
-#define _UNKNOWN_ 272
-#define _TEXTSTRING_ 273
-#define _HEXSTRING_ 274
-#define _REGEXP_ 275
-#define _ASCII_ 276
-#define _WIDE_ 277
-#define _NOCASE_ 278
-#define _FULLWORD_ 279
-#define _AT_ 280
-#define _SIZE_ 281
-#define _ENTRYPOINT_ 282
-#define _ALL_ 283
-#define _ANY_ 284
-#define _RVA_ 285
-#define _OFFSET_ 286
-#define _FILE_ 287
-#define _IN_ 288
-#define _OF_ 289
-#define _FOR_ 290
-#define _THEM_ 291
-#define _SECTION_ 292
-#define _INT8_ 293
-#define _INT16_ 294
-#define _INT32_ 295
-#define _UINT8_ 296
-#define _UINT16_ 297
-#define _UINT32_ 298
-#define _MATCHES_ 299
-#define _CONTAINS_ 300
-#define _INDEX_ 301
-#define _MZ_ 302
-#define _PE_ 303
-#define _DLL_ 304
-#define _TRUE_ 305
-#define _FALSE_ 306
-#define _OR_ 307
-#define _AND_ 308
-#define _IS_ 309
-#define _NEQ_ 310
-#define _EQ_ 311
-#define _GE_ 312
-#define _GT_ 313
-#define _LE_ 314
-#define _LT_ 315
-#define _SHIFT_RIGHT_ 316
-#define _SHIFT_LEFT_ 317
-#define _NOT_ 318
-
-
-
-
-/* Copy the first part of user declarations.  */
+#define yyparse         yara_yyparse
+#define yylex           yara_yylex
+#define yyerror         yara_yyerror
+#define yydebug         yara_yydebug
+#define yynerrs         yara_yynerrs
+
+/* First part of user prologue.  */
 #line 17 "grammar.y"
 
 
@@ -223,8 +91,6 @@
 #include "utils.h"
 #include "yara.h"
 
-#define YYERROR_VERBOSE
-
 #define INTEGER_SET_ENUMERATION 1
 #define INTEGER_SET_RANGE 2
 
@@ -236,80 +102,242 @@
     } \
 
 
+#line 106 "grammar.c"
 
-/* Enabling traces.  */
-#ifndef YYDEBUG
-# define YYDEBUG 1
-#endif
-
-/* Enabling verbose error messages.  */
-#ifdef YYERROR_VERBOSE
-# undef YYERROR_VERBOSE
-# define YYERROR_VERBOSE 1
-#else
-# define YYERROR_VERBOSE 0
-#endif
-
-/* Enabling the token table.  */
-#ifndef YYTOKEN_TABLE
-# define YYTOKEN_TABLE 0
-#endif
+# ifndef YY_CAST
+#  ifdef __cplusplus
+#   define YY_CAST(Type, Val) static_cast<Type> (Val)
+#   define YY_REINTERPRET_CAST(Type, Val) reinterpret_cast<Type> (Val)
+#  else
+#   define YY_CAST(Type, Val) ((Type) (Val))
+#   define YY_REINTERPRET_CAST(Type, Val) ((Type) (Val))
+#  endif
+# endif
+# ifndef YY_NULLPTR
+#  if defined __cplusplus
+#   if 201103L <= __cplusplus
+#    define YY_NULLPTR nullptr
+#   else
+#    define YY_NULLPTR 0
+#   endif
+#  else
+#   define YY_NULLPTR ((void*)0)
+#  endif
+# endif
 
-#if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
-typedef union YYSTYPE
-#line 148 "grammar.y"
+#include "grammar.h"
+/* Symbol kind.  */
+enum yysymbol_kind_t
 {
-  SIZED_STRING*   sized_string;
-  char*           c_string;
-  int64_t         integer;
-  YR_STRING*         string;
-  YR_META*           meta;
-}
-/* Line 193 of yacc.c.  */
-#line 270 "grammar.c"
-	YYSTYPE;
-# define yystype YYSTYPE /* obsolescent; will be withdrawn */
-# define YYSTYPE_IS_DECLARED 1
-# define YYSTYPE_IS_TRIVIAL 1
-#endif
-
-
+  YYSYMBOL_YYEMPTY = -2,
+  YYSYMBOL_YYEOF = 0,                      /* "end of file"  */
+  YYSYMBOL_YYerror = 1,                    /* error  */
+  YYSYMBOL_YYUNDEF = 2,                    /* "invalid token"  */
+  YYSYMBOL__RULE_ = 3,                     /* _RULE_  */
+  YYSYMBOL__PRIVATE_ = 4,                  /* _PRIVATE_  */
+  YYSYMBOL__GLOBAL_ = 5,                   /* _GLOBAL_  */
+  YYSYMBOL__META_ = 6,                     /* _META_  */
+  YYSYMBOL__STRINGS_ = 7,                  /* _STRINGS_  */
+  YYSYMBOL__CONDITION_ = 8,                /* _CONDITION_  */
+  YYSYMBOL__END_ = 9,                      /* _END_  */
+  YYSYMBOL__IDENTIFIER_ = 10,              /* _IDENTIFIER_  */
+  YYSYMBOL__STRING_IDENTIFIER_ = 11,       /* _STRING_IDENTIFIER_  */
+  YYSYMBOL__STRING_COUNT_ = 12,            /* _STRING_COUNT_  */
+  YYSYMBOL__STRING_OFFSET_ = 13,           /* _STRING_OFFSET_  */
+  YYSYMBOL__STRING_IDENTIFIER_WITH_WILDCARD_ = 14, /* _STRING_IDENTIFIER_WITH_WILDCARD_  */
+  YYSYMBOL__ANONYMOUS_STRING_ = 15,        /* _ANONYMOUS_STRING_  */
+  YYSYMBOL__NUMBER_ = 16,                  /* _NUMBER_  */
+  YYSYMBOL__UNKNOWN_ = 17,                 /* _UNKNOWN_  */
+  YYSYMBOL__TEXTSTRING_ = 18,              /* _TEXTSTRING_  */
+  YYSYMBOL__HEXSTRING_ = 19,               /* _HEXSTRING_  */
+  YYSYMBOL__REGEXP_ = 20,                  /* _REGEXP_  */
+  YYSYMBOL__ASCII_ = 21,                   /* _ASCII_  */
+  YYSYMBOL__WIDE_ = 22,                    /* _WIDE_  */
+  YYSYMBOL__NOCASE_ = 23,                  /* _NOCASE_  */
+  YYSYMBOL__FULLWORD_ = 24,                /* _FULLWORD_  */
+  YYSYMBOL__AT_ = 25,                      /* _AT_  */
+  YYSYMBOL__SIZE_ = 26,                    /* _SIZE_  */
+  YYSYMBOL__ENTRYPOINT_ = 27,              /* _ENTRYPOINT_  */
+  YYSYMBOL__ALL_ = 28,                     /* _ALL_  */
+  YYSYMBOL__ANY_ = 29,                     /* _ANY_  */
+  YYSYMBOL__RVA_ = 30,                     /* _RVA_  */
+  YYSYMBOL__OFFSET_ = 31,                  /* _OFFSET_  */
+  YYSYMBOL__FILE_ = 32,                    /* _FILE_  */
+  YYSYMBOL__IN_ = 33,                      /* _IN_  */
+  YYSYMBOL__OF_ = 34,                      /* _OF_  */
+  YYSYMBOL__FOR_ = 35,                     /* _FOR_  */
+  YYSYMBOL__THEM_ = 36,                    /* _THEM_  */
+  YYSYMBOL__SECTION_ = 37,                 /* _SECTION_  */
+  YYSYMBOL__INT8_ = 38,                    /* _INT8_  */
+  YYSYMBOL__INT16_ = 39,                   /* _INT16_  */
+  YYSYMBOL__INT32_ = 40,                   /* _INT32_  */
+  YYSYMBOL__UINT8_ = 41,                   /* _UINT8_  */
+  YYSYMBOL__UINT16_ = 42,                  /* _UINT16_  */
+  YYSYMBOL__UINT32_ = 43,                  /* _UINT32_  */
+  YYSYMBOL__MATCHES_ = 44,                 /* _MATCHES_  */
+  YYSYMBOL__CONTAINS_ = 45,                /* _CONTAINS_  */
+  YYSYMBOL__INDEX_ = 46,                   /* _INDEX_  */
+  YYSYMBOL__MZ_ = 47,                      /* _MZ_  */
+  YYSYMBOL__PE_ = 48,                      /* _PE_  */
+  YYSYMBOL__DLL_ = 49,                     /* _DLL_  */
+  YYSYMBOL__TRUE_ = 50,                    /* _TRUE_  */
+  YYSYMBOL__FALSE_ = 51,                   /* _FALSE_  */
+  YYSYMBOL__OR_ = 52,                      /* _OR_  */
+  YYSYMBOL__AND_ = 53,                     /* _AND_  */
+  YYSYMBOL_54_ = 54,                       /* '&'  */
+  YYSYMBOL_55_ = 55,                       /* '|'  */
+  YYSYMBOL_56_ = 56,                       /* '^'  */
+  YYSYMBOL__LT_ = 57,                      /* _LT_  */
+  YYSYMBOL__LE_ = 58,                      /* _LE_  */
+  YYSYMBOL__GT_ = 59,                      /* _GT_  */
+  YYSYMBOL__GE_ = 60,                      /* _GE_  */
+  YYSYMBOL__EQ_ = 61,                      /* _EQ_  */
+  YYSYMBOL__NEQ_ = 62,                     /* _NEQ_  */
+  YYSYMBOL__IS_ = 63,                      /* _IS_  */
+  YYSYMBOL__SHIFT_LEFT_ = 64,              /* _SHIFT_LEFT_  */
+  YYSYMBOL__SHIFT_RIGHT_ = 65,             /* _SHIFT_RIGHT_  */
+  YYSYMBOL_66_ = 66,                       /* '+'  */
+  YYSYMBOL_67_ = 67,                       /* '-'  */
+  YYSYMBOL_68_ = 68,                       /* '*'  */
+  YYSYMBOL_69_ = 69,                       /* '\\'  */
+  YYSYMBOL_70_ = 70,                       /* '%'  */
+  YYSYMBOL__NOT_ = 71,                     /* _NOT_  */
+  YYSYMBOL_72_ = 72,                       /* '~'  */
+  YYSYMBOL_73_ = 73,                       /* '{'  */
+  YYSYMBOL_74_ = 74,                       /* '}'  */
+  YYSYMBOL_75_ = 75,                       /* ':'  */
+  YYSYMBOL_76_ = 76,                       /* '='  */
+  YYSYMBOL_77_ = 77,                       /* '('  */
+  YYSYMBOL_78_ = 78,                       /* ')'  */
+  YYSYMBOL_79_ = 79,                       /* '.'  */
+  YYSYMBOL_80_ = 80,                       /* ','  */
+  YYSYMBOL_81_ = 81,                       /* '['  */
+  YYSYMBOL_82_ = 82,                       /* ']'  */
+  YYSYMBOL_YYACCEPT = 83,                  /* $accept  */
+  YYSYMBOL_rules = 84,                     /* rules  */
+  YYSYMBOL_rule = 85,                      /* rule  */
+  YYSYMBOL_meta = 86,                      /* meta  */
+  YYSYMBOL_strings = 87,                   /* strings  */
+  YYSYMBOL_condition = 88,                 /* condition  */
+  YYSYMBOL_89_1 = 89,                      /* $@1  */
+  YYSYMBOL_rule_modifiers = 90,            /* rule_modifiers  */
+  YYSYMBOL_rule_modifier = 91,             /* rule_modifier  */
+  YYSYMBOL_tags = 92,                      /* tags  */
+  YYSYMBOL_tag_list = 93,                  /* tag_list  */
+  YYSYMBOL_meta_declarations = 94,         /* meta_declarations  */
+  YYSYMBOL_meta_declaration = 95,          /* meta_declaration  */
+  YYSYMBOL_string_declarations = 96,       /* string_declarations  */
+  YYSYMBOL_string_declaration = 97,        /* string_declaration  */
+  YYSYMBOL_string_modifiers = 98,          /* string_modifiers  */
+  YYSYMBOL_string_modifier = 99,           /* string_modifier  */
+  YYSYMBOL_boolean_expression = 100,       /* boolean_expression  */
+  YYSYMBOL_101_2 = 101,                    /* $@2  */
+  YYSYMBOL_102_3 = 102,                    /* $@3  */
+  YYSYMBOL_103_4 = 103,                    /* $@4  */
+  YYSYMBOL_104_5 = 104,                    /* @5  */
+  YYSYMBOL_105_6 = 105,                    /* @6  */
+  YYSYMBOL_text = 106,                     /* text  */
+  YYSYMBOL_integer_set = 107,              /* integer_set  */
+  YYSYMBOL_range = 108,                    /* range  */
+  YYSYMBOL_integer_enumeration = 109,      /* integer_enumeration  */
+  YYSYMBOL_string_set = 110,               /* string_set  */
+  YYSYMBOL_111_7 = 111,                    /* $@7  */
+  YYSYMBOL_string_enumeration = 112,       /* string_enumeration  */
+  YYSYMBOL_string_enumeration_item = 113,  /* string_enumeration_item  */
+  YYSYMBOL_for_expression = 114,           /* for_expression  */
+  YYSYMBOL_expression = 115,               /* expression  */
+  YYSYMBOL_type = 116                      /* type  */
+};
+typedef enum yysymbol_kind_t yysymbol_kind_t;
 
-/* Copy the second part of user declarations.  */
 
 
-/* Line 216 of yacc.c.  */
-#line 283 "grammar.c"
 
 #ifdef short
 # undef short
 #endif
 
-#ifdef YYTYPE_UINT8
-typedef YYTYPE_UINT8 yytype_uint8;
-#else
-typedef unsigned char yytype_uint8;
+/* On compilers that do not define __PTRDIFF_MAX__ etc., make sure
+   <limits.h> and (if available) <stdint.h> are included
+   so that the code can choose integer types of a good width.  */
+
+#ifndef __PTRDIFF_MAX__
+# include <limits.h> /* INFRINGES ON USER NAME SPACE */
+# if defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
+#  include <stdint.h> /* INFRINGES ON USER NAME SPACE */
+#  define YY_STDINT_H
+# endif
 #endif
 
-#ifdef YYTYPE_INT8
-typedef YYTYPE_INT8 yytype_int8;
-#elif (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
+/* Narrow types that promote to a signed type and that can represent a
+   signed or unsigned integer of at least N bits.  In tables they can
+   save space and decrease cache pressure.  Promoting to a signed type
+   helps avoid bugs in integer arithmetic.  */
+
+#ifdef __INT_LEAST8_MAX__
+typedef __INT_LEAST8_TYPE__ yytype_int8;
+#elif defined YY_STDINT_H
+typedef int_least8_t yytype_int8;
+#else
 typedef signed char yytype_int8;
+#endif
+
+#ifdef __INT_LEAST16_MAX__
+typedef __INT_LEAST16_TYPE__ yytype_int16;
+#elif defined YY_STDINT_H
+typedef int_least16_t yytype_int16;
 #else
-typedef short int yytype_int8;
+typedef short yytype_int16;
+#endif
+
+/* Work around bug in HP-UX 11.23, which defines these macros
+   incorrectly for preprocessor constants.  This workaround can likely
+   be removed in 2023, as HPE has promised support for HP-UX 11.23
+   (aka HP-UX 11i v2) only through the end of 2022; see Table 2 of
+   <https://h20195.www2.hpe.com/V2/getpdf.aspx/4AA4-7673ENW.pdf>.  */
+#ifdef __hpux
+# undef UINT_LEAST8_MAX
+# undef UINT_LEAST16_MAX
+# define UINT_LEAST8_MAX 255
+# define UINT_LEAST16_MAX 65535
 #endif
 
-#ifdef YYTYPE_UINT16
-typedef YYTYPE_UINT16 yytype_uint16;
+#if defined __UINT_LEAST8_MAX__ && __UINT_LEAST8_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST8_TYPE__ yytype_uint8;
+#elif (!defined __UINT_LEAST8_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST8_MAX <= INT_MAX)
+typedef uint_least8_t yytype_uint8;
+#elif !defined __UINT_LEAST8_MAX__ && UCHAR_MAX <= INT_MAX
+typedef unsigned char yytype_uint8;
 #else
-typedef unsigned short int yytype_uint16;
+typedef short yytype_uint8;
 #endif
 
-#ifdef YYTYPE_INT16
-typedef YYTYPE_INT16 yytype_int16;
+#if defined __UINT_LEAST16_MAX__ && __UINT_LEAST16_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST16_TYPE__ yytype_uint16;
+#elif (!defined __UINT_LEAST16_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST16_MAX <= INT_MAX)
+typedef uint_least16_t yytype_uint16;
+#elif !defined __UINT_LEAST16_MAX__ && USHRT_MAX <= INT_MAX
+typedef unsigned short yytype_uint16;
 #else
-typedef short int yytype_int16;
+typedef int yytype_uint16;
+#endif
+
+#ifndef YYPTRDIFF_T
+# if defined __PTRDIFF_TYPE__ && defined __PTRDIFF_MAX__
+#  define YYPTRDIFF_T __PTRDIFF_TYPE__
+#  define YYPTRDIFF_MAXIMUM __PTRDIFF_MAX__
+# elif defined PTRDIFF_MAX
+#  ifndef ptrdiff_t
+#   include <stddef.h> /* INFRINGES ON USER NAME SPACE */
+#  endif
+#  define YYPTRDIFF_T ptrdiff_t
+#  define YYPTRDIFF_MAXIMUM PTRDIFF_MAX
+# else
+#  define YYPTRDIFF_T long
+#  define YYPTRDIFF_MAXIMUM LONG_MAX
+# endif
 #endif
 
 #ifndef YYSIZE_T
@@ -317,55 +345,106 @@ typedef short int yytype_int16;
 #  define YYSIZE_T __SIZE_TYPE__
 # elif defined size_t
 #  define YYSIZE_T size_t
-# elif ! defined YYSIZE_T && (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
+# elif defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
 #  include <stddef.h> /* INFRINGES ON USER NAME SPACE */
 #  define YYSIZE_T size_t
 # else
-#  define YYSIZE_T unsigned int
+#  define YYSIZE_T unsigned
 # endif
 #endif
 
-#define YYSIZE_MAXIMUM ((YYSIZE_T) -1)
+#define YYSIZE_MAXIMUM                                  \
+  YY_CAST (YYPTRDIFF_T,                                 \
+           (YYPTRDIFF_MAXIMUM < YY_CAST (YYSIZE_T, -1)  \
+            ? YYPTRDIFF_MAXIMUM                         \
+            : YY_CAST (YYSIZE_T, -1)))
+
+#define YYSIZEOF(X) YY_CAST (YYPTRDIFF_T, sizeof (X))
+
+
+/* Stored state numbers (used for stacks). */
+typedef yytype_uint8 yy_state_t;
+
+/* State numbers in computations.  */
+typedef int yy_state_fast_t;
 
 #ifndef YY_
 # if defined YYENABLE_NLS && YYENABLE_NLS
 #  if ENABLE_NLS
 #   include <libintl.h> /* INFRINGES ON USER NAME SPACE */
-#   define YY_(msgid) dgettext ("bison-runtime", msgid)
+#   define YY_(Msgid) dgettext ("bison-runtime", Msgid)
 #  endif
 # endif
 # ifndef YY_
-#  define YY_(msgid) msgid
+#  define YY_(Msgid) Msgid
+# endif
+#endif
+
+
+#ifndef YY_ATTRIBUTE_PURE
+# if defined __GNUC__ && 2 < __GNUC__ + (96 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_PURE __attribute__ ((__pure__))
+# else
+#  define YY_ATTRIBUTE_PURE
+# endif
+#endif
+
+#ifndef YY_ATTRIBUTE_UNUSED
+# if defined __GNUC__ && 2 < __GNUC__ + (7 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_UNUSED __attribute__ ((__unused__))
+# else
+#  define YY_ATTRIBUTE_UNUSED
 # endif
 #endif
 
 /* Suppress unused-variable warnings by "using" E.  */
 #if ! defined lint || defined __GNUC__
-# define YYUSE(e) ((void) (e))
+# define YY_USE(E) ((void) (E))
 #else
-# define YYUSE(e) /* empty */
+# define YY_USE(E) /* empty */
 #endif
 
-/* Identity function, used to suppress warnings about constant conditions.  */
-#ifndef lint
-# define YYID(n) (n)
-#else
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static int
-YYID (int i)
+/* Suppress an incorrect diagnostic about yylval being uninitialized.  */
+#if defined __GNUC__ && ! defined __ICC && 406 <= __GNUC__ * 100 + __GNUC_MINOR__
+# if __GNUC__ * 100 + __GNUC_MINOR__ < 407
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")
+# else
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")              \
+    _Pragma ("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+# endif
+# define YY_IGNORE_MAYBE_UNINITIALIZED_END      \
+    _Pragma ("GCC diagnostic pop")
 #else
-static int
-YYID (i)
-    int i;
+# define YY_INITIAL_VALUE(Value) Value
 #endif
-{
-  return i;
-}
+#ifndef YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+# define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+# define YY_IGNORE_MAYBE_UNINITIALIZED_END
+#endif
+#ifndef YY_INITIAL_VALUE
+# define YY_INITIAL_VALUE(Value) /* Nothing. */
+#endif
+
+#if defined __cplusplus && defined __GNUC__ && ! defined __ICC && 6 <= __GNUC__
+# define YY_IGNORE_USELESS_CAST_BEGIN                          \
+    _Pragma ("GCC diagnostic push")                            \
+    _Pragma ("GCC diagnostic ignored \"-Wuseless-cast\"")
+# define YY_IGNORE_USELESS_CAST_END            \
+    _Pragma ("GCC diagnostic pop")
+#endif
+#ifndef YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_END
 #endif
 
-#if ! defined yyoverflow || YYERROR_VERBOSE
+
+#define YY_ASSERT(E) ((void) (0 && (E)))
+
+#if 1
 
 /* The parser invokes alloca or malloc; define the necessary symbols.  */
 
@@ -382,11 +461,11 @@ YYID (i)
 #    define alloca _alloca
 #   else
 #    define YYSTACK_ALLOC alloca
-#    if ! defined _ALLOCA_H && ! defined _STDLIB_H && (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
+#    if ! defined _ALLOCA_H && ! defined EXIT_SUCCESS
 #     include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
-#     ifndef _STDLIB_H
-#      define _STDLIB_H 1
+      /* Use EXIT_SUCCESS as a witness for stdlib.h.  */
+#     ifndef EXIT_SUCCESS
+#      define EXIT_SUCCESS 0
 #     endif
 #    endif
 #   endif
@@ -394,8 +473,8 @@ YYID (i)
 # endif
 
 # ifdef YYSTACK_ALLOC
-   /* Pacify GCC's `empty if-body' warning.  */
-#  define YYSTACK_FREE(Ptr) do { /* empty */; } while (YYID (0))
+   /* Pacify GCC's 'empty if-body' warning.  */
+#  define YYSTACK_FREE(Ptr) do { /* empty */; } while (0)
 #  ifndef YYSTACK_ALLOC_MAXIMUM
     /* The OS might guarantee only one guard page at the bottom of the stack,
        and a page size can be as small as 4096 bytes.  So we cannot safely
@@ -409,125 +488,131 @@ YYID (i)
 #  ifndef YYSTACK_ALLOC_MAXIMUM
 #   define YYSTACK_ALLOC_MAXIMUM YYSIZE_MAXIMUM
 #  endif
-#  if (defined __cplusplus && ! defined _STDLIB_H \
+#  if (defined __cplusplus && ! defined EXIT_SUCCESS \
        && ! ((defined YYMALLOC || defined malloc) \
-	     && (defined YYFREE || defined free)))
+             && (defined YYFREE || defined free)))
 #   include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
-#   ifndef _STDLIB_H
-#    define _STDLIB_H 1
+#   ifndef EXIT_SUCCESS
+#    define EXIT_SUCCESS 0
 #   endif
 #  endif
 #  ifndef YYMALLOC
 #   define YYMALLOC malloc
-#   if ! defined malloc && ! defined _STDLIB_H && (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
+#   if ! defined malloc && ! defined EXIT_SUCCESS
 void *malloc (YYSIZE_T); /* INFRINGES ON USER NAME SPACE */
 #   endif
 #  endif
 #  ifndef YYFREE
 #   define YYFREE free
-#   if ! defined free && ! defined _STDLIB_H && (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
+#   if ! defined free && ! defined EXIT_SUCCESS
 void free (void *); /* INFRINGES ON USER NAME SPACE */
 #   endif
 #  endif
 # endif
-#endif /* ! defined yyoverflow || YYERROR_VERBOSE */
-
+#endif /* 1 */
 
 #if (! defined yyoverflow \
      && (! defined __cplusplus \
-	 || (defined YYSTYPE_IS_TRIVIAL && YYSTYPE_IS_TRIVIAL)))
+         || (defined YYSTYPE_IS_TRIVIAL && YYSTYPE_IS_TRIVIAL)))
 
 /* A type that is properly aligned for any stack member.  */
 union yyalloc
 {
-  yytype_int16 yyss;
-  YYSTYPE yyvs;
-  };
+  yy_state_t yyss_alloc;
+  YYSTYPE yyvs_alloc;
+};
 
 /* The size of the maximum gap between one aligned stack and the next.  */
-# define YYSTACK_GAP_MAXIMUM (sizeof (union yyalloc) - 1)
+# define YYSTACK_GAP_MAXIMUM (YYSIZEOF (union yyalloc) - 1)
 
 /* The size of an array large to enough to hold all stacks, each with
    N elements.  */
 # define YYSTACK_BYTES(N) \
-     ((N) * (sizeof (yytype_int16) + sizeof (YYSTYPE)) \
+     ((N) * (YYSIZEOF (yy_state_t) + YYSIZEOF (YYSTYPE)) \
       + YYSTACK_GAP_MAXIMUM)
 
-/* Copy COUNT objects from FROM to TO.  The source and destination do
-   not overlap.  */
-# ifndef YYCOPY
-#  if defined __GNUC__ && 1 < __GNUC__
-#   define YYCOPY(To, From, Count) \
-      __builtin_memcpy (To, From, (Count) * sizeof (*(From)))
-#  else
-#   define YYCOPY(To, From, Count)		\
-      do					\
-	{					\
-	  YYSIZE_T yyi;				\
-	  for (yyi = 0; yyi < (Count); yyi++)	\
-	    (To)[yyi] = (From)[yyi];		\
-	}					\
-      while (YYID (0))
-#  endif
-# endif
+# define YYCOPY_NEEDED 1
 
 /* Relocate STACK from its old location to the new one.  The
    local variables YYSIZE and YYSTACKSIZE give the old and new number of
    elements in the stack, and YYPTR gives the new location of the
    stack.  Advance YYPTR to a properly aligned location for the next
    stack.  */
-# define YYSTACK_RELOCATE(Stack)					\
-    do									\
-      {									\
-	YYSIZE_T yynewbytes;						\
-	YYCOPY (&yyptr->Stack, Stack, yysize);				\
-	Stack = &yyptr->Stack;						\
-	yynewbytes = yystacksize * sizeof (*Stack) + YYSTACK_GAP_MAXIMUM; \
-	yyptr += yynewbytes / sizeof (*yyptr);				\
-      }									\
-    while (YYID (0))
+# define YYSTACK_RELOCATE(Stack_alloc, Stack)                           \
+    do                                                                  \
+      {                                                                 \
+        YYPTRDIFF_T yynewbytes;                                         \
+        YYCOPY (&yyptr->Stack_alloc, Stack, yysize);                    \
+        Stack = &yyptr->Stack_alloc;                                    \
+        yynewbytes = yystacksize * YYSIZEOF (*Stack) + YYSTACK_GAP_MAXIMUM; \
+        yyptr += yynewbytes / YYSIZEOF (*yyptr);                        \
+      }                                                                 \
+    while (0)
 
 #endif
 
+#if defined YYCOPY_NEEDED && YYCOPY_NEEDED
+/* Copy COUNT objects from SRC to DST.  The source and destination do
+   not overlap.  */
+# ifndef YYCOPY
+#  if defined __GNUC__ && 1 < __GNUC__
+#   define YYCOPY(Dst, Src, Count) \
+      __builtin_memcpy (Dst, Src, YY_CAST (YYSIZE_T, (Count)) * sizeof (*(Src)))
+#  else
+#   define YYCOPY(Dst, Src, Count)              \
+      do                                        \
+        {                                       \
+          YYPTRDIFF_T yyi;                      \
+          for (yyi = 0; yyi < (Count); yyi++)   \
+            (Dst)[yyi] = (Src)[yyi];            \
+        }                                       \
+      while (0)
+#  endif
+# endif
+#endif /* !YYCOPY_NEEDED */
+
 /* YYFINAL -- State number of the termination state.  */
 #define YYFINAL  2
 /* YYLAST -- Last index in YYTABLE.  */
-#define YYLAST   425
+#define YYLAST   438
 
 /* YYNTOKENS -- Number of terminals.  */
-#define YYNTOKENS  84
+#define YYNTOKENS  83
 /* YYNNTS -- Number of nonterminals.  */
-#define YYNNTS  31
+#define YYNNTS  34
 /* YYNRULES -- Number of rules.  */
-#define YYNRULES  109
-/* YYNRULES -- Number of states.  */
-#define YYNSTATES  211
+#define YYNRULES  111
+/* YYNSTATES -- Number of states.  */
+#define YYNSTATES  213
 
-/* YYTRANSLATE(YYLEX) -- Bison symbol number corresponding to YYLEX.  */
-#define YYUNDEFTOK  2
+/* YYMAXUTOK -- Last valid token kind.  */
 #define YYMAXUTOK   318
 
-#define YYTRANSLATE(YYX)						\
-  ((unsigned int) (YYX) <= YYMAXUTOK ? yytranslate[YYX] : YYUNDEFTOK)
 
-/* YYTRANSLATE[YYLEX] -- Bison symbol number corresponding to YYLEX.  */
-static const yytype_uint8 yytranslate[] =
+/* YYTRANSLATE(TOKEN-NUM) -- Symbol number corresponding to TOKEN-NUM
+   as returned by yylex, with out-of-bounds checking.  */
+#define YYTRANSLATE(YYX)                                \
+  (0 <= (YYX) && (YYX) <= YYMAXUTOK                     \
+   ? YY_CAST (yysymbol_kind_t, yytranslate[YYX])        \
+   : YYSYMBOL_YYUNDEF)
+
+/* YYTRANSLATE[TOKEN-NUM] -- Symbol number corresponding to TOKEN-NUM
+   as returned by yylex.  */
+static const yytype_int8 yytranslate[] =
 {
        0,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,    70,    54,     2,
-      78,    79,    68,    66,    81,    67,    80,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,    76,     2,
-       2,    77,     2,     2,     2,     2,     2,     2,     2,     2,
+      77,    78,    68,    66,    80,    67,    79,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,    75,     2,
+       2,    76,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,    81,    69,    82,    56,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,    82,    69,    83,    56,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,    73,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,    74,    55,    75,    72,     2,     2,     2,
+       2,     2,     2,    73,    55,    74,    72,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
@@ -550,452 +635,347 @@ static const yytype_uint8 yytranslate[] =
 };
 
 #if YYDEBUG
-/* YYPRHS[YYN] -- Index of the first RHS symbol of rule number YYN in
-   YYRHS.  */
-static const yytype_uint16 yyprhs[] =
+/* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
+static const yytype_int16 yyrline[] =
 {
-       0,     0,     3,     4,     7,    11,    15,    25,    26,    30,
-      31,    35,    39,    40,    43,    45,    47,    48,    51,    53,
-      56,    58,    61,    65,    69,    73,    77,    79,    82,    87,
-      92,    96,    97,   100,   102,   104,   106,   108,   112,   114,
-     116,   118,   122,   126,   128,   132,   137,   141,   148,   149,
-     150,   162,   163,   173,   177,   181,   184,   188,   192,   196,
-     200,   204,   208,   212,   216,   220,   222,   224,   228,   230,
-     237,   239,   243,   244,   249,   251,   253,   257,   259,   261,
-     263,   265,   267,   271,   273,   275,   280,   285,   290,   295,
-     300,   305,   307,   309,   314,   316,   318,   322,   326,   330,
-     334,   338,   342,   346,   350,   353,   357,   361,   363,   365
+       0,   162,   162,   163,   164,   168,   185,   186,   214,   218,
+     262,   261,   273,   274,   278,   279,   283,   284,   299,   309,
+     343,   344,   348,   364,   377,   390,   406,   407,   411,   424,
+     437,   453,   454,   458,   459,   460,   461,   465,   466,   470,
+     474,   507,   542,   546,   557,   568,   572,   583,   589,   626,
+     588,   725,   724,   798,   806,   809,   814,   813,   849,   848,
+     898,   902,   906,   910,   914,   918,   922,   929,   948,   962,
+     963,   967,   971,   972,   976,   975,   980,   992,   993,   996,
+    1007,  1020,  1021,  1025,  1032,  1033,  1037,  1041,  1045,  1049,
+    1053,  1057,  1061,  1065,  1069,  1080,  1091,  1105,  1132,  1136,
+    1140,  1144,  1148,  1152,  1156,  1160,  1164,  1168,  1172,  1178,
+    1179,  1180
 };
+#endif
 
-/* YYRHS -- A `-1'-separated list of the rules' RHS.  */
-static const yytype_int8 yyrhs[] =
-{
-      85,     0,    -1,    -1,    85,    86,    -1,    85,     1,    86,
-      -1,    85,     1,    73,    -1,    90,     3,    10,    92,    74,
-      87,    88,    89,    75,    -1,    -1,     6,    76,    94,    -1,
-      -1,     7,    76,    96,    -1,     8,    76,   100,    -1,    -1,
-      90,    91,    -1,     4,    -1,     5,    -1,    -1,    76,    93,
-      -1,    10,    -1,    93,    10,    -1,    95,    -1,    94,    95,
-      -1,    10,    77,    18,    -1,    10,    77,    16,    -1,    10,
-      77,    50,    -1,    10,    77,    51,    -1,    97,    -1,    96,
-      97,    -1,    11,    77,    18,    98,    -1,    11,    77,    20,
-      98,    -1,    11,    77,    19,    -1,    -1,    98,    99,    -1,
-      22,    -1,    21,    -1,    23,    -1,    24,    -1,    78,   100,
-      79,    -1,    50,    -1,    51,    -1,    10,    -1,   104,    44,
-      20,    -1,   104,    45,   104,    -1,    11,    -1,    11,    25,
-     113,    -1,    11,    25,    30,   113,    -1,    11,    33,   106,
-      -1,    11,    33,    37,    78,    18,    79,    -1,    -1,    -1,
-      35,   112,    10,    33,   101,   105,    76,   102,    78,   100,
-      79,    -1,    -1,    35,   112,    34,   108,    76,   103,    78,
-     100,    79,    -1,   112,    34,   108,    -1,    32,    57,   114,
-      -1,    71,   100,    -1,   100,    53,   100,    -1,   100,    52,
-     100,    -1,   113,    63,   113,    -1,   113,    61,   113,    -1,
-     113,    62,   113,    -1,   113,    60,   113,    -1,   113,    59,
-     113,    -1,   113,    57,   113,    -1,   113,    58,   113,    -1,
-      18,    -1,    10,    -1,    78,   107,    79,    -1,   106,    -1,
-      78,   113,    80,    80,   113,    79,    -1,   113,    -1,   107,
-      81,   113,    -1,    -1,    78,   109,   110,    79,    -1,    36,
-      -1,   111,    -1,   110,    81,   111,    -1,    11,    -1,    14,
-      -1,   113,    -1,    28,    -1,    29,    -1,    78,   113,    79,
-      -1,    26,    -1,    27,    -1,    38,    78,   113,    79,    -1,
-      39,    78,   113,    79,    -1,    40,    78,   113,    79,    -1,
-      41,    78,   113,    79,    -1,    42,    78,   113,    79,    -1,
-      43,    78,   113,    79,    -1,    16,    -1,    12,    -1,    13,
-      82,   113,    83,    -1,    13,    -1,    10,    -1,   113,    66,
-     113,    -1,   113,    67,   113,    -1,   113,    68,   113,    -1,
-     113,    69,   113,    -1,   113,    70,   113,    -1,   113,    56,
-     113,    -1,   113,    54,   113,    -1,   113,    55,   113,    -1,
-      72,   113,    -1,   113,    65,   113,    -1,   113,    64,   113,
-      -1,    47,    -1,    48,    -1,    49,    -1
-};
+/** Accessing symbol of state STATE.  */
+#define YY_ACCESSING_SYMBOL(State) YY_CAST (yysymbol_kind_t, yystos[State])
 
-/* YYRLINE[YYN] -- source line where rule number YYN was defined.  */
-static const yytype_uint16 yyrline[] =
-{
-       0,   159,   159,   160,   161,   162,   166,   183,   184,   212,
-     216,   244,   248,   249,   253,   254,   258,   259,   274,   284,
-     318,   319,   323,   339,   352,   365,   381,   382,   386,   399,
-     412,   428,   429,   433,   434,   435,   436,   440,   441,   445,
-     449,   479,   514,   518,   529,   540,   544,   555,   561,   598,
-     560,   697,   696,   765,   769,   772,   776,   780,   784,   788,
-     792,   796,   800,   804,   808,   815,   834,   848,   849,   853,
-     857,   858,   862,   861,   866,   873,   874,   877,   882,   889,
-     890,   894,   901,   902,   906,   910,   914,   918,   922,   926,
-     930,   934,   938,   949,   960,   974,  1001,  1005,  1009,  1013,
-    1017,  1021,  1025,  1029,  1033,  1037,  1041,  1047,  1048,  1049
-};
-#endif
+#if 1
+/* The user-facing name of the symbol whose (internal) number is
+   YYSYMBOL.  No bounds checking.  */
+static const char *yysymbol_name (yysymbol_kind_t yysymbol) YY_ATTRIBUTE_UNUSED;
 
-#if YYDEBUG || YYERROR_VERBOSE || YYTOKEN_TABLE
 /* YYTNAME[SYMBOL-NUM] -- String name of the symbol SYMBOL-NUM.
    First, the terminals, then, starting at YYNTOKENS, nonterminals.  */
 static const char *const yytname[] =
 {
-  "$end", "error", "$undefined", "_RULE_", "_PRIVATE_", "_GLOBAL_",
-  "_META_", "_STRINGS_", "_CONDITION_", "_END_", "_IDENTIFIER_",
-  "_STRING_IDENTIFIER_", "_STRING_COUNT_", "_STRING_OFFSET_",
-  "_STRING_IDENTIFIER_WITH_WILDCARD_", "_ANONYMOUS_STRING_", "_NUMBER_",
-  "_UNKNOWN_", "_TEXTSTRING_", "_HEXSTRING_", "_REGEXP_", "_ASCII_",
-  "_WIDE_", "_NOCASE_", "_FULLWORD_", "_AT_", "_SIZE_", "_ENTRYPOINT_",
-  "_ALL_", "_ANY_", "_RVA_", "_OFFSET_", "_FILE_", "_IN_", "_OF_", "_FOR_",
-  "_THEM_", "_SECTION_", "_INT8_", "_INT16_", "_INT32_", "_UINT8_",
-  "_UINT16_", "_UINT32_", "_MATCHES_", "_CONTAINS_", "_INDEX_", "_MZ_",
-  "_PE_", "_DLL_", "_TRUE_", "_FALSE_", "_OR_", "_AND_", "'&'", "'|'",
-  "'^'", "_IS_", "_NEQ_", "_EQ_", "_GE_", "_GT_", "_LE_", "_LT_",
-  "_SHIFT_RIGHT_", "_SHIFT_LEFT_", "'+'", "'-'", "'*'", "'\\\\'", "'%'",
-  "_NOT_", "'~'", "'include'", "'{'", "'}'", "':'", "'='", "'('", "')'",
-  "'.'", "','", "'['", "']'", "$accept", "rules", "rule", "meta",
-  "strings", "condition", "rule_modifiers", "rule_modifier", "tags",
-  "tag_list", "meta_declarations", "meta_declaration",
+  "\"end of file\"", "error", "\"invalid token\"", "_RULE_", "_PRIVATE_",
+  "_GLOBAL_", "_META_", "_STRINGS_", "_CONDITION_", "_END_",
+  "_IDENTIFIER_", "_STRING_IDENTIFIER_", "_STRING_COUNT_",
+  "_STRING_OFFSET_", "_STRING_IDENTIFIER_WITH_WILDCARD_",
+  "_ANONYMOUS_STRING_", "_NUMBER_", "_UNKNOWN_", "_TEXTSTRING_",
+  "_HEXSTRING_", "_REGEXP_", "_ASCII_", "_WIDE_", "_NOCASE_", "_FULLWORD_",
+  "_AT_", "_SIZE_", "_ENTRYPOINT_", "_ALL_", "_ANY_", "_RVA_", "_OFFSET_",
+  "_FILE_", "_IN_", "_OF_", "_FOR_", "_THEM_", "_SECTION_", "_INT8_",
+  "_INT16_", "_INT32_", "_UINT8_", "_UINT16_", "_UINT32_", "_MATCHES_",
+  "_CONTAINS_", "_INDEX_", "_MZ_", "_PE_", "_DLL_", "_TRUE_", "_FALSE_",
+  "_OR_", "_AND_", "'&'", "'|'", "'^'", "_LT_", "_LE_", "_GT_", "_GE_",
+  "_EQ_", "_NEQ_", "_IS_", "_SHIFT_LEFT_", "_SHIFT_RIGHT_", "'+'", "'-'",
+  "'*'", "'\\\\'", "'%'", "_NOT_", "'~'", "'{'", "'}'", "':'", "'='",
+  "'('", "')'", "'.'", "','", "'['", "']'", "$accept", "rules", "rule",
+  "meta", "strings", "condition", "$@1", "rule_modifiers", "rule_modifier",
+  "tags", "tag_list", "meta_declarations", "meta_declaration",
   "string_declarations", "string_declaration", "string_modifiers",
-  "string_modifier", "boolean_expression", "@1", "@2", "@3", "text",
-  "integer_set", "range", "integer_enumeration", "string_set", "@4",
-  "string_enumeration", "string_enumeration_item", "for_expression",
-  "expression", "type", 0
+  "string_modifier", "boolean_expression", "$@2", "$@3", "$@4", "@5", "@6",
+  "text", "integer_set", "range", "integer_enumeration", "string_set",
+  "$@7", "string_enumeration", "string_enumeration_item", "for_expression",
+  "expression", "type", YY_NULLPTR
 };
-#endif
 
-# ifdef YYPRINT
-/* YYTOKNUM[YYLEX-NUM] -- Internal token number corresponding to
-   token YYLEX-NUM.  */
-static const yytype_uint16 yytoknum[] =
+static const char *
+yysymbol_name (yysymbol_kind_t yysymbol)
 {
-       0,   256,   257,   258,   259,   260,   261,   262,   263,   264,
-     265,   266,   267,   268,   269,   270,   271,   272,   273,   274,
-     275,   276,   277,   278,   279,   280,   281,   282,   283,   284,
-     285,   286,   287,   288,   289,   290,   291,   292,   293,   294,
-     295,   296,   297,   298,   299,   300,   301,   302,   303,   304,
-     305,   306,   307,   308,    38,   124,    94,   309,   310,   311,
-     312,   313,   314,   315,   316,   317,    43,    45,    42,    92,
-      37,   318,   126,   105,   123,   125,    58,    61,    40,    41,
-      46,    44,    91,    93
-};
-# endif
+  return yytname[yysymbol];
+}
+#endif
 
-/* YYR1[YYN] -- Symbol number of symbol that rule YYN derives.  */
-static const yytype_uint8 yyr1[] =
-{
-       0,    84,    85,    85,    85,    85,    86,    87,    87,    88,
-      88,    89,    90,    90,    91,    91,    92,    92,    93,    93,
-      94,    94,    95,    95,    95,    95,    96,    96,    97,    97,
-      97,    98,    98,    99,    99,    99,    99,   100,   100,   100,
-     100,   100,   100,   100,   100,   100,   100,   100,   101,   102,
-     100,   103,   100,   100,   100,   100,   100,   100,   100,   100,
-     100,   100,   100,   100,   100,   104,   104,   105,   105,   106,
-     107,   107,   109,   108,   108,   110,   110,   111,   111,   112,
-     112,   112,   113,   113,   113,   113,   113,   113,   113,   113,
-     113,   113,   113,   113,   113,   113,   113,   113,   113,   113,
-     113,   113,   113,   113,   113,   113,   113,   114,   114,   114
-};
+#define YYPACT_NINF (-66)
 
-/* YYR2[YYN] -- Number of symbols composing right hand side of rule YYN.  */
-static const yytype_uint8 yyr2[] =
-{
-       0,     2,     0,     2,     3,     3,     9,     0,     3,     0,
-       3,     3,     0,     2,     1,     1,     0,     2,     1,     2,
-       1,     2,     3,     3,     3,     3,     1,     2,     4,     4,
-       3,     0,     2,     1,     1,     1,     1,     3,     1,     1,
-       1,     3,     3,     1,     3,     4,     3,     6,     0,     0,
-      11,     0,     9,     3,     3,     2,     3,     3,     3,     3,
-       3,     3,     3,     3,     3,     1,     1,     3,     1,     6,
-       1,     3,     0,     4,     1,     1,     3,     1,     1,     1,
-       1,     1,     3,     1,     1,     4,     4,     4,     4,     4,
-       4,     1,     1,     4,     1,     1,     3,     3,     3,     3,
-       3,     3,     3,     3,     2,     3,     3,     1,     1,     1
-};
+#define yypact_value_is_default(Yyn) \
+  ((Yyn) == YYPACT_NINF)
 
-/* YYDEFACT[STATE-NAME] -- Default rule to reduce with in state
-   STATE-NUM when YYTABLE doesn't specify something else to do.  Zero
-   means the default is an error.  */
-static const yytype_uint8 yydefact[] =
-{
-       2,     0,     1,    12,     3,     0,     5,     4,     0,    14,
-      15,    13,    16,     0,     0,    18,    17,     7,    19,     0,
-       9,     0,     0,     0,     0,     8,    20,     0,     0,     0,
-       0,    21,     0,    10,    26,     0,     6,    23,    22,    24,
-      25,     0,    27,    95,    43,    92,    94,    91,    65,    83,
-      84,    80,    81,     0,     0,     0,     0,     0,     0,     0,
-       0,    38,    39,     0,     0,     0,    11,     0,     0,    79,
-      31,    30,    31,     0,     0,     0,     0,    95,     0,     0,
-      79,     0,     0,     0,     0,     0,     0,    55,   104,     0,
-      79,     0,     0,     0,     0,     0,     0,     0,     0,     0,
-       0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
-       0,     0,     0,    28,    29,     0,    44,     0,     0,    46,
-       0,   107,   108,   109,    54,     0,     0,     0,     0,     0,
-       0,     0,     0,     0,    37,    82,    57,    56,    41,    66,
-      42,    74,    72,    53,   102,   103,   101,    63,    64,    62,
-      61,    59,    60,    58,   106,   105,    96,    97,    98,    99,
-     100,    34,    33,    35,    36,    32,    45,     0,     0,    93,
-      48,     0,    85,    86,    87,    88,    89,    90,     0,     0,
-       0,     0,    51,    77,    78,     0,    75,    47,     0,     0,
-       0,    68,     0,    73,     0,     0,     0,    70,    49,     0,
-      76,    69,    67,     0,     0,     0,    71,     0,    52,     0,
-      50
-};
+#define YYTABLE_NINF (-69)
 
-/* YYDEFGOTO[NTERM-NUM].  */
-static const yytype_int16 yydefgoto[] =
-{
-      -1,     1,     4,    20,    23,    29,     5,    11,    14,    16,
-      25,    26,    33,    34,   113,   165,    66,   181,   204,   192,
-      67,   190,   119,   196,   143,   178,   185,   186,    68,    69,
-     124
-};
+#define yytable_value_is_error(Yyn) \
+  0
 
 /* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
    STATE-NUM.  */
-#define YYPACT_NINF -77
 static const yytype_int16 yypact[] =
 {
-     -77,   119,   -77,   -35,   -77,    71,   -77,   -77,     6,   -77,
-     -77,   -77,   -43,    30,   -12,   -77,    50,    73,   -77,    23,
-     114,   115,    52,   121,    54,   115,   -77,   125,    56,    63,
-     -14,   -77,    64,   125,   -77,    55,   -77,   -77,   -77,   -77,
-     -77,   173,   -77,    25,    -7,   -77,    69,   -77,   -77,   -77,
-     -77,   -77,   -77,    95,   127,    80,    83,    84,    93,    94,
-      97,   -77,   -77,    55,   168,    55,    33,    44,   130,   338,
-     -77,   -77,   -77,   147,   -15,   168,   149,   -77,   168,    -9,
-     355,   168,   168,   168,   168,   168,   168,   -77,   -77,   -40,
-     193,    55,    55,   156,    62,   -19,   168,   168,   168,   168,
-     168,   168,   168,   168,   168,   168,   168,   168,   168,   168,
-     168,   168,   168,    86,    86,   168,   355,   101,   168,   -77,
-      47,   -77,   -77,   -77,   -77,   166,   150,   -19,   210,   227,
-     244,   261,   278,   295,   -77,   -77,   129,   -77,   -77,   -77,
-     -77,   -77,   -77,   -77,   319,   319,   319,   355,   355,   355,
-     355,   355,   355,   355,    78,    78,   169,   169,   -77,   -77,
-     -77,   -77,   -77,   -77,   -77,   -77,   355,   182,   148,   -77,
-     -77,   151,   -77,   -77,   -77,   -77,   -77,   -77,     9,   122,
-     143,   146,   -77,   -77,   -77,   -76,   -77,   -77,   168,   168,
-     153,   -77,   163,   -77,     9,   312,   -72,   148,   -77,    55,
-     -77,   -77,   -77,   168,   164,   -38,   355,    55,   -77,    39,
-     -77
+     -66,    88,   -66,   -66,   -66,   186,   -66,    15,   -66,   -66,
+     -66,   -60,    28,    -6,   -66,    75,    92,   -66,   -41,    98,
+     102,    42,   105,    55,   102,   -66,   121,    71,    69,   -14,
+     -66,    73,   121,   -66,   -66,   -66,   -66,   -66,   -66,   -66,
+     176,   -66,    68,   -66,   -66,   -66,   -39,    -1,   -66,    66,
+     -66,   -66,   -66,   -66,   -66,   -66,    87,   125,    79,    82,
+      83,    85,    93,    96,   -66,   -66,    68,   166,    68,   -31,
+      38,   135,   351,    99,    99,   145,   -18,   166,   151,   -66,
+     166,     6,   368,   166,   166,   166,   166,   166,   166,   -66,
+     -66,   -45,   190,   -66,   -66,   154,    50,   -19,   166,   166,
+     166,   166,   166,   166,   166,   166,   166,   166,   166,   166,
+     166,   166,   166,   166,   166,   -66,   -66,   -66,   -66,   -66,
+     166,   368,   100,   166,   -66,    60,   -66,   -66,   -66,   -66,
+     207,   147,   -19,   224,   241,   258,   275,   292,   309,   -66,
+     -66,    68,    68,   -66,   -66,   -66,   -66,   -66,   -66,     5,
+       5,     5,   368,   368,   368,   368,   368,   368,   368,   165,
+     165,   142,   142,   -66,   -66,   -66,   368,   163,   160,   -66,
+     -66,   126,   -66,   -66,   -66,   -66,   -66,   -66,   150,   -66,
+      -2,   140,   134,   143,   -66,   -66,   -66,    21,   -66,   -66,
+     166,   166,   144,   -66,   146,   -66,    -2,   326,    24,   160,
+     -66,    68,   -66,   -66,   -66,   166,   159,     9,   368,    68,
+     -66,    12,   -66
+};
+
+/* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
+   Performed when YYTABLE does not specify something else to do.  Zero
+   means the default is an error.  */
+static const yytype_int8 yydefact[] =
+{
+       2,     0,     1,    12,     3,     0,     4,     0,    14,    15,
+      13,    16,     0,     0,    18,    17,     6,    19,     0,     8,
+       0,     0,     0,     0,     7,    20,     0,     0,     0,     0,
+      21,     0,     9,    26,    10,     5,    23,    22,    24,    25,
+       0,    27,     0,    31,    30,    31,    97,    43,    94,    96,
+      93,    67,    85,    86,    82,    83,     0,     0,     0,     0,
+       0,     0,     0,     0,    38,    39,     0,     0,     0,    11,
+       0,     0,    81,    28,    29,     0,     0,     0,     0,    97,
+       0,     0,    81,     0,     0,     0,     0,     0,     0,    55,
+     106,     0,    81,    58,    56,     0,     0,     0,     0,     0,
+       0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+       0,     0,     0,     0,     0,    34,    33,    35,    36,    32,
+       0,    44,     0,     0,    46,     0,   109,   110,   111,    54,
+       0,     0,     0,     0,     0,     0,     0,     0,     0,    37,
+      84,     0,     0,    41,    68,    42,    76,    74,    53,   104,
+     105,   103,    60,    62,    61,    63,    64,    66,    65,   107,
+     108,    98,    99,   100,   101,   102,    45,     0,     0,    95,
+      48,     0,    87,    88,    89,    90,    91,    92,    59,    57,
+       0,     0,     0,     0,    51,    79,    80,     0,    77,    47,
+       0,     0,     0,    70,     0,    75,     0,     0,     0,    72,
+      49,     0,    78,    71,    69,     0,     0,     0,    73,     0,
+      52,     0,    50
 };
 
 /* YYPGOTO[NTERM-NUM].  */
 static const yytype_int16 yypgoto[] =
 {
-     -77,   -77,   223,   -77,   -77,   -77,   -77,   -77,   -77,   -77,
-     -77,   218,   -77,   211,   195,   -77,   -57,   -77,   -77,   -77,
-     174,   -77,    88,   -77,   144,   -77,   -77,    76,   219,   -54,
-     -77
+     -66,   -66,   218,   -66,   -66,   -66,   -66,   -66,   -66,   -66,
+     -66,   -66,   213,   -66,   208,   196,   -66,   -65,   -66,   -66,
+     -66,   -66,   -66,   168,   -66,    59,   -66,   133,   -66,   -66,
+      70,   210,   -57,   -66
+};
+
+/* YYDEFGOTO[NTERM-NUM].  */
+static const yytype_uint8 yydefgoto[] =
+{
+       0,     1,     4,    19,    22,    28,    42,     5,    10,    13,
+      15,    24,    25,    32,    33,    73,   119,    69,   183,   206,
+     194,   142,   141,    70,   192,   124,   198,   148,   180,   187,
+     188,    71,    72,   129
 };
 
-/* YYTABLE[YYPACT[STATE-NUM]].  What to do in state STATE-NUM.  If
-   positive, shift that token.  If negative, reduce the rule which
-   number is the opposite.  If zero, do what YYDEFACT says.
-   If YYTABLE_NINF, syntax error.  */
-#define YYTABLE_NINF -67
+/* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
+   positive, shift that token.  If negative, reduce the rule whose
+   number is the opposite.  If YYTABLE_NINF, syntax error.  */
 static const yytype_int16 yytable[] =
 {
-      80,   126,    37,   193,    38,   194,    87,   202,    89,   203,
-      88,    90,    91,    92,    91,    92,    12,   141,    73,   116,
-     183,   120,   117,   184,   125,   127,    74,   128,   129,   130,
-     131,   132,   133,    13,   136,   137,    39,    40,     6,   134,
-      15,   208,   144,   145,   146,   147,   148,   149,   150,   151,
-     152,   153,   154,   155,   156,   157,   158,   159,   160,   142,
-      18,   166,    17,   118,   168,    43,    44,    45,    46,   -66,
-     -66,    47,   139,    48,     8,     9,    10,   -40,   -40,    19,
-      48,    49,    50,    51,    52,    91,    92,    53,    93,    94,
-      54,    91,    92,    55,    56,    57,    58,    59,    60,    21,
-     -40,    96,    97,    98,   -40,    61,    62,   161,   162,   163,
-     164,   106,   107,   108,   109,   110,   111,   112,   210,     2,
-       3,    22,   -12,   -12,   -12,    24,    63,    64,    27,    28,
-     169,    30,    35,    65,   195,   197,    32,    77,    36,    45,
-      46,    41,   205,    47,   108,   109,   110,   111,   112,   206,
-     209,    75,    76,    49,    50,    51,    52,    77,    81,    45,
-      46,    82,    83,    47,    95,    55,    56,    57,    58,    59,
-      60,    84,    85,    49,    50,    86,   138,   115,    77,   167,
-      45,    46,    92,   170,    47,    55,    56,    57,    58,    59,
-      60,    70,    71,    72,    49,    50,   121,   122,   123,    64,
-     179,   187,    96,    97,    98,    78,    55,    56,    57,    58,
-      59,    60,   106,   107,   108,   109,   110,   111,   112,    64,
-      96,    97,    98,   188,   189,    78,     7,   182,   180,   198,
-     106,   107,   108,   109,   110,   111,   112,   110,   111,   112,
-      64,   199,   207,    31,    42,   135,    78,    96,    97,    98,
-      99,   100,   101,   102,   103,   104,   105,   106,   107,   108,
-     109,   110,   111,   112,    96,    97,    98,   114,   140,   191,
-     200,   171,   135,    79,   106,   107,   108,   109,   110,   111,
-     112,    96,    97,    98,     0,     0,     0,     0,     0,   172,
-       0,   106,   107,   108,   109,   110,   111,   112,    96,    97,
-      98,     0,     0,     0,     0,     0,   173,     0,   106,   107,
-     108,   109,   110,   111,   112,    96,    97,    98,     0,     0,
-       0,     0,     0,   174,     0,   106,   107,   108,   109,   110,
-     111,   112,    96,    97,    98,     0,     0,     0,     0,     0,
-     175,     0,   106,   107,   108,   109,   110,   111,   112,    96,
-      97,    98,     0,     0,     0,     0,     0,   176,     0,   106,
-     107,   108,   109,   110,   111,   112,    96,    97,    98,     0,
-       0,     0,     0,     0,   177,     0,   106,   107,   108,   109,
-     110,   111,   112,   106,   107,   108,   109,   110,   111,   112,
-       0,   201,    96,    97,    98,    99,   100,   101,   102,   103,
-     104,   105,   106,   107,   108,   109,   110,   111,   112,    96,
-      97,    98,     0,     0,     0,     0,     0,     0,     0,   106,
-     107,   108,   109,   110,   111,   112
+      82,    89,    36,    91,    37,   -68,   -68,    93,    94,   185,
+      90,    92,   186,   -40,   -40,    12,   131,   146,   121,   122,
+     125,    93,    94,   130,    75,    11,   133,   134,   135,   136,
+     137,   138,    76,   139,    20,   -40,    38,    39,    14,   -40,
+     132,   149,   150,   151,   152,   153,   154,   155,   156,   157,
+     158,   159,   160,   161,   162,   163,   164,   165,   147,   123,
+     144,    93,    94,   166,    93,    94,   168,    16,    51,   108,
+     109,   110,   111,   112,   113,   114,   178,   179,    46,    47,
+      48,    49,    95,    96,    50,    17,    51,   210,     2,     3,
+     212,   -12,   -12,   -12,    52,    53,    54,    55,    18,   195,
+      56,   196,   204,    57,   205,    21,    58,    59,    60,    61,
+      62,    63,    23,    27,    98,    99,   100,    26,    64,    65,
+     115,   116,   117,   118,   108,   109,   110,   111,   112,   113,
+     114,    29,    31,   197,   199,    79,   207,    48,    49,    66,
+      67,    50,   169,    35,   211,    68,    34,    77,   208,    40,
+      78,    52,    53,    54,    55,    79,    83,    48,    49,    84,
+      85,    50,    86,    58,    59,    60,    61,    62,    63,    97,
+      87,    52,    53,    88,   143,   120,    79,   167,    48,    49,
+     170,   181,    50,    58,    59,    60,    61,    62,    63,     7,
+       8,     9,    52,    53,    43,    44,    45,    67,   126,   127,
+     128,   184,    80,    94,    58,    59,    60,    61,    62,    63,
+     112,   113,   114,   190,    98,    99,   100,    67,   189,   200,
+     191,     6,    80,   201,   108,   109,   110,   111,   112,   113,
+     114,   110,   111,   112,   113,   114,   209,    30,    67,   182,
+      41,    74,   193,    80,    98,    99,   100,   101,   102,   103,
+     104,   105,   106,   107,   108,   109,   110,   111,   112,   113,
+     114,    98,    99,   100,   145,   171,   202,    81,   140,     0,
+       0,   108,   109,   110,   111,   112,   113,   114,    98,    99,
+     100,     0,     0,     0,     0,   140,     0,     0,   108,   109,
+     110,   111,   112,   113,   114,    98,    99,   100,     0,     0,
+       0,     0,   172,     0,     0,   108,   109,   110,   111,   112,
+     113,   114,    98,    99,   100,     0,     0,     0,     0,   173,
+       0,     0,   108,   109,   110,   111,   112,   113,   114,    98,
+      99,   100,     0,     0,     0,     0,   174,     0,     0,   108,
+     109,   110,   111,   112,   113,   114,    98,    99,   100,     0,
+       0,     0,     0,   175,     0,     0,   108,   109,   110,   111,
+     112,   113,   114,    98,    99,   100,     0,     0,     0,     0,
+     176,     0,     0,   108,   109,   110,   111,   112,   113,   114,
+      98,    99,   100,     0,     0,     0,     0,   177,     0,     0,
+     108,   109,   110,   111,   112,   113,   114,     0,     0,     0,
+       0,     0,     0,     0,   203,    98,    99,   100,   101,   102,
+     103,   104,   105,   106,   107,   108,   109,   110,   111,   112,
+     113,   114,    98,    99,   100,     0,     0,     0,     0,     0,
+       0,     0,   108,   109,   110,   111,   112,   113,   114
 };
 
 static const yytype_int16 yycheck[] =
 {
-      54,    10,    16,    79,    18,    81,    63,    79,    65,    81,
-      64,    65,    52,    53,    52,    53,    10,    36,    25,    73,
-      11,    75,    37,    14,    78,    34,    33,    81,    82,    83,
-      84,    85,    86,    76,    91,    92,    50,    51,    73,    79,
-      10,    79,    96,    97,    98,    99,   100,   101,   102,   103,
-     104,   105,   106,   107,   108,   109,   110,   111,   112,    78,
-      10,   115,    74,    78,   118,    10,    11,    12,    13,    44,
-      45,    16,    10,    18,     3,     4,     5,    52,    53,     6,
-      18,    26,    27,    28,    29,    52,    53,    32,    44,    45,
-      35,    52,    53,    38,    39,    40,    41,    42,    43,    76,
-      75,    54,    55,    56,    79,    50,    51,    21,    22,    23,
-      24,    64,    65,    66,    67,    68,    69,    70,    79,     0,
-       1,     7,     3,     4,     5,    10,    71,    72,    76,     8,
-      83,    77,    76,    78,   188,   189,    11,    10,    75,    12,
-      13,    77,   199,    16,    66,    67,    68,    69,    70,   203,
-     207,    82,    57,    26,    27,    28,    29,    10,    78,    12,
-      13,    78,    78,    16,    34,    38,    39,    40,    41,    42,
-      43,    78,    78,    26,    27,    78,    20,    30,    10,    78,
-      12,    13,    53,    33,    16,    38,    39,    40,    41,    42,
-      43,    18,    19,    20,    26,    27,    47,    48,    49,    72,
-      18,    79,    54,    55,    56,    78,    38,    39,    40,    41,
-      42,    43,    64,    65,    66,    67,    68,    69,    70,    72,
-      54,    55,    56,    80,    78,    78,     3,    76,    80,    76,
-      64,    65,    66,    67,    68,    69,    70,    68,    69,    70,
-      72,    78,    78,    25,    33,    79,    78,    54,    55,    56,
-      57,    58,    59,    60,    61,    62,    63,    64,    65,    66,
-      67,    68,    69,    70,    54,    55,    56,    72,    94,   181,
-     194,   127,    79,    54,    64,    65,    66,    67,    68,    69,
-      70,    54,    55,    56,    -1,    -1,    -1,    -1,    -1,    79,
+      57,    66,    16,    68,    18,    44,    45,    52,    53,    11,
+      67,    68,    14,    52,    53,    75,    10,    36,    75,    37,
+      77,    52,    53,    80,    25,    10,    83,    84,    85,    86,
+      87,    88,    33,    78,    75,    74,    50,    51,    10,    78,
+      34,    98,    99,   100,   101,   102,   103,   104,   105,   106,
+     107,   108,   109,   110,   111,   112,   113,   114,    77,    77,
+      10,    52,    53,   120,    52,    53,   123,    73,    18,    64,
+      65,    66,    67,    68,    69,    70,   141,   142,    10,    11,
+      12,    13,    44,    45,    16,    10,    18,    78,     0,     1,
+      78,     3,     4,     5,    26,    27,    28,    29,     6,    78,
+      32,    80,    78,    35,    80,     7,    38,    39,    40,    41,
+      42,    43,    10,     8,    54,    55,    56,    75,    50,    51,
+      21,    22,    23,    24,    64,    65,    66,    67,    68,    69,
+      70,    76,    11,   190,   191,    10,   201,    12,    13,    71,
+      72,    16,    82,    74,   209,    77,    75,    81,   205,    76,
+      63,    26,    27,    28,    29,    10,    77,    12,    13,    77,
+      77,    16,    77,    38,    39,    40,    41,    42,    43,    34,
+      77,    26,    27,    77,    20,    30,    10,    77,    12,    13,
+      33,    18,    16,    38,    39,    40,    41,    42,    43,     3,
+       4,     5,    26,    27,    18,    19,    20,    72,    47,    48,
+      49,    75,    77,    53,    38,    39,    40,    41,    42,    43,
+      68,    69,    70,    79,    54,    55,    56,    72,    78,    75,
+      77,     3,    77,    77,    64,    65,    66,    67,    68,    69,
+      70,    66,    67,    68,    69,    70,    77,    24,    72,    79,
+      32,    45,   183,    77,    54,    55,    56,    57,    58,    59,
+      60,    61,    62,    63,    64,    65,    66,    67,    68,    69,
+      70,    54,    55,    56,    96,   132,   196,    57,    78,    -1,
       -1,    64,    65,    66,    67,    68,    69,    70,    54,    55,
-      56,    -1,    -1,    -1,    -1,    -1,    79,    -1,    64,    65,
+      56,    -1,    -1,    -1,    -1,    78,    -1,    -1,    64,    65,
       66,    67,    68,    69,    70,    54,    55,    56,    -1,    -1,
-      -1,    -1,    -1,    79,    -1,    64,    65,    66,    67,    68,
-      69,    70,    54,    55,    56,    -1,    -1,    -1,    -1,    -1,
-      79,    -1,    64,    65,    66,    67,    68,    69,    70,    54,
-      55,    56,    -1,    -1,    -1,    -1,    -1,    79,    -1,    64,
+      -1,    -1,    78,    -1,    -1,    64,    65,    66,    67,    68,
+      69,    70,    54,    55,    56,    -1,    -1,    -1,    -1,    78,
+      -1,    -1,    64,    65,    66,    67,    68,    69,    70,    54,
+      55,    56,    -1,    -1,    -1,    -1,    78,    -1,    -1,    64,
       65,    66,    67,    68,    69,    70,    54,    55,    56,    -1,
-      -1,    -1,    -1,    -1,    79,    -1,    64,    65,    66,    67,
-      68,    69,    70,    64,    65,    66,    67,    68,    69,    70,
-      -1,    79,    54,    55,    56,    57,    58,    59,    60,    61,
-      62,    63,    64,    65,    66,    67,    68,    69,    70,    54,
-      55,    56,    -1,    -1,    -1,    -1,    -1,    -1,    -1,    64,
-      65,    66,    67,    68,    69,    70
+      -1,    -1,    -1,    78,    -1,    -1,    64,    65,    66,    67,
+      68,    69,    70,    54,    55,    56,    -1,    -1,    -1,    -1,
+      78,    -1,    -1,    64,    65,    66,    67,    68,    69,    70,
+      54,    55,    56,    -1,    -1,    -1,    -1,    78,    -1,    -1,
+      64,    65,    66,    67,    68,    69,    70,    -1,    -1,    -1,
+      -1,    -1,    -1,    -1,    78,    54,    55,    56,    57,    58,
+      59,    60,    61,    62,    63,    64,    65,    66,    67,    68,
+      69,    70,    54,    55,    56,    -1,    -1,    -1,    -1,    -1,
+      -1,    -1,    64,    65,    66,    67,    68,    69,    70
 };
 
-/* YYSTOS[STATE-NUM] -- The (internal number of the) accessing
-   symbol of state STATE-NUM.  */
-static const yytype_uint8 yystos[] =
+/* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
+   state STATE-NUM.  */
+static const yytype_int8 yystos[] =
 {
-       0,    85,     0,     1,    86,    90,    73,    86,     3,     4,
-       5,    91,    10,    76,    92,    10,    93,    74,    10,     6,
-      87,    76,     7,    88,    10,    94,    95,    76,     8,    89,
-      77,    95,    11,    96,    97,    76,    75,    16,    18,    50,
-      51,    77,    97,    10,    11,    12,    13,    16,    18,    26,
-      27,    28,    29,    32,    35,    38,    39,    40,    41,    42,
-      43,    50,    51,    71,    72,    78,   100,   104,   112,   113,
-      18,    19,    20,    25,    33,    82,    57,    10,    78,   112,
-     113,    78,    78,    78,    78,    78,    78,   100,   113,   100,
-     113,    52,    53,    44,    45,    34,    54,    55,    56,    57,
-      58,    59,    60,    61,    62,    63,    64,    65,    66,    67,
-      68,    69,    70,    98,    98,    30,   113,    37,    78,   106,
-     113,    47,    48,    49,   114,   113,    10,    34,   113,   113,
-     113,   113,   113,   113,    79,    79,   100,   100,    20,    10,
-     104,    36,    78,   108,   113,   113,   113,   113,   113,   113,
-     113,   113,   113,   113,   113,   113,   113,   113,   113,   113,
-     113,    21,    22,    23,    24,    99,   113,    78,   113,    83,
-      33,   108,    79,    79,    79,    79,    79,    79,   109,    18,
-      80,   101,    76,    11,    14,   110,   111,    79,    80,    78,
-     105,   106,   103,    79,    81,   113,   107,   113,    76,    78,
-     111,    79,    79,    81,   102,   100,   113,    78,    79,   100,
-      79
+       0,    84,     0,     1,    85,    90,    85,     3,     4,     5,
+      91,    10,    75,    92,    10,    93,    73,    10,     6,    86,
+      75,     7,    87,    10,    94,    95,    75,     8,    88,    76,
+      95,    11,    96,    97,    75,    74,    16,    18,    50,    51,
+      76,    97,    89,    18,    19,    20,    10,    11,    12,    13,
+      16,    18,    26,    27,    28,    29,    32,    35,    38,    39,
+      40,    41,    42,    43,    50,    51,    71,    72,    77,   100,
+     106,   114,   115,    98,    98,    25,    33,    81,    63,    10,
+      77,   114,   115,    77,    77,    77,    77,    77,    77,   100,
+     115,   100,   115,    52,    53,    44,    45,    34,    54,    55,
+      56,    57,    58,    59,    60,    61,    62,    63,    64,    65,
+      66,    67,    68,    69,    70,    21,    22,    23,    24,    99,
+      30,   115,    37,    77,   108,   115,    47,    48,    49,   116,
+     115,    10,    34,   115,   115,   115,   115,   115,   115,    78,
+      78,   105,   104,    20,    10,   106,    36,    77,   110,   115,
+     115,   115,   115,   115,   115,   115,   115,   115,   115,   115,
+     115,   115,   115,   115,   115,   115,   115,    77,   115,    82,
+      33,   110,    78,    78,    78,    78,    78,    78,   100,   100,
+     111,    18,    79,   101,    75,    11,    14,   112,   113,    78,
+      79,    77,   107,   108,   103,    78,    80,   115,   109,   115,
+      75,    77,   113,    78,    78,    80,   102,   100,   115,    77,
+      78,   100,    78
 };
 
-#define yyerrok		(yyerrstatus = 0)
-#define yyclearin	(yychar = YYEMPTY)
-#define YYEMPTY		(-2)
-#define YYEOF		0
-
-#define YYACCEPT	goto yyacceptlab
-#define YYABORT		goto yyabortlab
-#define YYERROR		goto yyerrorlab
-
+/* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr1[] =
+{
+       0,    83,    84,    84,    84,    85,    86,    86,    87,    87,
+      89,    88,    90,    90,    91,    91,    92,    92,    93,    93,
+      94,    94,    95,    95,    95,    95,    96,    96,    97,    97,
+      97,    98,    98,    99,    99,    99,    99,   100,   100,   100,
+     100,   100,   100,   100,   100,   100,   100,   100,   101,   102,
+     100,   103,   100,   100,   100,   100,   104,   100,   105,   100,
+     100,   100,   100,   100,   100,   100,   100,   106,   106,   107,
+     107,   108,   109,   109,   111,   110,   110,   112,   112,   113,
+     113,   114,   114,   114,   115,   115,   115,   115,   115,   115,
+     115,   115,   115,   115,   115,   115,   115,   115,   115,   115,
+     115,   115,   115,   115,   115,   115,   115,   115,   115,   116,
+     116,   116
+};
 
-/* Like YYERROR except do call yyerror.  This remains here temporarily
-   to ease the transition to the new meaning of YYERROR, for GCC.
-   Once GCC version 2 has supplanted version 1, this can go.  */
+/* YYR2[RULE-NUM] -- Number of symbols on the right-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr2[] =
+{
+       0,     2,     0,     2,     3,     9,     0,     3,     0,     3,
+       0,     4,     0,     2,     1,     1,     0,     2,     1,     2,
+       1,     2,     3,     3,     3,     3,     1,     2,     4,     4,
+       3,     0,     2,     1,     1,     1,     1,     3,     1,     1,
+       1,     3,     3,     1,     3,     4,     3,     6,     0,     0,
+      11,     0,     9,     3,     3,     2,     0,     4,     0,     4,
+       3,     3,     3,     3,     3,     3,     3,     1,     1,     3,
+       1,     6,     1,     3,     0,     4,     1,     1,     3,     1,
+       1,     1,     1,     1,     3,     1,     1,     4,     4,     4,
+       4,     4,     4,     1,     1,     4,     1,     1,     3,     3,
+       3,     3,     3,     3,     3,     3,     2,     3,     3,     1,
+       1,     1
+};
 
-#define YYFAIL		goto yyerrlab
 
-#define YYRECOVERING()  (!!yyerrstatus)
+enum { YYENOMEM = -2 };
 
-#define YYBACKUP(Token, Value)					\
-do								\
-  if (yychar == YYEMPTY && yylen == 1)				\
-    {								\
-      yychar = (Token);						\
-      yylval = (Value);						\
-      yytoken = YYTRANSLATE (yychar);				\
-      YYPOPSTACK (1);						\
-      goto yybackup;						\
-    }								\
-  else								\
-    {								\
-      yyerror (yyscanner, YY_("syntax error: cannot back up")); \
-      YYERROR;							\
-    }								\
-while (YYID (0))
-
-
-#define YYTERROR	1
-#define YYERRCODE	256
-
-
-/* YYLLOC_DEFAULT -- Set CURRENT to span from RHS[1] to RHS[N].
-   If N is 0, then set CURRENT to the empty location which ends
-   the previous symbol: RHS[0] (always defined).  */
-
-#define YYRHSLOC(Rhs, K) ((Rhs)[K])
-#ifndef YYLLOC_DEFAULT
-# define YYLLOC_DEFAULT(Current, Rhs, N)				\
-    do									\
-      if (YYID (N))                                                    \
-	{								\
-	  (Current).first_line   = YYRHSLOC (Rhs, 1).first_line;	\
-	  (Current).first_column = YYRHSLOC (Rhs, 1).first_column;	\
-	  (Current).last_line    = YYRHSLOC (Rhs, N).last_line;		\
-	  (Current).last_column  = YYRHSLOC (Rhs, N).last_column;	\
-	}								\
-      else								\
-	{								\
-	  (Current).first_line   = (Current).last_line   =		\
-	    YYRHSLOC (Rhs, 0).last_line;				\
-	  (Current).first_column = (Current).last_column =		\
-	    YYRHSLOC (Rhs, 0).last_column;				\
-	}								\
-    while (YYID (0))
-#endif
+#define yyerrok         (yyerrstatus = 0)
+#define yyclearin       (yychar = YYEMPTY)
 
+#define YYACCEPT        goto yyacceptlab
+#define YYABORT         goto yyabortlab
+#define YYERROR         goto yyerrorlab
+#define YYNOMEM         goto yyexhaustedlab
 
-/* YY_LOCATION_PRINT -- Print the location on the stream.
-   This macro was not mandated originally: define only if we know
-   we won't break user code: when these are the locations we know.  */
 
-#ifndef YY_LOCATION_PRINT
-# if defined YYLTYPE_IS_TRIVIAL && YYLTYPE_IS_TRIVIAL
-#  define YY_LOCATION_PRINT(File, Loc)			\
-     fprintf (File, "%d.%d-%d.%d",			\
-	      (Loc).first_line, (Loc).first_column,	\
-	      (Loc).last_line,  (Loc).last_column)
-# else
-#  define YY_LOCATION_PRINT(File, Loc) ((void) 0)
-# endif
-#endif
+#define YYRECOVERING()  (!!yyerrstatus)
 
+#define YYBACKUP(Token, Value)                                    \
+  do                                                              \
+    if (yychar == YYEMPTY)                                        \
+      {                                                           \
+        yychar = (Token);                                         \
+        yylval = (Value);                                         \
+        YYPOPSTACK (yylen);                                       \
+        yystate = *yyssp;                                         \
+        goto yybackup;                                            \
+      }                                                           \
+    else                                                          \
+      {                                                           \
+        yyerror (yyscanner, YY_("syntax error: cannot back up")); \
+        YYERROR;                                                  \
+      }                                                           \
+  while (0)
+
+/* Backward compatibility with an undocumented macro.
+   Use YYerror or YYUNDEF. */
+#define YYERRCODE YYUNDEF
 
-/* YYLEX -- calling `yylex' with the right arguments.  */
-
-#ifdef YYLEX_PARAM
-# define YYLEX yylex (&yylval, YYLEX_PARAM)
-#else
-# define YYLEX yylex (&yylval, yyscanner)
-#endif
 
 /* Enable debugging if requested.  */
 #if YYDEBUG
@@ -1005,83 +985,59 @@ while (YYID (0))
 #  define YYFPRINTF fprintf
 # endif
 
-# define YYDPRINTF(Args)			\
-do {						\
-  if (yydebug)					\
-    YYFPRINTF Args;				\
-} while (YYID (0))
-
-# define YY_SYMBOL_PRINT(Title, Type, Value, Location)			  \
-do {									  \
-  if (yydebug)								  \
-    {									  \
-      YYFPRINTF (stderr, "%s ", Title);					  \
-      yy_symbol_print (stderr,						  \
-		  Type, Value, yyscanner); \
-      YYFPRINTF (stderr, "\n");						  \
-    }									  \
-} while (YYID (0))
-
-
-/*--------------------------------.
-| Print this symbol on YYOUTPUT.  |
-`--------------------------------*/
-
-/*ARGSUSED*/
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static void
-yy_symbol_value_print (FILE *yyoutput, int yytype, YYSTYPE const * const yyvaluep, void *yyscanner)
-#else
+# define YYDPRINTF(Args)                        \
+do {                                            \
+  if (yydebug)                                  \
+    YYFPRINTF Args;                             \
+} while (0)
+
+
+
+
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)                    \
+do {                                                                      \
+  if (yydebug)                                                            \
+    {                                                                     \
+      YYFPRINTF (stderr, "%s ", Title);                                   \
+      yy_symbol_print (stderr,                                            \
+                  Kind, Value, yyscanner); \
+      YYFPRINTF (stderr, "\n");                                           \
+    }                                                                     \
+} while (0)
+
+
+/*-----------------------------------.
+| Print this symbol's value on YYO.  |
+`-----------------------------------*/
+
 static void
-yy_symbol_value_print (yyoutput, yytype, yyvaluep, yyscanner)
-    FILE *yyoutput;
-    int yytype;
-    YYSTYPE const * const yyvaluep;
-    void *yyscanner;
-#endif
+yy_symbol_value_print (FILE *yyo,
+                       yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, void *yyscanner)
 {
+  FILE *yyoutput = yyo;
+  YY_USE (yyoutput);
+  YY_USE (yyscanner);
   if (!yyvaluep)
     return;
-  YYUSE (yyscanner);
-# ifdef YYPRINT
-  if (yytype < YYNTOKENS)
-    YYPRINT (yyoutput, yytoknum[yytype], *yyvaluep);
-# else
-  YYUSE (yyoutput);
-# endif
-  switch (yytype)
-    {
-      default:
-	break;
-    }
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  YY_USE (yykind);
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
 }
 
 
-/*--------------------------------.
-| Print this symbol on YYOUTPUT.  |
-`--------------------------------*/
+/*---------------------------.
+| Print this symbol on YYO.  |
+`---------------------------*/
 
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static void
-yy_symbol_print (FILE *yyoutput, int yytype, YYSTYPE const * const yyvaluep, void *yyscanner)
-#else
 static void
-yy_symbol_print (yyoutput, yytype, yyvaluep, yyscanner)
-    FILE *yyoutput;
-    int yytype;
-    YYSTYPE const * const yyvaluep;
-    void *yyscanner;
-#endif
+yy_symbol_print (FILE *yyo,
+                 yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, void *yyscanner)
 {
-  if (yytype < YYNTOKENS)
-    YYFPRINTF (yyoutput, "token %s (", yytname[yytype]);
-  else
-    YYFPRINTF (yyoutput, "nterm %s (", yytname[yytype]);
+  YYFPRINTF (yyo, "%s %s (",
+             yykind < YYNTOKENS ? "token" : "nterm", yysymbol_name (yykind));
 
-  yy_symbol_value_print (yyoutput, yytype, yyvaluep, yyscanner);
-  YYFPRINTF (yyoutput, ")");
+  yy_symbol_value_print (yyo, yykind, yyvaluep, yyscanner);
+  YYFPRINTF (yyo, ")");
 }
 
 /*------------------------------------------------------------------.
@@ -1089,81 +1045,68 @@ yy_symbol_print (yyoutput, yytype, yyvaluep, yyscanner)
 | TOP (included).                                                   |
 `------------------------------------------------------------------*/
 
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static void
-yy_stack_print (yytype_int16 *bottom, yytype_int16 *top)
-#else
 static void
-yy_stack_print (bottom, top)
-    yytype_int16 *bottom;
-    yytype_int16 *top;
-#endif
+yy_stack_print (yy_state_t *yybottom, yy_state_t *yytop)
 {
   YYFPRINTF (stderr, "Stack now");
-  for (; bottom <= top; ++bottom)
-    YYFPRINTF (stderr, " %d", *bottom);
+  for (; yybottom <= yytop; yybottom++)
+    {
+      int yybot = *yybottom;
+      YYFPRINTF (stderr, " %d", yybot);
+    }
   YYFPRINTF (stderr, "\n");
 }
 
-# define YY_STACK_PRINT(Bottom, Top)				\
-do {								\
-  if (yydebug)							\
-    yy_stack_print ((Bottom), (Top));				\
-} while (YYID (0))
+# define YY_STACK_PRINT(Bottom, Top)                            \
+do {                                                            \
+  if (yydebug)                                                  \
+    yy_stack_print ((Bottom), (Top));                           \
+} while (0)
 
 
 /*------------------------------------------------.
 | Report that the YYRULE is going to be reduced.  |
 `------------------------------------------------*/
 
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static void
-yy_reduce_print (YYSTYPE *yyvsp, int yyrule, void *yyscanner)
-#else
 static void
-yy_reduce_print (yyvsp, yyrule, yyscanner)
-    YYSTYPE *yyvsp;
-    int yyrule;
-    void *yyscanner;
-#endif
+yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp,
+                 int yyrule, void *yyscanner)
 {
+  int yylno = yyrline[yyrule];
   int yynrhs = yyr2[yyrule];
   int yyi;
-  unsigned long int yylno = yyrline[yyrule];
-  YYFPRINTF (stderr, "Reducing stack by rule %d (line %lu):\n",
-	     yyrule - 1, yylno);
+  YYFPRINTF (stderr, "Reducing stack by rule %d (line %d):\n",
+             yyrule - 1, yylno);
   /* The symbols being reduced.  */
   for (yyi = 0; yyi < yynrhs; yyi++)
     {
-      fprintf (stderr, "   $%d = ", yyi + 1);
-      yy_symbol_print (stderr, yyrhs[yyprhs[yyrule] + yyi],
-		       &(yyvsp[(yyi + 1) - (yynrhs)])
-		       		       , yyscanner);
-      fprintf (stderr, "\n");
+      YYFPRINTF (stderr, "   $%d = ", yyi + 1);
+      yy_symbol_print (stderr,
+                       YY_ACCESSING_SYMBOL (+yyssp[yyi + 1 - yynrhs]),
+                       &yyvsp[(yyi + 1) - (yynrhs)], yyscanner);
+      YYFPRINTF (stderr, "\n");
     }
 }
 
-# define YY_REDUCE_PRINT(Rule)		\
-do {					\
-  if (yydebug)				\
-    yy_reduce_print (yyvsp, Rule, yyscanner); \
-} while (YYID (0))
+# define YY_REDUCE_PRINT(Rule)          \
+do {                                    \
+  if (yydebug)                          \
+    yy_reduce_print (yyssp, yyvsp, Rule, yyscanner); \
+} while (0)
 
 /* Nonzero means print parse trace.  It is left uninitialized so that
    multiple parsers can coexist.  */
 int yydebug;
 #else /* !YYDEBUG */
-# define YYDPRINTF(Args)
-# define YY_SYMBOL_PRINT(Title, Type, Value, Location)
+# define YYDPRINTF(Args) ((void) 0)
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)
 # define YY_STACK_PRINT(Bottom, Top)
 # define YY_REDUCE_PRINT(Rule)
 #endif /* !YYDEBUG */
 
 
 /* YYINITDEPTH -- initial size of the parser's stacks.  */
-#ifndef	YYINITDEPTH
+#ifndef YYINITDEPTH
 # define YYINITDEPTH 200
 #endif
 
@@ -1178,49 +1121,81 @@ int yydebug;
 # define YYMAXDEPTH 10000
 #endif
 
-
 
-#if YYERROR_VERBOSE
+/* Context of a parse error.  */
+typedef struct
+{
+  yy_state_t *yyssp;
+  yysymbol_kind_t yytoken;
+} yypcontext_t;
+
+/* Put in YYARG at most YYARGN of the expected tokens given the
+   current YYCTX, and return the number of tokens stored in YYARG.  If
+   YYARG is null, return the number of expected tokens (guaranteed to
+   be less than YYNTOKENS).  Return YYENOMEM on memory exhaustion.
+   Return 0 if there are more than YYARGN expected tokens, yet fill
+   YYARG up to YYARGN. */
+static int
+yypcontext_expected_tokens (const yypcontext_t *yyctx,
+                            yysymbol_kind_t yyarg[], int yyargn)
+{
+  /* Actual size of YYARG. */
+  int yycount = 0;
+  int yyn = yypact[+*yyctx->yyssp];
+  if (!yypact_value_is_default (yyn))
+    {
+      /* Start YYX at -YYN if negative to avoid negative indexes in
+         YYCHECK.  In other words, skip the first -YYN actions for
+         this state because they are default actions.  */
+      int yyxbegin = yyn < 0 ? -yyn : 0;
+      /* Stay within bounds of both yycheck and yytname.  */
+      int yychecklim = YYLAST - yyn + 1;
+      int yyxend = yychecklim < YYNTOKENS ? yychecklim : YYNTOKENS;
+      int yyx;
+      for (yyx = yyxbegin; yyx < yyxend; ++yyx)
+        if (yycheck[yyx + yyn] == yyx && yyx != YYSYMBOL_YYerror
+            && !yytable_value_is_error (yytable[yyx + yyn]))
+          {
+            if (!yyarg)
+              ++yycount;
+            else if (yycount == yyargn)
+              return 0;
+            else
+              yyarg[yycount++] = YY_CAST (yysymbol_kind_t, yyx);
+          }
+    }
+  if (yyarg && yycount == 0 && 0 < yyargn)
+    yyarg[0] = YYSYMBOL_YYEMPTY;
+  return yycount;
+}
 
-# ifndef yystrlen
-#  if defined __GLIBC__ && defined _STRING_H
-#   define yystrlen strlen
-#  else
+
+
+
+#ifndef yystrlen
+# if defined __GLIBC__ && defined _STRING_H
+#  define yystrlen(S) (YY_CAST (YYPTRDIFF_T, strlen (S)))
+# else
 /* Return the length of YYSTR.  */
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static YYSIZE_T
+static YYPTRDIFF_T
 yystrlen (const char *yystr)
-#else
-static YYSIZE_T
-yystrlen (yystr)
-    const char *yystr;
-#endif
 {
-  YYSIZE_T yylen;
+  YYPTRDIFF_T yylen;
   for (yylen = 0; yystr[yylen]; yylen++)
     continue;
   return yylen;
 }
-#  endif
 # endif
+#endif
 
-# ifndef yystpcpy
-#  if defined __GLIBC__ && defined _STRING_H && defined _GNU_SOURCE
-#   define yystpcpy stpcpy
-#  else
+#ifndef yystpcpy
+# if defined __GLIBC__ && defined _STRING_H && defined _GNU_SOURCE
+#  define yystpcpy stpcpy
+# else
 /* Copy YYSRC to YYDEST, returning the address of the terminating '\0' in
    YYDEST.  */
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
 static char *
 yystpcpy (char *yydest, const char *yysrc)
-#else
-static char *
-yystpcpy (yydest, yysrc)
-    char *yydest;
-    const char *yysrc;
-#endif
 {
   char *yyd = yydest;
   const char *yys = yysrc;
@@ -1230,10 +1205,10 @@ yystpcpy (yydest, yysrc)
 
   return yyd - 1;
 }
-#  endif
 # endif
+#endif
 
-# ifndef yytnamerr
+#ifndef yytnamerr
 /* Copy to YYRES the contents of YYSTR after stripping away unnecessary
    quotes and backslashes, so that it's suitable for yyerror.  The
    heuristic is that double-quoting is unnecessary unless the string
@@ -1241,250 +1216,259 @@ yystpcpy (yydest, yysrc)
    backslash-backslash).  YYSTR is taken from yytname.  If YYRES is
    null, do not copy; instead, return the length of what the result
    would have been.  */
-static YYSIZE_T
+static YYPTRDIFF_T
 yytnamerr (char *yyres, const char *yystr)
 {
   if (*yystr == '"')
     {
-      YYSIZE_T yyn = 0;
+      YYPTRDIFF_T yyn = 0;
       char const *yyp = yystr;
-
       for (;;)
-	switch (*++yyp)
-	  {
-	  case '\'':
-	  case ',':
-	    goto do_not_strip_quotes;
-
-	  case '\\':
-	    if (*++yyp != '\\')
-	      goto do_not_strip_quotes;
-	    /* Fall through.  */
-	  default:
-	    if (yyres)
-	      yyres[yyn] = *yyp;
-	    yyn++;
-	    break;
-
-	  case '"':
-	    if (yyres)
-	      yyres[yyn] = '\0';
-	    return yyn;
-	  }
+        switch (*++yyp)
+          {
+          case '\'':
+          case ',':
+            goto do_not_strip_quotes;
+
+          case '\\':
+            if (*++yyp != '\\')
+              goto do_not_strip_quotes;
+            else
+              goto append;
+
+          append:
+          default:
+            if (yyres)
+              yyres[yyn] = *yyp;
+            yyn++;
+            break;
+
+          case '"':
+            if (yyres)
+              yyres[yyn] = '\0';
+            return yyn;
+          }
     do_not_strip_quotes: ;
     }
 
-  if (! yyres)
+  if (yyres)
+    return yystpcpy (yyres, yystr) - yyres;
+  else
     return yystrlen (yystr);
-
-  return yystpcpy (yyres, yystr) - yyres;
 }
-# endif
+#endif
 
-/* Copy into YYRESULT an error message about the unexpected token
-   YYCHAR while in state YYSTATE.  Return the number of bytes copied,
-   including the terminating null byte.  If YYRESULT is null, do not
-   copy anything; just return the number of bytes that would be
-   copied.  As a special case, return 0 if an ordinary "syntax error"
-   message will do.  Return YYSIZE_MAXIMUM if overflow occurs during
-   size calculation.  */
-static YYSIZE_T
-yysyntax_error (char *yyresult, int yystate, int yychar)
-{
-  int yyn = yypact[yystate];
 
-  if (! (YYPACT_NINF < yyn && yyn <= YYLAST))
-    return 0;
-  else
-    {
-      int yytype = YYTRANSLATE (yychar);
-      YYSIZE_T yysize0 = yytnamerr (0, yytname[yytype]);
-      YYSIZE_T yysize = yysize0;
-      YYSIZE_T yysize1;
-      int yysize_overflow = 0;
-      enum { YYERROR_VERBOSE_ARGS_MAXIMUM = 5 };
-      char const *yyarg[YYERROR_VERBOSE_ARGS_MAXIMUM];
-      int yyx;
-
-# if 0
-      /* This is so xgettext sees the translatable formats that are
-	 constructed on the fly.  */
-      YY_("syntax error, unexpected %s");
-      YY_("syntax error, unexpected %s, expecting %s");
-      YY_("syntax error, unexpected %s, expecting %s or %s");
-      YY_("syntax error, unexpected %s, expecting %s or %s or %s");
-      YY_("syntax error, unexpected %s, expecting %s or %s or %s or %s");
-# endif
-      char *yyfmt;
-      char const *yyf;
-      static char const yyunexpected[] = "syntax error, unexpected %s";
-      static char const yyexpecting[] = ", expecting %s";
-      static char const yyor[] = " or %s";
-      char yyformat[sizeof yyunexpected
-		    + sizeof yyexpecting - 1
-		    + ((YYERROR_VERBOSE_ARGS_MAXIMUM - 2)
-		       * (sizeof yyor - 1))];
-      char const *yyprefix = yyexpecting;
+static int
+yy_syntax_error_arguments (const yypcontext_t *yyctx,
+                           yysymbol_kind_t yyarg[], int yyargn)
+{
+  /* Actual size of YYARG. */
+  int yycount = 0;
+  /* There are many possibilities here to consider:
+     - If this state is a consistent state with a default action, then
+       the only way this function was invoked is if the default action
+       is an error action.  In that case, don't check for expected
+       tokens because there are none.
+     - The only way there can be no lookahead present (in yychar) is if
+       this state is a consistent state with a default action.  Thus,
+       detecting the absence of a lookahead is sufficient to determine
+       that there is no unexpected or expected token to report.  In that
+       case, just report a simple "syntax error".
+     - Don't assume there isn't a lookahead just because this state is a
+       consistent state with a default action.  There might have been a
+       previous inconsistent state, consistent state with a non-default
+       action, or user semantic action that manipulated yychar.
+     - Of course, the expected token list depends on states to have
+       correct lookahead information, and it depends on the parser not
+       to perform extra reductions after fetching a lookahead from the
+       scanner and before detecting a syntax error.  Thus, state merging
+       (from LALR or IELR) and default reductions corrupt the expected
+       token list.  However, the list is correct for canonical LR with
+       one exception: it will still contain any token that will not be
+       accepted due to an error action in a later state.
+  */
+  if (yyctx->yytoken != YYSYMBOL_YYEMPTY)
+    {
+      int yyn;
+      if (yyarg)
+        yyarg[yycount] = yyctx->yytoken;
+      ++yycount;
+      yyn = yypcontext_expected_tokens (yyctx,
+                                        yyarg ? yyarg + 1 : yyarg, yyargn - 1);
+      if (yyn == YYENOMEM)
+        return YYENOMEM;
+      else
+        yycount += yyn;
+    }
+  return yycount;
+}
 
-      /* Start YYX at -YYN if negative to avoid negative indexes in
-	 YYCHECK.  */
-      int yyxbegin = yyn < 0 ? -yyn : 0;
+/* Copy into *YYMSG, which is of size *YYMSG_ALLOC, an error message
+   about the unexpected token YYTOKEN for the state stack whose top is
+   YYSSP.
 
-      /* Stay within bounds of both yycheck and yytname.  */
-      int yychecklim = YYLAST - yyn + 1;
-      int yyxend = yychecklim < YYNTOKENS ? yychecklim : YYNTOKENS;
-      int yycount = 1;
+   Return 0 if *YYMSG was successfully written.  Return -1 if *YYMSG is
+   not large enough to hold the message.  In that case, also set
+   *YYMSG_ALLOC to the required number of bytes.  Return YYENOMEM if the
+   required number of bytes is too large to store.  */
+static int
+yysyntax_error (YYPTRDIFF_T *yymsg_alloc, char **yymsg,
+                const yypcontext_t *yyctx)
+{
+  enum { YYARGS_MAX = 5 };
+  /* Internationalized format string. */
+  const char *yyformat = YY_NULLPTR;
+  /* Arguments of yyformat: reported tokens (one for the "unexpected",
+     one per "expected"). */
+  yysymbol_kind_t yyarg[YYARGS_MAX];
+  /* Cumulated lengths of YYARG.  */
+  YYPTRDIFF_T yysize = 0;
+
+  /* Actual size of YYARG. */
+  int yycount = yy_syntax_error_arguments (yyctx, yyarg, YYARGS_MAX);
+  if (yycount == YYENOMEM)
+    return YYENOMEM;
+
+  switch (yycount)
+    {
+#define YYCASE_(N, S)                       \
+      case N:                               \
+        yyformat = S;                       \
+        break
+    default: /* Avoid compiler warnings. */
+      YYCASE_(0, YY_("syntax error"));
+      YYCASE_(1, YY_("syntax error, unexpected %s"));
+      YYCASE_(2, YY_("syntax error, unexpected %s, expecting %s"));
+      YYCASE_(3, YY_("syntax error, unexpected %s, expecting %s or %s"));
+      YYCASE_(4, YY_("syntax error, unexpected %s, expecting %s or %s or %s"));
+      YYCASE_(5, YY_("syntax error, unexpected %s, expecting %s or %s or %s or %s"));
+#undef YYCASE_
+    }
 
-      yyarg[0] = yytname[yytype];
-      yyfmt = yystpcpy (yyformat, yyunexpected);
+  /* Compute error message size.  Don't count the "%s"s, but reserve
+     room for the terminator.  */
+  yysize = yystrlen (yyformat) - 2 * yycount + 1;
+  {
+    int yyi;
+    for (yyi = 0; yyi < yycount; ++yyi)
+      {
+        YYPTRDIFF_T yysize1
+          = yysize + yytnamerr (YY_NULLPTR, yytname[yyarg[yyi]]);
+        if (yysize <= yysize1 && yysize1 <= YYSTACK_ALLOC_MAXIMUM)
+          yysize = yysize1;
+        else
+          return YYENOMEM;
+      }
+  }
 
-      for (yyx = yyxbegin; yyx < yyxend; ++yyx)
-	if (yycheck[yyx + yyn] == yyx && yyx != YYTERROR)
-	  {
-	    if (yycount == YYERROR_VERBOSE_ARGS_MAXIMUM)
-	      {
-		yycount = 1;
-		yysize = yysize0;
-		yyformat[sizeof yyunexpected - 1] = '\0';
-		break;
-	      }
-	    yyarg[yycount++] = yytname[yyx];
-	    yysize1 = yysize + yytnamerr (0, yytname[yyx]);
-	    yysize_overflow |= (yysize1 < yysize);
-	    yysize = yysize1;
-	    yyfmt = yystpcpy (yyfmt, yyprefix);
-	    yyprefix = yyor;
-	  }
-
-      yyf = YY_(yyformat);
-      yysize1 = yysize + yystrlen (yyf);
-      yysize_overflow |= (yysize1 < yysize);
-      yysize = yysize1;
-
-      if (yysize_overflow)
-	return YYSIZE_MAXIMUM;
-
-      if (yyresult)
-	{
-	  /* Avoid sprintf, as that infringes on the user's name space.
-	     Don't have undefined behavior even if the translation
-	     produced a string with the wrong number of "%s"s.  */
-	  char *yyp = yyresult;
-	  int yyi = 0;
-	  while ((*yyp = *yyf) != '\0')
-	    {
-	      if (*yyp == '%' && yyf[1] == 's' && yyi < yycount)
-		{
-		  yyp += yytnamerr (yyp, yyarg[yyi++]);
-		  yyf += 2;
-		}
-	      else
-		{
-		  yyp++;
-		  yyf++;
-		}
-	    }
-	}
-      return yysize;
+  if (*yymsg_alloc < yysize)
+    {
+      *yymsg_alloc = 2 * yysize;
+      if (! (yysize <= *yymsg_alloc
+             && *yymsg_alloc <= YYSTACK_ALLOC_MAXIMUM))
+        *yymsg_alloc = YYSTACK_ALLOC_MAXIMUM;
+      return -1;
     }
+
+  /* Avoid sprintf, as that infringes on the user's name space.
+     Don't have undefined behavior even if the translation
+     produced a string with the wrong number of "%s"s.  */
+  {
+    char *yyp = *yymsg;
+    int yyi = 0;
+    while ((*yyp = *yyformat) != '\0')
+      if (*yyp == '%' && yyformat[1] == 's' && yyi < yycount)
+        {
+          yyp += yytnamerr (yyp, yytname[yyarg[yyi++]]);
+          yyformat += 2;
+        }
+      else
+        {
+          ++yyp;
+          ++yyformat;
+        }
+  }
+  return 0;
 }
-#endif /* YYERROR_VERBOSE */
-
+
 
 /*-----------------------------------------------.
 | Release the memory associated to this symbol.  |
 `-----------------------------------------------*/
 
-/*ARGSUSED*/
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
 static void
-yydestruct (const char *yymsg, int yytype, YYSTYPE *yyvaluep, void *yyscanner)
-#else
-static void
-yydestruct (yymsg, yytype, yyvaluep, yyscanner)
-    const char *yymsg;
-    int yytype;
-    YYSTYPE *yyvaluep;
-    void *yyscanner;
-#endif
+yydestruct (const char *yymsg,
+            yysymbol_kind_t yykind, YYSTYPE *yyvaluep, void *yyscanner)
 {
-  YYUSE (yyvaluep);
-  YYUSE (yyscanner);
-
+  YY_USE (yyvaluep);
+  YY_USE (yyscanner);
   if (!yymsg)
     yymsg = "Deleting";
-  YY_SYMBOL_PRINT (yymsg, yytype, yyvaluep, yylocationp);
+  YY_SYMBOL_PRINT (yymsg, yykind, yyvaluep, yylocationp);
 
-  switch (yytype)
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  switch (yykind)
     {
-      case 10: /* "_IDENTIFIER_" */
+    case YYSYMBOL__IDENTIFIER_: /* _IDENTIFIER_  */
+#line 137 "grammar.y"
+            { yr_free(((*yyvaluep).c_string)); }
+#line 1417 "grammar.c"
+        break;
+
+    case YYSYMBOL__STRING_IDENTIFIER_: /* _STRING_IDENTIFIER_  */
 #line 138 "grammar.y"
-	{ yr_free((yyvaluep->c_string)); };
-#line 1425 "grammar.c"
-	break;
-      case 11: /* "_STRING_IDENTIFIER_" */
+            { yr_free(((*yyvaluep).c_string)); }
+#line 1423 "grammar.c"
+        break;
+
+    case YYSYMBOL__STRING_COUNT_: /* _STRING_COUNT_  */
 #line 139 "grammar.y"
-	{ yr_free((yyvaluep->c_string)); };
-#line 1430 "grammar.c"
-	break;
-      case 12: /* "_STRING_COUNT_" */
+            { yr_free(((*yyvaluep).c_string)); }
+#line 1429 "grammar.c"
+        break;
+
+    case YYSYMBOL__STRING_OFFSET_: /* _STRING_OFFSET_  */
 #line 140 "grammar.y"
-	{ yr_free((yyvaluep->c_string)); };
+            { yr_free(((*yyvaluep).c_string)); }
 #line 1435 "grammar.c"
-	break;
-      case 13: /* "_STRING_OFFSET_" */
+        break;
+
+    case YYSYMBOL__STRING_IDENTIFIER_WITH_WILDCARD_: /* _STRING_IDENTIFIER_WITH_WILDCARD_  */
 #line 141 "grammar.y"
-	{ yr_free((yyvaluep->c_string)); };
-#line 1440 "grammar.c"
-	break;
-      case 14: /* "_STRING_IDENTIFIER_WITH_WILDCARD_" */
+            { yr_free(((*yyvaluep).c_string)); }
+#line 1441 "grammar.c"
+        break;
+
+    case YYSYMBOL__ANONYMOUS_STRING_: /* _ANONYMOUS_STRING_  */
 #line 142 "grammar.y"
-	{ yr_free((yyvaluep->c_string)); };
-#line 1445 "grammar.c"
-	break;
-      case 15: /* "_ANONYMOUS_STRING_" */
+            { yr_free(((*yyvaluep).c_string)); }
+#line 1447 "grammar.c"
+        break;
+
+    case YYSYMBOL__TEXTSTRING_: /* _TEXTSTRING_  */
 #line 143 "grammar.y"
-	{ yr_free((yyvaluep->c_string)); };
-#line 1450 "grammar.c"
-	break;
-      case 18: /* "_TEXTSTRING_" */
+            { yr_free(((*yyvaluep).sized_string)); }
+#line 1453 "grammar.c"
+        break;
+
+    case YYSYMBOL__HEXSTRING_: /* _HEXSTRING_  */
 #line 144 "grammar.y"
-	{ yr_free((yyvaluep->sized_string)); };
-#line 1455 "grammar.c"
-	break;
-      case 19: /* "_HEXSTRING_" */
+            { yr_free(((*yyvaluep).sized_string)); }
+#line 1459 "grammar.c"
+        break;
+
+    case YYSYMBOL__REGEXP_: /* _REGEXP_  */
 #line 145 "grammar.y"
-	{ yr_free((yyvaluep->sized_string)); };
-#line 1460 "grammar.c"
-	break;
-      case 20: /* "_REGEXP_" */
-#line 146 "grammar.y"
-	{ yr_free((yyvaluep->sized_string)); };
+            { yr_free(((*yyvaluep).sized_string)); }
 #line 1465 "grammar.c"
-	break;
+        break;
 
       default:
-	break;
+        break;
     }
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
 }
-
-
-/* Prevent warnings from -Wmissing-prototypes.  */
-
-#ifdef YYPARSE_PARAM
-#if defined __STDC__ || defined __cplusplus
-int yyparse (void *YYPARSE_PARAM);
-#else
-int yyparse ();
-#endif
-#else /* ! YYPARSE_PARAM */
-#if defined __STDC__ || defined __cplusplus
-int yyparse (void *yyscanner);
-#else
-int yyparse ();
-#endif
-#endif /* ! YYPARSE_PARAM */
 
 
 
@@ -1495,79 +1479,57 @@ int yyparse ();
 | yyparse.  |
 `----------*/
 
-#ifdef YYPARSE_PARAM
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-int
-yyparse (void *YYPARSE_PARAM)
-#else
-int
-yyparse (YYPARSE_PARAM)
-    void *YYPARSE_PARAM;
-#endif
-#else /* ! YYPARSE_PARAM */
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
 int
 yyparse (void *yyscanner)
-#else
-int
-yyparse (yyscanner)
-    void *yyscanner;
-#endif
-#endif
 {
-  /* The look-ahead symbol.  */
+/* Lookahead token kind.  */
 int yychar;
 
-/* The semantic value of the look-ahead symbol.  */
-YYSTYPE yylval;
 
-/* Number of syntax errors so far.  */
-int yynerrs;
+/* The semantic value of the lookahead symbol.  */
+/* Default value used for initialization, for pacifying older GCCs
+   or non-GCC compilers.  */
+YY_INITIAL_VALUE (static YYSTYPE yyval_default;)
+YYSTYPE yylval YY_INITIAL_VALUE (= yyval_default);
 
-  int yystate;
-  int yyn;
-  int yyresult;
-  /* Number of tokens to shift before error messages enabled.  */
-  int yyerrstatus;
-  /* Look-ahead token as an internal (translated) token number.  */
-  int yytoken = 0;
-#if YYERROR_VERBOSE
-  /* Buffer for error messages, and its allocated size.  */
-  char yymsgbuf[128];
-  char *yymsg = yymsgbuf;
-  YYSIZE_T yymsg_alloc = sizeof yymsgbuf;
-#endif
-
-  /* Three stacks and their tools:
-     `yyss': related to states,
-     `yyvs': related to semantic values,
-     `yyls': related to locations.
-
-     Refer to the stacks thru separate pointers, to allow yyoverflow
-     to reallocate them elsewhere.  */
+    /* Number of syntax errors so far.  */
+    int yynerrs = 0;
 
-  /* The state stack.  */
-  yytype_int16 yyssa[YYINITDEPTH];
-  yytype_int16 *yyss = yyssa;
-  yytype_int16 *yyssp;
+    yy_state_fast_t yystate = 0;
+    /* Number of tokens to shift before error messages enabled.  */
+    int yyerrstatus = 0;
 
-  /* The semantic value stack.  */
-  YYSTYPE yyvsa[YYINITDEPTH];
-  YYSTYPE *yyvs = yyvsa;
-  YYSTYPE *yyvsp;
+    /* Refer to the stacks through separate pointers, to allow yyoverflow
+       to reallocate them elsewhere.  */
 
+    /* Their size.  */
+    YYPTRDIFF_T yystacksize = YYINITDEPTH;
 
+    /* The state stack: array, bottom, top.  */
+    yy_state_t yyssa[YYINITDEPTH];
+    yy_state_t *yyss = yyssa;
+    yy_state_t *yyssp = yyss;
 
-#define YYPOPSTACK(N)   (yyvsp -= (N), yyssp -= (N))
-
-  YYSIZE_T yystacksize = YYINITDEPTH;
+    /* The semantic value stack: array, bottom, top.  */
+    YYSTYPE yyvsa[YYINITDEPTH];
+    YYSTYPE *yyvs = yyvsa;
+    YYSTYPE *yyvsp = yyvs;
 
+  int yyn;
+  /* The return value of yyparse.  */
+  int yyresult;
+  /* Lookahead symbol kind.  */
+  yysymbol_kind_t yytoken = YYSYMBOL_YYEMPTY;
   /* The variables used to return semantic value and location from the
      action routines.  */
   YYSTYPE yyval;
 
+  /* Buffer for error messages, and its allocated size.  */
+  char yymsgbuf[128];
+  char *yymsg = yymsgbuf;
+  YYPTRDIFF_T yymsg_alloc = sizeof yymsgbuf;
+
+#define YYPOPSTACK(N)   (yyvsp -= (N), yyssp -= (N))
 
   /* The number of symbols on the RHS of the reduced rule.
      Keep to zero when no symbol should be popped.  */
@@ -1575,128 +1537,138 @@ int yynerrs;
 
   YYDPRINTF ((stderr, "Starting parse\n"));
 
-  yystate = 0;
-  yyerrstatus = 0;
-  yynerrs = 0;
-  yychar = YYEMPTY;		/* Cause a token to be read.  */
-
-  /* Initialize stack pointers.
-     Waste one element of value and location stack
-     so that they stay on the same level as the state stack.
-     The wasted elements are never initialized.  */
-
-  yyssp = yyss;
-  yyvsp = yyvs;
+  yychar = YYEMPTY; /* Cause a token to be read.  */
 
   goto yysetstate;
 
+
 /*------------------------------------------------------------.
-| yynewstate -- Push a new state, which is found in yystate.  |
+| yynewstate -- push a new state, which is found in yystate.  |
 `------------------------------------------------------------*/
- yynewstate:
+yynewstate:
   /* In all cases, when you get here, the value and location stacks
      have just been pushed.  So pushing a state here evens the stacks.  */
   yyssp++;
 
- yysetstate:
-  *yyssp = yystate;
+
+/*--------------------------------------------------------------------.
+| yysetstate -- set current state (the top of the stack) to yystate.  |
+`--------------------------------------------------------------------*/
+yysetstate:
+  YYDPRINTF ((stderr, "Entering state %d\n", yystate));
+  YY_ASSERT (0 <= yystate && yystate < YYNSTATES);
+  YY_IGNORE_USELESS_CAST_BEGIN
+  *yyssp = YY_CAST (yy_state_t, yystate);
+  YY_IGNORE_USELESS_CAST_END
+  YY_STACK_PRINT (yyss, yyssp);
 
   if (yyss + yystacksize - 1 <= yyssp)
+#if !defined yyoverflow && !defined YYSTACK_RELOCATE
+    YYNOMEM;
+#else
     {
       /* Get the current used size of the three stacks, in elements.  */
-      YYSIZE_T yysize = yyssp - yyss + 1;
+      YYPTRDIFF_T yysize = yyssp - yyss + 1;
 
-#ifdef yyoverflow
+# if defined yyoverflow
       {
-	/* Give user a chance to reallocate the stack.  Use copies of
-	   these so that the &'s don't force the real ones into
-	   memory.  */
-	YYSTYPE *yyvs1 = yyvs;
-	yytype_int16 *yyss1 = yyss;
-
-
-	/* Each stack pointer address is followed by the size of the
-	   data in use in that stack, in bytes.  This used to be a
-	   conditional around just the two extra args, but that might
-	   be undefined if yyoverflow is a macro.  */
-	yyoverflow (YY_("memory exhausted"),
-		    &yyss1, yysize * sizeof (*yyssp),
-		    &yyvs1, yysize * sizeof (*yyvsp),
-
-		    &yystacksize);
-
-	yyss = yyss1;
-	yyvs = yyvs1;
+        /* Give user a chance to reallocate the stack.  Use copies of
+           these so that the &'s don't force the real ones into
+           memory.  */
+        yy_state_t *yyss1 = yyss;
+        YYSTYPE *yyvs1 = yyvs;
+
+        /* Each stack pointer address is followed by the size of the
+           data in use in that stack, in bytes.  This used to be a
+           conditional around just the two extra args, but that might
+           be undefined if yyoverflow is a macro.  */
+        yyoverflow (YY_("memory exhausted"),
+                    &yyss1, yysize * YYSIZEOF (*yyssp),
+                    &yyvs1, yysize * YYSIZEOF (*yyvsp),
+                    &yystacksize);
+        yyss = yyss1;
+        yyvs = yyvs1;
       }
-#else /* no yyoverflow */
-# ifndef YYSTACK_RELOCATE
-      goto yyexhaustedlab;
-# else
+# else /* defined YYSTACK_RELOCATE */
       /* Extend the stack our own way.  */
       if (YYMAXDEPTH <= yystacksize)
-	goto yyexhaustedlab;
+        YYNOMEM;
       yystacksize *= 2;
       if (YYMAXDEPTH < yystacksize)
-	yystacksize = YYMAXDEPTH;
+        yystacksize = YYMAXDEPTH;
 
       {
-	yytype_int16 *yyss1 = yyss;
-	union yyalloc *yyptr =
-	  (union yyalloc *) YYSTACK_ALLOC (YYSTACK_BYTES (yystacksize));
-	if (! yyptr)
-	  goto yyexhaustedlab;
-	YYSTACK_RELOCATE (yyss);
-	YYSTACK_RELOCATE (yyvs);
-
+        yy_state_t *yyss1 = yyss;
+        union yyalloc *yyptr =
+          YY_CAST (union yyalloc *,
+                   YYSTACK_ALLOC (YY_CAST (YYSIZE_T, YYSTACK_BYTES (yystacksize))));
+        if (! yyptr)
+          YYNOMEM;
+        YYSTACK_RELOCATE (yyss_alloc, yyss);
+        YYSTACK_RELOCATE (yyvs_alloc, yyvs);
 #  undef YYSTACK_RELOCATE
-	if (yyss1 != yyssa)
-	  YYSTACK_FREE (yyss1);
+        if (yyss1 != yyssa)
+          YYSTACK_FREE (yyss1);
       }
 # endif
-#endif /* no yyoverflow */
 
       yyssp = yyss + yysize - 1;
       yyvsp = yyvs + yysize - 1;
 
-
-      YYDPRINTF ((stderr, "Stack size increased to %lu\n",
-		  (unsigned long int) yystacksize));
+      YY_IGNORE_USELESS_CAST_BEGIN
+      YYDPRINTF ((stderr, "Stack size increased to %ld\n",
+                  YY_CAST (long, yystacksize)));
+      YY_IGNORE_USELESS_CAST_END
 
       if (yyss + yystacksize - 1 <= yyssp)
-	YYABORT;
+        YYABORT;
     }
+#endif /* !defined yyoverflow && !defined YYSTACK_RELOCATE */
 
-  YYDPRINTF ((stderr, "Entering state %d\n", yystate));
+
+  if (yystate == YYFINAL)
+    YYACCEPT;
 
   goto yybackup;
 
+
 /*-----------.
 | yybackup.  |
 `-----------*/
 yybackup:
-
   /* Do appropriate processing given the current state.  Read a
-     look-ahead token if we need one and don't already have one.  */
+     lookahead token if we need one and don't already have one.  */
 
-  /* First try to decide what to do without reference to look-ahead token.  */
+  /* First try to decide what to do without reference to lookahead token.  */
   yyn = yypact[yystate];
-  if (yyn == YYPACT_NINF)
+  if (yypact_value_is_default (yyn))
     goto yydefault;
 
-  /* Not known => get a look-ahead token if don't already have one.  */
+  /* Not known => get a lookahead token if don't already have one.  */
 
-  /* YYCHAR is either YYEMPTY or YYEOF or a valid look-ahead symbol.  */
+  /* YYCHAR is either empty, or end-of-input, or a valid lookahead.  */
   if (yychar == YYEMPTY)
     {
-      YYDPRINTF ((stderr, "Reading a token: "));
-      yychar = YYLEX;
+      YYDPRINTF ((stderr, "Reading a token\n"));
+      yychar = yylex (&yylval, yyscanner);
     }
 
   if (yychar <= YYEOF)
     {
-      yychar = yytoken = YYEOF;
+      yychar = YYEOF;
+      yytoken = YYSYMBOL_YYEOF;
       YYDPRINTF ((stderr, "Now at end of input.\n"));
     }
+  else if (yychar == YYerror)
+    {
+      /* The scanner already issued an error message, process directly
+         to error recovery.  But do not keep the error token as
+         lookahead, it is too special and may lead us to an endless
+         loop in error recovery. */
+      yychar = YYUNDEF;
+      yytoken = YYSYMBOL_YYerror;
+      goto yyerrlab1;
+    }
   else
     {
       yytoken = YYTRANSLATE (yychar);
@@ -1711,30 +1683,26 @@ yybackup:
   yyn = yytable[yyn];
   if (yyn <= 0)
     {
-      if (yyn == 0 || yyn == YYTABLE_NINF)
-	goto yyerrlab;
+      if (yytable_value_is_error (yyn))
+        goto yyerrlab;
       yyn = -yyn;
       goto yyreduce;
     }
 
-  if (yyn == YYFINAL)
-    YYACCEPT;
-
   /* Count tokens shifted since error; after three, turn off error
      status.  */
   if (yyerrstatus)
     yyerrstatus--;
 
-  /* Shift the look-ahead token.  */
+  /* Shift the lookahead token.  */
   YY_SYMBOL_PRINT ("Shifting", yytoken, &yylval, &yylloc);
-
-  /* Discard the shifted token unless it is eof.  */
-  if (yychar != YYEOF)
-    yychar = YYEMPTY;
-
   yystate = yyn;
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
   *++yyvsp = yylval;
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
 
+  /* Discard the shifted token.  */
+  yychar = YYEMPTY;
   goto yynewstate;
 
 
@@ -1749,14 +1717,14 @@ yydefault:
 
 
 /*-----------------------------.
-| yyreduce -- Do a reduction.  |
+| yyreduce -- do a reduction.  |
 `-----------------------------*/
 yyreduce:
   /* yyn is the number of a rule to reduce with.  */
   yylen = yyr2[yyn];
 
   /* If YYLEN is nonzero, implement the default value of the action:
-     `$$ = $1'.
+     '$$ = $1'.
 
      Otherwise, the following line sets YYVAL to garbage.
      This behavior is undocumented and Bison
@@ -1769,31 +1737,33 @@ yyreduce:
   YY_REDUCE_PRINT (yyn);
   switch (yyn)
     {
-        case 6:
-#line 167 "grammar.y"
-    {
+  case 5: /* rule: rule_modifiers _RULE_ _IDENTIFIER_ tags '{' meta strings condition '}'  */
+#line 169 "grammar.y"
+        {
           int result = yr_parser_reduce_rule_declaration(
               yyscanner,
-              (yyvsp[(1) - (9)].integer),
-              (yyvsp[(3) - (9)].c_string),
-              (yyvsp[(4) - (9)].c_string),
-              (yyvsp[(7) - (9)].string),
-              (yyvsp[(6) - (9)].meta));
+              (yyvsp[-8].integer),
+              (yyvsp[-6].c_string),
+              (yyvsp[-5].c_string),
+              (yyvsp[-2].string),
+              (yyvsp[-3].meta));
 
-          yr_free((yyvsp[(3) - (9)].c_string));
+          yr_free((yyvsp[-6].c_string));
 
           ERROR_IF(result != ERROR_SUCCESS);
         }
+#line 1756 "grammar.c"
     break;
 
-  case 7:
-#line 183 "grammar.y"
-    {  (yyval.meta) = NULL; }
+  case 6: /* meta: %empty  */
+#line 185 "grammar.y"
+                                         {  (yyval.meta) = NULL; }
+#line 1762 "grammar.c"
     break;
 
-  case 8:
-#line 185 "grammar.y"
-    {
+  case 7: /* meta: _META_ ':' meta_declarations  */
+#line 187 "grammar.y"
+        {
           // Each rule have a list of meta-data info, consisting in a
           // sequence of YR_META structures. The last YR_META structure does
           // not represent a real meta-data, it's just a end-of-list marker
@@ -1814,21 +1784,23 @@ yyreduce:
               sizeof(YR_META),
               NULL);
 
-          (yyval.meta) = (yyvsp[(3) - (3)].meta);
+          (yyval.meta) = (yyvsp[0].meta);
         }
+#line 1790 "grammar.c"
     break;
 
-  case 9:
-#line 212 "grammar.y"
-    {
+  case 8: /* strings: %empty  */
+#line 214 "grammar.y"
+        {
           (yyval.string) = NULL;
           yyget_extra(yyscanner)->current_rule_strings = (yyval.string);
         }
+#line 1799 "grammar.c"
     break;
 
-  case 10:
-#line 217 "grammar.y"
-    {
+  case 9: /* strings: _STRINGS_ ':' string_declarations  */
+#line 219 "grammar.y"
+        {
           // Each rule have a list of strings, consisting in a sequence
           // of YR_STRING structures. The last YR_STRING structure does not
           // represent a real string, it's just a end-of-list marker
@@ -1836,6 +1808,7 @@ yyreduce:
           // write the end-of-list marker.
 
           YR_STRING null_string;
+          YR_STRING* string;
           YR_COMPILER* compiler;
 
           compiler = yyget_extra(yyscanner);
@@ -1849,39 +1822,71 @@ yyreduce:
               sizeof(YR_STRING),
               NULL);
 
-          (yyval.string) = (yyvsp[(3) - (3)].string);
+          (yyval.string) = (yyvsp[0].string);
           compiler->current_rule_strings = (yyval.string);
+
+          // Number the strings, which is where scan contexts keep their
+          // matches. Strings of a rule get consecutive numbers.
+
+          string = (yyval.string);
+
+          while (!STRING_IS_NULL(string))
+          {
+            string->idx = compiler->strings_count++;
+            string = yr_arena_next_address(
+                compiler->strings_arena,
+                string,
+                sizeof(YR_STRING));
+          }
         }
+#line 1843 "grammar.c"
+    break;
+
+  case 10: /* $@1: %empty  */
+#line 262 "grammar.y"
+            {
+              YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+              compiler->last_result = yr_parser_emit_init_rule(yyscanner);
+
+              ERROR_IF(compiler->last_result != ERROR_SUCCESS);
+            }
+#line 1855 "grammar.c"
     break;
 
-  case 12:
-#line 248 "grammar.y"
-    { (yyval.integer) = 0;  }
+  case 12: /* rule_modifiers: %empty  */
+#line 273 "grammar.y"
+                                                  { (yyval.integer) = 0;  }
+#line 1861 "grammar.c"
     break;
 
-  case 13:
-#line 249 "grammar.y"
-    { (yyval.integer) = (yyvsp[(1) - (2)].integer) | (yyvsp[(2) - (2)].integer); }
+  case 13: /* rule_modifiers: rule_modifiers rule_modifier  */
+#line 274 "grammar.y"
+                                                  { (yyval.integer) = (yyvsp[-1].integer) | (yyvsp[0].integer); }
+#line 1867 "grammar.c"
     break;
 
-  case 14:
-#line 253 "grammar.y"
-    { (yyval.integer) = RULE_GFLAGS_PRIVATE; }
+  case 14: /* rule_modifier: _PRIVATE_  */
+#line 278 "grammar.y"
+                                { (yyval.integer) = RULE_GFLAGS_PRIVATE; }
+#line 1873 "grammar.c"
     break;
 
-  case 15:
-#line 254 "grammar.y"
-    { (yyval.integer) = RULE_GFLAGS_GLOBAL; }
+  case 15: /* rule_modifier: _GLOBAL_  */
+#line 279 "grammar.y"
+                                { (yyval.integer) = RULE_GFLAGS_GLOBAL; }
+#line 1879 "grammar.c"
     break;
 
-  case 16:
-#line 258 "grammar.y"
-    { (yyval.c_string) = NULL; }
+  case 16: /* tags: %empty  */
+#line 283 "grammar.y"
+                                { (yyval.c_string) = NULL; }
+#line 1885 "grammar.c"
     break;
 
-  case 17:
-#line 260 "grammar.y"
-    {
+  case 17: /* tags: ':' tag_list  */
+#line 285 "grammar.y"
+        {
           // Tags list is represented in the arena as a sequence
           // of null-terminated strings, the sequence ends with an
           // additional null character. Here we write the ending null
@@ -1890,33 +1895,35 @@ yyreduce:
           yr_arena_write_string(
               yyget_extra(yyscanner)->sz_arena, "", NULL);
 
-          (yyval.c_string) = (yyvsp[(2) - (2)].c_string);
+          (yyval.c_string) = (yyvsp[0].c_string);
         }
+#line 1901 "grammar.c"
     break;
 
-  case 18:
-#line 275 "grammar.y"
-    {
+  case 18: /* tag_list: _IDENTIFIER_  */
+#line 300 "grammar.y"
+            {
               char* identifier;
 
               yr_arena_write_string(
-                  yyget_extra(yyscanner)->sz_arena, (yyvsp[(1) - (1)].c_string), &identifier);
+                  yyget_extra(yyscanner)->sz_arena, (yyvsp[0].c_string), &identifier);
 
-              yr_free((yyvsp[(1) - (1)].c_string));
+              yr_free((yyvsp[0].c_string));
               (yyval.c_string) = identifier;
             }
+#line 1915 "grammar.c"
     break;
 
-  case 19:
-#line 285 "grammar.y"
-    {
+  case 19: /* tag_list: tag_list _IDENTIFIER_  */
+#line 310 "grammar.y"
+            {
               YR_COMPILER* compiler = yyget_extra(yyscanner);
-              char* tag_name = (yyvsp[(1) - (2)].c_string);
+              char* tag_name = (yyvsp[-1].c_string);
               size_t tag_length = tag_name != NULL ? strlen(tag_name) : 0;
 
               while (tag_length > 0)
               {
-                if (strcmp(tag_name, (yyvsp[(2) - (2)].c_string)) == 0)
+                if (strcmp(tag_name, (yyvsp[0].c_string)) == 0)
                 {
                   yr_compiler_set_error_extra_info(compiler, tag_name);
                   compiler->last_result = ERROR_DUPLICATE_TAG_IDENTIFIER;
@@ -1933,207 +1940,230 @@ yyreduce:
 
               if (compiler->last_result == ERROR_SUCCESS)
                 compiler->last_result = yr_arena_write_string(
-                    yyget_extra(yyscanner)->sz_arena, (yyvsp[(2) - (2)].c_string), NULL);
+                    yyget_extra(yyscanner)->sz_arena, (yyvsp[0].c_string), NULL);
 
-              yr_free((yyvsp[(2) - (2)].c_string));
-              (yyval.c_string) = (yyvsp[(1) - (2)].c_string);
+              yr_free((yyvsp[0].c_string));
+              (yyval.c_string) = (yyvsp[-1].c_string);
 
               ERROR_IF(compiler->last_result != ERROR_SUCCESS);
             }
+#line 1951 "grammar.c"
     break;
 
-  case 20:
-#line 318 "grammar.y"
-    {  (yyval.meta) = (yyvsp[(1) - (1)].meta); }
+  case 20: /* meta_declarations: meta_declaration  */
+#line 343 "grammar.y"
+                                                        {  (yyval.meta) = (yyvsp[0].meta); }
+#line 1957 "grammar.c"
     break;
 
-  case 21:
-#line 319 "grammar.y"
-    {  (yyval.meta) = (yyvsp[(1) - (2)].meta); }
+  case 21: /* meta_declarations: meta_declarations meta_declaration  */
+#line 344 "grammar.y"
+                                                        {  (yyval.meta) = (yyvsp[-1].meta); }
+#line 1963 "grammar.c"
     break;
 
-  case 22:
-#line 324 "grammar.y"
-    {
-                      SIZED_STRING* sized_string = (yyvsp[(3) - (3)].sized_string);
+  case 22: /* meta_declaration: _IDENTIFIER_ '=' _TEXTSTRING_  */
+#line 349 "grammar.y"
+                    {
+                      SIZED_STRING* sized_string = (yyvsp[0].sized_string);
 
                       (yyval.meta) = yr_parser_reduce_meta_declaration(
                           yyscanner,
                           META_TYPE_STRING,
-                          (yyvsp[(1) - (3)].c_string),
+                          (yyvsp[-2].c_string),
                           sized_string->c_string,
                           0);
 
-                      yr_free((yyvsp[(1) - (3)].c_string));
-                      yr_free((yyvsp[(3) - (3)].sized_string));
+                      yr_free((yyvsp[-2].c_string));
+                      yr_free((yyvsp[0].sized_string));
 
                       ERROR_IF((yyval.meta) == NULL);
                     }
+#line 1983 "grammar.c"
     break;
 
-  case 23:
-#line 340 "grammar.y"
-    {
+  case 23: /* meta_declaration: _IDENTIFIER_ '=' _NUMBER_  */
+#line 365 "grammar.y"
+                    {
                       (yyval.meta) = yr_parser_reduce_meta_declaration(
                           yyscanner,
                           META_TYPE_INTEGER,
-                          (yyvsp[(1) - (3)].c_string),
+                          (yyvsp[-2].c_string),
                           NULL,
-                          (yyvsp[(3) - (3)].integer));
+                          (yyvsp[0].integer));
 
-                      yr_free((yyvsp[(1) - (3)].c_string));
+                      yr_free((yyvsp[-2].c_string));
 
                       ERROR_IF((yyval.meta) == NULL);
                     }
+#line 2000 "grammar.c"
     break;
 
-  case 24:
-#line 353 "grammar.y"
-    {
+  case 24: /* meta_declaration: _IDENTIFIER_ '=' _TRUE_  */
+#line 378 "grammar.y"
+                    {
                       (yyval.meta) = yr_parser_reduce_meta_declaration(
                           yyscanner,
                           META_TYPE_BOOLEAN,
-                          (yyvsp[(1) - (3)].c_string),
+                          (yyvsp[-2].c_string),
                           NULL,
                           TRUE);
 
-                      yr_free((yyvsp[(1) - (3)].c_string));
+                      yr_free((yyvsp[-2].c_string));
 
                       ERROR_IF((yyval.meta) == NULL);
                     }
+#line 2017 "grammar.c"
     break;
 
-  case 25:
-#line 366 "grammar.y"
-    {
+  case 25: /* meta_declaration: _IDENTIFIER_ '=' _FALSE_  */
+#line 391 "grammar.y"
+                    {
                       (yyval.meta) = yr_parser_reduce_meta_declaration(
                           yyscanner,
                           META_TYPE_BOOLEAN,
-                          (yyvsp[(1) - (3)].c_string),
+                          (yyvsp[-2].c_string),
                           NULL,
                           FALSE);
 
-                      yr_free((yyvsp[(1) - (3)].c_string));
+                      yr_free((yyvsp[-2].c_string));
 
                       ERROR_IF((yyval.meta) == NULL);
                     }
+#line 2034 "grammar.c"
     break;
 
-  case 26:
-#line 381 "grammar.y"
-    { (yyval.string) = (yyvsp[(1) - (1)].string); }
+  case 26: /* string_declarations: string_declaration  */
+#line 406 "grammar.y"
+                                                              { (yyval.string) = (yyvsp[0].string); }
+#line 2040 "grammar.c"
     break;
 
-  case 27:
-#line 382 "grammar.y"
-    { (yyval.string) = (yyvsp[(1) - (2)].string); }
+  case 27: /* string_declarations: string_declarations string_declaration  */
+#line 407 "grammar.y"
+                                                              { (yyval.string) = (yyvsp[-1].string); }
+#line 2046 "grammar.c"
     break;
 
-  case 28:
-#line 387 "grammar.y"
-    {
+  case 28: /* string_declaration: _STRING_IDENTIFIER_ '=' _TEXTSTRING_ string_modifiers  */
+#line 412 "grammar.y"
+                      {
                         (yyval.string) = yr_parser_reduce_string_declaration(
                             yyscanner,
-                            (yyvsp[(4) - (4)].integer),
-                            (yyvsp[(1) - (4)].c_string),
-                            (yyvsp[(3) - (4)].sized_string));
+                            (yyvsp[0].integer),
+                            (yyvsp[-3].c_string),
+                            (yyvsp[-1].sized_string));
 
-                        yr_free((yyvsp[(1) - (4)].c_string));
-                        yr_free((yyvsp[(3) - (4)].sized_string));
+                        yr_free((yyvsp[-3].c_string));
+                        yr_free((yyvsp[-1].sized_string));
 
                         ERROR_IF((yyval.string) == NULL);
                       }
+#line 2063 "grammar.c"
     break;
 
-  case 29:
-#line 400 "grammar.y"
-    {
+  case 29: /* string_declaration: _STRING_IDENTIFIER_ '=' _REGEXP_ string_modifiers  */
+#line 425 "grammar.y"
+                      {
                         (yyval.string) = yr_parser_reduce_string_declaration(
                             yyscanner,
-                            (yyvsp[(4) - (4)].integer) | STRING_GFLAGS_REGEXP,
-                            (yyvsp[(1) - (4)].c_string),
-                            (yyvsp[(3) - (4)].sized_string));
+                            (yyvsp[0].integer) | STRING_GFLAGS_REGEXP,
+                            (yyvsp[-3].c_string),
+                            (yyvsp[-1].sized_string));
 
-                        yr_free((yyvsp[(1) - (4)].c_string));
-                        yr_free((yyvsp[(3) - (4)].sized_string));
+                        yr_free((yyvsp[-3].c_string));
+                        yr_free((yyvsp[-1].sized_string));
 
                         ERROR_IF((yyval.string) == NULL);
                       }
+#line 2080 "grammar.c"
     break;
 
-  case 30:
-#line 413 "grammar.y"
-    {
+  case 30: /* string_declaration: _STRING_IDENTIFIER_ '=' _HEXSTRING_  */
+#line 438 "grammar.y"
+                      {
                         (yyval.string) = yr_parser_reduce_string_declaration(
                             yyscanner,
                             STRING_GFLAGS_HEXADECIMAL,
-                            (yyvsp[(1) - (3)].c_string),
-                            (yyvsp[(3) - (3)].sized_string));
+                            (yyvsp[-2].c_string),
+                            (yyvsp[0].sized_string));
 
-                        yr_free((yyvsp[(1) - (3)].c_string));
-                        yr_free((yyvsp[(3) - (3)].sized_string));
+                        yr_free((yyvsp[-2].c_string));
+                        yr_free((yyvsp[0].sized_string));
 
                         ERROR_IF((yyval.string) == NULL);
                       }
+#line 2097 "grammar.c"
     break;
 
-  case 31:
-#line 428 "grammar.y"
-    { (yyval.integer) = 0;  }
+  case 31: /* string_modifiers: %empty  */
+#line 453 "grammar.y"
+                                                            { (yyval.integer) = 0;  }
+#line 2103 "grammar.c"
     break;
 
-  case 32:
-#line 429 "grammar.y"
-    { (yyval.integer) = (yyvsp[(1) - (2)].integer) | (yyvsp[(2) - (2)].integer); }
+  case 32: /* string_modifiers: string_modifiers string_modifier  */
+#line 454 "grammar.y"
+                                                            { (yyval.integer) = (yyvsp[-1].integer) | (yyvsp[0].integer); }
+#line 2109 "grammar.c"
     break;
 
-  case 33:
-#line 433 "grammar.y"
-    { (yyval.integer) = STRING_GFLAGS_WIDE; }
+  case 33: /* string_modifier: _WIDE_  */
+#line 458 "grammar.y"
+                                { (yyval.integer) = STRING_GFLAGS_WIDE; }
+#line 2115 "grammar.c"
     break;
 
-  case 34:
-#line 434 "grammar.y"
-    { (yyval.integer) = STRING_GFLAGS_ASCII; }
+  case 34: /* string_modifier: _ASCII_  */
+#line 459 "grammar.y"
+                                { (yyval.integer) = STRING_GFLAGS_ASCII; }
+#line 2121 "grammar.c"
     break;
 
-  case 35:
-#line 435 "grammar.y"
-    { (yyval.integer) = STRING_GFLAGS_NO_CASE; }
+  case 35: /* string_modifier: _NOCASE_  */
+#line 460 "grammar.y"
+                                { (yyval.integer) = STRING_GFLAGS_NO_CASE; }
+#line 2127 "grammar.c"
     break;
 
-  case 36:
-#line 436 "grammar.y"
-    { (yyval.integer) = STRING_GFLAGS_FULL_WORD; }
+  case 36: /* string_modifier: _FULLWORD_  */
+#line 461 "grammar.y"
+                                { (yyval.integer) = STRING_GFLAGS_FULL_WORD; }
+#line 2133 "grammar.c"
     break;
 
-  case 38:
-#line 442 "grammar.y"
-    {
+  case 38: /* boolean_expression: _TRUE_  */
+#line 467 "grammar.y"
+                      {
                         yr_parser_emit_with_arg(yyscanner, PUSH, 1, NULL);
                       }
+#line 2141 "grammar.c"
     break;
 
-  case 39:
-#line 446 "grammar.y"
-    {
+  case 39: /* boolean_expression: _FALSE_  */
+#line 471 "grammar.y"
+                      {
                         yr_parser_emit_with_arg(yyscanner, PUSH, 0, NULL);
                       }
+#line 2149 "grammar.c"
     break;
 
-  case 40:
-#line 450 "grammar.y"
-    {
+  case 40: /* boolean_expression: _IDENTIFIER_  */
+#line 475 "grammar.y"
+                      {
                         YR_COMPILER* compiler = yyget_extra(yyscanner);
                         YR_RULE* rule;
 
                         rule = (YR_RULE*) yr_hash_table_lookup(
                             compiler->rules_table,
-                            (yyvsp[(1) - (1)].c_string),
+                            (yyvsp[0].c_string),
                             compiler->current_namespace->name);
 
                         if (rule != NULL)
                         {
+                          compiler->current_rule_flags |= \
+                              RULE_GFLAGS_REFERENCES_RULES;
+
                           compiler->last_result = yr_parser_emit_with_arg_reloc(
                               yyscanner,
                               RULE_PUSH,
@@ -2144,21 +2174,22 @@ yyreduce:
                         {
                           compiler->last_result = yr_parser_reduce_external(
                               yyscanner,
-                              (yyvsp[(1) - (1)].c_string),
+                              (yyvsp[0].c_string),
                               EXT_BOOL);
                         }
 
-                        yr_free((yyvsp[(1) - (1)].c_string));
+                        yr_free((yyvsp[0].c_string));
 
                         ERROR_IF(compiler->last_result != ERROR_SUCCESS);
                       }
+#line 2186 "grammar.c"
     break;
 
-  case 41:
-#line 480 "grammar.y"
-    {
+  case 41: /* boolean_expression: text _MATCHES_ _REGEXP_  */
+#line 508 "grammar.y"
+                      {
                         YR_COMPILER* compiler = yyget_extra(yyscanner);
-                        SIZED_STRING* sized_string = (yyvsp[(3) - (3)].sized_string);
+                        SIZED_STRING* sized_string = (yyvsp[0].sized_string);
                         RE* re;
 
                         compiler->last_result = yr_re_compile(
@@ -2186,79 +2217,86 @@ yyreduce:
                         yr_parser_emit(yyscanner, MATCHES, NULL);
 
                         yr_re_destroy(re);
-                        yr_free((yyvsp[(3) - (3)].sized_string));
+                        yr_free((yyvsp[0].sized_string));
 
                         ERROR_IF(compiler->last_result != ERROR_SUCCESS);
                       }
+#line 2225 "grammar.c"
     break;
 
-  case 42:
-#line 515 "grammar.y"
-    {
+  case 42: /* boolean_expression: text _CONTAINS_ text  */
+#line 543 "grammar.y"
+                      {
                         yr_parser_emit(yyscanner, CONTAINS, NULL);
                       }
+#line 2233 "grammar.c"
     break;
 
-  case 43:
-#line 519 "grammar.y"
-    {
+  case 43: /* boolean_expression: _STRING_IDENTIFIER_  */
+#line 547 "grammar.y"
+                      {
                         int result = yr_parser_reduce_string_identifier(
                             yyscanner,
-                            (yyvsp[(1) - (1)].c_string),
+                            (yyvsp[0].c_string),
                             SFOUND);
 
-                        yr_free((yyvsp[(1) - (1)].c_string));
+                        yr_free((yyvsp[0].c_string));
 
                         ERROR_IF(result != ERROR_SUCCESS);
                       }
+#line 2248 "grammar.c"
     break;
 
-  case 44:
-#line 530 "grammar.y"
-    {
+  case 44: /* boolean_expression: _STRING_IDENTIFIER_ _AT_ expression  */
+#line 558 "grammar.y"
+                      {
                         int result = yr_parser_reduce_string_identifier(
                             yyscanner,
-                            (yyvsp[(1) - (3)].c_string),
+                            (yyvsp[-2].c_string),
                             SFOUND_AT);
 
-                        yr_free((yyvsp[(1) - (3)].c_string));
+                        yr_free((yyvsp[-2].c_string));
 
                         ERROR_IF(result != ERROR_SUCCESS);
                       }
+#line 2263 "grammar.c"
     break;
 
-  case 45:
-#line 541 "grammar.y"
-    {
-                        yr_free((yyvsp[(1) - (4)].c_string));
+  case 45: /* boolean_expression: _STRING_IDENTIFIER_ _AT_ _RVA_ expression  */
+#line 569 "grammar.y"
+                      {
+                        yr_free((yyvsp[-3].c_string));
                       }
+#line 2271 "grammar.c"
     break;
 
-  case 46:
-#line 545 "grammar.y"
-    {
+  case 46: /* boolean_expression: _STRING_IDENTIFIER_ _IN_ range  */
+#line 573 "grammar.y"
+                      {
                         int result = yr_parser_reduce_string_identifier(
                             yyscanner,
-                            (yyvsp[(1) - (3)].c_string),
+                            (yyvsp[-2].c_string),
                             SFOUND_IN);
 
-                        yr_free((yyvsp[(1) - (3)].c_string));
+                        yr_free((yyvsp[-2].c_string));
 
                         ERROR_IF(result != ERROR_SUCCESS);
                       }
+#line 2286 "grammar.c"
     break;
 
-  case 47:
-#line 556 "grammar.y"
-    {
-                        yr_free((yyvsp[(1) - (6)].c_string));
-                        yr_free((yyvsp[(5) - (6)].sized_string));
+  case 47: /* boolean_expression: _STRING_IDENTIFIER_ _IN_ _SECTION_ '(' _TEXTSTRING_ ')'  */
+#line 584 "grammar.y"
+                      {
+                        yr_free((yyvsp[-5].c_string));
+                        yr_free((yyvsp[-1].sized_string));
                       }
+#line 2295 "grammar.c"
     break;
 
-  case 48:
-#line 561 "grammar.y"
-    {
+  case 48: /* $@2: %empty  */
+#line 589 "grammar.y"
+                      {
                         YR_COMPILER* compiler = yyget_extra(yyscanner);
                         int result = ERROR_SUCCESS;
                         int var_index;
@@ -2271,13 +2309,13 @@ yyreduce:
 
                         var_index = yr_parser_lookup_loop_variable(
                             yyscanner,
-                            (yyvsp[(3) - (4)].c_string));
+                            (yyvsp[-1].c_string));
 
                         if (var_index >= 0)
                         {
                           yr_compiler_set_error_extra_info(
                               compiler,
-                              (yyvsp[(3) - (4)].c_string));
+                              (yyvsp[-1].c_string));
 
                           compiler->last_result = \
                               ERROR_DUPLICATE_LOOP_IDENTIFIER;
@@ -2294,11 +2332,12 @@ yyreduce:
 
                         ERROR_IF(result != ERROR_SUCCESS);
                       }
+#line 2336 "grammar.c"
     break;
 
-  case 49:
-#line 598 "grammar.y"
-    {
+  case 49: /* $@3: %empty  */
+#line 626 "grammar.y"
+                      {
                         YR_COMPILER* compiler = yyget_extra(yyscanner);
                         int mem_offset = LOOP_LOCAL_VARS * compiler->loop_depth;
                         int8_t* addr;
@@ -2312,7 +2351,7 @@ yyreduce:
                         yr_parser_emit_with_arg(
                             yyscanner, CLEAR_M, mem_offset + 2, NULL);
 
-                        if ((yyvsp[(6) - (7)].integer) == INTEGER_SET_ENUMERATION)
+                        if ((yyvsp[-1].integer) == INTEGER_SET_ENUMERATION)
                         {
                           // Pop the first integer
                           yr_parser_emit_with_arg(
@@ -2328,14 +2367,15 @@ yyreduce:
                         }
 
                         compiler->loop_address[compiler->loop_depth] = addr;
-                        compiler->loop_identifier[compiler->loop_depth] = (yyvsp[(3) - (7)].c_string);
+                        compiler->loop_identifier[compiler->loop_depth] = (yyvsp[-4].c_string);
                         compiler->loop_depth++;
                       }
+#line 2374 "grammar.c"
     break;
 
-  case 50:
-#line 632 "grammar.y"
-    {
+  case 50: /* boolean_expression: _FOR_ for_expression _IDENTIFIER_ _IN_ $@2 integer_set ':' $@3 '(' boolean_expression ')'  */
+#line 660 "grammar.y"
+                      {
                         YR_COMPILER* compiler = yyget_extra(yyscanner);
                         int mem_offset;
 
@@ -2348,7 +2388,7 @@ yyreduce:
                         yr_parser_emit_with_arg(
                             yyscanner, INCR_M, mem_offset + 2, NULL);
 
-                        if ((yyvsp[(6) - (11)].integer) == INTEGER_SET_ENUMERATION)
+                        if ((yyvsp[-5].integer) == INTEGER_SET_ENUMERATION)
                         {
                           yr_parser_emit_with_arg_reloc(
                               yyscanner,
@@ -2397,13 +2437,14 @@ yyreduce:
                         yr_parser_emit(yyscanner, LE, NULL);
 
                         compiler->loop_identifier[compiler->loop_depth] = NULL;
-                        yr_free((yyvsp[(3) - (11)].c_string));
+                        yr_free((yyvsp[-8].c_string));
                       }
+#line 2443 "grammar.c"
     break;
 
-  case 51:
-#line 697 "grammar.y"
-    {
+  case 51: /* $@4: %empty  */
+#line 725 "grammar.y"
+                      {
                         YR_COMPILER* compiler = yyget_extra(yyscanner);
                         int mem_offset = LOOP_LOCAL_VARS * compiler->loop_depth;
                         int8_t* addr;
@@ -2414,6 +2455,11 @@ yyreduce:
 
                         ERROR_IF(compiler->last_result != ERROR_SUCCESS);
 
+                        compiler->last_result = \
+                            yr_parser_emit_pushes_for_string_set(yyscanner);
+
+                        ERROR_IF(compiler->last_result != ERROR_SUCCESS);
+
                         yr_parser_emit_with_arg(
                             yyscanner, CLEAR_M, mem_offset + 1, NULL);
 
@@ -2427,11 +2473,12 @@ yyreduce:
                         compiler->loop_address[compiler->loop_depth] = addr;
                         compiler->loop_depth++;
                       }
+#line 2477 "grammar.c"
     break;
 
-  case 52:
-#line 722 "grammar.y"
-    {
+  case 52: /* boolean_expression: _FOR_ for_expression _OF_ string_set ':' $@4 '(' boolean_expression ')'  */
+#line 755 "grammar.y"
+                      {
                         YR_COMPILER* compiler = yyget_extra(yyscanner);
                         int mem_offset;
 
@@ -2474,96 +2521,198 @@ yyreduce:
                         yr_parser_emit(yyscanner, LE, NULL);
 
                       }
+#line 2525 "grammar.c"
     break;
 
-  case 53:
-#line 766 "grammar.y"
-    {
-                        yr_parser_emit(yyscanner, OF, NULL);
+  case 53: /* boolean_expression: for_expression _OF_ string_set  */
+#line 799 "grammar.y"
+                      {
+                        YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+                        compiler->last_result = yr_parser_emit_of(yyscanner);
+
+                        ERROR_IF(compiler->last_result != ERROR_SUCCESS);
                       }
+#line 2537 "grammar.c"
     break;
 
-  case 54:
-#line 770 "grammar.y"
-    {
+  case 54: /* boolean_expression: _FILE_ _IS_ type  */
+#line 807 "grammar.y"
+                      {
                       }
+#line 2544 "grammar.c"
     break;
 
-  case 55:
-#line 773 "grammar.y"
-    {
+  case 55: /* boolean_expression: _NOT_ boolean_expression  */
+#line 810 "grammar.y"
+                      {
                         yr_parser_emit(yyscanner, NOT, NULL);
                       }
+#line 2552 "grammar.c"
     break;
 
-  case 56:
-#line 777 "grammar.y"
-    {
+  case 56: /* @5: %empty  */
+#line 814 "grammar.y"
+                      {
+                        YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+                        // If the left operand is false the right one is
+                        // skipped, the false value in the stack is the
+                        // result of the whole expression.
+                        (yyval.logical).left_is_boolean = \
+                            compiler->last_expression_is_boolean;
+
+                        compiler->last_result = yr_parser_emit_forward_jump(
+                            yyscanner,
+                            JFALSE,
+                            &(yyval.logical).jump_target);
+
+                        ERROR_IF(compiler->last_result != ERROR_SUCCESS);
+                      }
+#line 2573 "grammar.c"
+    break;
+
+  case 57: /* boolean_expression: boolean_expression _AND_ @5 boolean_expression  */
+#line 831 "grammar.y"
+                      {
+                        YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+                        int right_is_boolean = \
+                            compiler->last_expression_is_boolean;
+
                         yr_parser_emit(yyscanner, AND, NULL);
+
+                        compiler->last_result = yr_parser_set_jump_target(
+                            yyscanner,
+                            (yyvsp[-1].logical).jump_target);
+
+                        compiler->last_expression_is_boolean = \
+                            (yyvsp[-1].logical).left_is_boolean || right_is_boolean;
+
+                        ERROR_IF(compiler->last_result != ERROR_SUCCESS);
                       }
+#line 2595 "grammar.c"
     break;
 
-  case 57:
-#line 781 "grammar.y"
-    {
+  case 58: /* @6: %empty  */
+#line 849 "grammar.y"
+                      {
+                        YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+                        // If the left operand is true the right one is
+                        // skipped. Integer externals are not just 0 or 1,
+                        // and the bitwise OR of such a value with the
+                        // right operand could differ from the value alone.
+                        // The jump lands on the right operand for now, it
+                        // is moved past the OR only if both operands are
+                        // either 0 or 1.
+                        (yyval.logical).left_is_boolean = \
+                            compiler->last_expression_is_boolean;
+
+                        (yyval.logical).jump_target = NULL;
+
+                        if ((yyval.logical).left_is_boolean)
+                        {
+                          compiler->last_result = yr_parser_emit_forward_jump(
+                              yyscanner,
+                              JTRUE,
+                              &(yyval.logical).jump_target);
+
+                          if (compiler->last_result == ERROR_SUCCESS)
+                            compiler->last_result = yr_parser_set_jump_target(
+                                yyscanner,
+                                (yyval.logical).jump_target);
+                        }
+
+                        ERROR_IF(compiler->last_result != ERROR_SUCCESS);
+                      }
+#line 2630 "grammar.c"
+    break;
+
+  case 59: /* boolean_expression: boolean_expression _OR_ @6 boolean_expression  */
+#line 880 "grammar.y"
+                      {
+                        YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+                        int is_boolean = \
+                            (yyvsp[-1].logical).left_is_boolean &&
+                            compiler->last_expression_is_boolean;
+
                         yr_parser_emit(yyscanner, OR, NULL);
+
+                        if (is_boolean)
+                          compiler->last_result = yr_parser_set_jump_target(
+                              yyscanner,
+                              (yyvsp[-1].logical).jump_target);
+
+                        compiler->last_expression_is_boolean = is_boolean;
+
+                        ERROR_IF(compiler->last_result != ERROR_SUCCESS);
                       }
+#line 2653 "grammar.c"
     break;
 
-  case 58:
-#line 785 "grammar.y"
-    {
+  case 60: /* boolean_expression: expression _LT_ expression  */
+#line 899 "grammar.y"
+                      {
                         yr_parser_emit(yyscanner, LT, NULL);
                       }
+#line 2661 "grammar.c"
     break;
 
-  case 59:
-#line 789 "grammar.y"
-    {
+  case 61: /* boolean_expression: expression _GT_ expression  */
+#line 903 "grammar.y"
+                      {
                         yr_parser_emit(yyscanner, GT, NULL);
                       }
+#line 2669 "grammar.c"
     break;
 
-  case 60:
-#line 793 "grammar.y"
-    {
+  case 62: /* boolean_expression: expression _LE_ expression  */
+#line 907 "grammar.y"
+                      {
                         yr_parser_emit(yyscanner, LE, NULL);
                       }
+#line 2677 "grammar.c"
     break;
 
-  case 61:
-#line 797 "grammar.y"
-    {
+  case 63: /* boolean_expression: expression _GE_ expression  */
+#line 911 "grammar.y"
+                      {
                         yr_parser_emit(yyscanner, GE, NULL);
                       }
+#line 2685 "grammar.c"
     break;
 
-  case 62:
-#line 801 "grammar.y"
-    {
+  case 64: /* boolean_expression: expression _EQ_ expression  */
+#line 915 "grammar.y"
+                      {
                         yr_parser_emit(yyscanner, EQ, NULL);
                       }
+#line 2693 "grammar.c"
     break;
 
-  case 63:
-#line 805 "grammar.y"
-    {
+  case 65: /* boolean_expression: expression _IS_ expression  */
+#line 919 "grammar.y"
+                      {
                         yr_parser_emit(yyscanner, EQ, NULL);
                       }
+#line 2701 "grammar.c"
     break;
 
-  case 64:
-#line 809 "grammar.y"
-    {
+  case 66: /* boolean_expression: expression _NEQ_ expression  */
+#line 923 "grammar.y"
+                      {
                         yr_parser_emit(yyscanner, NEQ, NULL);
                       }
+#line 2709 "grammar.c"
     break;
 
-  case 65:
-#line 816 "grammar.y"
-    {
+  case 67: /* text: _TEXTSTRING_  */
+#line 930 "grammar.y"
+        {
           YR_COMPILER* compiler = yyget_extra(yyscanner);
-          SIZED_STRING* sized_string = (yyvsp[(1) - (1)].sized_string);
+          SIZED_STRING* sized_string = (yyvsp[0].sized_string);
           char* string;
 
           yr_arena_write_string(
@@ -2577,194 +2726,233 @@ yyreduce:
               PTR_TO_UINT64(string),
               NULL);
 
-          yr_free((yyvsp[(1) - (1)].sized_string));
+          yr_free((yyvsp[0].sized_string));
         }
+#line 2732 "grammar.c"
     break;
 
-  case 66:
-#line 835 "grammar.y"
-    {
+  case 68: /* text: _IDENTIFIER_  */
+#line 949 "grammar.y"
+        {
           int result = yr_parser_reduce_external(
               yyscanner,
-              (yyvsp[(1) - (1)].c_string),
+              (yyvsp[0].c_string),
               EXT_STR);
 
-          yr_free((yyvsp[(1) - (1)].c_string));
+          yr_free((yyvsp[0].c_string));
 
           ERROR_IF(result != ERROR_SUCCESS);
         }
+#line 2747 "grammar.c"
     break;
 
-  case 67:
-#line 848 "grammar.y"
-    { (yyval.integer) = INTEGER_SET_ENUMERATION; }
+  case 69: /* integer_set: '(' integer_enumeration ')'  */
+#line 962 "grammar.y"
+                                           { (yyval.integer) = INTEGER_SET_ENUMERATION; }
+#line 2753 "grammar.c"
     break;
 
-  case 68:
-#line 849 "grammar.y"
-    { (yyval.integer) = INTEGER_SET_RANGE; }
+  case 70: /* integer_set: range  */
+#line 963 "grammar.y"
+                                           { (yyval.integer) = INTEGER_SET_RANGE; }
+#line 2759 "grammar.c"
     break;
 
-  case 72:
-#line 862 "grammar.y"
-    {
-                yr_parser_emit_with_arg(yyscanner, PUSH, UNDEFINED, NULL);
+  case 74: /* $@7: %empty  */
+#line 976 "grammar.y"
+              {
+                yyget_extra(yyscanner)->string_set_count = 0;
               }
+#line 2767 "grammar.c"
     break;
 
-  case 74:
-#line 867 "grammar.y"
-    {
-                yr_parser_emit_with_arg(yyscanner, PUSH, UNDEFINED, NULL);
-                yr_parser_emit_pushes_for_strings(yyscanner, "$*");
+  case 76: /* string_set: _THEM_  */
+#line 981 "grammar.y"
+              {
+                YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+                compiler->string_set_count = 0;
+                compiler->last_result = yr_parser_add_strings_to_set(
+                    yyscanner, "$*");
+
+                ERROR_IF(compiler->last_result != ERROR_SUCCESS);
               }
+#line 2781 "grammar.c"
     break;
 
-  case 77:
-#line 878 "grammar.y"
-    {
-                            yr_parser_emit_pushes_for_strings(yyscanner, (yyvsp[(1) - (1)].c_string));
-                            yr_free((yyvsp[(1) - (1)].c_string));
+  case 79: /* string_enumeration_item: _STRING_IDENTIFIER_  */
+#line 997 "grammar.y"
+                          {
+                            YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+                            compiler->last_result = \
+                                yr_parser_add_strings_to_set(yyscanner, (yyvsp[0].c_string));
+
+                            yr_free((yyvsp[0].c_string));
+
+                            ERROR_IF(compiler->last_result != ERROR_SUCCESS);
                           }
+#line 2796 "grammar.c"
     break;
 
-  case 78:
-#line 883 "grammar.y"
-    {
-                            yr_parser_emit_pushes_for_strings(yyscanner, (yyvsp[(1) - (1)].c_string));
-                            yr_free((yyvsp[(1) - (1)].c_string));
+  case 80: /* string_enumeration_item: _STRING_IDENTIFIER_WITH_WILDCARD_  */
+#line 1008 "grammar.y"
+                          {
+                            YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+                            compiler->last_result = \
+                                yr_parser_add_strings_to_set(yyscanner, (yyvsp[0].c_string));
+
+                            yr_free((yyvsp[0].c_string));
+
+                            ERROR_IF(compiler->last_result != ERROR_SUCCESS);
                           }
+#line 2811 "grammar.c"
     break;
 
-  case 80:
-#line 891 "grammar.y"
-    {
+  case 82: /* for_expression: _ALL_  */
+#line 1022 "grammar.y"
+                  {
                     yr_parser_emit_with_arg(yyscanner, PUSH, UNDEFINED, NULL);
                   }
+#line 2819 "grammar.c"
     break;
 
-  case 81:
-#line 895 "grammar.y"
-    {
+  case 83: /* for_expression: _ANY_  */
+#line 1026 "grammar.y"
+                  {
                     yr_parser_emit_with_arg(yyscanner, PUSH, 1, NULL);
                   }
+#line 2827 "grammar.c"
     break;
 
-  case 83:
-#line 903 "grammar.y"
-    {
+  case 85: /* expression: _SIZE_  */
+#line 1034 "grammar.y"
+              {
                 yr_parser_emit(yyscanner, SIZE, NULL);
               }
+#line 2835 "grammar.c"
     break;
 
-  case 84:
-#line 907 "grammar.y"
-    {
+  case 86: /* expression: _ENTRYPOINT_  */
+#line 1038 "grammar.y"
+              {
                 yr_parser_emit(yyscanner, ENTRYPOINT, NULL);
               }
+#line 2843 "grammar.c"
     break;
 
-  case 85:
-#line 911 "grammar.y"
-    {
+  case 87: /* expression: _INT8_ '(' expression ')'  */
+#line 1042 "grammar.y"
+              {
                 yr_parser_emit(yyscanner, INT8, NULL);
               }
+#line 2851 "grammar.c"
     break;
 
-  case 86:
-#line 915 "grammar.y"
-    {
+  case 88: /* expression: _INT16_ '(' expression ')'  */
+#line 1046 "grammar.y"
+              {
                 yr_parser_emit(yyscanner, INT16, NULL);
               }
+#line 2859 "grammar.c"
     break;
 
-  case 87:
-#line 919 "grammar.y"
-    {
+  case 89: /* expression: _INT32_ '(' expression ')'  */
+#line 1050 "grammar.y"
+              {
                 yr_parser_emit(yyscanner, INT32, NULL);
               }
+#line 2867 "grammar.c"
     break;
 
-  case 88:
-#line 923 "grammar.y"
-    {
+  case 90: /* expression: _UINT8_ '(' expression ')'  */
+#line 1054 "grammar.y"
+              {
                 yr_parser_emit(yyscanner, UINT8, NULL);
               }
+#line 2875 "grammar.c"
     break;
 
-  case 89:
-#line 927 "grammar.y"
-    {
+  case 91: /* expression: _UINT16_ '(' expression ')'  */
+#line 1058 "grammar.y"
+              {
                 yr_parser_emit(yyscanner, UINT16, NULL);
               }
+#line 2883 "grammar.c"
     break;
 
-  case 90:
-#line 931 "grammar.y"
-    {
+  case 92: /* expression: _UINT32_ '(' expression ')'  */
+#line 1062 "grammar.y"
+              {
                 yr_parser_emit(yyscanner, UINT32, NULL);
               }
+#line 2891 "grammar.c"
     break;
 
-  case 91:
-#line 935 "grammar.y"
-    {
-                yr_parser_emit_with_arg(yyscanner, PUSH, (yyvsp[(1) - (1)].integer), NULL);
+  case 93: /* expression: _NUMBER_  */
+#line 1066 "grammar.y"
+              {
+                yr_parser_emit_with_arg(yyscanner, PUSH, (yyvsp[0].integer), NULL);
               }
+#line 2899 "grammar.c"
     break;
 
-  case 92:
-#line 939 "grammar.y"
-    {
+  case 94: /* expression: _STRING_COUNT_  */
+#line 1070 "grammar.y"
+              {
                 int result = yr_parser_reduce_string_identifier(
                     yyscanner,
-                    (yyvsp[(1) - (1)].c_string),
+                    (yyvsp[0].c_string),
                     SCOUNT);
 
-                yr_free((yyvsp[(1) - (1)].c_string));
+                yr_free((yyvsp[0].c_string));
 
                 ERROR_IF(result != ERROR_SUCCESS);
               }
+#line 2914 "grammar.c"
     break;
 
-  case 93:
-#line 950 "grammar.y"
-    {
+  case 95: /* expression: _STRING_OFFSET_ '[' expression ']'  */
+#line 1081 "grammar.y"
+              {
                 int result = yr_parser_reduce_string_identifier(
                     yyscanner,
-                    (yyvsp[(1) - (4)].c_string),
+                    (yyvsp[-3].c_string),
                     SOFFSET);
 
-                yr_free((yyvsp[(1) - (4)].c_string));
+                yr_free((yyvsp[-3].c_string));
 
                 ERROR_IF(result != ERROR_SUCCESS);
               }
+#line 2929 "grammar.c"
     break;
 
-  case 94:
-#line 961 "grammar.y"
-    {
+  case 96: /* expression: _STRING_OFFSET_  */
+#line 1092 "grammar.y"
+              {
                 int result = yr_parser_emit_with_arg(yyscanner, PUSH, 1, NULL);
 
                 if (result == ERROR_SUCCESS)
                   result = yr_parser_reduce_string_identifier(
                       yyscanner,
-                      (yyvsp[(1) - (1)].c_string),
+                      (yyvsp[0].c_string),
                       SOFFSET);
 
-                yr_free((yyvsp[(1) - (1)].c_string));
+                yr_free((yyvsp[0].c_string));
 
                 ERROR_IF(result != ERROR_SUCCESS);
               }
+#line 2947 "grammar.c"
     break;
 
-  case 95:
-#line 975 "grammar.y"
-    {
+  case 97: /* expression: _IDENTIFIER_  */
+#line 1106 "grammar.y"
+              {
                 YR_COMPILER* compiler = yyget_extra(yyscanner);
                 int var_index;
 
-                var_index = yr_parser_lookup_loop_variable(yyscanner, (yyvsp[(1) - (1)].c_string));
+                var_index = yr_parser_lookup_loop_variable(yyscanner, (yyvsp[0].c_string));
 
                 if (var_index >= 0)
                 {
@@ -2778,189 +2966,206 @@ yyreduce:
                 {
                   compiler->last_result = yr_parser_reduce_external(
                       yyscanner,
-                      (yyvsp[(1) - (1)].c_string),
+                      (yyvsp[0].c_string),
                       EXT_INT);
                 }
 
-                yr_free((yyvsp[(1) - (1)].c_string));
+                yr_free((yyvsp[0].c_string));
 
                 ERROR_IF(compiler->last_result != ERROR_SUCCESS);
               }
+#line 2978 "grammar.c"
     break;
 
-  case 96:
-#line 1002 "grammar.y"
-    {
+  case 98: /* expression: expression '+' expression  */
+#line 1133 "grammar.y"
+              {
                 yr_parser_emit(yyscanner, ADD, NULL);
               }
+#line 2986 "grammar.c"
     break;
 
-  case 97:
-#line 1006 "grammar.y"
-    {
+  case 99: /* expression: expression '-' expression  */
+#line 1137 "grammar.y"
+              {
                 yr_parser_emit(yyscanner, SUB, NULL);
               }
+#line 2994 "grammar.c"
     break;
 
-  case 98:
-#line 1010 "grammar.y"
-    {
+  case 100: /* expression: expression '*' expression  */
+#line 1141 "grammar.y"
+              {
                 yr_parser_emit(yyscanner, MUL, NULL);
               }
+#line 3002 "grammar.c"
     break;
 
-  case 99:
-#line 1014 "grammar.y"
-    {
+  case 101: /* expression: expression '\\' expression  */
+#line 1145 "grammar.y"
+              {
                 yr_parser_emit(yyscanner, DIV, NULL);
               }
+#line 3010 "grammar.c"
     break;
 
-  case 100:
-#line 1018 "grammar.y"
-    {
+  case 102: /* expression: expression '%' expression  */
+#line 1149 "grammar.y"
+              {
                 yr_parser_emit(yyscanner, MOD, NULL);
               }
+#line 3018 "grammar.c"
     break;
 
-  case 101:
-#line 1022 "grammar.y"
-    {
+  case 103: /* expression: expression '^' expression  */
+#line 1153 "grammar.y"
+              {
                 yr_parser_emit(yyscanner, XOR, NULL);
               }
+#line 3026 "grammar.c"
     break;
 
-  case 102:
-#line 1026 "grammar.y"
-    {
+  case 104: /* expression: expression '&' expression  */
+#line 1157 "grammar.y"
+              {
                 yr_parser_emit(yyscanner, AND, NULL);
               }
+#line 3034 "grammar.c"
     break;
 
-  case 103:
-#line 1030 "grammar.y"
-    {
+  case 105: /* expression: expression '|' expression  */
+#line 1161 "grammar.y"
+              {
                 yr_parser_emit(yyscanner, OR, NULL);
               }
+#line 3042 "grammar.c"
     break;
 
-  case 104:
-#line 1034 "grammar.y"
-    {
+  case 106: /* expression: '~' expression  */
+#line 1165 "grammar.y"
+              {
                 yr_parser_emit(yyscanner, NEG, NULL);
               }
+#line 3050 "grammar.c"
     break;
 
-  case 105:
-#line 1038 "grammar.y"
-    {
+  case 107: /* expression: expression _SHIFT_LEFT_ expression  */
+#line 1169 "grammar.y"
+              {
                 yr_parser_emit(yyscanner, SHL, NULL);
               }
+#line 3058 "grammar.c"
     break;
 
-  case 106:
-#line 1042 "grammar.y"
-    {
+  case 108: /* expression: expression _SHIFT_RIGHT_ expression  */
+#line 1173 "grammar.y"
+              {
                 yr_parser_emit(yyscanner, SHR, NULL);
               }
+#line 3066 "grammar.c"
     break;
 
 
-/* Line 1267 of yacc.c.  */
-#line 2871 "grammar.c"
+#line 3070 "grammar.c"
+
       default: break;
     }
-  YY_SYMBOL_PRINT ("-> $$ =", yyr1[yyn], &yyval, &yyloc);
+  /* User semantic actions sometimes alter yychar, and that requires
+     that yytoken be updated with the new translation.  We take the
+     approach of translating immediately before every use of yytoken.
+     One alternative is translating here after every semantic action,
+     but that translation would be missed if the semantic action invokes
+     YYABORT, YYACCEPT, or YYERROR immediately after altering yychar or
+     if it invokes YYBACKUP.  In the case of YYABORT or YYACCEPT, an
+     incorrect destructor might then be invoked immediately.  In the
+     case of YYERROR or YYBACKUP, subsequent parser actions might lead
+     to an incorrect destructor call or verbose syntax error message
+     before the lookahead is translated.  */
+  YY_SYMBOL_PRINT ("-> $$ =", YY_CAST (yysymbol_kind_t, yyr1[yyn]), &yyval, &yyloc);
 
   YYPOPSTACK (yylen);
   yylen = 0;
-  YY_STACK_PRINT (yyss, yyssp);
 
   *++yyvsp = yyval;
 
-
-  /* Now `shift' the result of the reduction.  Determine what state
+  /* Now 'shift' the result of the reduction.  Determine what state
      that goes to, based on the state we popped back to and the rule
      number reduced by.  */
-
-  yyn = yyr1[yyn];
-
-  yystate = yypgoto[yyn - YYNTOKENS] + *yyssp;
-  if (0 <= yystate && yystate <= YYLAST && yycheck[yystate] == *yyssp)
-    yystate = yytable[yystate];
-  else
-    yystate = yydefgoto[yyn - YYNTOKENS];
+  {
+    const int yylhs = yyr1[yyn] - YYNTOKENS;
+    const int yyi = yypgoto[yylhs] + *yyssp;
+    yystate = (0 <= yyi && yyi <= YYLAST && yycheck[yyi] == *yyssp
+               ? yytable[yyi]
+               : yydefgoto[yylhs]);
+  }
 
   goto yynewstate;
 
 
-/*------------------------------------.
-| yyerrlab -- here on detecting error |
-`------------------------------------*/
+/*--------------------------------------.
+| yyerrlab -- here on detecting error.  |
+`--------------------------------------*/
 yyerrlab:
+  /* Make sure we have latest lookahead translation.  See comments at
+     user semantic actions for why this is necessary.  */
+  yytoken = yychar == YYEMPTY ? YYSYMBOL_YYEMPTY : YYTRANSLATE (yychar);
   /* If not already recovering from an error, report this error.  */
   if (!yyerrstatus)
     {
       ++yynerrs;
-#if ! YYERROR_VERBOSE
-      yyerror (yyscanner, YY_("syntax error"));
-#else
       {
-	YYSIZE_T yysize = yysyntax_error (0, yystate, yychar);
-	if (yymsg_alloc < yysize && yymsg_alloc < YYSTACK_ALLOC_MAXIMUM)
-	  {
-	    YYSIZE_T yyalloc = 2 * yysize;
-	    if (! (yysize <= yyalloc && yyalloc <= YYSTACK_ALLOC_MAXIMUM))
-	      yyalloc = YYSTACK_ALLOC_MAXIMUM;
-	    if (yymsg != yymsgbuf)
-	      YYSTACK_FREE (yymsg);
-	    yymsg = (char *) YYSTACK_ALLOC (yyalloc);
-	    if (yymsg)
-	      yymsg_alloc = yyalloc;
-	    else
-	      {
-		yymsg = yymsgbuf;
-		yymsg_alloc = sizeof yymsgbuf;
-	      }
-	  }
-
-	if (0 < yysize && yysize <= yymsg_alloc)
-	  {
-	    (void) yysyntax_error (yymsg, yystate, yychar);
-	    yyerror (yyscanner, yymsg);
-	  }
-	else
-	  {
-	    yyerror (yyscanner, YY_("syntax error"));
-	    if (yysize != 0)
-	      goto yyexhaustedlab;
-	  }
+        yypcontext_t yyctx
+          = {yyssp, yytoken};
+        char const *yymsgp = YY_("syntax error");
+        int yysyntax_error_status;
+        yysyntax_error_status = yysyntax_error (&yymsg_alloc, &yymsg, &yyctx);
+        if (yysyntax_error_status == 0)
+          yymsgp = yymsg;
+        else if (yysyntax_error_status == -1)
+          {
+            if (yymsg != yymsgbuf)
+              YYSTACK_FREE (yymsg);
+            yymsg = YY_CAST (char *,
+                             YYSTACK_ALLOC (YY_CAST (YYSIZE_T, yymsg_alloc)));
+            if (yymsg)
+              {
+                yysyntax_error_status
+                  = yysyntax_error (&yymsg_alloc, &yymsg, &yyctx);
+                yymsgp = yymsg;
+              }
+            else
+              {
+                yymsg = yymsgbuf;
+                yymsg_alloc = sizeof yymsgbuf;
+                yysyntax_error_status = YYENOMEM;
+              }
+          }
+        yyerror (yyscanner, yymsgp);
+        if (yysyntax_error_status == YYENOMEM)
+          YYNOMEM;
       }
-#endif
     }
 
-
-
   if (yyerrstatus == 3)
     {
-      /* If just tried and failed to reuse look-ahead token after an
-	 error, discard it.  */
+      /* If just tried and failed to reuse lookahead token after an
+         error, discard it.  */
 
       if (yychar <= YYEOF)
-	{
-	  /* Return failure if at end of input.  */
-	  if (yychar == YYEOF)
-	    YYABORT;
-	}
+        {
+          /* Return failure if at end of input.  */
+          if (yychar == YYEOF)
+            YYABORT;
+        }
       else
-	{
-	  yydestruct ("Error: discarding",
-		      yytoken, &yylval, yyscanner);
-	  yychar = YYEMPTY;
-	}
+        {
+          yydestruct ("Error: discarding",
+                      yytoken, &yylval, yyscanner);
+          yychar = YYEMPTY;
+        }
     }
 
-  /* Else will try to reuse look-ahead token after shifting the error
+  /* Else will try to reuse lookahead token after shifting the error
      token.  */
   goto yyerrlab1;
 
@@ -2969,14 +3174,13 @@ yyerrlab:
 | yyerrorlab -- error raised explicitly by YYERROR.  |
 `---------------------------------------------------*/
 yyerrorlab:
+  /* Pacify compilers when the user code never invokes YYERROR and the
+     label yyerrorlab therefore never appears in user code.  */
+  if (0)
+    YYERROR;
+  ++yynerrs;
 
-  /* Pacify compilers like GCC when the user code never invokes
-     YYERROR and the label yyerrorlab therefore never appears in user
-     code.  */
-  if (/*CONSTCOND*/ 0)
-     goto yyerrorlab;
-
-  /* Do not reclaim the symbols of the rule which action triggered
+  /* Do not reclaim the symbols of the rule whose action triggered
      this YYERROR.  */
   YYPOPSTACK (yylen);
   yylen = 0;
@@ -2989,42 +3193,42 @@ yyerrorlab:
 | yyerrlab1 -- common code for both syntax error and YYERROR.  |
 `-------------------------------------------------------------*/
 yyerrlab1:
-  yyerrstatus = 3;	/* Each real token shifted decrements this.  */
+  yyerrstatus = 3;      /* Each real token shifted decrements this.  */
 
+  /* Pop stack until we find a state that shifts the error token.  */
   for (;;)
     {
       yyn = yypact[yystate];
-      if (yyn != YYPACT_NINF)
-	{
-	  yyn += YYTERROR;
-	  if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYTERROR)
-	    {
-	      yyn = yytable[yyn];
-	      if (0 < yyn)
-		break;
-	    }
-	}
+      if (!yypact_value_is_default (yyn))
+        {
+          yyn += YYSYMBOL_YYerror;
+          if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYSYMBOL_YYerror)
+            {
+              yyn = yytable[yyn];
+              if (0 < yyn)
+                break;
+            }
+        }
 
       /* Pop the current state because it cannot handle the error token.  */
       if (yyssp == yyss)
-	YYABORT;
+        YYABORT;
 
 
       yydestruct ("Error: popping",
-		  yystos[yystate], yyvsp, yyscanner);
+                  YY_ACCESSING_SYMBOL (yystate), yyvsp, yyscanner);
       YYPOPSTACK (1);
       yystate = *yyssp;
       YY_STACK_PRINT (yyss, yyssp);
     }
 
-  if (yyn == YYFINAL)
-    YYACCEPT;
-
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
   *++yyvsp = yylval;
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
 
 
   /* Shift the error token.  */
-  YY_SYMBOL_PRINT ("Shifting", yystos[yyn], yyvsp, yylsp);
+  YY_SYMBOL_PRINT ("Shifting", YY_ACCESSING_SYMBOL (yyn), yyvsp, yylsp);
 
   yystate = yyn;
   goto yynewstate;
@@ -3035,54 +3239,58 @@ yyerrlab1:
 `-------------------------------------*/
 yyacceptlab:
   yyresult = 0;
-  goto yyreturn;
+  goto yyreturnlab;
+
 
 /*-----------------------------------.
 | yyabortlab -- YYABORT comes here.  |
 `-----------------------------------*/
 yyabortlab:
   yyresult = 1;
-  goto yyreturn;
+  goto yyreturnlab;
 
-#ifndef yyoverflow
-/*-------------------------------------------------.
-| yyexhaustedlab -- memory exhaustion comes here.  |
-`-------------------------------------------------*/
+
+/*-----------------------------------------------------------.
+| yyexhaustedlab -- YYNOMEM (memory exhaustion) comes here.  |
+`-----------------------------------------------------------*/
 yyexhaustedlab:
   yyerror (yyscanner, YY_("memory exhausted"));
   yyresult = 2;
-  /* Fall through.  */
-#endif
+  goto yyreturnlab;
+
 
-yyreturn:
-  if (yychar != YYEOF && yychar != YYEMPTY)
-     yydestruct ("Cleanup: discarding lookahead",
-		 yytoken, &yylval, yyscanner);
-  /* Do not reclaim the symbols of the rule which action triggered
+/*----------------------------------------------------------.
+| yyreturnlab -- parsing is finished, clean up and return.  |
+`----------------------------------------------------------*/
+yyreturnlab:
+  if (yychar != YYEMPTY)
+    {
+      /* Make sure we have latest lookahead translation.  See comments at
+         user semantic actions for why this is necessary.  */
+      yytoken = YYTRANSLATE (yychar);
+      yydestruct ("Cleanup: discarding lookahead",
+                  yytoken, &yylval, yyscanner);
+    }
+  /* Do not reclaim the symbols of the rule whose action triggered
      this YYABORT or YYACCEPT.  */
   YYPOPSTACK (yylen);
   YY_STACK_PRINT (yyss, yyssp);
   while (yyssp != yyss)
     {
       yydestruct ("Cleanup: popping",
-		  yystos[*yyssp], yyvsp, yyscanner);
+                  YY_ACCESSING_SYMBOL (+*yyssp), yyvsp, yyscanner);
       YYPOPSTACK (1);
     }
 #ifndef yyoverflow
   if (yyss != yyssa)
     YYSTACK_FREE (yyss);
 #endif
-#if YYERROR_VERBOSE
   if (yymsg != yymsgbuf)
     YYSTACK_FREE (yymsg);
-#endif
-  /* Make sure YYID is used.  */
-  return YYID (yyresult);
+  return yyresult;
 }
 
-
-#line 1052 "grammar.y"
-
+#line 1183 "grammar.y"
 
 
 
@@ -1,14 +1,14 @@
-/* A Bison parser, made by GNU Bison 2.3.  */
+/* A Bison parser, made by GNU Bison 3.8.2.  */
 
-/* Skeleton interface for Bison's Yacc-like parsers in C
+/* Bison interface for Yacc-like parsers in C
 
-   Copyright (C) 1984, 1989, 1990, 2000, 2001, 2002, 2003, 2004, 2005, 2006
-   Free Software Foundation, Inc.
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
 
-   This program is free software; you can redistribute it and/or modify
+   This program is free software: you can redistribute it and/or modify
    it under the terms of the GNU General Public License as published by
-   the Free Software Foundation; either version 2, or (at your option)
-   any later version.
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
 
    This program is distributed in the hope that it will be useful,
    but WITHOUT ANY WARRANTY; without even the implied warranty of
@@ -16,9 +16,7 @@
    GNU General Public License for more details.
 
    You should have received a copy of the GNU General Public License
-   along with this program; if not, write to the Free Software
-   Foundation, Inc., 51 Franklin Street, Fifth Floor,
-   Boston, MA 02110-1301, USA.  */
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 /* As a special exception, you may create a larger work that contains
    part or all of the Bison parser skeleton and distribute that work
@@ -33,158 +31,122 @@
    This special exception was added by the Free Software Foundation in
    version 2.2 of Bison.  */
 
-/* Tokens.  */
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
+#ifndef YY_YARA_YY_GRAMMAR_H_INCLUDED
+# define YY_YARA_YY_GRAMMAR_H_INCLUDED
+/* Debug traces.  */
+#ifndef YYDEBUG
+# define YYDEBUG 1
+#endif
+#if YYDEBUG
+extern int yara_yydebug;
+#endif
+
+/* Token kinds.  */
 #ifndef YYTOKENTYPE
 # define YYTOKENTYPE
-   /* Put the tokens into the symbol table, so that GDB and other debuggers
-      know about them.  */
-   enum yytokentype {
-     _RULE_ = 258,
-     _PRIVATE_ = 259,
-     _GLOBAL_ = 260,
-     _META_ = 261,
-     _STRINGS_ = 262,
-     _CONDITION_ = 263,
-     _END_ = 264,
-     _IDENTIFIER_ = 265,
-     _STRING_IDENTIFIER_ = 266,
-     _STRING_COUNT_ = 267,
-     _STRING_OFFSET_ = 268,
-     _STRING_IDENTIFIER_WITH_WILDCARD_ = 269,
-     _ANONYMOUS_STRING_ = 270,
-     _NUMBER_ = 271,
-     _UNKNOWN_ = 272,
-     _TEXTSTRING_ = 273,
-     _HEXSTRING_ = 274,
-     _REGEXP_ = 275,
-     _ASCII_ = 276,
-     _WIDE_ = 277,
-     _NOCASE_ = 278,
-     _FULLWORD_ = 279,
-     _AT_ = 280,
-     _SIZE_ = 281,
-     _ENTRYPOINT_ = 282,
-     _ALL_ = 283,
-     _ANY_ = 284,
-     _RVA_ = 285,
-     _OFFSET_ = 286,
-     _FILE_ = 287,
-     _IN_ = 288,
-     _OF_ = 289,
-     _FOR_ = 290,
-     _THEM_ = 291,
-     _SECTION_ = 292,
-     _INT8_ = 293,
-     _INT16_ = 294,
-     _INT32_ = 295,
-     _UINT8_ = 296,
-     _UINT16_ = 297,
-     _UINT32_ = 298,
-     _MATCHES_ = 299,
-     _CONTAINS_ = 300,
-     _INDEX_ = 301,
-     _MZ_ = 302,
-     _PE_ = 303,
-     _DLL_ = 304,
-     _TRUE_ = 305,
-     _FALSE_ = 306,
-     _OR_ = 307,
-     _AND_ = 308,
-     _IS_ = 309,
-     _NEQ_ = 310,
-     _EQ_ = 311,
-     _GE_ = 312,
-     _GT_ = 313,
-     _LE_ = 314,
-     _LT_ = 315,
-     _SHIFT_RIGHT_ = 316,
-     _SHIFT_LEFT_ = 317,
-     _NOT_ = 318
-   };
+  enum yytokentype
+  {
+    YYEMPTY = -2,
+    YYEOF = 0,                     /* "end of file"  */
+    YYerror = 256,                 /* error  */
+    YYUNDEF = 257,                 /* "invalid token"  */
+    _RULE_ = 258,                  /* _RULE_  */
+    _PRIVATE_ = 259,               /* _PRIVATE_  */
+    _GLOBAL_ = 260,                /* _GLOBAL_  */
+    _META_ = 261,                  /* _META_  */
+    _STRINGS_ = 262,               /* _STRINGS_  */
+    _CONDITION_ = 263,             /* _CONDITION_  */
+    _END_ = 264,                   /* _END_  */
+    _IDENTIFIER_ = 265,            /* _IDENTIFIER_  */
+    _STRING_IDENTIFIER_ = 266,     /* _STRING_IDENTIFIER_  */
+    _STRING_COUNT_ = 267,          /* _STRING_COUNT_  */
+    _STRING_OFFSET_ = 268,         /* _STRING_OFFSET_  */
+    _STRING_IDENTIFIER_WITH_WILDCARD_ = 269, /* _STRING_IDENTIFIER_WITH_WILDCARD_  */
+    _ANONYMOUS_STRING_ = 270,      /* _ANONYMOUS_STRING_  */
+    _NUMBER_ = 271,                /* _NUMBER_  */
+    _UNKNOWN_ = 272,               /* _UNKNOWN_  */
+    _TEXTSTRING_ = 273,            /* _TEXTSTRING_  */
+    _HEXSTRING_ = 274,             /* _HEXSTRING_  */
+    _REGEXP_ = 275,                /* _REGEXP_  */
+    _ASCII_ = 276,                 /* _ASCII_  */
+    _WIDE_ = 277,                  /* _WIDE_  */
+    _NOCASE_ = 278,                /* _NOCASE_  */
+    _FULLWORD_ = 279,              /* _FULLWORD_  */
+    _AT_ = 280,                    /* _AT_  */
+    _SIZE_ = 281,                  /* _SIZE_  */
+    _ENTRYPOINT_ = 282,            /* _ENTRYPOINT_  */
+    _ALL_ = 283,                   /* _ALL_  */
+    _ANY_ = 284,                   /* _ANY_  */
+    _RVA_ = 285,                   /* _RVA_  */
+    _OFFSET_ = 286,                /* _OFFSET_  */
+    _FILE_ = 287,                  /* _FILE_  */
+    _IN_ = 288,                    /* _IN_  */
+    _OF_ = 289,                    /* _OF_  */
+    _FOR_ = 290,                   /* _FOR_  */
+    _THEM_ = 291,                  /* _THEM_  */
+    _SECTION_ = 292,               /* _SECTION_  */
+    _INT8_ = 293,                  /* _INT8_  */
+    _INT16_ = 294,                 /* _INT16_  */
+    _INT32_ = 295,                 /* _INT32_  */
+    _UINT8_ = 296,                 /* _UINT8_  */
+    _UINT16_ = 297,                /* _UINT16_  */
+    _UINT32_ = 298,                /* _UINT32_  */
+    _MATCHES_ = 299,               /* _MATCHES_  */
+    _CONTAINS_ = 300,              /* _CONTAINS_  */
+    _INDEX_ = 301,                 /* _INDEX_  */
+    _MZ_ = 302,                    /* _MZ_  */
+    _PE_ = 303,                    /* _PE_  */
+    _DLL_ = 304,                   /* _DLL_  */
+    _TRUE_ = 305,                  /* _TRUE_  */
+    _FALSE_ = 306,                 /* _FALSE_  */
+    _OR_ = 307,                    /* _OR_  */
+    _AND_ = 308,                   /* _AND_  */
+    _LT_ = 309,                    /* _LT_  */
+    _LE_ = 310,                    /* _LE_  */
+    _GT_ = 311,                    /* _GT_  */
+    _GE_ = 312,                    /* _GE_  */
+    _EQ_ = 313,                    /* _EQ_  */
+    _NEQ_ = 314,                   /* _NEQ_  */
+    _IS_ = 315,                    /* _IS_  */
+    _SHIFT_LEFT_ = 316,            /* _SHIFT_LEFT_  */
+    _SHIFT_RIGHT_ = 317,           /* _SHIFT_RIGHT_  */
+    _NOT_ = 318                    /* _NOT_  */
+  };
+  typedef enum yytokentype yytoken_kind_t;
 #endif
-/* Tokens.  */
-#define _RULE_ 258
-#define _PRIVATE_ 259
-#define _GLOBAL_ 260
-#define _META_ 261
-#define _STRINGS_ 262
-#define _CONDITION_ 263
-#define _END_ 264
-#define _IDENTIFIER_ 265
-#define _STRING_IDENTIFIER_ 266
-#define _STRING_COUNT_ 267
-#define _STRING_OFFSET_ 268
-#define _STRING_IDENTIFIER_WITH_WILDCARD_ 269
-#define _ANONYMOUS_STRING_ 270
-#define _NUMBER_ 271
-#define _UNKNOWN_ 272
-#define _TEXTSTRING_ 273
-#define _HEXSTRING_ 274
-#define _REGEXP_ 275
-#define _ASCII_ 276
-#define _WIDE_ 277
-#define _NOCASE_ 278
-#define _FULLWORD_ 279
-#define _AT_ 280
-#define _SIZE_ 281
-#define _ENTRYPOINT_ 282
-#define _ALL_ 283
-#define _ANY_ 284
-#define _RVA_ 285
-#define _OFFSET_ 286
-#define _FILE_ 287
-#define _IN_ 288
-#define _OF_ 289
-#define _FOR_ 290
-#define _THEM_ 291
-#define _SECTION_ 292
-#define _INT8_ 293
-#define _INT16_ 294
-#define _INT32_ 295
-#define _UINT8_ 296
-#define _UINT16_ 297
-#define _UINT32_ 298
-#define _MATCHES_ 299
-#define _CONTAINS_ 300
-#define _INDEX_ 301
-#define _MZ_ 302
-#define _PE_ 303
-#define _DLL_ 304
-#define _TRUE_ 305
-#define _FALSE_ 306
-#define _OR_ 307
-#define _AND_ 308
-#define _IS_ 309
-#define _NEQ_ 310
-#define _EQ_ 311
-#define _GE_ 312
-#define _GT_ 313
-#define _LE_ 314
-#define _LT_ 315
-#define _SHIFT_RIGHT_ 316
-#define _SHIFT_LEFT_ 317
-#define _NOT_ 318
-
-
-
 
+/* Value type.  */
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
-typedef union YYSTYPE
-#line 148 "grammar.y"
+union YYSTYPE
 {
+#line 147 "grammar.y"
+
   SIZED_STRING*   sized_string;
   char*           c_string;
   int64_t         integer;
   YR_STRING*         string;
   YR_META*           meta;
-}
-/* Line 1529 of yacc.c.  */
-#line 183 "grammar.h"
-	YYSTYPE;
-# define yystype YYSTYPE /* obsolescent; will be withdrawn */
-# define YYSTYPE_IS_DECLARED 1
+  struct {
+    int8_t**         jump_target;
+    int              left_is_boolean;
+  } logical;
+
+#line 139 "grammar.h"
+
+};
+typedef union YYSTYPE YYSTYPE;
 # define YYSTYPE_IS_TRIVIAL 1
+# define YYSTYPE_IS_DECLARED 1
 #endif
 
 
 
+
+int yara_yyparse (void *yyscanner);
+
+
+#endif /* !YY_YARA_YY_GRAMMAR_H_INCLUDED  */
@@ -32,8 +32,6 @@ limitations under the License.
 #include "utils.h"
 #include "yara.h"
 
-#define YYERROR_VERBOSE
-
 #define INTEGER_SET_ENUMERATION 1
 #define INTEGER_SET_RANGE 2
 
@@ -47,6 +45,7 @@ limitations under the License.
 %}
 
 %debug
+%error-verbose
 %name-prefix="yara_yy"
 %pure-parser
 %parse-param {void *yyscanner}
@@ -151,6 +150,10 @@ limitations under the License.
   int64_t         integer;
   YR_STRING*         string;
   YR_META*           meta;
+  struct {
+    int8_t**         jump_target;
+    int              left_is_boolean;
+  } logical;
 }
 
 
@@ -159,7 +162,6 @@ limitations under the License.
 rules : /* empty */
       | rules rule
       | rules error rule      /* on error skip until next rule..*/
-      | rules error 'include' /* .. or include statement */
       ;
 
 
@@ -222,6 +224,7 @@ strings : /* empty */
           // write the end-of-list marker.
 
           YR_STRING null_string;
+          YR_STRING* string;
           YR_COMPILER* compiler;
 
           compiler = yyget_extra(yyscanner);
@@ -237,11 +240,33 @@ strings : /* empty */
 
           $$ = $3;
           compiler->current_rule_strings = $$;
+
+          // Number the strings, which is where scan contexts keep their
+          // matches. Strings of a rule get consecutive numbers.
+
+          string = $$;
+
+          while (!STRING_IS_NULL(string))
+          {
+            string->idx = compiler->strings_count++;
+            string = yr_arena_next_address(
+                compiler->strings_arena,
+                string,
+                sizeof(YR_STRING));
+          }
         }
         ;
 
 
-condition : _CONDITION_ ':' boolean_expression
+condition : _CONDITION_ ':'
+            {
+              YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+              compiler->last_result = yr_parser_emit_init_rule(yyscanner);
+
+              ERROR_IF(compiler->last_result != ERROR_SUCCESS);
+            }
+            boolean_expression
           ;
 
 
@@ -458,6 +483,9 @@ boolean_expression  : '(' boolean_expression ')'
 
                         if (rule != NULL)
                         {
+                          compiler->current_rule_flags |= \
+                              RULE_GFLAGS_REFERENCES_RULES;
+
                           compiler->last_result = yr_parser_emit_with_arg_reloc(
                               yyscanner,
                               RULE_PUSH,
@@ -705,6 +733,11 @@ boolean_expression  : '(' boolean_expression ')'
 
                         ERROR_IF(compiler->last_result != ERROR_SUCCESS);
 
+                        compiler->last_result = \
+                            yr_parser_emit_pushes_for_string_set(yyscanner);
+
+                        ERROR_IF(compiler->last_result != ERROR_SUCCESS);
+
                         yr_parser_emit_with_arg(
                             yyscanner, CLEAR_M, mem_offset + 1, NULL);
 
@@ -764,7 +797,11 @@ boolean_expression  : '(' boolean_expression ')'
                       }
                     | for_expression _OF_ string_set
                       {
-                        yr_parser_emit(yyscanner, OF, NULL);
+                        YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+                        compiler->last_result = yr_parser_emit_of(yyscanner);
+
+                        ERROR_IF(compiler->last_result != ERROR_SUCCESS);
                       }
                     | _FILE_ _IS_ type
                       {
@@ -773,13 +810,90 @@ boolean_expression  : '(' boolean_expression ')'
                       {
                         yr_parser_emit(yyscanner, NOT, NULL);
                       }
-                    | boolean_expression _AND_ boolean_expression
+                    | boolean_expression _AND_
+                      {
+                        YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+                        // If the left operand is false the right one is
+                        // skipped, the false value in the stack is the
+                        // result of the whole expression.
+                        $<logical>$.left_is_boolean = \
+                            compiler->last_expression_is_boolean;
+
+                        compiler->last_result = yr_parser_emit_forward_jump(
+                            yyscanner,
+                            JFALSE,
+                            &$<logical>$.jump_target);
+
+                        ERROR_IF(compiler->last_result != ERROR_SUCCESS);
+                      }
+                      boolean_expression
                       {
+                        YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+                        int right_is_boolean = \
+                            compiler->last_expression_is_boolean;
+
                         yr_parser_emit(yyscanner, AND, NULL);
+
+                        compiler->last_result = yr_parser_set_jump_target(
+                            yyscanner,
+                            $<logical>3.jump_target);
+
+                        compiler->last_expression_is_boolean = \
+                            $<logical>3.left_is_boolean || right_is_boolean;
+
+                        ERROR_IF(compiler->last_result != ERROR_SUCCESS);
+                      }
+                    | boolean_expression _OR_
+                      {
+                        YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+                        // If the left operand is true the right one is
+                        // skipped. Integer externals are not just 0 or 1,
+                        // and the bitwise OR of such a value with the
+                        // right operand could differ from the value alone.
+                        // The jump lands on the right operand for now, it
+                        // is moved past the OR only if both operands are
+                        // either 0 or 1.
+                        $<logical>$.left_is_boolean = \
+                            compiler->last_expression_is_boolean;
+
+                        $<logical>$.jump_target = NULL;
+
+                        if ($<logical>$.left_is_boolean)
+                        {
+                          compiler->last_result = yr_parser_emit_forward_jump(
+                              yyscanner,
+                              JTRUE,
+                              &$<logical>$.jump_target);
+
+                          if (compiler->last_result == ERROR_SUCCESS)
+                            compiler->last_result = yr_parser_set_jump_target(
+                                yyscanner,
+                                $<logical>$.jump_target);
+                        }
+
+                        ERROR_IF(compiler->last_result != ERROR_SUCCESS);
                       }
-                    | boolean_expression _OR_ boolean_expression
+                      boolean_expression
                       {
+                        YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+                        int is_boolean = \
+                            $<logical>3.left_is_boolean &&
+                            compiler->last_expression_is_boolean;
+
                         yr_parser_emit(yyscanner, OR, NULL);
+
+                        if (is_boolean)
+                          compiler->last_result = yr_parser_set_jump_target(
+                              yyscanner,
+                              $<logical>3.jump_target);
+
+                        compiler->last_expression_is_boolean = is_boolean;
+
+                        ERROR_IF(compiler->last_result != ERROR_SUCCESS);
                       }
                     | expression _LT_ expression
                       {
@@ -860,13 +974,18 @@ integer_enumeration : expression
 
 string_set  : '('
               {
-                yr_parser_emit_with_arg(yyscanner, PUSH, UNDEFINED, NULL);
+                yyget_extra(yyscanner)->string_set_count = 0;
               }
               string_enumeration ')'
             | _THEM_
               {
-                yr_parser_emit_with_arg(yyscanner, PUSH, UNDEFINED, NULL);
-                yr_parser_emit_pushes_for_strings(yyscanner, "$*");
+                YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+                compiler->string_set_count = 0;
+                compiler->last_result = yr_parser_add_strings_to_set(
+                    yyscanner, "$*");
+
+                ERROR_IF(compiler->last_result != ERROR_SUCCESS);
               }
             ;
 
@@ -876,13 +995,25 @@ string_enumeration  : string_enumeration_item
 
 string_enumeration_item : _STRING_IDENTIFIER_
                           {
-                            yr_parser_emit_pushes_for_strings(yyscanner, $1);
+                            YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+                            compiler->last_result = \
+                                yr_parser_add_strings_to_set(yyscanner, $1);
+
                             yr_free($1);
+
+                            ERROR_IF(compiler->last_result != ERROR_SUCCESS);
                           }
                         | _STRING_IDENTIFIER_WITH_WILDCARD_
                           {
-                            yr_parser_emit_pushes_for_strings(yyscanner, $1);
+                            YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+                            compiler->last_result = \
+                                yr_parser_add_strings_to_set(yyscanner, $1);
+
                             yr_free($1);
+
+                            ERROR_IF(compiler->last_result != ERROR_SUCCESS);
                           }
                         ;
 
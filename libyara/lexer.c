@@ -2963,10 +2963,6 @@ int yr_lex_parse_rules_file(
   yyscan_t yyscanner;
   yara_yylex_init(&yyscanner);
 
-  #if YYDEBUG
-  printf("debug enabled");
-  #endif
-
   yara_yyset_debug(1,yyscanner);
 
   yara_yyset_in(rules_file,yyscanner);
@@ -36,10 +36,32 @@ char altercase[256];
 
 #ifdef WIN32
 DWORD key;
+DWORD context_key;
 #else
 pthread_key_t key;
+pthread_key_t context_key;
 #endif
 
+#ifdef WIN32
+#define compare_and_swap(ptr, old, new) \
+    (InterlockedCompareExchange64( \
+        (volatile LONGLONG*) (ptr), (LONGLONG) (new), (LONGLONG) (old)) == \
+        (LONGLONG) (old))
+#else
+#define compare_and_swap(ptr, old, new) \
+    __sync_bool_compare_and_swap(ptr, old, new)
+#endif
+
+
+// Thread indexes not taken by any thread are kept in a lock-free stack.
+// The lower 32 bits of free_tidx_head hold the first free tidx plus one,
+// or zero when there are none. The upper 32 bits are incremented every
+// time the head changes, so that a compare-and-swap with a stale head
+// fails even if the same tidx is at the top again.
+
+volatile uint64_t free_tidx_head;
+int32_t free_tidx_next[MAX_THREADS];
+
 
 //
 // yr_initialize
@@ -64,12 +86,20 @@ void yr_initialize(void)
     lowercase[i] = tolower(i);
   }
 
+  for (i = 0; i < MAX_THREADS - 1; i++)
+    free_tidx_next[i] = i + 2;
+
+  free_tidx_next[MAX_THREADS - 1] = 0;
+  free_tidx_head = 1;
+
   yr_heap_alloc();
 
   #ifdef WIN32
   key = TlsAlloc();
+  context_key = TlsAlloc();
   #else
   pthread_key_create(&key, NULL);
+  pthread_key_create(&context_key, NULL);
   #endif
 
   yr_re_initialize();
@@ -79,11 +109,20 @@ void yr_initialize(void)
 //
 // yr_finalize_thread
 //
-// Should be called by ALL threads using libyara before exiting.
+// Should be called by ALL threads using libyara before exiting. The tidx
+// of the thread, if it has one, becomes available for other threads.
 //
 
 void yr_finalize_thread(void)
 {
+  int tidx = yr_get_tidx();
+
+  if (tidx != -1)
+  {
+    yr_release_tidx(tidx);
+    yr_set_tidx(-1);
+  }
+
   yr_re_finalize_thread();
 }
 
@@ -98,12 +137,14 @@ void yr_finalize_thread(void)
 
 void yr_finalize(void)
 {
-  yr_re_finalize_thread();
+  yr_finalize_thread();
 
   #ifdef WIN32
   TlsFree(key);
+  TlsFree(context_key);
   #else
   pthread_key_delete(key);
+  pthread_key_delete(context_key);
   #endif
 
   yr_re_finalize();
@@ -132,6 +173,66 @@ void yr_set_tidx(int tidx)
 }
 
 
+//
+// yr_acquire_tidx
+//
+// Returns the tidx of the current thread, taking a free one if the thread
+// doesn't have any yet. Scan contexts kept for each tidx (see YR_RULES)
+// are reused by whatever thread takes the tidx next.
+//
+// Returns:
+//    The tidx for the current thread or -1 if all of them are taken.
+//
+
+int yr_acquire_tidx(void)
+{
+  uint64_t head;
+  uint64_t new_head;
+
+  int tidx = yr_get_tidx();
+
+  if (tidx != -1)
+    return tidx;
+
+  do
+  {
+    head = free_tidx_head;
+    tidx = (int) (head & 0xFFFFFFFF) - 1;
+
+    if (tidx == -1)
+      return -1;
+
+    new_head = ((head >> 32) + 1) << 32 | (uint32_t) free_tidx_next[tidx];
+  }
+  while (!compare_and_swap(&free_tidx_head, head, new_head));
+
+  yr_set_tidx(tidx);
+
+  return tidx;
+}
+
+
+//
+// yr_release_tidx
+//
+// Makes a tidx available for other threads.
+//
+
+void yr_release_tidx(int tidx)
+{
+  uint64_t head;
+  uint64_t new_head;
+
+  do
+  {
+    head = free_tidx_head;
+    free_tidx_next[tidx] = (int32_t) (head & 0xFFFFFFFF);
+    new_head = ((head >> 32) + 1) << 32 | (uint32_t) (tidx + 1);
+  }
+  while (!compare_and_swap(&free_tidx_head, head, new_head));
+}
+
+
 //
 // _yr_get_tidx
 //
@@ -150,3 +251,44 @@ int yr_get_tidx(void)
   return (int) (size_t) pthread_getspecific(key) - 1;
   #endif
 }
+
+
+//
+// yr_set_scan_context
+//
+// Set the scan context used by the scan in progress in the current thread.
+// It's what the STRING_MATCHES, STRING_FOUND and RULE_MATCHES macros look
+// at, so they can be used from scan callbacks.
+//
+// Args:
+//    YR_SCAN_CONTEXT* context  - The scan context, or NULL when no scan is
+//                                in progress.
+//
+
+void yr_set_scan_context(YR_SCAN_CONTEXT* context)
+{
+  #ifdef WIN32
+  TlsSetValue(context_key, (LPVOID) context);
+  #else
+  pthread_setspecific(context_key, (void*) context);
+  #endif
+}
+
+
+//
+// yr_get_scan_context
+//
+// Get the scan context used by the scan in progress in the current thread.
+//
+// Returns:
+//    The scan context or NULL if the current thread isn't scanning.
+//
+
+YR_SCAN_CONTEXT* yr_get_scan_context(void)
+{
+  #ifdef WIN32
+  return (YR_SCAN_CONTEXT*) TlsGetValue(context_key);
+  #else
+  return (YR_SCAN_CONTEXT*) pthread_getspecific(context_key);
+  #endif
+}
@@ -0,0 +1,1279 @@
+/*
+Copyright (c) 2013. Victor M. Alvarez [plusvic@gmail.com].
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/*
+
+This module optimizes the condition code emitted by the parser before it
+is appended to the compiled rules. The code arena is decoded into a list
+of instructions and the following transformations are applied until none
+of them makes progress:
+
+  - Operands of "and" and "or" are swapped when the right one looks
+    cheaper to evaluate than the left one, so that short-circuit
+    evaluation skips the expensive one more often. This is done only once,
+    before the other transformations.
+
+  - Constant folding: PUSH a; PUSH b; ADD becomes PUSH a+b, and the same
+    for every other arithmetic, bitwise, comparison and boolean operator.
+    PUSH a; NOT and PUSH a; NEG are folded too.
+
+  - PUSH a; POP is removed.
+
+  - Conditional jumps preceded by a PUSH of a constant are either removed,
+    if they are never taken, or marked as always taken.
+
+  - Code not reachable from the first instruction is removed. This drops
+    the right operand of "and" and "or" when the left one is constant.
+
+  - Conditional jumps to the next instruction are removed.
+
+An instruction which is the target of some jump is never folded with the
+instructions before it, as the values in the stack depend on where the
+execution comes from. The code is then written into a new arena, with
+jump targets pointing to the new addresses and relocatable arguments still
+marked as such.
+
+*/
+
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+
+#include "arena.h"
+#include "exec.h"
+#include "mem.h"
+#include "optimizer.h"
+
+
+#define MAX_OPTIMIZER_PASSES      8
+
+// Evaluating an instruction within a loop is assumed to cost as much as
+// this number of evaluations outside it.
+
+#define LOOP_COST_FACTOR          8
+
+#define INSTR_FLAGS_LABEL         0x01
+#define INSTR_FLAGS_REACHABLE     0x02
+#define INSTR_FLAGS_REMOVED       0x04
+#define INSTR_FLAGS_ALWAYS_JUMPS  0x08
+
+
+typedef struct _INSTRUCTION
+{
+  uint8_t opcode;
+  int flags;
+
+  int args_count;
+  int relocatable_args;
+  int64_t args[2];
+
+  int64_t offset;
+  int target;
+  int cost;
+
+  uint8_t* new_address;
+  uint8_t** new_jump_arg;
+
+} INSTRUCTION;
+
+
+typedef struct _CODE
+{
+  INSTRUCTION* instructions;
+  int count;
+  int size;
+
+} CODE;
+
+
+#define IS_REMOVED(instr)   ((instr)->flags & INSTR_FLAGS_REMOVED)
+#define IS_LABEL(instr)     ((instr)->flags & INSTR_FLAGS_LABEL)
+
+#define IS_CONSTANT_PUSH(instr) \
+    ((instr)->opcode == PUSH && !((instr)->relocatable_args & 1))
+
+
+int _yr_optimizer_args_count(
+    uint8_t opcode)
+{
+  switch(opcode)
+  {
+    case PUSH:
+    case CLEAR_M:
+    case ADD_M:
+    case INCR_M:
+    case PUSH_M:
+    case POP_M:
+    case SWAPUNDEF:
+    case JNUNDEF:
+    case JLE:
+    case JFALSE:
+    case JTRUE:
+    case RULE_PUSH:
+    case RULE_AND:
+    case RULE_POP:
+    case EXT_INT:
+    case EXT_STR:
+    case EXT_BOOL:
+    case SFOUND_S:
+    case SFOUND_AT_S:
+    case SFOUND_IN_S:
+    case SCOUNT_S:
+    case SOFFSET_S:
+    case OF_MASK:
+      return 1;
+
+    case SFOUND_AT_N:
+    case INIT_RULE:
+      return 2;
+  }
+
+  return 0;
+}
+
+
+//
+// Returns the index of the argument holding the jump target, or -1 if
+// the instruction doesn't jump.
+//
+
+int _yr_optimizer_jump_arg(
+    uint8_t opcode)
+{
+  switch(opcode)
+  {
+    case JNUNDEF:
+    case JLE:
+    case JFALSE:
+    case JTRUE:
+      return 0;
+
+    case INIT_RULE:
+      return 1;
+  }
+
+  return -1;
+}
+
+
+//
+// Number of values popped from and pushed into the stack by the
+// instruction. OF pops a variable number of values, it's handled by
+// _yr_optimizer_compute_depths.
+//
+
+void _yr_optimizer_stack_effect(
+    uint8_t opcode,
+    int* pops,
+    int* pushes)
+{
+  *pops = 0;
+  *pushes = 0;
+
+  switch(opcode)
+  {
+    case PUSH:
+    case PUSH_M:
+    case RULE_PUSH:
+    case EXT_BOOL:
+    case EXT_INT:
+    case EXT_STR:
+    case SFOUND_S:
+    case SFOUND_AT_N:
+    case SCOUNT_S:
+    case SIZE:
+    case ENTRYPOINT:
+      *pushes = 1;
+      break;
+
+    case POP:
+    case POP_M:
+    case ADD_M:
+    case RULE_POP:
+      *pops = 1;
+      break;
+
+    case NOT:
+    case NEG:
+    case RULE_AND:
+    case SWAPUNDEF:
+    case SFOUND:
+    case SFOUND_AT_S:
+    case SCOUNT:
+    case SOFFSET_S:
+    case OF_MASK:
+    case INT8:
+    case INT16:
+    case INT32:
+    case UINT8:
+    case UINT16:
+    case UINT32:
+      *pops = 1;
+      *pushes = 1;
+      break;
+
+    case AND:
+    case OR:
+    case XOR:
+    case LT:
+    case GT:
+    case LE:
+    case GE:
+    case EQ:
+    case NEQ:
+    case ADD:
+    case SUB:
+    case MUL:
+    case DIV:
+    case MOD:
+    case SHL:
+    case SHR:
+    case SFOUND_AT:
+    case SFOUND_IN_S:
+    case SOFFSET:
+    case CONTAINS:
+      *pops = 2;
+      *pushes = 1;
+      break;
+
+    case SFOUND_IN:
+    case MATCHES:
+      *pops = 3;
+      *pushes = 1;
+      break;
+  }
+}
+
+
+//
+// Rough estimate of the cost of executing an instruction, relative to
+// pushing a value.
+//
+
+int _yr_optimizer_cost(
+    uint8_t opcode)
+{
+  switch(opcode)
+  {
+    case SFOUND:
+    case SFOUND_S:
+    case INT8:
+    case INT16:
+    case INT32:
+    case UINT8:
+    case UINT16:
+    case UINT32:
+      return 4;
+
+    case SFOUND_AT:
+    case SFOUND_AT_S:
+    case SFOUND_AT_N:
+    case SFOUND_IN:
+    case SFOUND_IN_S:
+    case OF:
+    case OF_MASK:
+      return 6;
+
+    case SCOUNT:
+    case SCOUNT_S:
+    case SOFFSET:
+    case SOFFSET_S:
+      return 8;
+
+    case CONTAINS:
+      return 32;
+
+    case MATCHES:
+      return 256;
+  }
+
+  return 1;
+}
+
+
+//
+// Offset of an address within the code, as if the arena's pages were
+// contiguous.
+//
+
+int64_t _yr_optimizer_offset(
+    YR_ARENA* arena,
+    uint8_t* address)
+{
+  YR_ARENA_PAGE* page = arena->page_list_head;
+  int64_t base = 0;
+
+  while (page != NULL)
+  {
+    if (address >= page->address && address < page->address + page->used)
+      return base + (address - page->address);
+
+    base += page->used;
+    page = page->next;
+  }
+
+  assert(FALSE);
+  return -1;
+}
+
+
+int _yr_optimizer_find_instruction(
+    CODE* code,
+    int64_t offset)
+{
+  int low = 0;
+  int high = code->count - 1;
+  int middle;
+
+  while (low <= high)
+  {
+    middle = (low + high) / 2;
+
+    if (code->instructions[middle].offset == offset)
+      return middle;
+
+    if (code->instructions[middle].offset < offset)
+      low = middle + 1;
+    else
+      high = middle - 1;
+  }
+
+  // Jumps always land on the first byte of some instruction.
+  assert(FALSE);
+  return -1;
+}
+
+
+//
+// _yr_optimizer_decode
+//
+// Decodes the code in the arena, up to the final HALT, into a list of
+// instructions. Instructions may span multiple pages but every argument
+// is written in a single page, which is also where its reloc, if any, is
+// found.
+//
+
+int _yr_optimizer_decode(
+    YR_ARENA* arena,
+    CODE* code)
+{
+  YR_ARENA_PAGE* page = arena->page_list_head;
+  YR_RELOC* reloc = page->reloc_list_head;
+  INSTRUCTION* instr;
+  INSTRUCTION* new_instructions;
+
+  int64_t base = 0;
+  int32_t position = 0;
+  int jump_arg;
+  int i;
+
+  do
+  {
+    if (code->count == code->size)
+    {
+      code->size = code->size > 0 ? code->size * 2 : 256;
+
+      new_instructions = (INSTRUCTION*) yr_realloc(
+          code->instructions,
+          code->size * sizeof(INSTRUCTION));
+
+      if (new_instructions == NULL)
+        return ERROR_INSUFICIENT_MEMORY;
+
+      code->instructions = new_instructions;
+    }
+
+    instr = &code->instructions[code->count++];
+
+    while (position == page->used)
+    {
+      base += page->used;
+      page = page->next;
+      reloc = page->reloc_list_head;
+      position = 0;
+    }
+
+    instr->opcode = page->address[position];
+    instr->offset = base + position;
+    instr->flags = 0;
+    instr->args_count = _yr_optimizer_args_count(instr->opcode);
+    instr->relocatable_args = 0;
+    instr->target = -1;
+
+    position++;
+
+    for (i = 0; i < instr->args_count; i++)
+    {
+      while (position == page->used)
+      {
+        base += page->used;
+        page = page->next;
+        reloc = page->reloc_list_head;
+        position = 0;
+      }
+
+      memcpy(&instr->args[i], page->address + position, sizeof(int64_t));
+
+      while (reloc != NULL && reloc->offset < position)
+        reloc = reloc->next;
+
+      if (reloc != NULL && reloc->offset == position)
+        instr->relocatable_args |= 1 << i;
+
+      position += sizeof(int64_t);
+    }
+
+  } while (instr->opcode != HALT);
+
+  for (i = 0; i < code->count; i++)
+  {
+    instr = &code->instructions[i];
+    jump_arg = _yr_optimizer_jump_arg(instr->opcode);
+
+    if (jump_arg >= 0)
+      instr->target = _yr_optimizer_find_instruction(
+          code,
+          _yr_optimizer_offset(
+              arena,
+              UINT64_TO_PTR(uint8_t*, instr->args[jump_arg])));
+  }
+
+  return ERROR_SUCCESS;
+}
+
+
+//
+// _yr_optimizer_compute_depths
+//
+// Computes the number of values in the stack before executing each
+// instruction, following the code in order. Loops are followed only for
+// their first iteration, except for the lists of strings or integers
+// consumed by loops ending in JNUNDEF, which are fully popped when the
+// loop exits. Lists are terminated by a PUSH UNDEFINED, such pushes are
+// tracked in markers. Returns FALSE if the code doesn't look as expected.
+//
+
+int _yr_optimizer_compute_depths(
+    CODE* code,
+    int* depths,
+    int* markers)
+{
+  INSTRUCTION* instr;
+
+  int pops;
+  int pushes;
+  int sp = 0;
+  int i;
+
+  for (i = 0; i < code->count; i++)
+  {
+    instr = &code->instructions[i];
+    depths[i] = sp;
+
+    if (instr->opcode == OF)
+    {
+      // Pop strings and the end-of-list marker, then the quantifier.
+      while (sp > 0 && !markers[sp - 1])
+        sp--;
+
+      sp -= 2;
+
+      if (sp < 0)
+        return FALSE;
+
+      markers[sp++] = FALSE;
+      continue;
+    }
+
+    if (instr->opcode == JNUNDEF && instr->target < i)
+    {
+      while (sp > 0 && !markers[sp - 1])
+        sp--;
+
+      continue;
+    }
+
+    _yr_optimizer_stack_effect(instr->opcode, &pops, &pushes);
+
+    sp -= pops;
+
+    if (sp < 0)
+      return FALSE;
+
+    if (pushes > 0)
+      markers[sp++] =
+          IS_CONSTANT_PUSH(instr) && IS_UNDEFINED(instr->args[0]);
+  }
+
+  return TRUE;
+}
+
+
+//
+// _yr_optimizer_swap_operands
+//
+// Rewrites left; jump; right; operator as right; jump; left; operator,
+// where left starts at index start, jump is at index jump and operator at
+// index end. Jumps within the operands to the end of the operand are
+// redirected to the new end.
+//
+
+void _yr_optimizer_swap_operands(
+    CODE* code,
+    INSTRUCTION* buffer,
+    int* in_count,
+    int start,
+    int jump,
+    int end)
+{
+  INSTRUCTION* instr;
+
+  int right_length = end - jump - 1;
+  int new_jump = start + right_length;
+  int i;
+
+  #define new_index(x) \
+      ((x) > jump ? (x) - jump - 1 + start : \
+       (x) == jump ? new_jump : (x) + right_length + 1)
+
+  for (i = start; i < end; i++)
+  {
+    instr = &code->instructions[i];
+
+    if (instr->target >= 0 && i != jump)
+    {
+      in_count[instr->target]--;
+
+      if (i < jump)
+        instr->target = (instr->target == jump) ?
+            end : new_index(instr->target);
+      else
+        instr->target = (instr->target == end) ?
+            new_jump : new_index(instr->target);
+    }
+
+    buffer[new_index(i)] = *instr;
+  }
+
+  memcpy(
+      &code->instructions[start],
+      &buffer[start],
+      (end - start) * sizeof(INSTRUCTION));
+
+  for (i = start; i < end; i++)
+  {
+    instr = &code->instructions[i];
+
+    if (instr->target >= 0 && i != new_jump)
+      in_count[instr->target]++;
+  }
+
+  #undef new_index
+}
+
+
+int _yr_optimizer_block_cost(
+    CODE* code,
+    int start,
+    int end)
+{
+  int cost = 0;
+  int i;
+
+  for (i = start; i < end; i++)
+    cost += code->instructions[i].cost;
+
+  return cost;
+}
+
+
+//
+// Checks that jumps within [start, end) land within [start, end] and that
+// no jump from elsewhere lands within (start, end].
+//
+
+int _yr_optimizer_is_closed_block(
+    CODE* code,
+    int start,
+    int end,
+    int* internal_jumps)
+{
+  int target;
+  int i;
+
+  *internal_jumps = 0;
+
+  for (i = start; i < end; i++)
+  {
+    target = code->instructions[i].target;
+
+    if (target < 0)
+      continue;
+
+    if (target < start || target > end)
+      return FALSE;
+
+    if (target > start)
+      (*internal_jumps)++;
+  }
+
+  return TRUE;
+}
+
+
+//
+// _yr_optimizer_reorder_operands
+//
+// Swaps the operands of "and" and "or" when the right one is cheaper.
+// Operands have no side effects and AND/OR are commutative, so the result
+// is the same with either order. The parser only makes "or" skip its right
+// operand when both operands are 0 or 1, other "or" expressions don't
+// have a jump past the OR and are left alone. Expressions are processed
+// from the innermost to the outermost.
+//
+
+int _yr_optimizer_reorder_operands(
+    CODE* code)
+{
+  INSTRUCTION* instr;
+  INSTRUCTION* buffer;
+
+  int* depths;
+  int* markers;
+  int* jump_for_end;
+  int* start_for_end;
+  int* in_count;
+
+  int start;
+  int jump;
+  int end;
+  int left_jumps;
+  int right_jumps;
+  int inner_jumps;
+  int i, j;
+
+  int result = ERROR_SUCCESS;
+
+  buffer = (INSTRUCTION*) yr_malloc(code->count * sizeof(INSTRUCTION));
+  depths = (int*) yr_malloc(5 * code->count * sizeof(int));
+
+  if (buffer == NULL || depths == NULL)
+  {
+    result = ERROR_INSUFICIENT_MEMORY;
+    goto _exit;
+  }
+
+  markers = depths + code->count;
+  jump_for_end = markers + code->count;
+  start_for_end = jump_for_end + code->count;
+  in_count = start_for_end + code->count;
+
+  if (!_yr_optimizer_compute_depths(code, depths, markers))
+    goto _exit;
+
+  for (i = 0; i < code->count; i++)
+  {
+    jump_for_end[i] = -1;
+    in_count[i] = 0;
+  }
+
+  for (i = 0; i < code->count; i++)
+  {
+    instr = &code->instructions[i];
+    instr->cost = _yr_optimizer_cost(instr->opcode);
+
+    if (instr->target >= 0)
+      in_count[instr->target]++;
+  }
+
+  for (i = 0; i < code->count; i++)
+  {
+    instr = &code->instructions[i];
+
+    // Loop bodies are repeated, make them more expensive.
+
+    if ((instr->opcode == JNUNDEF || instr->opcode == JLE) &&
+        instr->target < i)
+    {
+      for (j = instr->target; j <= i; j++)
+        if (code->instructions[j].cost < INT_MAX / LOOP_COST_FACTOR)
+          code->instructions[j].cost *= LOOP_COST_FACTOR;
+    }
+
+    if (instr->opcode != JFALSE && instr->opcode != JTRUE)
+      continue;
+
+    end = instr->target - 1;
+
+    if (end <= i + 1 ||
+        code->instructions[end].opcode != (instr->opcode == JFALSE ? AND : OR) ||
+        depths[end] != depths[i] + 1)
+      continue;
+
+    // The left operand starts at the last instruction before the jump
+    // with one value less in the stack.
+
+    for (start = i - 1; start >= 0 && depths[start] >= depths[i]; start--);
+
+    if (start < 0 ||
+        depths[start] != depths[i] - 1 ||
+        code->instructions[start].opcode == INIT_RULE)
+      continue;
+
+    jump_for_end[end] = i;
+    start_for_end[end] = start;
+  }
+
+  for (end = 0; end < code->count; end++)
+  {
+    jump = jump_for_end[end];
+
+    if (jump < 0)
+      continue;
+
+    start = start_for_end[end];
+
+    if (!_yr_optimizer_is_closed_block(
+            code, start, jump, &left_jumps) ||
+        !_yr_optimizer_is_closed_block(
+            code, jump + 1, end, &right_jumps))
+      continue;
+
+    // Besides jumps from the operands themselves only the jump between
+    // them may land within the expression, on the operator following
+    // the right operand.
+
+    inner_jumps = 0;
+
+    for (i = start + 1; i <= end; i++)
+      inner_jumps += in_count[i];
+
+    if (inner_jumps != left_jumps + right_jumps)
+      continue;
+
+    if (_yr_optimizer_block_cost(code, jump + 1, end) <
+        _yr_optimizer_block_cost(code, start, jump))
+    {
+      _yr_optimizer_swap_operands(
+          code, buffer, in_count, start, jump, end);
+    }
+  }
+
+_exit:
+
+  if (buffer != NULL)
+    yr_free(buffer);
+
+  if (depths != NULL)
+    yr_free(depths);
+
+  return result;
+}
+
+
+int _yr_optimizer_next(
+    CODE* code,
+    int index)
+{
+  do { index++; } while (IS_REMOVED(&code->instructions[index]));
+  return index;
+}
+
+
+//
+// Makes jumps to removed instructions point to the next remaining one,
+// and sets the labels accordingly.
+//
+
+void _yr_optimizer_update_targets(
+    CODE* code)
+{
+  INSTRUCTION* instr;
+  int i;
+
+  for (i = 0; i < code->count; i++)
+    code->instructions[i].flags &= ~INSTR_FLAGS_LABEL;
+
+  for (i = 0; i < code->count; i++)
+  {
+    instr = &code->instructions[i];
+
+    if (IS_REMOVED(instr) || instr->target < 0)
+      continue;
+
+    if (IS_REMOVED(&code->instructions[instr->target]))
+      instr->target = _yr_optimizer_next(code, instr->target);
+
+    code->instructions[instr->target].flags |= INSTR_FLAGS_LABEL;
+  }
+}
+
+
+//
+// Computes op1 operator op2 the same way the condition VM does. Returns
+// FALSE if the operation can't be evaluated at compile time.
+//
+
+int _yr_optimizer_fold(
+    uint8_t opcode,
+    int64_t op1,
+    int64_t op2,
+    int64_t* result)
+{
+  switch(opcode)
+  {
+    case AND:
+      *result = op1 & op2;
+      return TRUE;
+
+    case OR:
+      *result = op1 | op2;
+      return TRUE;
+  }
+
+  if (opcode >= LT && opcode <= NEQ && (IS_UNDEFINED(op1) || IS_UNDEFINED(op2)))
+  {
+    *result = 0;
+    return TRUE;
+  }
+
+  if (IS_UNDEFINED(op1) || IS_UNDEFINED(op2))
+  {
+    *result = UNDEFINED;
+    return TRUE;
+  }
+
+  switch(opcode)
+  {
+    case LT:  *result = op1 < op2;   return TRUE;
+    case GT:  *result = op1 > op2;   return TRUE;
+    case LE:  *result = op1 <= op2;  return TRUE;
+    case GE:  *result = op1 >= op2;  return TRUE;
+    case EQ:  *result = op1 == op2;  return TRUE;
+    case NEQ: *result = op1 != op2;  return TRUE;
+    case XOR: *result = op1 ^ op2;   return TRUE;
+
+    case ADD:
+      *result = (int64_t) ((uint64_t) op1 + (uint64_t) op2);
+      return TRUE;
+
+    case SUB:
+      *result = (int64_t) ((uint64_t) op1 - (uint64_t) op2);
+      return TRUE;
+
+    case MUL:
+      *result = (int64_t) ((uint64_t) op1 * (uint64_t) op2);
+      return TRUE;
+
+    case DIV:
+    case MOD:
+      // Leave traps to the runtime.
+      if (op2 == 0 || op2 == -1)
+        return FALSE;
+      *result = (opcode == DIV) ? op1 / op2 : op1 % op2;
+      return TRUE;
+
+    case SHL:
+    case SHR:
+      if (op2 < 0 || op2 > 63)
+        return FALSE;
+      *result = (opcode == SHL) ?
+          (int64_t) ((uint64_t) op1 << op2) : op1 >> op2;
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+
+//
+// _yr_optimizer_fold_constants
+//
+// Single pass over the code applying the peephole rules described at the
+// top of this file. The indexes of the remaining instructions seen so far
+// are kept in a stack, so the instructions preceding the current one are
+// always at its top.
+//
+
+int _yr_optimizer_fold_constants(
+    CODE* code,
+    int* kept)
+{
+  INSTRUCTION* instr;
+  INSTRUCTION* prev1;
+  INSTRUCTION* prev2;
+
+  int64_t result;
+  int kept_count = 0;
+  int changed = FALSE;
+  int taken;
+  int i;
+
+  for (i = 0; i < code->count; i++)
+  {
+    instr = &code->instructions[i];
+
+    if (IS_REMOVED(instr))
+      continue;
+
+    prev1 = kept_count > 0 ? &code->instructions[kept[kept_count - 1]] : NULL;
+    prev2 = kept_count > 1 ? &code->instructions[kept[kept_count - 2]] : NULL;
+
+    if (prev1 != NULL && IS_LABEL(instr))
+      prev1 = prev2 = NULL;
+
+    if (prev2 != NULL && IS_LABEL(prev1))
+      prev2 = NULL;
+
+    switch(instr->opcode)
+    {
+      case AND:
+      case OR:
+      case XOR:
+      case LT:
+      case GT:
+      case LE:
+      case GE:
+      case EQ:
+      case NEQ:
+      case ADD:
+      case SUB:
+      case MUL:
+      case DIV:
+      case MOD:
+      case SHL:
+      case SHR:
+        if (prev2 != NULL &&
+            IS_CONSTANT_PUSH(prev1) &&
+            IS_CONSTANT_PUSH(prev2) &&
+            _yr_optimizer_fold(
+                instr->opcode, prev2->args[0], prev1->args[0], &result))
+        {
+          prev2->args[0] = result;
+          prev1->flags |= INSTR_FLAGS_REMOVED;
+          instr->flags |= INSTR_FLAGS_REMOVED;
+          kept_count--;
+          changed = TRUE;
+          continue;
+        }
+        break;
+
+      case NOT:
+      case NEG:
+        if (prev1 != NULL && IS_CONSTANT_PUSH(prev1))
+        {
+          if (instr->opcode == NOT)
+            prev1->args[0] = !prev1->args[0];
+          else if (!IS_UNDEFINED(prev1->args[0]))
+            prev1->args[0] = ~prev1->args[0];
+
+          instr->flags |= INSTR_FLAGS_REMOVED;
+          changed = TRUE;
+          continue;
+        }
+        break;
+
+      case POP:
+        if (prev1 != NULL && prev1->opcode == PUSH)
+        {
+          prev1->flags |= INSTR_FLAGS_REMOVED;
+          instr->flags |= INSTR_FLAGS_REMOVED;
+          kept_count--;
+          changed = TRUE;
+          continue;
+        }
+        break;
+
+      case JFALSE:
+      case JTRUE:
+      case JNUNDEF:
+      case JLE:
+        if (instr->opcode == JLE)
+        {
+          if (prev2 == NULL ||
+              !IS_CONSTANT_PUSH(prev1) ||
+              !IS_CONSTANT_PUSH(prev2))
+            break;
+
+          taken = prev2->args[0] <= prev1->args[0];
+        }
+        else
+        {
+          if (prev1 == NULL || !IS_CONSTANT_PUSH(prev1))
+            break;
+
+          if (instr->opcode == JFALSE)
+            taken = prev1->args[0] == 0;
+          else if (instr->opcode == JTRUE)
+            taken = prev1->args[0] != 0;
+          else
+            taken = !IS_UNDEFINED(prev1->args[0]);
+        }
+
+        if (!taken)
+        {
+          instr->flags |= INSTR_FLAGS_REMOVED;
+          changed = TRUE;
+          continue;
+        }
+
+        if (!(instr->flags & INSTR_FLAGS_ALWAYS_JUMPS))
+        {
+          instr->flags |= INSTR_FLAGS_ALWAYS_JUMPS;
+          changed = TRUE;
+        }
+        break;
+    }
+
+    kept[kept_count++] = i;
+  }
+
+  return changed;
+}
+
+
+//
+// _yr_optimizer_remove_unreachable
+//
+// Removes instructions that can't be reached from the first one. Every
+// instruction falls through to the next one except HALT and jumps known
+// to be always taken.
+//
+
+int _yr_optimizer_remove_unreachable(
+    CODE* code,
+    int* pending)
+{
+  INSTRUCTION* instr;
+
+  int pending_count = 0;
+  int changed = FALSE;
+  int i;
+
+  for (i = 0; i < code->count; i++)
+    code->instructions[i].flags &= ~INSTR_FLAGS_REACHABLE;
+
+  code->instructions[0].flags |= INSTR_FLAGS_REACHABLE;
+  pending[pending_count++] = 0;
+
+  while (pending_count > 0)
+  {
+    i = pending[--pending_count];
+    instr = &code->instructions[i];
+
+    if (instr->target >= 0 &&
+        !(code->instructions[instr->target].flags & INSTR_FLAGS_REACHABLE))
+    {
+      code->instructions[instr->target].flags |= INSTR_FLAGS_REACHABLE;
+      pending[pending_count++] = instr->target;
+    }
+
+    if (instr->opcode == HALT || instr->flags & INSTR_FLAGS_ALWAYS_JUMPS)
+      continue;
+
+    i = _yr_optimizer_next(code, i);
+
+    if (!(code->instructions[i].flags & INSTR_FLAGS_REACHABLE))
+    {
+      code->instructions[i].flags |= INSTR_FLAGS_REACHABLE;
+      pending[pending_count++] = i;
+    }
+  }
+
+  for (i = 0; i < code->count; i++)
+  {
+    instr = &code->instructions[i];
+
+    if (!IS_REMOVED(instr) && !(instr->flags & INSTR_FLAGS_REACHABLE))
+    {
+      instr->flags |= INSTR_FLAGS_REMOVED;
+      changed = TRUE;
+    }
+  }
+
+  return changed;
+}
+
+
+int _yr_optimizer_remove_useless_jumps(
+    CODE* code)
+{
+  INSTRUCTION* instr;
+
+  int changed = FALSE;
+  int i;
+
+  for (i = 0; i < code->count; i++)
+  {
+    instr = &code->instructions[i];
+
+    if (IS_REMOVED(instr) || instr->opcode == INIT_RULE)
+      continue;
+
+    if (instr->target >= 0 && instr->target == _yr_optimizer_next(code, i))
+    {
+      instr->flags |= INSTR_FLAGS_REMOVED;
+      changed = TRUE;
+    }
+  }
+
+  return changed;
+}
+
+
+int _yr_optimizer_emit(
+    CODE* code,
+    YR_ARENA* arena)
+{
+  INSTRUCTION* instr;
+  void* arg;
+
+  int result = ERROR_SUCCESS;
+  int i, j;
+
+  for (i = 0; i < code->count && result == ERROR_SUCCESS; i++)
+  {
+    instr = &code->instructions[i];
+
+    if (IS_REMOVED(instr))
+      continue;
+
+    result = yr_arena_write_data(
+        arena,
+        &instr->opcode,
+        sizeof(uint8_t),
+        (void**) &instr->new_address);
+
+    for (j = 0; j < instr->args_count && result == ERROR_SUCCESS; j++)
+    {
+      result = yr_arena_write_data(
+          arena,
+          &instr->args[j],
+          sizeof(int64_t),
+          &arg);
+
+      if (result == ERROR_SUCCESS && instr->relocatable_args & (1 << j))
+        result = yr_arena_make_relocatable(arena, arg, 0, EOL);
+
+      if (j == _yr_optimizer_jump_arg(instr->opcode))
+        instr->new_jump_arg = (uint8_t**) arg;
+    }
+  }
+
+  if (result != ERROR_SUCCESS)
+    return result;
+
+  for (i = 0; i < code->count; i++)
+  {
+    instr = &code->instructions[i];
+
+    if (!IS_REMOVED(instr) && instr->target >= 0)
+      *instr->new_jump_arg = code->instructions[instr->target].new_address;
+  }
+
+  return ERROR_SUCCESS;
+}
+
+
+//
+// yr_optimizer_optimize_code
+//
+// Creates a new arena with the optimized version of the code in
+// code_arena, which must end with a HALT instruction. Code sizes before
+// and after the optimization are returned in stats.
+//
+
+int yr_optimizer_optimize_code(
+    YR_ARENA* code_arena,
+    YR_ARENA** optimized_code_arena,
+    YR_CODE_STATS* stats)
+{
+  CODE code;
+  INSTRUCTION* instr;
+
+  int* indexes = NULL;
+  int changed = TRUE;
+  int passes = 0;
+  int result;
+  int i;
+
+  code.instructions = NULL;
+  code.count = 0;
+  code.size = 0;
+
+  *optimized_code_arena = NULL;
+
+  result = _yr_optimizer_decode(code_arena, &code);
+
+  if (result == ERROR_SUCCESS)
+    result = _yr_optimizer_reorder_operands(&code);
+
+  if (result == ERROR_SUCCESS)
+  {
+    indexes = (int*) yr_malloc(code.count * sizeof(int));
+
+    if (indexes == NULL)
+      result = ERROR_INSUFICIENT_MEMORY;
+  }
+
+  if (result == ERROR_SUCCESS)
+  {
+    while (changed && passes++ < MAX_OPTIMIZER_PASSES)
+    {
+      _yr_optimizer_update_targets(&code);
+      changed = _yr_optimizer_fold_constants(&code, indexes);
+      _yr_optimizer_update_targets(&code);
+      changed |= _yr_optimizer_remove_unreachable(&code, indexes);
+      _yr_optimizer_update_targets(&code);
+      changed |= _yr_optimizer_remove_useless_jumps(&code);
+    }
+
+    _yr_optimizer_update_targets(&code);
+
+    result = yr_arena_create(1024, 0, optimized_code_arena);
+  }
+
+  if (result == ERROR_SUCCESS)
+    result = _yr_optimizer_emit(&code, *optimized_code_arena);
+
+  if (result == ERROR_SUCCESS)
+  {
+    stats->size = 0;
+    stats->optimized_size = 0;
+
+    for (i = 0; i < code.count; i++)
+    {
+      instr = &code.instructions[i];
+      stats->size += 1 + instr->args_count * sizeof(int64_t);
+
+      if (!IS_REMOVED(instr))
+        stats->optimized_size += 1 + instr->args_count * sizeof(int64_t);
+    }
+  }
+  else if (*optimized_code_arena != NULL)
+  {
+    yr_arena_destroy(*optimized_code_arena);
+    *optimized_code_arena = NULL;
+  }
+
+  if (indexes != NULL)
+    yr_free(indexes);
+
+  if (code.instructions != NULL)
+    yr_free(code.instructions);
+
+  return result;
+}
@@ -0,0 +1,28 @@
+/*
+Copyright (c) 2013. Victor M. Alvarez [plusvic@gmail.com].
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef _OPTIMIZER_H
+#define _OPTIMIZER_H
+
+#include "yara.h"
+
+
+int yr_optimizer_optimize_code(
+    YR_ARENA* code_arena,
+    YR_ARENA** optimized_code_arena,
+    YR_CODE_STATS* stats);
+
+#endif
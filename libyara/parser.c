@@ -32,16 +32,110 @@ limitations under the License.
                     ((uint8_t) (x - '0'))
 
 
-int yr_parser_emit(
-    yyscan_t yyscanner,
+//
+// The address of the last emitted instruction is kept in the compiler,
+// this allows fusing it with the next one into a superinstruction.
+// Forward jumps waiting for their target are resolved here too, they
+// land on the next instruction written.
+//
+
+int _yr_parser_write_instruction(
+    YR_COMPILER* compiler,
     int8_t instruction,
     int8_t** instruction_address)
 {
-  return yr_arena_write_data(
-      yyget_extra(yyscanner)->code_arena,
+  int8_t* address;
+  int i;
+
+  int result = yr_arena_write_data(
+      compiler->code_arena,
       &instruction,
       sizeof(int8_t),
-      (void**) instruction_address);
+      (void**) &address);
+
+  if (result == ERROR_SUCCESS)
+  {
+    compiler->last_instruction = address;
+    compiler->last_expression_is_boolean = TRUE;
+
+    for (i = 0; i < compiler->pending_jumps_count; i++)
+      *compiler->pending_jumps[i] = address;
+
+    compiler->pending_jumps_count = 0;
+
+    if (instruction_address != NULL)
+      *instruction_address = address;
+  }
+
+  return result;
+}
+
+
+int _yr_parser_write_arg_reloc(
+    YR_COMPILER* compiler,
+    int64_t argument,
+    void** argument_address)
+{
+  void* ptr;
+
+  int result = yr_arena_write_data(
+      compiler->code_arena,
+      &argument,
+      sizeof(int64_t),
+      &ptr);
+
+  if (result == ERROR_SUCCESS)
+    result = yr_arena_make_relocatable(
+        compiler->code_arena,
+        ptr,
+        0,
+        EOL);
+
+  if (result == ERROR_SUCCESS && argument_address != NULL)
+    *argument_address = ptr;
+
+  return result;
+}
+
+
+//
+// The last instruction can't be fused with the next one if some jump is
+// going to land between them.
+//
+
+int _yr_parser_can_fuse(
+    YR_COMPILER* compiler,
+    int8_t instruction)
+{
+  return compiler->last_instruction != NULL &&
+         *compiler->last_instruction == instruction &&
+         compiler->pending_jumps_count == 0;
+}
+
+
+int yr_parser_emit(
+    yyscan_t yyscanner,
+    int8_t instruction,
+    int8_t** instruction_address)
+{
+  YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+  // RULE_PUSH followed by AND is fused into RULE_AND.
+
+  if (instruction == AND && _yr_parser_can_fuse(compiler, RULE_PUSH))
+  {
+    *compiler->last_instruction = RULE_AND;
+
+    if (instruction_address != NULL)
+      *instruction_address = compiler->last_instruction;
+
+    return ERROR_SUCCESS;
+  }
+
+  return _yr_parser_write_instruction(
+      compiler,
+      instruction,
+      instruction_address);
 }
 
 
@@ -51,11 +145,10 @@ int yr_parser_emit_with_arg(
     int64_t argument,
     int8_t** instruction_address)
 {
-  int result = yr_arena_write_data(
-      yyget_extra(yyscanner)->code_arena,
-      &instruction,
-      sizeof(int8_t),
-      (void**) instruction_address);
+  int result = _yr_parser_write_instruction(
+      yyget_extra(yyscanner),
+      instruction,
+      instruction_address);
 
   if (result == ERROR_SUCCESS)
     result = yr_arena_write_data(
@@ -74,38 +167,121 @@ int yr_parser_emit_with_arg_reloc(
     int64_t argument,
     int8_t** instruction_address)
 {
-  void* ptr;
+  int result = _yr_parser_write_instruction(
+      yyget_extra(yyscanner),
+      instruction,
+      instruction_address);
+
+  if (result == ERROR_SUCCESS)
+    result = _yr_parser_write_arg_reloc(
+        yyget_extra(yyscanner),
+        argument,
+        NULL);
+
+  return result;
+}
 
-  int result = yr_arena_write_data(
-      yyget_extra(yyscanner)->code_arena,
-      &instruction,
-      sizeof(int8_t),
-      (void**) instruction_address);
+
+//
+// yr_parser_emit_forward_jump
+//
+// Emits a jump instruction whose target is not known yet. The address of
+// the jump's argument is returned in jump_target, it must be passed later
+// to yr_parser_set_jump_target.
+//
+
+int yr_parser_emit_forward_jump(
+    yyscan_t yyscanner,
+    int8_t instruction,
+    int8_t*** jump_target)
+{
+  int result = _yr_parser_write_instruction(
+      yyget_extra(yyscanner),
+      instruction,
+      NULL);
 
   if (result == ERROR_SUCCESS)
-    result = yr_arena_write_data(
-        yyget_extra(yyscanner)->code_arena,
-        &argument,
-        sizeof(int64_t),
-        &ptr);
+    result = _yr_parser_write_arg_reloc(
+        yyget_extra(yyscanner),
+        0,
+        (void**) jump_target);
+
+  return result;
+}
+
+
+//
+// yr_parser_set_jump_target
+//
+// Makes a jump emitted with yr_parser_emit_forward_jump land on the next
+// instruction emitted.
+//
+
+int yr_parser_set_jump_target(
+    yyscan_t yyscanner,
+    int8_t** jump_target)
+{
+  YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+  if (compiler->pending_jumps_count == MAX_PENDING_JUMPS)
+    return ERROR_INSUFICIENT_MEMORY;
+
+  compiler->pending_jumps[compiler->pending_jumps_count++] = jump_target;
+
+  return ERROR_SUCCESS;
+}
+
+
+//
+// yr_parser_emit_init_rule
+//
+// Emits the INIT_RULE instruction starting a rule's condition. Its
+// arguments are filled in by yr_parser_reduce_rule_declaration once the
+// rule and the end of its code are known.
+//
+
+int yr_parser_emit_init_rule(
+    yyscan_t yyscanner)
+{
+  YR_COMPILER* compiler = yyget_extra(yyscanner);
+
+  int result = _yr_parser_write_instruction(
+      compiler,
+      INIT_RULE,
+      NULL);
 
   if (result == ERROR_SUCCESS)
-    result = yr_arena_make_relocatable(
-        yyget_extra(yyscanner)->code_arena,
-        ptr,
+    result = _yr_parser_write_arg_reloc(
+        compiler,
         0,
-        EOL);
+        (void**) &compiler->current_rule_init);
+
+  if (result == ERROR_SUCCESS)
+    result = _yr_parser_write_arg_reloc(
+        compiler,
+        0,
+        (void**) &compiler->current_rule_skip);
 
   return result;
 }
 
 
-void yr_parser_emit_pushes_for_strings(
+//
+// yr_parser_add_strings_to_set
+//
+// Adds the strings whose identifiers match the given one, which may end
+// with a wildcard, to the string set being parsed. Nothing is emitted
+// until the set is complete, as the code depends on how the set is used
+// (see yr_parser_emit_of and yr_parser_emit_pushes_for_string_set).
+//
+
+int yr_parser_add_strings_to_set(
     yyscan_t yyscanner,
     const char* identifier)
 {
   YR_COMPILER* compiler = yyget_extra(yyscanner);
   YR_STRING* string = compiler->current_rule_strings;
+  YR_STRING** string_set;
   const char* string_identifier;
   const char* target_identifier;
 
@@ -125,20 +301,173 @@ void yr_parser_emit_pushes_for_strings(
     if ((*target_identifier == '\0' && *string_identifier == '\0') ||
          *target_identifier == '*')
     {
-      yr_parser_emit_with_arg_reloc(
+      if (compiler->string_set_count == compiler->string_set_size)
+      {
+        string_set = (YR_STRING**) yr_realloc(
+            compiler->string_set,
+            2 * (compiler->string_set_size + 8) * sizeof(YR_STRING*));
+
+        if (string_set == NULL)
+        {
+          compiler->last_result = ERROR_INSUFICIENT_MEMORY;
+          return compiler->last_result;
+        }
+
+        compiler->string_set = string_set;
+        compiler->string_set_size = 2 * (compiler->string_set_size + 8);
+      }
+
+      compiler->string_set[compiler->string_set_count++] = string;
+      string->g_flags |= STRING_GFLAGS_REFERENCED;
+    }
+
+    string = yr_arena_next_address(
+        compiler->strings_arena,
+        string,
+        sizeof(YR_STRING));
+  }
+
+  return ERROR_SUCCESS;
+}
+
+
+//
+// yr_parser_emit_pushes_for_string_set
+//
+// Emits a PUSH for each string in the string set, preceded by the
+// end-of-list marker.
+//
+
+int yr_parser_emit_pushes_for_string_set(
+    yyscan_t yyscanner)
+{
+  YR_COMPILER* compiler = yyget_extra(yyscanner);
+  int result;
+  int i;
+
+  result = yr_parser_emit_with_arg(yyscanner, PUSH, UNDEFINED, NULL);
+
+  for (i = 0; i < compiler->string_set_count; i++)
+  {
+    if (result == ERROR_SUCCESS)
+      result = yr_parser_emit_with_arg_reloc(
           yyscanner,
           PUSH,
-          PTR_TO_UINT64(string),
+          PTR_TO_UINT64(compiler->string_set[i]),
           NULL);
+  }
 
-      string->g_flags |= STRING_GFLAGS_REFERENCED;
-    }
+  compiler->string_set_count = 0;
+
+  return result;
+}
+
+
+//
+// yr_parser_emit_of
+//
+// Emits the code for "N of" over the string set, once the quantifier has
+// been pushed. The set becomes a mask over the bitmap of matching strings,
+// which is what OF_MASK counts. Sets naming the same string more than once
+// count it every time, those are evaluated by pushing the strings for OF
+// instead.
+//
+
+int yr_parser_emit_of(
+    yyscan_t yyscanner)
+{
+  YR_COMPILER* compiler = yyget_extra(yyscanner);
+  YR_STRING_SET* string_set;
+  YR_STRING* string;
+  uint64_t* mask;
+
+  int first_word = 0;
+  int words = 0;
+  int result;
+  int index;
+  int i;
+
+  string = compiler->current_rule_strings;
+
+  if (!STRING_IS_NULL(string))
+    first_word = string->idx / 64;
 
+  while (!STRING_IS_NULL(string))
+  {
+    words = string->idx / 64 - first_word + 1;
     string = yr_arena_next_address(
         compiler->strings_arena,
         string,
         sizeof(YR_STRING));
   }
+
+  mask = NULL;
+
+  if (words > 0)
+    mask = (uint64_t*) yr_malloc(words * sizeof(uint64_t));
+
+  if (mask != NULL)
+  {
+    memset(mask, 0, words * sizeof(uint64_t));
+
+    for (i = 0; i < compiler->string_set_count; i++)
+    {
+      index = compiler->string_set[i]->idx - first_word * 64;
+
+      if (mask[index / 64] & ((uint64_t) 1 << (index % 64)))
+        break;
+
+      mask[index / 64] |= (uint64_t) 1 << (index % 64);
+    }
+
+    if (i < compiler->string_set_count)
+    {
+      yr_free(mask);
+      mask = NULL;
+    }
+  }
+
+  if (mask == NULL)
+  {
+    result = yr_parser_emit_pushes_for_string_set(yyscanner);
+
+    if (result == ERROR_SUCCESS)
+      result = yr_parser_emit(yyscanner, OF, NULL);
+
+    return result;
+  }
+
+  result = yr_arena_allocate_struct(
+      compiler->sz_arena,
+      sizeof(YR_STRING_SET),
+      (void**) &string_set,
+      offsetof(YR_STRING_SET, mask),
+      EOL);
+
+  if (result == ERROR_SUCCESS)
+  {
+    string_set->count = compiler->string_set_count;
+    string_set->first_word = first_word;
+    string_set->words = words;
+
+    result = yr_arena_write_data(
+        compiler->sz_arena,
+        mask,
+        words * sizeof(uint64_t),
+        (void**) &string_set->mask);
+  }
+
+  if (result == ERROR_SUCCESS)
+    result = yr_parser_emit_with_arg_reloc(
+        yyscanner,
+        OF_MASK,
+        PTR_TO_UINT64(string_set),
+        NULL);
+
+  compiler->string_set_count = 0;
+  yr_free(mask);
+
+  return result;
 }
 
 
@@ -221,6 +550,7 @@ YR_STRING* yr_parser_reduce_string_declaration(
 
   int literal_string_len;
   int max_string_len;
+  int fits_in_atom;
 
   YR_COMPILER* compiler = yyget_extra(yyscanner);
 
@@ -230,6 +560,7 @@ YR_STRING* yr_parser_reduce_string_declaration(
       (void**) &string,
       offsetof(YR_STRING, identifier),
       offsetof(YR_STRING, string),
+      offsetof(YR_STRING, rule),
       EOL);
 
   if (compiler->last_result != ERROR_SUCCESS)
@@ -259,8 +590,6 @@ YR_STRING* yr_parser_reduce_string_declaration(
 
   string->g_flags = flags;
 
-  memset(string->matches, 0, sizeof(string->matches));
-
   if (flags & STRING_GFLAGS_HEXADECIMAL ||
       flags & STRING_GFLAGS_REGEXP)
   {
@@ -378,6 +707,8 @@ YR_STRING* yr_parser_reduce_string_declaration(
     if (compiler->last_result == ERROR_SUCCESS)
     {
       new_match->backtrack = 0;
+      new_match->flags = string->g_flags & (
+          STRING_GFLAGS_ASCII | STRING_GFLAGS_WIDE);
       new_match->string = string;
       new_match->forward_code = re->root_node->forward_code;
       new_match->backward_code = NULL;
@@ -393,24 +724,31 @@ YR_STRING* yr_parser_reduce_string_declaration(
   else
     min_atom_length = 0;
 
+  // A literal string fits in its atoms if every atom covers the whole
+  // string in the atom's encoding, this is true for short strings
+  // declared both ascii and wide too.
+
+  fits_in_atom = STRING_IS_LITERAL(string) && atom != NULL;
+
   while (atom != NULL)
   {
     if (atom->atom_length < min_atom_length)
       min_atom_length = atom->atom_length;
-    atom = atom->next;
-  }
 
-  if (STRING_IS_LITERAL(string))
-  {
-    if (STRING_IS_WIDE(string))
+    if (atom->flags & STRING_GFLAGS_WIDE)
       max_string_len = string->length * 2;
     else
       max_string_len = string->length;
 
-    if (max_string_len == min_atom_length)
-      string->g_flags |= STRING_GFLAGS_FITS_IN_ATOM;
+    if (max_string_len != atom->atom_length)
+      fits_in_atom = FALSE;
+
+    atom = atom->next;
   }
 
+  if (fits_in_atom)
+    string->g_flags |= STRING_GFLAGS_FITS_IN_ATOM;
+
   if (compiler->file_name_stack_ptr > 0)
     file_name = compiler->file_name_stack[compiler->file_name_stack_ptr - 1];
   else
@@ -525,11 +863,43 @@ int yr_parser_reduce_rule_declaration(
   if (compiler->last_result != ERROR_SUCCESS)
     return compiler->last_result;
 
+  // If the condition turns out to be false without any string matching
+  // (see yr_execute_analyze_code) INIT_RULE jumps past the RULE_POP,
+  // right to the next instruction emitted.
+
+  *compiler->current_rule_init = rule;
+
+  compiler->last_result = yr_parser_set_jump_target(
+      yyscanner,
+      compiler->current_rule_skip);
+
+  if (compiler->last_result != ERROR_SUCCESS)
+    return compiler->last_result;
+
   rule->g_flags = flags | compiler->current_rule_flags;
+
+  if (RULE_IS_GLOBAL(rule) &&
+      STRING_IS_NULL(strings) &&
+      !(rule->g_flags & RULE_GFLAGS_REFERENCES_RULES))
+  {
+    rule->g_flags |= RULE_GFLAGS_EARLY_GLOBAL;
+  }
   rule->tags = tags;
   rule->strings = strings;
   rule->metas = metas;
   rule->ns = compiler->current_namespace;
+  rule->idx = compiler->rules_count++;
+
+  string = compiler->current_rule_strings;
+
+  while(!STRING_IS_NULL(string))
+  {
+    string->rule = rule;
+    string = yr_arena_next_address(
+        compiler->strings_arena,
+        string,
+        sizeof(YR_STRING));
+  }
 
   compiler->current_rule_flags = 0;
   compiler->current_rule_strings = NULL;
@@ -589,16 +959,51 @@ int yr_parser_reduce_string_identifier(
 
     if (string != NULL)
     {
-      yr_parser_emit_with_arg_reloc(
-          yyscanner,
-          PUSH,
-          PTR_TO_UINT64(string),
-          NULL);
-
       if (instruction != SFOUND)
         string->g_flags &= ~STRING_GFLAGS_SINGLE_MATCH;
 
-      yr_parser_emit(yyscanner, instruction, NULL);
+      if (instruction == SFOUND_AT && _yr_parser_can_fuse(compiler, PUSH))
+      {
+        // The offset is a constant pushed by the previous instruction,
+        // both the offset and the string become arguments of SFOUND_AT_N.
+
+        *compiler->last_instruction = SFOUND_AT_N;
+
+        compiler->last_result = _yr_parser_write_arg_reloc(
+            compiler,
+            PTR_TO_UINT64(string),
+            NULL);
+      }
+      else
+      {
+        // The string is passed as an argument instead of being pushed
+        // in the stack.
+
+        switch(instruction)
+        {
+          case SFOUND:
+            instruction = SFOUND_S;
+            break;
+          case SFOUND_AT:
+            instruction = SFOUND_AT_S;
+            break;
+          case SFOUND_IN:
+            instruction = SFOUND_IN_S;
+            break;
+          case SCOUNT:
+            instruction = SCOUNT_S;
+            break;
+          case SOFFSET:
+            instruction = SOFFSET_S;
+            break;
+        }
+
+        compiler->last_result = yr_parser_emit_with_arg_reloc(
+            yyscanner,
+            instruction,
+            PTR_TO_UINT64(string),
+            NULL);
+      }
 
       string->g_flags |= STRING_GFLAGS_REFERENCED;
     }
@@ -627,6 +1032,11 @@ int yr_parser_reduce_external(
           EXT_BOOL,
           PTR_TO_UINT64(external),
           NULL);
+
+      // Integer externals are pushed as they are, not just as 0 or 1.
+
+      if (external->type == EXTERNAL_VARIABLE_TYPE_INTEGER)
+        compiler->last_expression_is_boolean = FALSE;
     }
     else if (instruction == EXT_INT &&
              external->type == EXTERNAL_VARIABLE_TYPE_INTEGER)
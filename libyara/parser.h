@@ -43,6 +43,21 @@ int yr_parser_emit_with_arg_reloc(
     int8_t** instruction_address);
 
 
+int yr_parser_emit_forward_jump(
+    yyscan_t yyscanner,
+    int8_t instruction,
+    int8_t*** jump_target);
+
+
+int yr_parser_emit_init_rule(
+    yyscan_t yyscanner);
+
+
+int yr_parser_set_jump_target(
+    yyscan_t yyscanner,
+    int8_t** jump_target);
+
+
 YR_STRING* yr_parser_lookup_string(
   yyscan_t yyscanner,
   const char* identifier);
@@ -88,11 +103,19 @@ int yr_parser_reduce_string_identifier(
     int8_t instruction);
 
 
-void yr_parser_emit_pushes_for_strings(
+int yr_parser_add_strings_to_set(
     yyscan_t yyscanner,
     const char* identifier);
 
 
+int yr_parser_emit_pushes_for_string_set(
+    yyscan_t yyscanner);
+
+
+int yr_parser_emit_of(
+    yyscan_t yyscanner);
+
+
 int yr_parser_reduce_external(
     yyscan_t yyscanner,
     const char* identifier,
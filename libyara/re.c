@@ -44,8 +44,6 @@ order to avoid confusion with operating system threads.
 #define MAX_RE_FIBERS   1024
 #define MAX_RE_STACK    1024
 
-#define RE_SCAN_LIMIT   65535
-
 #define EMIT_FLAGS_BACKWARDS           1
 #define EMIT_FLAGS_DONT_ANNOTATE_RE    2
 
@@ -813,12 +811,236 @@ int _yr_re_emit(
 }
 
 
+//
+// _yr_re_first_bytes
+//
+// Adds to the bitmap every byte that can be the first one in a match for
+// the given node.
+//
+// Returns:
+//    TRUE if the node can match the empty string, FALSE otherwise.
+//
+
+int _yr_re_first_bytes(
+    RE_NODE* re_node,
+    uint8_t* bitmap)
+{
+  int i;
+  int match;
+  int nullable;
+
+  switch(re_node->type)
+  {
+  case RE_NODE_LITERAL:
+    bitmap[re_node->value / 8] |= 1 << (re_node->value % 8);
+    return FALSE;
+
+  case RE_NODE_MASKED_LITERAL:
+    for (i = 0; i < 256; i++)
+      if ((i & re_node->mask) == re_node->value)
+        bitmap[i / 8] |= 1 << (i % 8);
+    return FALSE;
+
+  case RE_NODE_CLASS:
+    for (i = 0; i < 32; i++)
+      bitmap[i] |= re_node->class_vector[i];
+    return FALSE;
+
+  case RE_NODE_WORD_CHAR:
+  case RE_NODE_NON_WORD_CHAR:
+  case RE_NODE_SPACE:
+  case RE_NODE_NON_SPACE:
+  case RE_NODE_DIGIT:
+  case RE_NODE_NON_DIGIT:
+  case RE_NODE_ANY:
+    for (i = 0; i < 256; i++)
+    {
+      switch(re_node->type)
+      {
+      case RE_NODE_WORD_CHAR:
+        match = isalnum(i) || i == '_';
+        break;
+      case RE_NODE_NON_WORD_CHAR:
+        match = !isalnum(i) && i != '_';
+        break;
+      case RE_NODE_SPACE:
+        match = i == ' ' || i == '\t';
+        break;
+      case RE_NODE_NON_SPACE:
+        match = i != ' ' && i != '\t';
+        break;
+      case RE_NODE_DIGIT:
+        match = isdigit(i);
+        break;
+      case RE_NODE_NON_DIGIT:
+        match = !isdigit(i);
+        break;
+      default:
+        match = TRUE;
+      }
+
+      if (match)
+        bitmap[i / 8] |= 1 << (i % 8);
+    }
+    return FALSE;
+
+  case RE_NODE_CONCAT:
+    if (!_yr_re_first_bytes(re_node->left, bitmap))
+      return FALSE;
+    return _yr_re_first_bytes(re_node->right, bitmap);
+
+  case RE_NODE_ALT:
+    nullable = _yr_re_first_bytes(re_node->left, bitmap);
+    return _yr_re_first_bytes(re_node->right, bitmap) || nullable;
+
+  case RE_NODE_STAR:
+    _yr_re_first_bytes(re_node->left, bitmap);
+    return TRUE;
+
+  case RE_NODE_PLUS:
+    return _yr_re_first_bytes(re_node->left, bitmap);
+
+  case RE_NODE_RANGE:
+    if (re_node->end == 0)
+      return TRUE;
+    nullable = _yr_re_first_bytes(re_node->left, bitmap);
+    return re_node->start == 0 || nullable;
+  }
+
+  return TRUE;
+}
+
+
+//
+// _yr_re_concat_items
+//
+// Stores in the items array the nodes concatenated by a tree of CONCAT
+// nodes, in matching order.
+//
+
+void _yr_re_concat_items(
+    RE_NODE* re_node,
+    RE_NODE** items,
+    int max_items,
+    int* count)
+{
+  if (re_node->type == RE_NODE_CONCAT)
+  {
+    _yr_re_concat_items(re_node->left, items, max_items, count);
+    _yr_re_concat_items(re_node->right, items, max_items, count);
+  }
+  else if (*count < max_items)
+  {
+    items[(*count)++] = re_node;
+  }
+}
+
+
+//
+// _yr_re_build_prefilter
+//
+// Fills a RE_PREFILTER structure for the regular expression. Every match
+// must start with a byte in the first_bytes bitmap. The literal is the
+// longest run of literal characters in the top-level concatenation, or its
+// prefix if it has at least two literal characters.
+//
+// Returns:
+//    TRUE if the prefilter can discard any input, FALSE otherwise.
+//
+
+int _yr_re_build_prefilter(
+    RE* re,
+    RE_PREFILTER* prefilter)
+{
+  RE_NODE* items[256];
+
+  int count = 0;
+  int run_start;
+  int run_length;
+  int best_start = 0;
+  int best_length = 0;
+  int i;
+
+  memset(prefilter, 0, sizeof(RE_PREFILTER));
+
+  if (_yr_re_first_bytes(re->root_node, prefilter->first_bytes))
+    return FALSE;
+
+  _yr_re_concat_items(re->root_node, items, 256, &count);
+
+  i = 0;
+
+  while (i < count)
+  {
+    run_start = i;
+
+    while (i < count && items[i]->type == RE_NODE_LITERAL)
+      i++;
+
+    run_length = i - run_start;
+
+    if (run_start == 0 && run_length >= 2)
+    {
+      prefilter->literal_is_prefix = TRUE;
+      best_length = run_length;
+      break;
+    }
+
+    if (run_length > best_length)
+    {
+      best_start = run_start;
+      best_length = run_length;
+    }
+
+    i++;
+  }
+
+  if (best_length == 1 && items[0]->type == RE_NODE_LITERAL)
+  {
+    best_start = 0;
+    prefilter->literal_is_prefix = TRUE;
+  }
+
+  prefilter->literal_length = min(best_length, RE_MAX_PREFILTER_LITERAL);
+
+  for (i = 0; i < prefilter->literal_length; i++)
+    prefilter->literal[i] = items[best_start + i]->value;
+
+  for (i = 0; i < 32; i++)
+    if (prefilter->first_bytes[i] != 0xFF)
+      return TRUE;
+
+  return prefilter->literal_length > 0;
+}
+
+
 int yr_re_emit_code(
     RE* re,
     YR_ARENA* arena)
 {
+  RE_PREFILTER prefilter;
+
+  uint8_t* prefilter_addr = NULL;
   int code_size;
 
+  // Emit the prefilter, if any, right before the forward code. The root
+  // node's forward code will start at the prefilter.
+
+  if (_yr_re_build_prefilter(re, &prefilter))
+  {
+    FAIL_ON_ERROR(_yr_emit_inst(
+        arena,
+        RE_OPCODE_PREFILTER,
+        &prefilter_addr,
+        &code_size));
+
+    FAIL_ON_ERROR(yr_arena_write_data(
+        arena,
+        &prefilter,
+        sizeof(RE_PREFILTER),
+        NULL));
+  }
+
   // Emit code for matching the regular expressions forwards.
   FAIL_ON_ERROR(_yr_re_emit(
       re->root_node,
@@ -827,6 +1049,9 @@ int yr_re_emit_code(
       NULL,
       &code_size));
 
+  if (prefilter_addr != NULL)
+    re->root_node->forward_code = prefilter_addr;
+
   FAIL_ON_ERROR(_yr_emit_inst(
       arena,
       RE_OPCODE_MATCH,
@@ -915,6 +1140,9 @@ void _yr_re_free_stack(
   if (stack->next != NULL)
     stack->next->prev = stack->prev;
 
+  if (pool->used == stack)
+    pool->used = stack->next;
+
   stack->next = pool->free;
 
   if (pool->free != NULL)
@@ -922,9 +1150,6 @@ void _yr_re_free_stack(
 
   pool->free = stack;
   stack->prev = NULL;
-
-  if (pool->used == stack)
-    pool->used = NULL;
 }
 
 
@@ -1026,6 +1251,74 @@ void _yr_re_add_fiber(
     y = tmp; \
   }
 
+
+//
+// _yr_re_find_literal
+//
+// Returns the offset of the first occurrence of a literal in the input,
+// or input_size if the literal is not found.
+//
+
+size_t _yr_re_find_literal(
+    uint8_t* literal,
+    size_t literal_length,
+    uint8_t* input,
+    size_t input_size)
+{
+  uint8_t* p = input;
+  uint8_t* last;
+
+  if (literal_length > input_size)
+    return input_size;
+
+  last = input + input_size - literal_length;
+
+  while (p <= last)
+  {
+    p = memchr(p, literal[0], last - p + 1);
+
+    if (p == NULL)
+      break;
+
+    if (memcmp(p + 1, literal + 1, literal_length - 1) == 0)
+      return p - input;
+
+    p++;
+  }
+
+  return input_size;
+}
+
+
+//
+// _yr_re_prefilter_skip
+//
+// Returns the number of input bytes that can be skipped before reaching a
+// position where a match could start.
+//
+
+size_t _yr_re_prefilter_skip(
+    RE_PREFILTER* prefilter,
+    uint8_t* input,
+    size_t input_size,
+    int flags)
+{
+  size_t i;
+
+  if (prefilter->literal_is_prefix && !(flags & RE_FLAGS_NO_CASE))
+    return _yr_re_find_literal(
+        prefilter->literal,
+        prefilter->literal_length,
+        input,
+        input_size);
+
+  for (i = 0; i < input_size; i++)
+    if (PREFILTER_FIRST_BYTE(prefilter, input[i], flags))
+      break;
+
+  return i;
+}
+
 //
 // yr_re_exec
 //
@@ -1040,24 +1333,41 @@ void _yr_re_add_fiber(
 //      RE_FLAGS_BACKWARDS
 //      RE_FLAGS_EXHAUSTIVE
 //      RE_FLAGS_WIDE
+//   YR_RE_LIMITS* limits             - Scan limit and cost budget, NULL
+//                                      for the defaults.
+//   YR_RE_STATS* stats               - Counters updated when the limit or
+//                                      the budget is reached, can be NULL.
 //   RE_MATCH_CALLBACK_FUNC callback  - Callback function
 //   void* callback_args              - Callback argument
 //
+// Returns:
+//    Length of the match, or -1 if no match was found. An execution that
+//    reaches the scan limit or the cost budget before finding a match
+//    returns -1 too, but it's accounted in the stats so it doesn't go
+//    unnoticed.
+//
 
 int yr_re_exec(
     uint8_t* code,
     uint8_t* input,
     size_t input_size,
     int flags,
+    YR_RE_LIMITS* limits,
+    YR_RE_STATS* stats,
     RE_MATCH_CALLBACK_FUNC callback,
     void* callback_args)
 {
   size_t i, t;
+  size_t scan_size;
+  size_t scan_limit;
+  uint32_t cost_budget;
+  uint32_t cost;
   uint8_t* ip;
   uint8_t* current_input;
   uint8_t mask;
   uint8_t value;
 
+  RE_PREFILTER* prefilter = NULL;
   RE_THREAD_STORAGE* storage;
   RE_FIBER_LIST* current_fibers;
   RE_FIBER_LIST* next_fibers;
@@ -1067,8 +1377,71 @@ int yr_re_exec(
   int match;
   char character;
   int character_size;
+  int scan;
+  int budget_exceeded;
   int result = -1;
 
+  if (limits != NULL)
+  {
+    scan_limit = limits->scan_limit;
+    cost_budget = limits->cost_budget;
+  }
+  else
+  {
+    scan_limit = RE_DEFAULT_SCAN_LIMIT;
+    cost_budget = 0;
+  }
+
+  if (stats != NULL)
+    stats->executions++;
+
+  scan_size = min(input_size, scan_limit);
+
+  scan = (flags & RE_FLAGS_SCAN) && !(flags & RE_FLAGS_START_ANCHORED);
+
+  if (*code == RE_OPCODE_PREFILTER)
+  {
+    prefilter = (RE_PREFILTER*) (code + 1);
+    code += RE_PREFILTER_INSTRUCTION_SIZE;
+
+    if (flags & RE_FLAGS_BACKWARDS)
+    {
+      prefilter = NULL;
+    }
+    else if (!scan)
+    {
+      // The first character of a wide string is also the first byte, so
+      // this check is valid in wide mode too.
+
+      if (input_size == 0 ||
+          !PREFILTER_FIRST_BYTE(prefilter, *input, flags))
+        return -1;
+    }
+    else if (flags & RE_FLAGS_WIDE)
+    {
+      prefilter = NULL;
+    }
+    else if (!prefilter->literal_is_prefix &&
+             prefilter->literal_length > 0 &&
+             !(flags & RE_FLAGS_NO_CASE))
+    {
+      // Every match must contain the literal, if it doesn't appear in the
+      // input there's nothing to do.
+
+      if (_yr_re_find_literal(
+              prefilter->literal,
+              prefilter->literal_length,
+              input,
+              scan_size) == scan_size)
+      {
+        if (stats != NULL && scan_size < input_size)
+          stats->scan_limit_exceeded++;
+
+        return -1;
+      }
+    }
+  }
+
   #ifdef WIN32
   storage = TlsGetValue(thread_storage_key);
   #else
@@ -1105,21 +1478,50 @@ int yr_re_exec(
 
   // Create the initial execution fiber starting at the provided the beginning
   // of the provided code. The stack is initially NULL and will be created
-  // dynamically when the first PUSH instruction is found.
+  // dynamically when the first PUSH instruction is found. When scanning
+  // with a prefilter the fiber is created inside the loop, once the first
+  // candidate position is found.
 
-  _yr_re_add_fiber(current_fibers, storage, code, NULL);
+  if (!scan || prefilter == NULL)
+    _yr_re_add_fiber(current_fibers, storage, code, NULL);
 
   current_input = input;
+  budget_exceeded = FALSE;
+  cost = 0;
 
-  for (i = 0; i < min(input_size, RE_SCAN_LIMIT); i += character_size)
+  for (i = 0; i < scan_size; i += character_size)
   {
-    if ((flags & RE_FLAGS_SCAN) &&
-        !(flags & RE_FLAGS_START_ANCHORED))
+    if (scan)
+    {
+      // If no fiber is alive, positions where a match can't start are
+      // skipped before creating the next fiber.
+
+      if (prefilter != NULL && current_fibers->count == 0)
+      {
+        t = _yr_re_prefilter_skip(
+            prefilter, current_input, scan_size - i, flags);
+
+        i += t;
+        current_input += t;
+
+        if (i >= scan_size)
+          break;
+      }
+
       _yr_re_add_fiber(current_fibers, storage, code, NULL);
+    }
 
     if (current_fibers->count == 0)
       break;
 
+    cost += current_fibers->count;
+
+    if (cost_budget > 0 && cost > cost_budget)
+    {
+      budget_exceeded = TRUE;
+      break;
+    }
+
     for(t = 0; t < current_fibers->count; t++)
     {
       ip = current_fibers->items[t].ip;
@@ -1222,6 +1624,12 @@ int yr_re_exec(
 
           if (flags & RE_FLAGS_EXHAUSTIVE)
           {
+            // Many fibers can reach the match at the same position, but
+            // they all represent the same match. Report it only once.
+
+            if (result == (int) i)
+              break;
+
             if (flags & RE_FLAGS_BACKWARDS)
               callback(
                   current_input + character_size,
@@ -1291,6 +1699,9 @@ int yr_re_exec(
                 i,
                 flags,
                 callback_args);
+
+          result = i;
+          break;
         }
         else
         {
@@ -1301,6 +1712,26 @@ int yr_re_exec(
     }
   }
 
+  if (stats != NULL && (result < 0 || flags & RE_FLAGS_EXHAUSTIVE))
+  {
+    // A match could have been found if the execution wasn't cut short. In
+    // scan mode a match could start anywhere beyond the limit, otherwise
+    // there must be some fiber still alive.
+
+    if (budget_exceeded)
+      stats->cost_budget_exceeded++;
+    else if (i >= scan_size && scan_size < input_size &&
+             (scan || current_fibers->count > 0))
+      stats->scan_limit_exceeded++;
+  }
+
+  // Release the stacks of fibers still alive at the end of the input.
+
+  for(t = 0; t < current_fibers->count; t++)
+    _yr_re_free_stack(
+        current_fibers->items[t].stack,
+        &storage->stack_pool);
+
   // Ensure that every stack was released
   assert(storage->stack_pool.used == NULL);
 
@@ -48,6 +48,7 @@ limitations under the License.
 #define RE_OPCODE_DIGIT             0xA9
 #define RE_OPCODE_NON_DIGIT         0xAA
 #define RE_OPCODE_MATCH             0xAB
+#define RE_OPCODE_PREFILTER         0xAC
 
 #define RE_OPCODE_SPLIT_A           0xB0
 #define RE_OPCODE_SPLIT_B           0xB1
@@ -77,6 +78,34 @@ typedef struct RE_NODE RE_NODE;
     ((cls)[(chr) / 8] & 1 << ((chr) % 8))
 
 
+#define RE_MAX_PREFILTER_LITERAL   16
+
+
+// The forward code for a regexp can start with a RE_OPCODE_PREFILTER
+// instruction followed by a RE_PREFILTER structure. It doesn't match
+// anything by itself but tells which bytes a match can start with and
+// which literal every match must contain, allowing the matching functions
+// to discard input positions without running the code.
+
+typedef struct _RE_PREFILTER
+{
+  uint8_t first_bytes[32];
+  uint8_t literal_is_prefix;
+  uint8_t literal_length;
+  uint8_t literal[RE_MAX_PREFILTER_LITERAL];
+
+} RE_PREFILTER;
+
+
+#define RE_PREFILTER_INSTRUCTION_SIZE   (1 + sizeof(RE_PREFILTER))
+
+
+#define PREFILTER_FIRST_BYTE(prefilter, chr, flags) \
+    (CHAR_IN_CLASS((chr), (prefilter)->first_bytes) || \
+     ((flags) & RE_FLAGS_NO_CASE && \
+      CHAR_IN_CLASS((uint8_t) altercase[(chr)], (prefilter)->first_bytes)))
+
+
 struct RE_NODE
 {
   int type;
@@ -163,6 +192,8 @@ int yr_re_exec(
     uint8_t* input,
     size_t input_size,
     int flags,
+    YR_RE_LIMITS* limits,
+    YR_RE_STATS* stats,
     RE_MATCH_CALLBACK_FUNC callback,
     void* callback_args);
 
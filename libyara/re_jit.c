@@ -0,0 +1,1671 @@
+/*
+Copyright (c) 2013. Victor M. Alvarez [plusvic@gmail.com].
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/*
+
+This module translates the forward and backward code of regexps and hex
+strings into native x86-64 code when rules are loaded. Two kinds of code are
+generated.
+
+Hex strings made of straight sequences of LITERAL, MASKED_LITERAL and ANY
+instructions ending in MATCH are translated into a function comparing the
+input byte by byte. For a code sequence consuming N bytes it looks like:
+
+      fail:  mov eax, -1
+             ret
+      entry: cmp input_size, N
+             jb fail
+             cmp byte [input + 0], literal         (for LITERAL)
+             jne fail
+             movzx eax, byte [input + 1]           (for MASKED_LITERAL)
+             and al, mask
+             cmp al, value
+             jne fail
+             ...                                   (nothing for ANY)
+             mov eax, N
+             ret
+
+Backward code uses negative displacements (input - 0, input - 1, ...).
+
+Any other regexp code, including alternatives, character classes and case
+insensitive or wide strings, is translated into a step function running the
+same threads as yr_re_exec. Each instruction consuming input, and the final
+MATCH, becomes a state identified by a number. The threads reached from each
+state through JUMP and SPLIT instructions are computed in advance, in the
+order used by the interpreter, so the native code for a state only tests the
+character and appends those threads to the next list:
+
+      loop:    cmp current, current_end
+               jae done
+               movzx ecx, word [current]           (state number)
+               add current, 2
+               jmp [table + ecx * 4]
+      state_0: cmp character, literal              (for exact literals)
+               jne loop
+               ...
+      state_1: bt [bitmap_1], character            (for anything else)
+               jnc loop
+               cmp [marks + n * 4], mark           (for each next state n)
+               je skip
+               mov [marks + n * 4], mark
+               mov word [next], n
+               add next, 2
+      skip:    ...
+               jmp loop
+
+Bitmaps are computed with the same tests used by the interpreter, taking
+into account the string's modifiers. The loop over the input, the cost
+budget, the scan limit and the callbacks for exhaustive matching are handled
+by yr_re_jit_exec exactly as in yr_re_exec, which keeps handling code with
+counted repetitions (PUSH, POP and JNZ instructions) and code with too many
+states. Hex strings with jumps are still handled by _yr_scan_fast_hex_re_exec.
+
+The native code lives in memory owned by the RE_JIT object and is never
+written into the rules arena, so compiled rules files are not affected.
+
+*/
+
+#include <assert.h>
+#include <ctype.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include "ahocorasick.h"
+#include "mem.h"
+#include "re.h"
+#include "re_jit.h"
+
+
+#define RE_JIT_INITIAL_ENTRIES    256
+#define RE_JIT_INITIAL_BUFFER     4096
+
+#define min(x, y)  ((x < y) ? (x) : (y))
+
+// Registers holding the arguments of a RE_JIT_FUNC, as encoded in the r/m
+// field of a ModR/M byte.
+
+#ifdef _WIN64
+#define REG_INPUT        1      // rcx
+#define REG_INPUT_SIZE   2      // rdx
+#define REG_THREADS      1      // rcx
+#define REG_CHARACTER    2      // edx
+#else
+#define REG_INPUT        7      // rdi
+#define REG_INPUT_SIZE   6      // rsi
+#define REG_THREADS      7      // rdi
+#define REG_CHARACTER    6      // esi
+#endif
+
+
+#define _yr_re_jit_hash(code, size) \
+    (((uint32_t) (size_t) (code) * 2654435761U) & ((size) - 1))
+
+
+RE_JIT_ENTRY* _yr_re_jit_find_entry(
+    RE_JIT* jit,
+    uint8_t* code)
+{
+  RE_JIT_ENTRY* entry;
+  uint32_t i;
+
+  if (jit->entries_size == 0)
+    return NULL;
+
+  i = _yr_re_jit_hash(code, jit->entries_size);
+
+  while (TRUE)
+  {
+    entry = &jit->entries[i];
+
+    if (entry->code == code || entry->code == NULL)
+      return entry;
+
+    i = (i + 1) & (jit->entries_size - 1);
+  }
+}
+
+
+//
+// yr_re_jit_lookup
+//
+// Returns the entry with the native code generated for a given code, or
+// NULL if the code must be executed by the interpreter.
+//
+// Args:
+//    RE_JIT* jit    - Pointer to RE_JIT object
+//    uint8_t* code  - Pointer to regexp code
+//
+// Returns:
+//    A pointer to RE_JIT_ENTRY or NULL.
+//
+
+RE_JIT_ENTRY* yr_re_jit_lookup(
+    RE_JIT* jit,
+    uint8_t* code)
+{
+  RE_JIT_ENTRY* entry;
+
+  if (jit->entries_count == 0)
+    return NULL;
+
+  entry = _yr_re_jit_find_entry(jit, code);
+
+  if (entry->code == NULL)
+    return NULL;
+
+  return entry;
+}
+
+
+//
+// yr_re_jit_exec
+//
+// Executes the native code for a regexp. It behaves exactly like yr_re_exec
+// for the same code, except that RE_FLAGS_SCAN is not supported.
+//
+// Args:
+//   RE_JIT_ENTRY* entry              - Entry returned by yr_re_jit_lookup
+//   uint8_t* input                   - Pointer to input data
+//   size_t input_size                - Input data size
+//   int flags                        - Flags:
+//      RE_FLAGS_BACKWARDS
+//      RE_FLAGS_EXHAUSTIVE
+//      RE_FLAGS_WIDE
+//   YR_RE_LIMITS* limits             - Scan limit and cost budget, NULL
+//                                      for the defaults.
+//   YR_RE_STATS* stats               - Counters updated like yr_re_exec
+//                                      does, can be NULL. Executions of
+//                                      native code are counted in
+//                                      jit_executions, including those of
+//                                      straight hex strings.
+//   RE_MATCH_CALLBACK_FUNC callback  - Callback function
+//   void* callback_args              - Callback argument
+//
+// Returns:
+//    Length of the match, or -1 if no match was found.
+//
+
+int yr_re_jit_exec(
+    RE_JIT_ENTRY* entry,
+    uint8_t* input,
+    size_t input_size,
+    int flags,
+    YR_RE_LIMITS* limits,
+    YR_RE_STATS* stats,
+    RE_MATCH_CALLBACK_FUNC callback,
+    void* callback_args)
+{
+  RE_JIT_THREADS threads;
+
+  uint16_t list1[RE_JIT_MAX_STATES];
+  uint16_t list2[RE_JIT_MAX_STATES];
+  uint32_t marks[RE_JIT_MAX_STATES];
+  uint16_t* list;
+
+  size_t i, t;
+  size_t scan_size;
+  size_t scan_limit;
+  uint32_t cost_budget;
+  uint32_t cost;
+  uint8_t* current_input;
+
+  int count;
+  int character_size;
+  int budget_exceeded;
+  int result = -1;
+
+  assert(!(flags & RE_FLAGS_SCAN));
+
+  if (stats != NULL)
+    stats->jit_executions++;
+
+  if (entry->function != NULL)
+  {
+    // Straight code is only generated for hex strings, which are never
+    // wide. It has a single path and therefore a single match.
+
+    result = entry->function(input, input_size);
+
+    if (result >= 0 && flags & RE_FLAGS_EXHAUSTIVE)
+    {
+      if (flags & RE_FLAGS_BACKWARDS)
+        callback(input - result + 1, result, flags, callback_args);
+      else
+        callback(input, result, flags, callback_args);
+    }
+
+    return result;
+  }
+
+  if (stats != NULL)
+    stats->executions++;
+
+  if (limits != NULL)
+  {
+    scan_limit = limits->scan_limit;
+    cost_budget = limits->cost_budget;
+  }
+  else
+  {
+    scan_limit = RE_DEFAULT_SCAN_LIMIT;
+    cost_budget = 0;
+  }
+
+  scan_size = min(input_size, scan_limit);
+
+  if (entry->prefilter != NULL && !(flags & RE_FLAGS_BACKWARDS))
+  {
+    if (input_size == 0 ||
+        !PREFILTER_FIRST_BYTE(entry->prefilter, *input, flags))
+      return -1;
+  }
+
+  if (flags & RE_FLAGS_WIDE)
+    character_size = 2;
+  else
+    character_size = 1;
+
+  memcpy(list1, entry->start, entry->start_count * sizeof(uint16_t));
+  memset(marks, 0, entry->states_count * sizeof(uint32_t));
+
+  threads.current = list1;
+  threads.next = list2;
+  threads.marks = marks;
+  threads.mark = 0;
+
+  // Matches found before the end of the input don't count when the regexp
+  // is anchored to the end, there's no reason to stop at them.
+
+  threads.stop_at_match = !(flags & RE_FLAGS_EXHAUSTIVE) &&
+                          !(flags & RE_FLAGS_END_ANCHORED);
+
+  count = entry->start_count;
+  current_input = input;
+  budget_exceeded = FALSE;
+  cost = 0;
+
+  for (i = 0; i < scan_size; i += character_size)
+  {
+    if (count == 0)
+      break;
+
+    cost += count;
+
+    if (cost_budget > 0 && cost > cost_budget)
+    {
+      budget_exceeded = TRUE;
+      break;
+    }
+
+    if (++threads.mark == 0)
+    {
+      memset(marks, 0, entry->states_count * sizeof(uint32_t));
+      threads.mark = 1;
+    }
+
+    threads.current_end = threads.current + count;
+    threads.matched = FALSE;
+
+    count = entry->step(&threads, *current_input);
+
+    if (threads.matched && !(flags & RE_FLAGS_END_ANCHORED))
+    {
+      if (flags & RE_FLAGS_EXHAUSTIVE)
+      {
+        if (flags & RE_FLAGS_BACKWARDS)
+          callback(
+              current_input + character_size,
+              i,
+              flags,
+              callback_args);
+        else
+          callback(
+              input,
+              i,
+              flags,
+              callback_args);
+      }
+
+      result = i;
+    }
+
+    list = threads.current;
+    threads.current = threads.next;
+    threads.next = list;
+
+    if (flags & RE_FLAGS_WIDE && *(current_input + 1) != 0)
+      break;
+
+    if (flags & RE_FLAGS_BACKWARDS)
+      current_input -= character_size;
+    else
+      current_input += character_size;
+  }
+
+  if (!(flags & RE_FLAGS_END_ANCHORED) || i == input_size)
+  {
+    for (t = 0; t < (size_t) count; t++)
+    {
+      if (threads.current[t] == entry->match_state)
+      {
+        if (flags & RE_FLAGS_EXHAUSTIVE)
+        {
+          if (flags & RE_FLAGS_BACKWARDS)
+            callback(
+                current_input + character_size,
+                i,
+                flags,
+                callback_args);
+          else
+            callback(
+                input,
+                i,
+                flags,
+                callback_args);
+        }
+
+        result = i;
+        break;
+      }
+    }
+  }
+
+  if (stats != NULL && (result < 0 || flags & RE_FLAGS_EXHAUSTIVE))
+  {
+    if (budget_exceeded)
+      stats->cost_budget_exceeded++;
+    else if (i >= scan_size && scan_size < input_size && count > 0)
+      stats->scan_limit_exceeded++;
+  }
+
+  return result;
+}
+
+
+#ifdef RE_JIT_ENABLED
+
+int _yr_re_jit_add_entry(
+    RE_JIT* jit,
+    uint8_t* code,
+    size_t offset)
+{
+  RE_JIT_ENTRY* old_entries;
+  RE_JIT_ENTRY* entry;
+
+  int old_entries_size;
+  int i;
+
+  if ((jit->entries_count + 1) * 2 > jit->entries_size)
+  {
+    old_entries = jit->entries;
+    old_entries_size = jit->entries_size;
+
+    if (old_entries_size == 0)
+      jit->entries_size = RE_JIT_INITIAL_ENTRIES;
+    else
+      jit->entries_size = old_entries_size * 2;
+
+    jit->entries = yr_malloc(jit->entries_size * sizeof(RE_JIT_ENTRY));
+
+    if (jit->entries == NULL)
+    {
+      jit->entries = old_entries;
+      jit->entries_size = old_entries_size;
+      return ERROR_INSUFICIENT_MEMORY;
+    }
+
+    memset(jit->entries, 0, jit->entries_size * sizeof(RE_JIT_ENTRY));
+
+    for (i = 0; i < old_entries_size; i++)
+    {
+      if (old_entries[i].code != NULL)
+      {
+        entry = _yr_re_jit_find_entry(jit, old_entries[i].code);
+        *entry = old_entries[i];
+      }
+    }
+
+    if (old_entries != NULL)
+      yr_free(old_entries);
+  }
+
+  entry = _yr_re_jit_find_entry(jit, code);
+  memset(entry, 0, sizeof(RE_JIT_ENTRY));
+  entry->code = code;
+  entry->offset = offset;
+
+  jit->entries_count++;
+
+  return ERROR_SUCCESS;
+}
+
+
+int _yr_re_jit_emit(
+    RE_JIT* jit,
+    uint8_t* data,
+    size_t size)
+{
+  uint8_t* new_buffer;
+  size_t new_size;
+
+  if (jit->buffer_used + size > jit->buffer_size)
+  {
+    new_size = jit->buffer_size == 0 ?
+        RE_JIT_INITIAL_BUFFER : jit->buffer_size * 2;
+
+    while (jit->buffer_used + size > new_size)
+      new_size *= 2;
+
+    if (jit->buffer == NULL)
+      new_buffer = yr_malloc(new_size);
+    else
+      new_buffer = yr_realloc(jit->buffer, new_size);
+
+    if (new_buffer == NULL)
+      return ERROR_INSUFICIENT_MEMORY;
+
+    jit->buffer = new_buffer;
+    jit->buffer_size = new_size;
+  }
+
+  memcpy(jit->buffer + jit->buffer_used, data, size);
+  jit->buffer_used += size;
+
+  return ERROR_SUCCESS;
+}
+
+
+int _yr_re_jit_emit_jump(
+    RE_JIT* jit,
+    uint8_t condition,
+    size_t target_offset)
+{
+  uint8_t instruction[6];
+  int32_t relative;
+
+  relative = (int32_t) (target_offset - (jit->buffer_used + 6));
+
+  instruction[0] = 0x0F;
+  instruction[1] = condition;
+  memcpy(instruction + 2, &relative, sizeof(relative));
+
+  return _yr_re_jit_emit(jit, instruction, sizeof(instruction));
+}
+
+
+int _yr_re_jit_emit_unconditional_jump(
+    RE_JIT* jit,
+    size_t target_offset)
+{
+  uint8_t instruction[5];
+  int32_t relative;
+
+  relative = (int32_t) (target_offset - (jit->buffer_used + 5));
+
+  instruction[0] = 0xE9;
+  memcpy(instruction + 1, &relative, sizeof(relative));
+
+  return _yr_re_jit_emit(jit, instruction, sizeof(instruction));
+}
+
+
+int _yr_re_jit_emit_return(
+    RE_JIT* jit,
+    int32_t value)
+{
+  uint8_t instruction[6];
+
+  instruction[0] = 0xB8;          // mov eax, imm32
+  memcpy(instruction + 1, &value, sizeof(value));
+  instruction[5] = 0xC3;          // ret
+
+  return _yr_re_jit_emit(jit, instruction, sizeof(instruction));
+}
+
+
+//
+// _yr_re_jit_emit_memory_operand
+//
+// Emits the ModR/M byte and displacement for [input + displacement], using
+// a 8-bits displacement when possible.
+//
+
+int _yr_re_jit_emit_memory_operand(
+    RE_JIT* jit,
+    uint8_t reg,
+    int32_t displacement)
+{
+  uint8_t operand[5];
+
+  if (displacement >= -128 && displacement <= 127)
+  {
+    operand[0] = 0x40 | (reg << 3) | REG_INPUT;
+    operand[1] = (uint8_t) displacement;
+
+    return _yr_re_jit_emit(jit, operand, 2);
+  }
+
+  operand[0] = 0x80 | (reg << 3) | REG_INPUT;
+  memcpy(operand + 1, &displacement, sizeof(displacement));
+
+  return _yr_re_jit_emit(jit, operand, 5);
+}
+
+
+//
+// _yr_re_jit_code_length
+//
+// Returns the number of input bytes consumed by a code sequence, or -1 if
+// the code contains instructions that can't be translated.
+//
+
+int _yr_re_jit_code_length(
+    uint8_t* code)
+{
+  uint8_t* ip = code;
+  int length = 0;
+
+  while (*ip != RE_OPCODE_MATCH)
+  {
+    switch(*ip)
+    {
+      case RE_OPCODE_LITERAL:
+        ip += 2;
+        break;
+      case RE_OPCODE_MASKED_LITERAL:
+        ip += 3;
+        break;
+      case RE_OPCODE_ANY:
+        ip += 1;
+        break;
+      default:
+        return -1;
+    }
+
+    length++;
+  }
+
+  return length;
+}
+
+
+int _yr_re_jit_compile_code(
+    RE_JIT* jit,
+    uint8_t* code,
+    int backwards)
+{
+  RE_JIT_ENTRY* entry;
+
+  uint8_t* ip = code;
+  uint8_t instruction[8];
+  uint8_t mask;
+  uint8_t value;
+
+  size_t fail_offset;
+  size_t entry_offset;
+
+  int32_t length;
+  int32_t displacement = 0;
+
+  entry = _yr_re_jit_find_entry(jit, code);
+
+  if (entry != NULL && entry->code != NULL)
+    return ERROR_SUCCESS;
+
+  length = _yr_re_jit_code_length(code);
+
+  if (length <= 0)
+    return ERROR_SUCCESS;
+
+  fail_offset = jit->buffer_used;
+
+  FAIL_ON_ERROR(_yr_re_jit_emit_return(jit, -1));
+
+  entry_offset = jit->buffer_used;
+
+  // cmp input_size, length
+  instruction[0] = 0x48;
+  instruction[1] = 0x81;
+  instruction[2] = 0xF8 | REG_INPUT_SIZE;
+  memcpy(instruction + 3, &length, sizeof(length));
+
+  FAIL_ON_ERROR(_yr_re_jit_emit(jit, instruction, 7));
+  FAIL_ON_ERROR(_yr_re_jit_emit_jump(jit, 0x82, fail_offset));  // jb
+
+  while (*ip != RE_OPCODE_MATCH)
+  {
+    switch(*ip)
+    {
+      case RE_OPCODE_LITERAL:
+        // cmp byte [input + displacement], value
+        instruction[0] = 0x80;
+        FAIL_ON_ERROR(_yr_re_jit_emit(jit, instruction, 1));
+        FAIL_ON_ERROR(_yr_re_jit_emit_memory_operand(jit, 7, displacement));
+        FAIL_ON_ERROR(_yr_re_jit_emit(jit, ip + 1, 1));
+        FAIL_ON_ERROR(_yr_re_jit_emit_jump(jit, 0x85, fail_offset));  // jne
+        ip += 2;
+        break;
+
+      case RE_OPCODE_MASKED_LITERAL:
+        value = *(int16_t*)(ip + 1) & 0xFF;
+        mask = *(int16_t*)(ip + 1) >> 8;
+        // movzx eax, byte [input + displacement]
+        instruction[0] = 0x0F;
+        instruction[1] = 0xB6;
+        FAIL_ON_ERROR(_yr_re_jit_emit(jit, instruction, 2));
+        FAIL_ON_ERROR(_yr_re_jit_emit_memory_operand(jit, 0, displacement));
+        // and al, mask
+        // cmp al, value
+        instruction[0] = 0x24;
+        instruction[1] = mask;
+        instruction[2] = 0x3C;
+        instruction[3] = value;
+        FAIL_ON_ERROR(_yr_re_jit_emit(jit, instruction, 4));
+        FAIL_ON_ERROR(_yr_re_jit_emit_jump(jit, 0x85, fail_offset));  // jne
+        ip += 3;
+        break;
+
+      case RE_OPCODE_ANY:
+        ip += 1;
+        break;
+    }
+
+    displacement += backwards ? -1 : 1;
+  }
+
+  FAIL_ON_ERROR(_yr_re_jit_emit_return(jit, length));
+
+  return _yr_re_jit_add_entry(jit, code, entry_offset);
+}
+
+
+// Instructions and states found in the code of a regexp while translating
+// it into a step function.
+
+typedef struct _RE_JIT_NFA
+{
+  uint8_t* instructions[RE_JIT_MAX_INSTRUCTIONS];
+  int16_t state[RE_JIT_MAX_INSTRUCTIONS];
+  uint8_t on_path[RE_JIT_MAX_INSTRUCTIONS];
+  int instructions_count;
+
+  uint8_t* states[RE_JIT_MAX_STATES];
+  int states_count;
+  int match_state;
+
+  uint16_t closure[RE_JIT_MAX_STATES];
+  int closure_count;
+
+  uint8_t* pending[RE_JIT_MAX_INSTRUCTIONS * 2];
+
+} RE_JIT_NFA;
+
+
+//
+// _yr_re_jit_next
+//
+// Returns the instruction following one that consumes input.
+//
+
+uint8_t* _yr_re_jit_next(
+    uint8_t* ip)
+{
+  switch(*ip)
+  {
+    case RE_OPCODE_LITERAL:
+      return ip + 2;
+    case RE_OPCODE_MASKED_LITERAL:
+      return ip + 3;
+    case RE_OPCODE_CLASS:
+      return ip + 33;
+    default:
+      return ip + 1;
+  }
+}
+
+
+int _yr_re_jit_nfa_index(
+    RE_JIT_NFA* nfa,
+    uint8_t* ip)
+{
+  int i;
+
+  for (i = 0; i < nfa->instructions_count; i++)
+    if (nfa->instructions[i] == ip)
+      return i;
+
+  return -1;
+}
+
+
+//
+// _yr_re_jit_nfa_discover
+//
+// Finds every instruction reachable from the start of the code and assigns
+// a state number to the ones consuming input and to the MATCH. Returns FALSE
+// if the code contains instructions that can't be translated or it's too
+// large.
+//
+
+int _yr_re_jit_nfa_discover(
+    RE_JIT_NFA* nfa,
+    uint8_t* code)
+{
+  uint8_t* ip;
+  int16_t jmp_offset;
+  int pending_count = 0;
+  int index;
+
+  nfa->pending[pending_count++] = code;
+
+  while (pending_count > 0)
+  {
+    ip = nfa->pending[--pending_count];
+
+    if (_yr_re_jit_nfa_index(nfa, ip) >= 0)
+      continue;
+
+    if (nfa->instructions_count == RE_JIT_MAX_INSTRUCTIONS)
+      return FALSE;
+
+    index = nfa->instructions_count++;
+
+    nfa->instructions[index] = ip;
+    nfa->on_path[index] = FALSE;
+    nfa->state[index] = -1;
+
+    switch(*ip)
+    {
+      case RE_OPCODE_JUMP:
+        jmp_offset = *(int16_t*)(ip + 1);
+        nfa->pending[pending_count++] = ip + jmp_offset;
+        continue;
+
+      case RE_OPCODE_SPLIT_A:
+      case RE_OPCODE_SPLIT_B:
+        jmp_offset = *(int16_t*)(ip + 1);
+        nfa->pending[pending_count++] = ip + jmp_offset;
+        nfa->pending[pending_count++] = ip + 3;
+        continue;
+
+      case RE_OPCODE_LITERAL:
+      case RE_OPCODE_MASKED_LITERAL:
+      case RE_OPCODE_CLASS:
+      case RE_OPCODE_ANY:
+      case RE_OPCODE_WORD_CHAR:
+      case RE_OPCODE_NON_WORD_CHAR:
+      case RE_OPCODE_SPACE:
+      case RE_OPCODE_NON_SPACE:
+      case RE_OPCODE_DIGIT:
+      case RE_OPCODE_NON_DIGIT:
+        nfa->pending[pending_count++] = _yr_re_jit_next(ip);
+        break;
+
+      case RE_OPCODE_MATCH:
+        // The code has a single MATCH at its end.
+        if (nfa->match_state >= 0)
+          return FALSE;
+        nfa->match_state = nfa->states_count;
+        break;
+
+      default:
+        return FALSE;
+    }
+
+    if (nfa->states_count == RE_JIT_MAX_STATES)
+      return FALSE;
+
+    nfa->state[index] = nfa->states_count;
+    nfa->states[nfa->states_count++] = ip;
+  }
+
+  return TRUE;
+}
+
+
+//
+// _yr_re_jit_nfa_closure
+//
+// Appends to nfa->closure the states reached from the instruction at ip,
+// following jumps and splits in the same order than _yr_re_add_fiber does.
+// Returns FALSE if a loop without any instruction consuming input is found.
+//
+
+int _yr_re_jit_nfa_closure(
+    RE_JIT_NFA* nfa,
+    uint8_t* ip)
+{
+  int16_t jmp_offset;
+  int index = _yr_re_jit_nfa_index(nfa, ip);
+  int result = TRUE;
+  int i;
+
+  assert(index >= 0);
+
+  if (nfa->state[index] >= 0)
+  {
+    for (i = 0; i < nfa->closure_count; i++)
+      if (nfa->closure[i] == nfa->state[index])
+        return TRUE;
+
+    nfa->closure[nfa->closure_count++] = nfa->state[index];
+    return TRUE;
+  }
+
+  if (nfa->on_path[index])
+    return FALSE;
+
+  nfa->on_path[index] = TRUE;
+  jmp_offset = *(int16_t*)(ip + 1);
+
+  switch(*ip)
+  {
+    case RE_OPCODE_JUMP:
+      result = _yr_re_jit_nfa_closure(nfa, ip + jmp_offset);
+      break;
+
+    case RE_OPCODE_SPLIT_A:
+      result = _yr_re_jit_nfa_closure(nfa, ip + 3) &&
+               _yr_re_jit_nfa_closure(nfa, ip + jmp_offset);
+      break;
+
+    case RE_OPCODE_SPLIT_B:
+      result = _yr_re_jit_nfa_closure(nfa, ip + jmp_offset) &&
+               _yr_re_jit_nfa_closure(nfa, ip + 3);
+      break;
+  }
+
+  nfa->on_path[index] = FALSE;
+
+  return result;
+}
+
+
+//
+// _yr_re_jit_state_bitmap
+//
+// Fills a bitmap with the characters accepted by the instruction at ip,
+// using the same tests than yr_re_exec. Returns the number of characters
+// accepted.
+//
+
+int _yr_re_jit_state_bitmap(
+    uint8_t* ip,
+    int flags,
+    uint8_t* bitmap)
+{
+  uint8_t mask;
+  uint8_t value;
+
+  int match;
+  int count = 0;
+  int c;
+
+  memset(bitmap, 0, 32);
+
+  for (c = 0; c < 256; c++)
+  {
+    switch(*ip)
+    {
+      case RE_OPCODE_LITERAL:
+        if (flags & RE_FLAGS_NO_CASE)
+          match = lowercase[c] == lowercase[*(ip + 1)];
+        else
+          match = c == *(ip + 1);
+        break;
+
+      case RE_OPCODE_MASKED_LITERAL:
+        value = *(int16_t*)(ip + 1) & 0xFF;
+        mask = *(int16_t*)(ip + 1) >> 8;
+        match = (c & mask) == value;
+        break;
+
+      case RE_OPCODE_CLASS:
+        if (flags & RE_FLAGS_NO_CASE)
+          match = CHAR_IN_CLASS(c, ip + 1) ||
+                  CHAR_IN_CLASS((uint8_t) altercase[c], ip + 1);
+        else
+          match = CHAR_IN_CLASS(c, ip + 1);
+        break;
+
+      case RE_OPCODE_WORD_CHAR:
+        match = isalnum(c) || c == '_';
+        break;
+
+      case RE_OPCODE_NON_WORD_CHAR:
+        match = !isalnum(c) && c != '_';
+        break;
+
+      case RE_OPCODE_SPACE:
+        match = c == ' ' || c == '\t';
+        break;
+
+      case RE_OPCODE_NON_SPACE:
+        match = c != ' ' && c != '\t';
+        break;
+
+      case RE_OPCODE_DIGIT:
+        match = isdigit(c);
+        break;
+
+      case RE_OPCODE_NON_DIGIT:
+        match = !isdigit(c);
+        break;
+
+      case RE_OPCODE_ANY:
+        match = c != 0x0A || flags & RE_FLAGS_DOT_ALL;
+        break;
+
+      default:
+        match = FALSE;
+    }
+
+    if (match)
+    {
+      bitmap[c / 8] |= 1 << (c % 8);
+      count++;
+    }
+  }
+
+  return count;
+}
+
+
+int _yr_re_jit_align(
+    RE_JIT* jit)
+{
+  uint8_t padding[4] = { 0xCC, 0xCC, 0xCC, 0xCC };
+
+  if (jit->buffer_used % 4 == 0)
+    return ERROR_SUCCESS;
+
+  return _yr_re_jit_emit(jit, padding, 4 - jit->buffer_used % 4);
+}
+
+
+//
+// _yr_re_jit_emit_state
+//
+// Emits the native code for a state: the test of the character and the
+// addition of the states following it to the next list.
+//
+
+int _yr_re_jit_emit_state(
+    RE_JIT* jit,
+    RE_JIT_NFA* nfa,
+    int state,
+    int flags,
+    size_t bitmap_offset,
+    size_t loop_offset,
+    size_t done_offset)
+{
+  uint8_t bitmap[32];
+  uint8_t instruction[16];
+  uint8_t* ip = nfa->states[state];
+
+  int32_t value;
+  int accepted;
+  int c, n;
+
+  if (state == nfa->match_state)
+  {
+    // mov dword [threads + matched], 1
+    // cmp dword [threads + stop_at_match], 0
+    instruction[0] = 0x41;
+    instruction[1] = 0xC7;
+    instruction[2] = 0x40;
+    instruction[3] = offsetof(RE_JIT_THREADS, matched);
+    value = 1;
+    memcpy(instruction + 4, &value, sizeof(value));
+    instruction[8] = 0x41;
+    instruction[9] = 0x83;
+    instruction[10] = 0x78;
+    instruction[11] = offsetof(RE_JIT_THREADS, stop_at_match);
+    instruction[12] = 0x00;
+
+    FAIL_ON_ERROR(_yr_re_jit_emit(jit, instruction, 13));
+    FAIL_ON_ERROR(_yr_re_jit_emit_jump(jit, 0x84, loop_offset));  // je
+    return _yr_re_jit_emit_unconditional_jump(jit, done_offset);
+  }
+
+  accepted = _yr_re_jit_state_bitmap(ip, flags, bitmap);
+
+  if (accepted == 0)
+    return _yr_re_jit_emit_unconditional_jump(jit, loop_offset);
+
+  if (accepted == 1)
+  {
+    for (c = 0; c < 255; c++)
+      if (CHAR_IN_CLASS(c, bitmap))
+        break;
+
+    // cmp r9d, c
+    instruction[0] = 0x41;
+    instruction[1] = 0x81;
+    instruction[2] = 0xF9;
+    value = c;
+    memcpy(instruction + 3, &value, sizeof(value));
+
+    FAIL_ON_ERROR(_yr_re_jit_emit(jit, instruction, 7));
+    FAIL_ON_ERROR(_yr_re_jit_emit_jump(jit, 0x85, loop_offset));  // jne
+  }
+  else if (accepted < 256)
+  {
+    // bt dword [rip + bitmap], r9d
+    instruction[0] = 0x44;
+    instruction[1] = 0x0F;
+    instruction[2] = 0xA3;
+    instruction[3] = 0x0D;
+    value = (int32_t) (bitmap_offset - (jit->buffer_used + 8));
+    memcpy(instruction + 4, &value, sizeof(value));
+
+    FAIL_ON_ERROR(_yr_re_jit_emit(jit, instruction, 8));
+    FAIL_ON_ERROR(_yr_re_jit_emit_jump(jit, 0x83, loop_offset));  // jnc
+  }
+
+  nfa->closure_count = 0;
+  _yr_re_jit_nfa_closure(nfa, _yr_re_jit_next(ip));
+
+  if (nfa->closure_count > 0)
+  {
+    // mov eax, [threads + mark]
+    instruction[0] = 0x41;
+    instruction[1] = 0x8B;
+    instruction[2] = 0x40;
+    instruction[3] = offsetof(RE_JIT_THREADS, mark);
+
+    FAIL_ON_ERROR(_yr_re_jit_emit(jit, instruction, 4));
+  }
+
+  for (n = 0; n < nfa->closure_count; n++)
+  {
+    value = nfa->closure[n] * sizeof(uint32_t);
+
+    // cmp [rdx + n * 4], eax
+    // je skip
+    // mov [rdx + n * 4], eax
+    // mov word [r11], n
+    // add r11, 2
+    instruction[0] = 0x39;
+    instruction[1] = 0x82;
+    memcpy(instruction + 2, &value, sizeof(value));
+    instruction[6] = 0x74;
+    instruction[7] = 16;
+
+    FAIL_ON_ERROR(_yr_re_jit_emit(jit, instruction, 8));
+
+    instruction[0] = 0x89;
+    instruction[1] = 0x82;
+    memcpy(instruction + 2, &value, sizeof(value));
+    instruction[6] = 0x66;
+    instruction[7] = 0x41;
+    instruction[8] = 0xC7;
+    instruction[9] = 0x03;
+    instruction[10] = nfa->closure[n] & 0xFF;
+    instruction[11] = nfa->closure[n] >> 8;
+    instruction[12] = 0x49;
+    instruction[13] = 0x83;
+    instruction[14] = 0xC3;
+    instruction[15] = 0x02;
+
+    FAIL_ON_ERROR(_yr_re_jit_emit(jit, instruction, 16));
+  }
+
+  return _yr_re_jit_emit_unconditional_jump(jit, loop_offset);
+}
+
+
+//
+// _yr_re_jit_compile_nfa
+//
+// Translates regexp code into a step function, see the description at the
+// top of this file. Code that can't be translated is silently left to the
+// interpreter.
+//
+
+int _yr_re_jit_compile_nfa(
+    RE_JIT* jit,
+    uint8_t* code,
+    int flags)
+{
+  RE_JIT_ENTRY* entry;
+  RE_JIT_NFA* nfa;
+  RE_PREFILTER* prefilter = NULL;
+
+  uint8_t bitmap[32];
+  uint8_t instruction[16];
+  uint8_t* start = code;
+
+  size_t* bitmap_offsets = NULL;
+  size_t* state_offsets = NULL;
+  size_t start_offset;
+  size_t done_offset;
+  size_t entry_offset;
+  size_t loop_offset;
+  size_t lea_offset;
+  size_t table_offset;
+
+  int32_t value;
+  int start_count;
+  int result = ERROR_SUCCESS;
+  int i;
+
+  entry = _yr_re_jit_find_entry(jit, code);
+
+  if (entry != NULL && entry->code != NULL)
+    return ERROR_SUCCESS;
+
+  if (*start == RE_OPCODE_PREFILTER)
+  {
+    prefilter = (RE_PREFILTER*) (start + 1);
+    start += RE_PREFILTER_INSTRUCTION_SIZE;
+  }
+
+  nfa = (RE_JIT_NFA*) yr_malloc(sizeof(RE_JIT_NFA));
+
+  if (nfa == NULL)
+    return ERROR_INSUFICIENT_MEMORY;
+
+  nfa->instructions_count = 0;
+  nfa->states_count = 0;
+  nfa->match_state = -1;
+  nfa->closure_count = 0;
+
+  if (!_yr_re_jit_nfa_discover(nfa, start) ||
+      nfa->match_state < 0 ||
+      !_yr_re_jit_nfa_closure(nfa, start))
+  {
+    yr_free(nfa);
+    return ERROR_SUCCESS;
+  }
+
+  start_count = nfa->closure_count;
+
+  // Every state must be translatable before emitting anything, epsilon
+  // loops are only detected while computing the closures.
+
+  for (i = 0; i < nfa->states_count; i++)
+  {
+    if (i == nfa->match_state)
+      continue;
+
+    nfa->closure_count = 0;
+
+    if (!_yr_re_jit_nfa_closure(nfa, _yr_re_jit_next(nfa->states[i])))
+    {
+      yr_free(nfa);
+      return ERROR_SUCCESS;
+    }
+  }
+
+  bitmap_offsets = yr_malloc(nfa->states_count * sizeof(size_t));
+  state_offsets = yr_malloc(nfa->states_count * sizeof(size_t));
+
+  if (bitmap_offsets == NULL || state_offsets == NULL)
+  {
+    result = ERROR_INSUFICIENT_MEMORY;
+    goto _exit;
+  }
+
+  // Bitmaps for the states needing them.
+
+  for (i = 0; i < nfa->states_count; i++)
+  {
+    bitmap_offsets[i] = 0;
+
+    if (i == nfa->match_state)
+      continue;
+
+    value = _yr_re_jit_state_bitmap(nfa->states[i], flags, bitmap);
+
+    if (value > 1 && value < 256)
+    {
+      bitmap_offsets[i] = jit->buffer_used;
+      result = _yr_re_jit_emit(jit, bitmap, sizeof(bitmap));
+
+      if (result != ERROR_SUCCESS)
+        goto _exit;
+    }
+  }
+
+  // States alive at the beginning of the input.
+
+  nfa->closure_count = 0;
+  _yr_re_jit_nfa_closure(nfa, start);
+
+  start_offset = jit->buffer_used;
+  result = _yr_re_jit_emit(
+      jit, (uint8_t*) nfa->closure, start_count * sizeof(uint16_t));
+
+  if (result != ERROR_SUCCESS)
+    goto _exit;
+
+  // done: sub r11, [r8 + next]
+  //       shr r11, 1
+  //       mov eax, r11d
+  //       ret
+
+  done_offset = jit->buffer_used;
+
+  instruction[0] = 0x4D;
+  instruction[1] = 0x2B;
+  instruction[2] = 0x58;
+  instruction[3] = offsetof(RE_JIT_THREADS, next);
+  instruction[4] = 0x49;
+  instruction[5] = 0xD1;
+  instruction[6] = 0xEB;
+  instruction[7] = 0x44;
+  instruction[8] = 0x89;
+  instruction[9] = 0xD8;
+  instruction[10] = 0xC3;
+
+  result = _yr_re_jit_emit(jit, instruction, 11);
+
+  if (result != ERROR_SUCCESS)
+    goto _exit;
+
+  // entry: mov r8, threads
+  //        mov r9d, character
+  //        mov r10, [r8 + current]
+  //        mov r11, [r8 + next]
+  //        mov rdx, [r8 + marks]
+
+  entry_offset = jit->buffer_used;
+
+  instruction[0] = 0x49;
+  instruction[1] = 0x89;
+  instruction[2] = 0xC0 | (REG_THREADS << 3);
+  instruction[3] = 0x41;
+  instruction[4] = 0x89;
+  instruction[5] = 0xC1 | (REG_CHARACTER << 3);
+  instruction[6] = 0x4D;
+  instruction[7] = 0x8B;
+  instruction[8] = 0x50;
+  instruction[9] = offsetof(RE_JIT_THREADS, current);
+  instruction[10] = 0x4D;
+  instruction[11] = 0x8B;
+  instruction[12] = 0x58;
+  instruction[13] = offsetof(RE_JIT_THREADS, next);
+
+  result = _yr_re_jit_emit(jit, instruction, 14);
+
+  if (result != ERROR_SUCCESS)
+    goto _exit;
+
+  instruction[0] = 0x49;
+  instruction[1] = 0x8B;
+  instruction[2] = 0x50;
+  instruction[3] = offsetof(RE_JIT_THREADS, marks);
+
+  result = _yr_re_jit_emit(jit, instruction, 4);
+
+  if (result != ERROR_SUCCESS)
+    goto _exit;
+
+  // loop: cmp r10, [r8 + current_end]
+  //       jae done
+  //       movzx ecx, word [r10]
+  //       add r10, 2
+  //       lea rax, [rip + table]
+  //       movsxd rcx, dword [rax + rcx * 4]
+  //       add rax, rcx
+  //       jmp rax
+
+  loop_offset = jit->buffer_used;
+
+  instruction[0] = 0x4D;
+  instruction[1] = 0x3B;
+  instruction[2] = 0x50;
+  instruction[3] = offsetof(RE_JIT_THREADS, current_end);
+
+  result = _yr_re_jit_emit(jit, instruction, 4);
+
+  if (result == ERROR_SUCCESS)
+    result = _yr_re_jit_emit_jump(jit, 0x83, done_offset);
+
+  if (result != ERROR_SUCCESS)
+    goto _exit;
+
+  instruction[0] = 0x41;
+  instruction[1] = 0x0F;
+  instruction[2] = 0xB7;
+  instruction[3] = 0x0A;
+  instruction[4] = 0x49;
+  instruction[5] = 0x83;
+  instruction[6] = 0xC2;
+  instruction[7] = 0x02;
+  instruction[8] = 0x48;
+  instruction[9] = 0x8D;
+  instruction[10] = 0x05;
+
+  result = _yr_re_jit_emit(jit, instruction, 11);
+
+  lea_offset = jit->buffer_used;
+  value = 0;
+
+  if (result == ERROR_SUCCESS)
+    result = _yr_re_jit_emit(jit, (uint8_t*) &value, sizeof(value));
+
+  if (result != ERROR_SUCCESS)
+    goto _exit;
+
+  instruction[0] = 0x48;
+  instruction[1] = 0x63;
+  instruction[2] = 0x0C;
+  instruction[3] = 0x88;
+  instruction[4] = 0x48;
+  instruction[5] = 0x01;
+  instruction[6] = 0xC8;
+  instruction[7] = 0xFF;
+  instruction[8] = 0xE0;
+
+  result = _yr_re_jit_emit(jit, instruction, 9);
+
+  if (result != ERROR_SUCCESS)
+    goto _exit;
+
+  for (i = 0; i < nfa->states_count; i++)
+  {
+    state_offsets[i] = jit->buffer_used;
+
+    result = _yr_re_jit_emit_state(
+        jit, nfa, i, flags, bitmap_offsets[i], loop_offset, done_offset);
+
+    if (result != ERROR_SUCCESS)
+      goto _exit;
+  }
+
+  // The table holds the offset of each state's code relative to the table
+  // itself.
+
+  result = _yr_re_jit_align(jit);
+
+  if (result != ERROR_SUCCESS)
+    goto _exit;
+
+  table_offset = jit->buffer_used;
+
+  value = (int32_t) (table_offset - (lea_offset + 4));
+  memcpy(jit->buffer + lea_offset, &value, sizeof(value));
+
+  for (i = 0; i < nfa->states_count; i++)
+  {
+    value = (int32_t) (state_offsets[i] - table_offset);
+    result = _yr_re_jit_emit(jit, (uint8_t*) &value, sizeof(value));
+
+    if (result != ERROR_SUCCESS)
+      goto _exit;
+  }
+
+  result = _yr_re_jit_add_entry(jit, code, entry_offset);
+
+  if (result == ERROR_SUCCESS)
+  {
+    entry = _yr_re_jit_find_entry(jit, code);
+    entry->prefilter = prefilter;
+    entry->start_offset = start_offset;
+    entry->start_count = start_count;
+    entry->states_count = nfa->states_count;
+    entry->match_state = nfa->match_state;
+  }
+
+_exit:
+
+  if (bitmap_offsets != NULL)
+    yr_free(bitmap_offsets);
+
+  if (state_offsets != NULL)
+    yr_free(state_offsets);
+
+  yr_free(nfa);
+
+  return result;
+}
+
+
+int _yr_re_jit_add_match(
+    YR_AC_MATCH* match,
+    void* args)
+{
+  RE_JIT* jit = (RE_JIT*) args;
+
+  int flags = 0;
+
+  // Hex strings without wildcards and literal regexps are turned into
+  // literals and have no code at all.
+
+  if (STRING_IS_LITERAL(match->string))
+    return ERROR_SUCCESS;
+
+  // Straight hex strings get a function comparing the input byte by byte.
+  // Those with jumps are left to _yr_scan_fast_hex_re_exec, which doesn't
+  // follow the semantics of yr_re_exec emulated by step functions.
+
+  if (STRING_IS_FAST_HEX_REGEXP(match->string))
+  {
+    FAIL_ON_ERROR(_yr_re_jit_compile_code(
+        jit, match->forward_code, FALSE));
+
+    if (match->backward_code != NULL)
+      FAIL_ON_ERROR(_yr_re_jit_compile_code(
+          jit, match->backward_code, TRUE));
+
+    return ERROR_SUCCESS;
+  }
+
+  if (STRING_IS_NO_CASE(match->string))
+    flags |= RE_FLAGS_NO_CASE;
+
+  if (STRING_IS_HEX(match->string))
+    flags |= RE_FLAGS_DOT_ALL;
+
+  FAIL_ON_ERROR(_yr_re_jit_compile_nfa(
+      jit, match->forward_code, flags));
+
+  if (match->backward_code != NULL)
+    FAIL_ON_ERROR(_yr_re_jit_compile_nfa(
+        jit, match->backward_code, flags));
+
+  return ERROR_SUCCESS;
+}
+
+
+//
+// _yr_re_jit_finalize
+//
+// Copies generated code into executable memory and resolves the function
+// pointer for each entry.
+//
+
+int _yr_re_jit_finalize(
+    RE_JIT* jit)
+{
+  RE_JIT_ENTRY* entry;
+
+  int i;
+
+  #ifdef WIN32
+  DWORD old_protect;
+  #endif
+
+  if (jit->buffer_used == 0)
+    return ERROR_SUCCESS;
+
+  #ifdef WIN32
+
+  jit->native_code = VirtualAlloc(
+      NULL,
+      jit->buffer_used,
+      MEM_COMMIT | MEM_RESERVE,
+      PAGE_READWRITE);
+
+  if (jit->native_code == NULL)
+    return ERROR_INSUFICIENT_MEMORY;
+
+  jit->native_code_size = jit->buffer_used;
+  memcpy(jit->native_code, jit->buffer, jit->buffer_used);
+
+  if (!VirtualProtect(
+          jit->native_code,
+          jit->native_code_size,
+          PAGE_EXECUTE_READ,
+          &old_protect))
+    return ERROR_INSUFICIENT_MEMORY;
+
+  #else
+
+  jit->native_code = mmap(
+      NULL,
+      jit->buffer_used,
+      PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS,
+      -1,
+      0);
+
+  if (jit->native_code == MAP_FAILED)
+  {
+    jit->native_code = NULL;
+    return ERROR_INSUFICIENT_MEMORY;
+  }
+
+  jit->native_code_size = jit->buffer_used;
+  memcpy(jit->native_code, jit->buffer, jit->buffer_used);
+
+  if (mprotect(
+          jit->native_code,
+          jit->native_code_size,
+          PROT_READ | PROT_EXEC) != 0)
+    return ERROR_INSUFICIENT_MEMORY;
+
+  #endif
+
+  for (i = 0; i < jit->entries_size; i++)
+  {
+    entry = &jit->entries[i];
+
+    if (entry->code == NULL)
+      continue;
+
+    if (entry->states_count > 0)
+    {
+      entry->step = (RE_JIT_STEP_FUNC) (jit->native_code + entry->offset);
+      entry->start = (uint16_t*) (jit->native_code + entry->start_offset);
+    }
+    else
+    {
+      entry->function = (RE_JIT_FUNC) (jit->native_code + entry->offset);
+    }
+  }
+
+  yr_free(jit->buffer);
+
+  jit->buffer = NULL;
+  jit->buffer_size = 0;
+  jit->buffer_used = 0;
+
+  return ERROR_SUCCESS;
+}
+
+#endif
+
+
+//
+// yr_re_jit_create
+//
+// Creates a RE_JIT object containing native code for every regexp and hex
+// string in the automaton that can be translated.
+//
+// Args:
+//    YR_AC_AUTOMATON* automaton  - Automaton containing the strings
+//    RE_JIT** jit                - Address of a pointer to RE_JIT object
+//                                  that will receive the new object.
+//
+// Returns:
+//    ERROR_SUCCESS if succeed or the corresponding error code otherwise.
+//
+
+int yr_re_jit_create(
+    YR_AC_AUTOMATON* automaton,
+    RE_JIT** jit)
+{
+  RE_JIT* new_jit;
+
+  int result = ERROR_SUCCESS;
+
+  new_jit = (RE_JIT*) yr_malloc(sizeof(RE_JIT));
+
+  if (new_jit == NULL)
+    return ERROR_INSUFICIENT_MEMORY;
+
+  memset(new_jit, 0, sizeof(RE_JIT));
+
+  #ifdef RE_JIT_ENABLED
+
+  result = yr_ac_walk_matches(automaton, _yr_re_jit_add_match, new_jit);
+
+  if (result == ERROR_SUCCESS)
+    result = _yr_re_jit_finalize(new_jit);
+
+  #endif
+
+  if (result != ERROR_SUCCESS)
+  {
+    yr_re_jit_destroy(new_jit);
+    return result;
+  }
+
+  *jit = new_jit;
+
+  return ERROR_SUCCESS;
+}
+
+
+//
+// yr_re_jit_destroy
+//
+// Destroys a RE_JIT object and releases its native code.
+//
+// Args:
+//    RE_JIT* jit  - Pointer to RE_JIT object
+//
+
+void yr_re_jit_destroy(
+    RE_JIT* jit)
+{
+  if (jit->native_code != NULL)
+  {
+    #ifdef WIN32
+    VirtualFree(jit->native_code, 0, MEM_RELEASE);
+    #else
+    munmap(jit->native_code, jit->native_code_size);
+    #endif
+  }
+
+  if (jit->buffer != NULL)
+    yr_free(jit->buffer);
+
+  if (jit->entries != NULL)
+    yr_free(jit->entries);
+
+  yr_free(jit);
+}
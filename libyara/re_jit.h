@@ -0,0 +1,130 @@
+/*
+Copyright (c) 2013. Victor M. Alvarez [plusvic@gmail.com].
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef _RE_JIT_H
+#define _RE_JIT_H
+
+#include "yara.h"
+#include "re.h"
+
+
+// Native code is only generated on x86-64. On any other architecture, or
+// when NO_RE_JIT is defined, yr_re_jit_create produces an empty JIT and
+// every lookup falls back to the bytecode interpreter.
+
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(NO_RE_JIT)
+#define RE_JIT_ENABLED
+#endif
+
+
+// Maximum number of states in regexp code translated by yr_re_jit_create.
+// Every instruction consuming input, and the final match, is a state.
+
+#define RE_JIT_MAX_STATES         256
+#define RE_JIT_MAX_INSTRUCTIONS   512
+
+
+// Execution threads alive at the current input position, as seen by the
+// native code generated for a regexp. Lists contain state numbers.
+
+typedef struct _RE_JIT_THREADS
+{
+  uint16_t* current;
+  uint16_t* current_end;
+  uint16_t* next;
+  uint32_t* marks;
+  uint32_t mark;
+  int32_t stop_at_match;
+  int32_t matched;
+
+} RE_JIT_THREADS;
+
+
+// Native code for straight hex strings, returns the match length or -1.
+
+typedef int (*RE_JIT_FUNC)(
+    uint8_t* input,
+    size_t input_size);
+
+
+// Native code for any other regexp, steps every thread in the current list
+// over a character and returns the number of threads in the next list.
+
+typedef int (*RE_JIT_STEP_FUNC)(
+    RE_JIT_THREADS* threads,
+    int character);
+
+
+typedef struct _RE_JIT_ENTRY
+{
+  uint8_t* code;
+  size_t offset;
+
+  RE_JIT_FUNC function;
+  RE_JIT_STEP_FUNC step;
+
+  RE_PREFILTER* prefilter;
+
+  size_t start_offset;
+  uint16_t* start;
+  int start_count;
+  int states_count;
+  int match_state;
+
+} RE_JIT_ENTRY;
+
+
+typedef struct _RE_JIT
+{
+  uint8_t* buffer;
+  size_t buffer_size;
+  size_t buffer_used;
+
+  uint8_t* native_code;
+  size_t native_code_size;
+
+  RE_JIT_ENTRY* entries;
+  int entries_size;
+  int entries_count;
+
+} RE_JIT;
+
+
+int yr_re_jit_create(
+    YR_AC_AUTOMATON* automaton,
+    RE_JIT** jit);
+
+
+void yr_re_jit_destroy(
+    RE_JIT* jit);
+
+
+RE_JIT_ENTRY* yr_re_jit_lookup(
+    RE_JIT* jit,
+    uint8_t* code);
+
+
+int yr_re_jit_exec(
+    RE_JIT_ENTRY* entry,
+    uint8_t* input,
+    size_t input_size,
+    int flags,
+    YR_RE_LIMITS* limits,
+    YR_RE_STATS* stats,
+    RE_MATCH_CALLBACK_FUNC callback,
+    void* callback_args);
+
+#endif
@@ -15,6 +15,8 @@ limitations under the License.
 */
 
 #include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <ctype.h>
@@ -27,10 +29,42 @@ limitations under the License.
 #include "mem.h"
 #include "proc.h"
 #include "re.h"
+#include "re_jit.h"
 #include "utils.h"
 #include "yara.h"
 
 
+#ifndef min
+#define min(x, y)  ((x < y) ? (x) : (y))
+#endif
+
+// Memory blocks are scanned in parallel only if each thread gets a chunk
+// of at least this size.
+
+#define PARALLEL_SCAN_MIN_CHUNK_SIZE  (1024 * 1024)
+
+// Number of bytes scanned between checks for cancellation, timeout and
+// progress. Small enough for a fine-grained timeout, large enough for the
+// checks to be negligible.
+#define SCAN_CHECK_INTERVAL  (64 * 1024)
+
+// Scan contexts and chunks used by different threads are padded with this
+// many bytes, so the counters and flags updated by one thread don't share
+// a cache line with those of another one.
+
+#define CACHE_LINE_SIZE  64
+
+#ifdef WIN32
+#define memory_barrier()  MemoryBarrier()
+#define atomic_add(ptr, value) \
+    InterlockedExchangeAdd64((volatile LONGLONG*) (ptr), (LONGLONG) (value))
+#else
+#define memory_barrier()  __sync_synchronize()
+#define atomic_add(ptr, value) \
+    __sync_fetch_and_add(ptr, value)
+#endif
+
+
 typedef struct _CALLBACK_ARGS
 {
   YR_STRING* string;
@@ -39,11 +73,63 @@ typedef struct _CALLBACK_ARGS
   uint8_t* data;
   int data_size;
   int full_word;
-  int tidx;
+  YR_SCAN_CONTEXT* context;
 
 } CALLBACK_ARGS;
 
 
+// Matches found by threads scanning chunks of a block in parallel are
+// logged and added to the scan context when all of them have finished,
+// in the same order a single thread would have found them. That keeps the
+// lists of matches exactly as if the block had been scanned at once.
+
+typedef struct _MATCH_LOG_ENTRY
+{
+  YR_STRING* string;
+  uint8_t* match_data;
+  size_t match_offset;
+  int match_length;
+
+} MATCH_LOG_ENTRY;
+
+
+typedef struct _MATCH_LOG
+{
+  MATCH_LOG_ENTRY* entries;
+  int count;
+  int size;
+  int result;
+
+} MATCH_LOG;
+
+
+typedef struct _SCAN_CHUNK
+{
+  YR_SCAN_CONTEXT context;
+  MATCH_LOG match_log;
+
+  uint8_t* data;
+  size_t data_size;
+  size_t start;
+  size_t end;
+
+  int fast_scan_mode;
+  int unsatisfied_namespaces;
+  int result;
+
+  #ifdef WIN32
+  HANDLE thread;
+  #else
+  pthread_t thread;
+  #endif
+
+  int thread_created;
+
+  uint8_t padding[CACHE_LINE_SIZE];
+
+} SCAN_CHUNK;
+
+
 #define inline
 
 inline int _yr_scan_compare(
@@ -134,6 +220,257 @@ inline int _yr_scan_wicompare(
 }
 
 
+//
+// _yr_scan_fast_hex_re_exec_exhaustive
+//
+// Finds every match for a fast hex regexp in a single pass over the code.
+// Instead of exploring each path through the jumps independently, the set
+// of input positions reachable after executing each instruction is kept
+// as a bit vector. Literals filter the set, wildcards shift it by one and
+// jumps [n-m] are the union of the set shifted by every value in [0, m-n],
+// computed with a logarithmic number of shifts. When the MATCH instruction
+// is reached every position in the set is a distinct match, so each one is
+// reported once no matter how many paths lead to it.
+//
+
+#define FAST_HEX_RE_SET_WORDS 64
+
+#define _yr_set_bit(set, n) \
+    set[(n) / 64] |= ((uint64_t) 1) << ((n) % 64)
+
+
+void _yr_scan_set_shift_or(
+    uint64_t* set,
+    int words,
+    size_t shift)
+{
+  size_t word_shift = shift / 64;
+  int bit_shift = shift % 64;
+  int j;
+
+  uint64_t value;
+
+  // Words are processed from the highest to the lowest one, this way
+  // source words are read before being updated.
+
+  for (j = words - 1; j >= (int) word_shift; j--)
+  {
+    value = set[j - word_shift] << bit_shift;
+
+    if (bit_shift > 0 && j - (int) word_shift > 0)
+      value |= set[j - word_shift - 1] >> (64 - bit_shift);
+
+    set[j] |= value;
+  }
+}
+
+
+void _yr_scan_set_truncate(
+    uint64_t* set,
+    int words,
+    size_t size)
+{
+  int j;
+
+  if (size >= (size_t) words * 64)
+    return;
+
+  set[size / 64] &= (((uint64_t) 1) << (size % 64)) - 1;
+
+  for (j = (int) (size / 64) + 1; j < words; j++)
+    set[j] = 0;
+}
+
+
+int _yr_scan_fast_hex_re_exec_exhaustive(
+    uint8_t* code,
+    uint8_t* input,
+    size_t input_size,
+    int flags,
+    RE_MATCH_CALLBACK_FUNC callback,
+    void* callback_args)
+{
+  uint64_t local_sets[2][FAST_HEX_RE_SET_WORDS];
+  uint64_t* sets = NULL;
+  uint64_t* current;
+  uint64_t* next;
+  uint64_t* temp;
+  uint64_t word;
+
+  uint8_t* ip;
+  uint8_t mask;
+  uint8_t value;
+
+  size_t max_length = 0;
+  size_t range;
+  size_t shift;
+  size_t d;
+
+  int words;
+  int increment;
+  int bit;
+  int j;
+  int result = -1;
+
+  increment = flags & RE_FLAGS_BACKWARDS ? -1 : 1;
+
+  for (ip = code; *ip != RE_OPCODE_MATCH;)
+  {
+    switch(*ip)
+    {
+      case RE_OPCODE_LITERAL:
+        max_length++;
+        ip += 2;
+        break;
+      case RE_OPCODE_MASKED_LITERAL:
+        max_length++;
+        ip += 3;
+        break;
+      case RE_OPCODE_ANY:
+        max_length++;
+        ip += 1;
+        break;
+      case RE_OPCODE_PUSH:
+        max_length += *(uint16_t*)(ip + 1);
+        ip += 11;
+        break;
+      default:
+        assert(FALSE);
+    }
+  }
+
+  // Positions go from 0 to max_length, but positions beyond input_size
+  // can't be reached.
+
+  words = (int) (min(max_length, input_size) / 64) + 1;
+
+  if (words <= FAST_HEX_RE_SET_WORDS)
+  {
+    current = local_sets[0];
+    next = local_sets[1];
+  }
+  else
+  {
+    sets = (uint64_t*) yr_malloc(2 * words * sizeof(uint64_t));
+
+    if (sets == NULL)
+      return -1;
+
+    current = sets;
+    next = sets + words;
+  }
+
+  memset(current, 0, words * sizeof(uint64_t));
+  current[0] = 1;
+
+  ip = code;
+
+  while (*ip != RE_OPCODE_MATCH)
+  {
+    // Instructions other than MATCH need at least one more byte of input.
+    _yr_scan_set_truncate(current, words, input_size);
+
+    switch(*ip)
+    {
+      case RE_OPCODE_LITERAL:
+      case RE_OPCODE_MASKED_LITERAL:
+
+        if (*ip == RE_OPCODE_LITERAL)
+        {
+          value = *(ip + 1);
+          mask = 0xFF;
+          ip += 2;
+        }
+        else
+        {
+          value = *(int16_t*)(ip + 1) & 0xFF;
+          mask = *(int16_t*)(ip + 1) >> 8;
+          ip += 3;
+        }
+
+        memset(next, 0, words * sizeof(uint64_t));
+
+        for (j = 0; j < words; j++)
+        {
+          word = current[j];
+
+          for (bit = 0; word != 0; bit++, word >>= 1)
+          {
+            if (!(word & 1))
+              continue;
+
+            d = (size_t) j * 64 + bit;
+
+            if ((input[increment * (ptrdiff_t) d] & mask) == value)
+              _yr_set_bit(next, d + 1);
+          }
+        }
+
+        temp = current;
+        current = next;
+        next = temp;
+        break;
+
+      case RE_OPCODE_ANY:
+        for (j = words - 1; j > 0; j--)
+          current[j] = (current[j] << 1) | (current[j - 1] >> 63);
+
+        current[0] <<= 1;
+        ip += 1;
+        break;
+
+      case RE_OPCODE_PUSH:
+        range = *(uint16_t*)(ip + 1);
+        shift = 1;
+
+        // After each step the set contains the original positions shifted
+        // by every value in [0, shift - 1].
+
+        while (shift * 2 <= range + 1)
+        {
+          _yr_scan_set_shift_or(current, words, shift);
+          shift *= 2;
+        }
+
+        if (shift < range + 1)
+          _yr_scan_set_shift_or(current, words, range + 1 - shift);
+
+        ip += 11;
+        break;
+
+      default:
+        assert(FALSE);
+    }
+  }
+
+  for (j = 0; j < words; j++)
+  {
+    word = current[j];
+
+    for (bit = 0; word != 0; bit++, word >>= 1)
+    {
+      if (!(word & 1))
+        continue;
+
+      d = (size_t) j * 64 + bit;
+
+      callback(
+          flags & RE_FLAGS_BACKWARDS ? input - d + 1 : input,
+          (int) d,
+          flags,
+          callback_args);
+
+      result = (int) d;
+    }
+  }
+
+  if (sets != NULL)
+    yr_free(sets);
+
+  return result;
+}
+
+
 //
 // _yr_scan_fast_hex_re_exec
 //
@@ -152,6 +489,9 @@ inline int _yr_scan_wicompare(
 // characteristics of the code generated for this kind of strings and do the
 // matching in a faster way.
 //
+// Scan limit and cost budget are not enforced here, jumps in hex strings
+// have bounded length so the cost of the matching is bounded too.
+//
 
 #define MAX_FAST_HEX_RE_STACK 200
 
@@ -160,6 +500,8 @@ int _yr_scan_fast_hex_re_exec(
     uint8_t* input,
     size_t input_size,
     int flags,
+    YR_RE_LIMITS* limits,
+    YR_RE_STATS* stats,
     RE_MATCH_CALLBACK_FUNC callback,
     void* callback_args)
 {
@@ -167,6 +509,8 @@ int _yr_scan_fast_hex_re_exec(
   uint8_t* input_stack[MAX_FAST_HEX_RE_STACK];
   int matches_stack[MAX_FAST_HEX_RE_STACK];
 
+  RE_PREFILTER* prefilter;
+
   int sp = 0;
 
   uint8_t* ip = code;
@@ -182,6 +526,26 @@ int _yr_scan_fast_hex_re_exec(
 
   increment = flags & RE_FLAGS_BACKWARDS ? -1 : 1;
 
+  if (*code == RE_OPCODE_PREFILTER)
+  {
+    prefilter = (RE_PREFILTER*) (code + 1);
+    code += RE_PREFILTER_INSTRUCTION_SIZE;
+
+    if (!(flags & RE_FLAGS_BACKWARDS) &&
+        input_size > 0 &&
+        !CHAR_IN_CLASS(*input, prefilter->first_bytes))
+      return -1;
+  }
+
+  if (flags & RE_FLAGS_EXHAUSTIVE)
+    return _yr_scan_fast_hex_re_exec_exhaustive(
+        code,
+        input,
+        input_size,
+        flags,
+        callback,
+        callback_args);
+
   code_stack[sp] = code;
   input_stack[sp] = input;
   matches_stack[sp] = 0;
@@ -300,72 +664,37 @@ int _yr_scan_fast_hex_re_exec(
   return -1;
 }
 
-void match_callback(
+//
+// _yr_scan_add_match
+//
+// Adds a match to the list of matches of the string, unless it's already
+// there. Consecutive matches of the same length are kept together as a
+// single YR_MATCH.
+//
+
+void _yr_scan_add_match(
+    YR_SCAN_CONTEXT* context,
+    YR_STRING* string,
+    YR_ARENA* matches_arena,
     uint8_t* match_data,
-    int match_length,
-    int flags,
-    void* args)
+    size_t match_offset,
+    int match_length)
 {
   YR_MATCH* new_match;
   YR_MATCH* match;
+  YR_MATCHES* matches = &context->matches[string->idx];
+  uint64_t bit = (uint64_t) 1 << (string->idx % 64);
 
-  CALLBACK_ARGS* callback_args = args;
-  YR_STRING* string = callback_args->string;
-
-  int character_size;
-  int tidx = callback_args->tidx;
-
-  size_t match_offset = match_data - callback_args->data;
-
-  if (flags & RE_FLAGS_WIDE)
-    character_size = 2;
-  else
-    character_size = 1;
-
-  // match_length > 0 means that we have found some backward matching
-  // but backward matching overlaps one character with forward matching,
-  // we decrement match_length here to compensate that overlapping.
-
-  if (match_length > 0)
-    match_length -= character_size;
-
-  // total match length is the sum of backward and forward matches.
-  match_length = match_length + callback_args->forward_matches;
-
-  if (flags & RE_FLAGS_START_ANCHORED && match_offset > 0)
-    return;
-
-  if (flags & RE_FLAGS_END_ANCHORED &&
-      match_offset + match_length != callback_args->data_size)
-    return;
-
-  if (callback_args->full_word)
-  {
-    if (flags & RE_FLAGS_WIDE)
-    {
-      if (match_offset >= 2 &&
-          *(match_data - 1) == 0 &&
-          isalnum(*(match_data - 2)))
-        return;
+  if (context->rules_flags[string->rule->idx] == 0)
+    context->dirty_rules[context->dirty_rules_count++] = string->rule->idx;
 
-      if (match_offset + match_length + 1 < callback_args->data_size &&
-          *(match_data + match_length + 1) == 0 &&
-          isalnum(*(match_data + match_length)))
-        return;
-    }
-    else
-    {
-      if (match_offset >= 1 &&
-          isalnum(*(match_data - 1)))
-        return;
+  if (!(context->matched_strings[string->idx / 64] & bit))
+    context->dirty_strings[context->dirty_strings_count++] = string->idx;
 
-      if (match_offset + match_length < callback_args->data_size &&
-          isalnum(*(match_data + match_length)))
-        return;
-    }
-  }
+  context->rules_flags[string->rule->idx] |= RULE_TFLAGS_DIRTY;
+  context->matched_strings[string->idx / 64] |= bit;
 
-  match = string->matches[tidx].tail;
+  match = matches->tail;
 
   while (match != NULL)
   {
@@ -380,12 +709,14 @@ void match_callback(
       if (match_offset == match->last_offset + 1)
       {
         match->last_offset++;
+        matches->count++;
         return;
       }
 
       if (match_offset == match->first_offset - 1)
       {
         match->first_offset--;
+        matches->count++;
         return;
       }
     }
@@ -397,7 +728,7 @@ void match_callback(
   }
 
   yr_arena_allocate_memory(
-      callback_args->matches_arena,
+      matches_arena,
       sizeof(YR_MATCH),
       (void**) &new_match);
 
@@ -412,87 +743,259 @@ void match_callback(
   }
   else
   {
-    new_match->next = string->matches[tidx].head;
-    string->matches[tidx].head = new_match;
+    new_match->next = matches->head;
+    matches->head = new_match;
   }
 
   if (new_match->next != NULL)
     new_match->next->prev = new_match;
   else
-    string->matches[tidx].tail = new_match;
+    matches->tail = new_match;
+
+  matches->count++;
 
   new_match->prev = match;
   //TODO: handle errors
   yr_arena_write_data(
-      callback_args->matches_arena,
+      matches_arena,
       match_data,
       match_length,
       (void**) &new_match->data);
 }
 
 
+//
+// _yr_scan_log_match
+//
+// Logs a match found while scanning a chunk of a block in parallel with
+// other threads, it's added to the matches of the string later.
+//
 
-typedef int (*RE_EXEC_FUNC)(
-    uint8_t* code,
-    uint8_t* input,
-    size_t input_size,
-    int flags,
-    RE_MATCH_CALLBACK_FUNC callback,
-    void* callback_args);
-
-
-int _yr_scan_verify_re_match(
-    YR_AC_MATCH* ac_match,
-    uint8_t* data,
-    size_t data_size,
-    size_t offset,
-    YR_ARENA* matches_arena)
+void _yr_scan_log_match(
+    MATCH_LOG* log,
+    YR_STRING* string,
+    uint8_t* match_data,
+    size_t match_offset,
+    int match_length)
 {
-  CALLBACK_ARGS callback_args;
-  RE_EXEC_FUNC exec;
-
-  int forward_matches = -1;
-  int flags = 0;
-
-  if (STRING_IS_FAST_HEX_REGEXP(ac_match->string))
-    exec = _yr_scan_fast_hex_re_exec;
-  else
-    exec = yr_re_exec;
+  MATCH_LOG_ENTRY* entries;
+  MATCH_LOG_ENTRY* entry;
 
-  if (STRING_IS_START_ANCHORED(ac_match->string))
-    flags |= RE_FLAGS_START_ANCHORED;
+  if (log->count == log->size)
+  {
+    entries = (MATCH_LOG_ENTRY*) yr_realloc(
+        log->entries,
+        (log->size * 2 + 64) * sizeof(MATCH_LOG_ENTRY));
 
-  if (STRING_IS_END_ANCHORED(ac_match->string))
-    flags |= RE_FLAGS_END_ANCHORED;
+    if (entries == NULL)
+    {
+      log->result = ERROR_INSUFICIENT_MEMORY;
+      return;
+    }
 
-  if (STRING_IS_NO_CASE(ac_match->string))
-    flags |= RE_FLAGS_NO_CASE;
+    log->entries = entries;
+    log->size = log->size * 2 + 64;
+  }
 
-  if (STRING_IS_HEX(ac_match->string))
-    flags |= RE_FLAGS_DOT_ALL;
+  entry = &log->entries[log->count++];
+  entry->string = string;
+  entry->match_data = match_data;
+  entry->match_offset = match_offset;
+  entry->match_length = match_length;
+}
 
-  if (STRING_IS_ASCII(ac_match->string))
-  {
-    forward_matches = exec(
-        ac_match->forward_code,
-        data + offset,
-        data_size - offset,
-        flags,
-        NULL,
-        NULL);
-  }
 
-  if (STRING_IS_WIDE(ac_match->string) &&
-      forward_matches < 0)
+void match_callback(
+    uint8_t* match_data,
+    int match_length,
+    int flags,
+    void* args)
+{
+  CALLBACK_ARGS* callback_args = args;
+  YR_STRING* string = callback_args->string;
+  YR_SCAN_CONTEXT* context = callback_args->context;
+
+  int character_size;
+
+  size_t match_offset = match_data - callback_args->data;
+
+  if (flags & RE_FLAGS_WIDE)
+    character_size = 2;
+  else
+    character_size = 1;
+
+  // match_length > 0 means that we have found some backward matching
+  // but backward matching overlaps one character with forward matching,
+  // we decrement match_length here to compensate that overlapping.
+
+  if (match_length > 0)
+    match_length -= character_size;
+
+  // total match length is the sum of backward and forward matches.
+  match_length = match_length + callback_args->forward_matches;
+
+  if (flags & RE_FLAGS_START_ANCHORED && match_offset > 0)
+    return;
+
+  if (flags & RE_FLAGS_END_ANCHORED &&
+      match_offset + match_length != callback_args->data_size)
+    return;
+
+  if (callback_args->full_word)
+  {
+    if (flags & RE_FLAGS_WIDE)
+    {
+      if (match_offset >= 2 &&
+          *(match_data - 1) == 0 &&
+          isalnum(*(match_data - 2)))
+        return;
+
+      if (match_offset + match_length + 1 < callback_args->data_size &&
+          *(match_data + match_length + 1) == 0 &&
+          isalnum(*(match_data + match_length)))
+        return;
+    }
+    else
+    {
+      if (match_offset >= 1 &&
+          isalnum(*(match_data - 1)))
+        return;
+
+      if (match_offset + match_length < callback_args->data_size &&
+          isalnum(*(match_data + match_length)))
+        return;
+    }
+  }
+
+  if (context->match_log != NULL)
+    _yr_scan_log_match(
+        context->match_log,
+        string,
+        match_data,
+        match_offset,
+        match_length);
+  else
+    _yr_scan_add_match(
+        context,
+        string,
+        callback_args->matches_arena,
+        match_data,
+        match_offset,
+        match_length);
+}
+
+
+typedef int (*RE_EXEC_FUNC)(
+    uint8_t* code,
+    uint8_t* input,
+    size_t input_size,
+    int flags,
+    YR_RE_LIMITS* limits,
+    YR_RE_STATS* stats,
+    RE_MATCH_CALLBACK_FUNC callback,
+    void* callback_args);
+
+
+int _yr_scan_verify_re_match(
+    YR_AC_MATCH* ac_match,
+    YR_SCAN_CONTEXT* context,
+    uint8_t* data,
+    size_t data_size,
+    size_t offset,
+    YR_ARENA* matches_arena)
+{
+  CALLBACK_ARGS callback_args;
+  RE_EXEC_FUNC exec;
+  RE_JIT_ENTRY* jit_entry;
+  YR_RE_STATS* stats = &context->re_stats;
+  YR_RE_LIMITS* limits;
+  YR_RULES* rules = context->rules;
+
+  int forward_matches = -1;
+  int flags = 0;
+
+  if (STRING_IS_FAST_HEX_REGEXP(ac_match->string))
+    exec = _yr_scan_fast_hex_re_exec;
+  else
+    exec = yr_re_exec;
+
+  if (STRING_IS_START_ANCHORED(ac_match->string))
+    flags |= RE_FLAGS_START_ANCHORED;
+
+  if (STRING_IS_END_ANCHORED(ac_match->string))
+    flags |= RE_FLAGS_END_ANCHORED;
+
+  if (STRING_IS_NO_CASE(ac_match->string))
+    flags |= RE_FLAGS_NO_CASE;
+
+  if (STRING_IS_HEX(ac_match->string))
+    flags |= RE_FLAGS_DOT_ALL;
+
+  limits = &rules->re_limits;
+
+  if (rules->strings_re_limits != NULL &&
+      rules->strings_re_limits[ac_match->string->idx].scan_limit > 0)
+    limits = &rules->strings_re_limits[ac_match->string->idx];
+
+  // Strings declared both ascii and wide are verified as ASCII first even
+  // when the atom found is a wide one, see _yr_scan_verify_literal_match.
+
+  if (ac_match->flags & STRING_GFLAGS_ASCII ||
+      STRING_IS_ASCII(ac_match->string))
+  {
+    jit_entry = yr_re_jit_lookup(rules->re_jit, ac_match->forward_code);
+
+    if (jit_entry != NULL)
+      forward_matches = yr_re_jit_exec(
+          jit_entry,
+          data + offset,
+          data_size - offset,
+          flags,
+          limits,
+          stats,
+          NULL,
+          NULL);
+    else
+      forward_matches = exec(
+          ac_match->forward_code,
+          data + offset,
+          data_size - offset,
+          flags,
+          limits,
+          stats,
+          NULL,
+          NULL);
+
+    if (!(ac_match->flags & STRING_GFLAGS_ASCII) && forward_matches >= 0)
+      return ERROR_SUCCESS;
+  }
+
+  if (ac_match->flags & STRING_GFLAGS_WIDE &&
+      forward_matches < 0)
   {
     flags |= RE_FLAGS_WIDE;
-    forward_matches = exec(
-        ac_match->forward_code,
-        data + offset,
-        data_size - offset,
-        flags,
-        NULL,
-        NULL);
+    jit_entry = yr_re_jit_lookup(rules->re_jit, ac_match->forward_code);
+
+    if (jit_entry != NULL)
+      forward_matches = yr_re_jit_exec(
+          jit_entry,
+          data + offset,
+          data_size - offset,
+          flags,
+          limits,
+          stats,
+          NULL,
+          NULL);
+    else
+      forward_matches = exec(
+          ac_match->forward_code,
+          data + offset,
+          data_size - offset,
+          flags,
+          limits,
+          stats,
+          NULL,
+          NULL);
   }
 
   if (forward_matches < 0)
@@ -507,17 +1010,33 @@ int _yr_scan_verify_re_match(
   callback_args.matches_arena = matches_arena;
   callback_args.forward_matches = forward_matches;
   callback_args.full_word = STRING_IS_FULL_WORD(ac_match->string);
-  callback_args.tidx = yr_get_tidx();
+  callback_args.context = context;
 
   if (ac_match->backward_code != NULL)
   {
-    exec(
-        ac_match->backward_code,
-        data + offset,
-        offset + 1,
-        flags | RE_FLAGS_BACKWARDS | RE_FLAGS_EXHAUSTIVE,
-        match_callback,
-        (void*) &callback_args);
+    flags |= RE_FLAGS_BACKWARDS | RE_FLAGS_EXHAUSTIVE;
+    jit_entry = yr_re_jit_lookup(rules->re_jit, ac_match->backward_code);
+
+    if (jit_entry != NULL)
+      yr_re_jit_exec(
+          jit_entry,
+          data + offset,
+          offset + 1,
+          flags,
+          limits,
+          stats,
+          match_callback,
+          (void*) &callback_args);
+    else
+      exec(
+          ac_match->backward_code,
+          data + offset,
+          offset + 1,
+          flags,
+          limits,
+          stats,
+          match_callback,
+          (void*) &callback_args);
   }
   else
   {
@@ -531,6 +1050,7 @@ int _yr_scan_verify_re_match(
 
 int _yr_scan_verify_literal_match(
     YR_AC_MATCH* ac_match,
+    YR_SCAN_CONTEXT* context,
     uint8_t* data,
     size_t data_size,
     size_t offset,
@@ -542,18 +1062,46 @@ int _yr_scan_verify_literal_match(
   CALLBACK_ARGS callback_args;
   YR_STRING* string = ac_match->string;
 
+  // A wide atom can be found at an offset where a string declared both
+  // ascii and wide matches as ASCII. The ASCII match takes precedence and
+  // it's recorded when its own atom is verified, so nothing is done here.
+
+  if (!(ac_match->flags & STRING_GFLAGS_ASCII) && STRING_IS_ASCII(string))
+  {
+    if (STRING_IS_NO_CASE(string))
+      forward_matches = _yr_scan_icompare(
+          data + offset,
+          data_size - offset,
+          string->string,
+          string->length);
+    else
+      forward_matches = _yr_scan_compare(
+          data + offset,
+          data_size - offset,
+          string->string,
+          string->length);
+
+    if (forward_matches > 0)
+      return ERROR_SUCCESS;
+  }
+
   if (STRING_FITS_IN_ATOM(string))
   {
-    if (STRING_IS_WIDE(string))
+    if (ac_match->flags & STRING_GFLAGS_WIDE)
+    {
+      flags |= RE_FLAGS_WIDE;
       forward_matches = string->length * 2;
+    }
     else
+    {
       forward_matches = string->length;
+    }
   }
   else if (STRING_IS_NO_CASE(string))
   {
     flags |= RE_FLAGS_NO_CASE;
 
-    if (STRING_IS_ASCII(string))
+    if (ac_match->flags & STRING_GFLAGS_ASCII)
     {
       forward_matches = _yr_scan_icompare(
           data + offset,
@@ -562,7 +1110,7 @@ int _yr_scan_verify_literal_match(
           string->length);
     }
 
-    if (STRING_IS_WIDE(string) && forward_matches == 0)
+    if (ac_match->flags & STRING_GFLAGS_WIDE && forward_matches == 0)
     {
       flags |= RE_FLAGS_WIDE;
       forward_matches = _yr_scan_wicompare(
@@ -574,7 +1122,7 @@ int _yr_scan_verify_literal_match(
   }
   else
   {
-    if (STRING_IS_ASCII(string))
+    if (ac_match->flags & STRING_GFLAGS_ASCII)
     {
       forward_matches = _yr_scan_compare(
           data + offset,
@@ -583,7 +1131,7 @@ int _yr_scan_verify_literal_match(
           string->length);
     }
 
-    if (STRING_IS_WIDE(string) && forward_matches == 0)
+    if (ac_match->flags & STRING_GFLAGS_WIDE && forward_matches == 0)
     {
       flags |= RE_FLAGS_WIDE;
       forward_matches = _yr_scan_wcompare(
@@ -634,7 +1182,7 @@ int _yr_scan_verify_literal_match(
     callback_args.matches_arena = matches_arena;
     callback_args.forward_matches = forward_matches;
     callback_args.full_word = STRING_IS_FULL_WORD(string);
-    callback_args.tidx = yr_get_tidx();
+    callback_args.context = context;
 
     match_callback(
         data + offset, 0, flags, &callback_args);
@@ -644,30 +1192,67 @@ int _yr_scan_verify_literal_match(
 }
 
 
+//
+// _yr_scan_matches_count
+//
+// Returns the number of matches found so far for the string, or the number
+// of matches logged for all strings while scanning a chunk of a block.
+// Only the difference between two calls is meaningful.
+//
+
+inline int32_t _yr_scan_matches_count(
+    YR_SCAN_CONTEXT* context,
+    YR_STRING* string)
+{
+  if (context->match_log != NULL)
+    return context->match_log->count;
+
+  return context->matches[string->idx].count;
+}
+
+
 inline int _yr_scan_verify_match(
     YR_AC_MATCH* ac_match,
+    YR_SCAN_CONTEXT* context,
     uint8_t* data,
     size_t data_size,
     size_t offset,
     YR_ARENA* matches_arena)
 {
   YR_STRING* string = ac_match->string;
+  YR_STRING_PROFILE* string_profile;
+  YR_PROFILING_INFO* profiling_info = context->profiling_info;
+
+  uint64_t start_clock;
+  int32_t matches_count;
+  int result;
 
   if (data_size - offset <= 0)
     return ERROR_SUCCESS;
 
-  if (STRING_IS_LITERAL(string))
+  if (profiling_info != NULL)
   {
-    FAIL_ON_ERROR(_yr_scan_verify_literal_match(
-        ac_match, data, data_size, offset, matches_arena));
+    matches_count = _yr_scan_matches_count(context, string);
+    start_clock = PROFILING_CLOCK();
   }
+
+  if (STRING_IS_LITERAL(string))
+    result = _yr_scan_verify_literal_match(
+        ac_match, context, data, data_size, offset, matches_arena);
   else
+    result = _yr_scan_verify_re_match(
+        ac_match, context, data, data_size, offset, matches_arena);
+
+  if (profiling_info != NULL)
   {
-    FAIL_ON_ERROR(_yr_scan_verify_re_match(
-        ac_match, data, data_size, offset, matches_arena));
+    string_profile = STRING_PROFILE(profiling_info, string);
+    string_profile->cycles += PROFILING_CLOCK() - start_clock;
+    string_profile->verifications++;
+    string_profile->matches +=
+        _yr_scan_matches_count(context, string) - matches_count;
   }
 
-  return ERROR_SUCCESS;
+  return result;
 }
 
 
@@ -766,109 +1351,878 @@ int yr_rules_define_string_variable(
 }
 
 
-void _yr_rules_clean_matches(
-    YR_RULES* rules)
-{
-  YR_RULE* rule;
-  YR_STRING* string;
-
-  int tidx = yr_get_tidx();
+//
+// yr_rules_get_variable_index
+//
+// Returns the index of the external variable with the given identifier, to
+// be used with yr_scan_context_set_*_variable, or -1 if the variable is not
+// defined in the rules.
+//
 
-  rule = rules->rules_list_head;
+int yr_rules_get_variable_index(
+    YR_RULES* rules,
+    const char* identifier)
+{
+  int i;
 
-  while (!RULE_IS_NULL(rule))
+  for (i = 0; i < rules->externals_count; i++)
   {
-    rule->t_flags[tidx] &= ~RULE_TFLAGS_MATCH;
-    rule->ns->t_flags[tidx] &= ~NAMESPACE_TFLAGS_UNSATISFIED_GLOBAL;
-    string = rule->strings;
-
-    while (!STRING_IS_NULL(string))
-    {
-      string->matches[tidx].head = NULL;
-      string->matches[tidx].tail = NULL;
-      string++;
-    }
-
-    rule++;
+    if (strcmp(rules->externals_list_head[i].identifier, identifier) == 0)
+      return i;
   }
+
+  return -1;
 }
 
 
-int yr_rules_scan_mem_block(
+//
+// yr_rules_set_re_limits
+//
+// Sets the maximum number of bytes examined by a single regexp execution
+// and the maximum cost it's allowed to incur. The cost is measured as the
+// number of execution threads stepped over the input, a zero budget means
+// no limit. Executions cut short by any of these limits are accounted in
+// the stats returned by yr_rules_get_re_stats.
+//
+
+void yr_rules_set_re_limits(
     YR_RULES* rules,
-    uint8_t* data,
-    size_t data_size,
-    int fast_scan_mode,
-    int timeout,
-    time_t start_time,
-    YR_ARENA* matches_arena)
+    size_t scan_limit,
+    uint32_t cost_budget)
 {
-  YR_AC_STATE* next_state;
-  YR_AC_MATCH* ac_match;
-  YR_AC_STATE* current_state;
+  rules->re_limits.scan_limit = scan_limit;
+  rules->re_limits.cost_budget = cost_budget;
+}
 
-  time_t current_time;
-  size_t offset;
-  size_t i;
 
-  int tidx = yr_get_tidx();
+//
+// yr_rules_set_string_re_limits
+//
+// Sets the scan limit and cost budget for the executions of a given string,
+// overriding those set with yr_rules_set_re_limits. A zero scan limit makes
+// the string use the rules' limits again. Limits must not be changed while
+// scanning.
+//
 
-  current_state = rules->automaton->root;
-  i = 0;
+int yr_rules_set_string_re_limits(
+    YR_RULES* rules,
+    YR_STRING* string,
+    size_t scan_limit,
+    uint32_t cost_budget)
+{
+  size_t size = rules->strings_count * sizeof(YR_RE_LIMITS);
 
-  while (i < data_size)
+  if (rules->strings_re_limits == NULL)
   {
-    ac_match = current_state->matches;
+    if (scan_limit == 0)
+      return ERROR_SUCCESS;
 
-    while (ac_match != NULL)
-    {
-      if (ac_match->backtrack <= i)
-      {
-        offset = i - ac_match->backtrack;
+    rules->strings_re_limits = (YR_RE_LIMITS*) yr_malloc(size);
 
-        _yr_scan_verify_match(
-              ac_match,
-              data,
-              data_size,
-              offset,
-              matches_arena);
-      }
+    if (rules->strings_re_limits == NULL)
+      return ERROR_INSUFICIENT_MEMORY;
 
-      ac_match = ac_match->next;
-    }
+    memset(rules->strings_re_limits, 0, size);
+  }
 
-    next_state = yr_ac_next_state(current_state, data[i]);
+  rules->strings_re_limits[string->idx].scan_limit = scan_limit;
+  rules->strings_re_limits[string->idx].cost_budget = cost_budget;
 
-    while (next_state == NULL && current_state->depth > 0)
-    {
-      current_state = current_state->failure;
-      next_state = yr_ac_next_state(current_state, data[i]);
-    }
+  return ERROR_SUCCESS;
+}
 
-    if (next_state != NULL)
-      current_state = next_state;
 
-    i++;
+//
+// yr_rules_set_scan_threads
+//
+// Sets the number of threads scanning each memory block. Blocks are split
+// in chunks scanned in parallel if they are large enough for every thread
+// to get a chunk of at least PARALLEL_SCAN_MIN_CHUNK_SIZE bytes, otherwise
+// fewer threads are used. Matches are the same as with a single thread.
+//
 
-    if (timeout > 0 && i % 256 == 0)
-    {
-      current_time = time(NULL);
+void yr_rules_set_scan_threads(
+    YR_RULES* rules,
+    int threads)
+{
+  rules->scan_threads = (threads > 1) ? threads : 1;
+}
 
-      if (difftime(current_time, start_time) > timeout)
-        return ERROR_SCAN_TIMEOUT;
-    }
-  }
 
-  ac_match = current_state->matches;
+//
+// yr_rules_get_re_stats
+//
+// Returns regexp execution stats for the last scan performed by the calling
+// thread. It can be called from the scan callback as well.
+//
 
-  while (ac_match != NULL)
-  {
-    _yr_scan_verify_match(
-        ac_match,
-        data,
-        data_size,
-        data_size - ac_match->backtrack,
-        matches_arena);
+void yr_rules_get_re_stats(
+    YR_RULES* rules,
+    YR_RE_STATS* stats)
+{
+  YR_SCAN_CONTEXT* context = yr_get_scan_context();
+
+  int tidx = yr_get_tidx();
+
+  if (context == NULL || context->rules != rules)
+  {
+    if (tidx >= 0 && tidx < MAX_THREADS)
+      context = rules->thread_contexts[tidx];
+    else
+      context = NULL;
+  }
+
+  if (context != NULL)
+    *stats = context->re_stats;
+  else
+    memset(stats, 0, sizeof(YR_RE_STATS));
+}
+
+
+//
+// yr_rules_enable_profiling
+//
+// Enables the collection of profiling information in the following scans.
+// For each rule it accumulates the number of instructions executed and the
+// time spent evaluating its condition. For each string it accumulates the
+// number of times its atoms were found, the number of verifications, the
+// matches they found and the time they took. Time is measured in CPU
+// cycles where possible. Profiling can't be disabled once enabled.
+//
+
+int yr_rules_enable_profiling(
+    YR_RULES* rules)
+{
+  rules->profiling_enabled = TRUE;
+
+  return ERROR_SUCCESS;
+}
+
+
+int _yr_rules_create_profiling_info(
+    YR_RULES* rules,
+    YR_PROFILING_INFO** profiling_info)
+{
+  YR_PROFILING_INFO* new_profiling_info;
+  YR_RULE* rule;
+  YR_STRING* string;
+
+  size_t size = sizeof(YR_PROFILING_INFO) +
+      rules->rules_count * sizeof(YR_RULE_PROFILE) +
+      rules->strings_count * sizeof(YR_STRING_PROFILE);
+
+  new_profiling_info = (YR_PROFILING_INFO*) yr_malloc(size);
+
+  if (new_profiling_info == NULL)
+    return ERROR_INSUFICIENT_MEMORY;
+
+  memset(new_profiling_info, 0, size);
+
+  new_profiling_info->rules = (YR_RULE_PROFILE*) (new_profiling_info + 1);
+  new_profiling_info->strings = (YR_STRING_PROFILE*) (
+      new_profiling_info->rules + rules->rules_count);
+
+  rule = rules->rules_list_head;
+
+  while (!RULE_IS_NULL(rule))
+  {
+    new_profiling_info->rules[rule->idx].rule = rule;
+    string = rule->strings;
+
+    while (!STRING_IS_NULL(string))
+    {
+      STRING_PROFILE(new_profiling_info, string)->string = string;
+      string++;
+    }
+
+    rule++;
+  }
+
+  *profiling_info = new_profiling_info;
+
+  return ERROR_SUCCESS;
+}
+
+
+void _yr_rules_add_profiling_info(
+    YR_RULES* rules,
+    YR_PROFILING_INFO* total,
+    YR_PROFILING_INFO* profiling_info)
+{
+  YR_STRING_PROFILE* string_profile;
+  int i;
+
+  for (i = 0; i < rules->rules_count; i++)
+  {
+    total->rules[i].instructions += profiling_info->rules[i].instructions;
+    total->rules[i].cycles += profiling_info->rules[i].cycles;
+  }
+
+  for (i = 0; i < rules->strings_count; i++)
+  {
+    string_profile = &profiling_info->strings[i];
+    total->strings[i].atom_hits += string_profile->atom_hits;
+    total->strings[i].verifications += string_profile->verifications;
+    total->strings[i].matches += string_profile->matches;
+    total->strings[i].cycles += string_profile->cycles;
+  }
+}
+
+
+//
+// _yr_rules_total_profiling_info
+//
+// Adds up the profiling information of destroyed scan contexts and the one
+// of contexts still used by yr_rules_scan_* functions.
+//
+
+int _yr_rules_total_profiling_info(
+    YR_RULES* rules,
+    YR_PROFILING_INFO** total)
+{
+  YR_SCAN_CONTEXT* context;
+
+  int result;
+  int i;
+
+  result = _yr_rules_create_profiling_info(rules, total);
+
+  if (result != ERROR_SUCCESS)
+    return result;
+
+  _yr_rules_lock(rules);
+
+  if (rules->profiling_info != NULL)
+    _yr_rules_add_profiling_info(rules, *total, rules->profiling_info);
+
+  _yr_rules_unlock(rules);
+
+  for (i = 0; i < MAX_THREADS; i++)
+  {
+    context = rules->thread_contexts[i];
+
+    if (context != NULL && context->profiling_info != NULL)
+      _yr_rules_add_profiling_info(rules, *total, context->profiling_info);
+  }
+
+  return ERROR_SUCCESS;
+}
+
+
+int _yr_rules_compare_rule_profiles(
+    const void* a,
+    const void* b)
+{
+  uint64_t cycles_a = ((YR_RULE_PROFILE*) a)->cycles;
+  uint64_t cycles_b = ((YR_RULE_PROFILE*) b)->cycles;
+
+  if (cycles_a > cycles_b)
+    return -1;
+
+  if (cycles_a < cycles_b)
+    return 1;
+
+  return 0;
+}
+
+
+int _yr_rules_compare_string_profiles(
+    const void* a,
+    const void* b)
+{
+  uint64_t cycles_a = ((YR_STRING_PROFILE*) a)->cycles;
+  uint64_t cycles_b = ((YR_STRING_PROFILE*) b)->cycles;
+
+  if (cycles_a > cycles_b)
+    return -1;
+
+  if (cycles_a < cycles_b)
+    return 1;
+
+  return 0;
+}
+
+
+//
+// yr_rules_get_slowest_rules
+//
+// Fills profiles with the rules which took longer to evaluate, slowest
+// first, adding up the time spent by all scans. On input count is the
+// number of profiles the array has room for, on output it's the number of
+// profiles written.
+//
+
+int yr_rules_get_slowest_rules(
+    YR_RULES* rules,
+    YR_RULE_PROFILE* profiles,
+    int* count)
+{
+  YR_PROFILING_INFO* totals;
+
+  int result;
+
+  if (!rules->profiling_enabled)
+  {
+    *count = 0;
+    return ERROR_SUCCESS;
+  }
+
+  result = _yr_rules_total_profiling_info(rules, &totals);
+
+  if (result != ERROR_SUCCESS)
+    return result;
+
+  qsort(
+      totals->rules,
+      rules->rules_count,
+      sizeof(YR_RULE_PROFILE),
+      _yr_rules_compare_rule_profiles);
+
+  if (*count > rules->rules_count)
+    *count = rules->rules_count;
+
+  memcpy(profiles, totals->rules, *count * sizeof(YR_RULE_PROFILE));
+  yr_free(totals);
+
+  return ERROR_SUCCESS;
+}
+
+
+//
+// yr_rules_get_slowest_strings
+//
+// Same as yr_rules_get_slowest_rules, but for strings according to the
+// time spent verifying them.
+//
+
+int yr_rules_get_slowest_strings(
+    YR_RULES* rules,
+    YR_STRING_PROFILE* profiles,
+    int* count)
+{
+  YR_PROFILING_INFO* totals;
+
+  int result;
+
+  if (!rules->profiling_enabled)
+  {
+    *count = 0;
+    return ERROR_SUCCESS;
+  }
+
+  result = _yr_rules_total_profiling_info(rules, &totals);
+
+  if (result != ERROR_SUCCESS)
+    return result;
+
+  qsort(
+      totals->strings,
+      rules->strings_count,
+      sizeof(YR_STRING_PROFILE),
+      _yr_rules_compare_string_profiles);
+
+  if (*count > rules->strings_count)
+    *count = rules->strings_count;
+
+  memcpy(profiles, totals->strings, *count * sizeof(YR_STRING_PROFILE));
+  yr_free(totals);
+
+  return ERROR_SUCCESS;
+}
+
+
+//
+// yr_scan_context_create
+//
+// Creates a context for scanning with the given rules. Contexts can be
+// reused for any number of scans, one at a time.
+//
+
+int yr_scan_context_create(
+    YR_RULES* rules,
+    YR_SCAN_CONTEXT** context)
+{
+  YR_SCAN_CONTEXT* new_context;
+
+  int words = (rules->strings_count + 63) / 64;
+
+  size_t size = sizeof(YR_SCAN_CONTEXT) +
+      sizeof(YR_SCAN_CONTROL) +
+      rules->strings_count * sizeof(YR_MATCHES) +
+      rules->externals_count * sizeof(YR_EXTERNAL_VARIABLE) +
+      words * sizeof(uint64_t) +
+      rules->rules_count * sizeof(int32_t) +
+      rules->namespaces_count * sizeof(int32_t) +
+      rules->rules_count * sizeof(int32_t) +
+      rules->strings_count * sizeof(int32_t) +
+      CACHE_LINE_SIZE;
+
+  new_context = (YR_SCAN_CONTEXT*) yr_malloc(size);
+
+  if (new_context == NULL)
+    return ERROR_INSUFICIENT_MEMORY;
+
+  memset(new_context, 0, size);
+
+  new_context->rules = rules;
+  new_context->control = (YR_SCAN_CONTROL*) (new_context + 1);
+  new_context->matches = (YR_MATCHES*) (new_context->control + 1);
+  new_context->externals = (YR_EXTERNAL_VARIABLE*) (
+      new_context->matches + rules->strings_count);
+  new_context->matched_strings = (uint64_t*) (
+      new_context->externals + rules->externals_count);
+  new_context->rules_flags = (int32_t*) (
+      new_context->matched_strings + words);
+  new_context->namespaces_flags = (
+      new_context->rules_flags + rules->rules_count);
+  new_context->dirty_rules = (
+      new_context->namespaces_flags + rules->namespaces_count);
+  new_context->dirty_strings = (
+      new_context->dirty_rules + rules->rules_count);
+
+  *context = new_context;
+
+  return ERROR_SUCCESS;
+}
+
+
+//
+// yr_scan_context_destroy
+//
+// Destroys a scan context. Its profiling information, if any, is kept in
+// the rules.
+//
+
+void yr_scan_context_destroy(
+    YR_SCAN_CONTEXT* context)
+{
+  YR_RULES* rules = context->rules;
+
+  if (context->profiling_info != NULL)
+  {
+    _yr_rules_lock(rules);
+
+    if (rules->profiling_info == NULL)
+    {
+      rules->profiling_info = context->profiling_info;
+      context->profiling_info = NULL;
+    }
+    else
+    {
+      _yr_rules_add_profiling_info(
+          rules, rules->profiling_info, context->profiling_info);
+    }
+
+    _yr_rules_unlock(rules);
+
+    if (context->profiling_info != NULL)
+      yr_free(context->profiling_info);
+  }
+
+  yr_free(context);
+}
+
+
+//
+// yr_scan_context_cancel
+//
+// Makes the scan in progress with the context return ERROR_SCAN_CANCELLED
+// as soon as possible. Can be called from any thread, if no scan is in
+// progress the next one is cancelled.
+//
+
+void yr_scan_context_cancel(
+    YR_SCAN_CONTEXT* context)
+{
+  context->control->cancelled = TRUE;
+  memory_barrier();
+}
+
+
+//
+// yr_scan_context_set_timeout
+//
+// Sets the maximum time in microseconds scans with this context can take
+// before returning ERROR_SCAN_TIMEOUT, or zero for no limit. When a scan
+// function receives a timeout in seconds too, the shortest one applies.
+//
+
+void yr_scan_context_set_timeout(
+    YR_SCAN_CONTEXT* context,
+    uint64_t timeout_us)
+{
+  context->control->timeout_us = timeout_us;
+}
+
+
+//
+// yr_scan_context_set_progress_callback
+//
+// Sets a function called from time to time during scans with this context,
+// with the number of bytes scanned so far and the total. The scan is
+// cancelled if it returns CALLBACK_ABORT.
+//
+
+void yr_scan_context_set_progress_callback(
+    YR_SCAN_CONTEXT* context,
+    YR_PROGRESS_FUNC callback,
+    void* user_data)
+{
+  context->control->progress_callback = callback;
+  context->control->progress_data = user_data;
+}
+
+
+//
+// _yr_scan_monotonic_time
+//
+// Returns the time in microseconds from some arbitrary point, not affected
+// by changes to the system clock.
+//
+
+uint64_t _yr_scan_monotonic_time()
+{
+  #ifdef WIN32
+  LARGE_INTEGER counter;
+  LARGE_INTEGER frequency;
+
+  QueryPerformanceCounter(&counter);
+  QueryPerformanceFrequency(&frequency);
+
+  return (uint64_t) (counter.QuadPart / frequency.QuadPart * 1000000 +
+      counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart);
+  #else
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+  #endif
+}
+
+
+//
+// _yr_scan_check_control
+//
+// Accounts for bytes just scanned and tells whether the scan should go on.
+// Only the thread that started the scan reports progress, the ones scanning
+// chunks of a block for it don't call user code.
+//
+
+int _yr_scan_check_control(
+    YR_SCAN_CONTEXT* context,
+    size_t bytes_scanned)
+{
+  YR_SCAN_CONTROL* control = context->control;
+
+  if (bytes_scanned > 0)
+    atomic_add(&control->bytes_scanned, bytes_scanned);
+
+  if (control->cancelled)
+    return ERROR_SCAN_CANCELLED;
+
+  if (control->deadline > 0 && _yr_scan_monotonic_time() >= control->deadline)
+    return ERROR_SCAN_TIMEOUT;
+
+  if (control->progress_callback != NULL && context->match_log == NULL)
+  {
+    if (control->progress_callback(
+            control->bytes_scanned,
+            control->bytes_total,
+            control->progress_data) == CALLBACK_ABORT)
+    {
+      control->cancelled = TRUE;
+      return ERROR_SCAN_CANCELLED;
+    }
+  }
+
+  return ERROR_SUCCESS;
+}
+
+
+//
+// _yr_scan_context_get_variable
+//
+// Returns the external variable with the given index if it can be set to
+// a value of the given kind, or NULL otherwise.
+//
+
+YR_EXTERNAL_VARIABLE* _yr_scan_context_get_variable(
+    YR_SCAN_CONTEXT* context,
+    int index,
+    int is_string)
+{
+  YR_EXTERNAL_VARIABLE* external;
+
+  if (index < 0 || index >= context->rules->externals_count)
+    return NULL;
+
+  external = &context->rules->externals_list_head[index];
+
+  if (is_string != (external->type == EXTERNAL_VARIABLE_TYPE_FIXED_STRING ||
+                    external->type == EXTERNAL_VARIABLE_TYPE_MALLOC_STRING))
+    return NULL;
+
+  return &context->externals[index];
+}
+
+
+//
+// yr_scan_context_set_integer_variable
+//
+// Sets the value of an external variable for the scans done with this
+// context, leaving the rules untouched. The variable is identified by the
+// index returned by yr_rules_get_variable_index.
+//
+
+int yr_scan_context_set_integer_variable(
+    YR_SCAN_CONTEXT* context,
+    int index,
+    int64_t value)
+{
+  YR_EXTERNAL_VARIABLE* external;
+
+  external = _yr_scan_context_get_variable(context, index, FALSE);
+
+  if (external == NULL)
+    return ERROR_INCORRECT_VARIABLE_TYPE;
+
+  external->type = EXTERNAL_VARIABLE_TYPE_INTEGER;
+  external->integer = value;
+
+  return ERROR_SUCCESS;
+}
+
+
+int yr_scan_context_set_boolean_variable(
+    YR_SCAN_CONTEXT* context,
+    int index,
+    int value)
+{
+  YR_EXTERNAL_VARIABLE* external;
+
+  external = _yr_scan_context_get_variable(context, index, FALSE);
+
+  if (external == NULL)
+    return ERROR_INCORRECT_VARIABLE_TYPE;
+
+  external->type = EXTERNAL_VARIABLE_TYPE_BOOLEAN;
+  external->integer = value;
+
+  return ERROR_SUCCESS;
+}
+
+
+//
+// yr_scan_context_set_string_variable
+//
+// Like yr_scan_context_set_integer_variable but for strings. The string is
+// not copied, it must remain valid while scanning with the context.
+//
+
+int yr_scan_context_set_string_variable(
+    YR_SCAN_CONTEXT* context,
+    int index,
+    const char* value)
+{
+  YR_EXTERNAL_VARIABLE* external;
+
+  external = _yr_scan_context_get_variable(context, index, TRUE);
+
+  if (external == NULL)
+    return ERROR_INCORRECT_VARIABLE_TYPE;
+
+  external->type = EXTERNAL_VARIABLE_TYPE_FIXED_STRING;
+  external->string = (char*) value;
+
+  return ERROR_SUCCESS;
+}
+
+
+//
+// yr_scan_context_reset_variables
+//
+// Makes all external variables take again the values defined in the rules.
+//
+
+void yr_scan_context_reset_variables(
+    YR_SCAN_CONTEXT* context)
+{
+  memset(
+      context->externals,
+      0,
+      context->rules->externals_count * sizeof(YR_EXTERNAL_VARIABLE));
+}
+
+
+void _yr_scan_context_clean_matches(
+    YR_SCAN_CONTEXT* context)
+{
+  int32_t idx;
+  int i;
+
+  // Only the rules and strings touched by the scan need to be cleaned.
+
+  for (i = 0; i < context->dirty_strings_count; i++)
+  {
+    idx = context->dirty_strings[i];
+    memset(&context->matches[idx], 0, sizeof(YR_MATCHES));
+    context->matched_strings[idx / 64] = 0;
+  }
+
+  for (i = 0; i < context->dirty_rules_count; i++)
+    context->rules_flags[context->dirty_rules[i]] = 0;
+
+  context->dirty_strings_count = 0;
+  context->dirty_rules_count = 0;
+
+  memset(
+      context->namespaces_flags,
+      0,
+      context->rules->namespaces_count * sizeof(int32_t));
+}
+
+
+//
+// _yr_scan_mem_block
+//
+// Scans the bytes from start to end of the block, looking for atoms that
+// end right before them. Matches are verified against the whole block.
+//
+
+int _yr_scan_mem_block(
+    YR_SCAN_CONTEXT* context,
+    uint8_t* data,
+    size_t data_size,
+    size_t start,
+    size_t end,
+    int fast_scan_mode,
+    YR_ARENA* matches_arena,
+    int unsatisfied_namespaces)
+{
+  YR_AC_STATE* next_state;
+  YR_AC_MATCH* ac_match;
+  YR_AC_STATE* current_state;
+  YR_PROFILING_INFO* profiling_info;
+
+  int32_t* namespaces_flags = context->namespaces_flags;
+
+  size_t next_check;
+  size_t last_check;
+  size_t offset;
+  size_t i;
+
+  int result;
+
+  profiling_info = context->profiling_info;
+  current_state = context->rules->automaton->root;
+
+  // Atoms are no longer than MAX_ATOM_LENGTH, so the automaton reaches the
+  // state it would have at start after going through that many bytes.
+
+  i = (start > MAX_ATOM_LENGTH) ? start - MAX_ATOM_LENGTH : 0;
+
+  while (i < start)
+  {
+    next_state = yr_ac_next_state(current_state, data[i]);
+
+    while (next_state == NULL && current_state->depth > 0)
+    {
+      current_state = current_state->failure;
+      next_state = yr_ac_next_state(current_state, data[i]);
+    }
+
+    if (next_state != NULL)
+      current_state = next_state;
+
+    i++;
+  }
+
+  last_check = start;
+  next_check = start;
+
+  while (i < end)
+  {
+    if (i == next_check)
+    {
+      result = _yr_scan_check_control(context, i - last_check);
+
+      if (result != ERROR_SUCCESS)
+        return result;
+
+      last_check = i;
+      next_check = i + SCAN_CHECK_INTERVAL;
+    }
+
+    ac_match = current_state->matches;
+
+    while (ac_match != NULL)
+    {
+      if (profiling_info != NULL)
+        STRING_PROFILE(profiling_info, ac_match->string)->atom_hits++;
+
+      // Strings of rules in namespaces with an unsatisfied global rule
+      // are not verified, those rules can't match anyway.
+
+      if (unsatisfied_namespaces &&
+          namespaces_flags[ac_match->string->rule->ns->idx] &
+              NAMESPACE_TFLAGS_UNSATISFIED_GLOBAL)
+      {
+        ac_match = ac_match->next;
+        continue;
+      }
+
+      if (ac_match->backtrack <= i)
+      {
+        offset = i - ac_match->backtrack;
+
+        _yr_scan_verify_match(
+              ac_match,
+              context,
+              data,
+              data_size,
+              offset,
+              matches_arena);
+      }
+
+      ac_match = ac_match->next;
+    }
+
+    next_state = yr_ac_next_state(current_state, data[i]);
+
+    while (next_state == NULL && current_state->depth > 0)
+    {
+      current_state = current_state->failure;
+      next_state = yr_ac_next_state(current_state, data[i]);
+    }
+
+    if (next_state != NULL)
+      current_state = next_state;
+
+    i++;
+  }
+
+  atomic_add(&context->control->bytes_scanned, end - last_check);
+
+  if (end < data_size)
+    return ERROR_SUCCESS;
+
+  ac_match = current_state->matches;
+
+  while (ac_match != NULL)
+  {
+    if (!unsatisfied_namespaces ||
+        !(namespaces_flags[ac_match->string->rule->ns->idx] &
+            NAMESPACE_TFLAGS_UNSATISFIED_GLOBAL))
+    {
+      _yr_scan_verify_match(
+          ac_match,
+          context,
+          data,
+          data_size,
+          data_size - ac_match->backtrack,
+          matches_arena);
+    }
 
     ac_match = ac_match->next;
   }
@@ -877,8 +2231,202 @@ int yr_rules_scan_mem_block(
 }
 
 
-int yr_rules_scan_mem_blocks(
-    YR_RULES* rules,
+//
+// _yr_scan_chunk
+//
+// Scans a chunk of a block, it's what threads of a parallel scan do.
+//
+
+void _yr_scan_chunk(
+    SCAN_CHUNK* chunk)
+{
+  chunk->result = _yr_scan_mem_block(
+      &chunk->context,
+      chunk->data,
+      chunk->data_size,
+      chunk->start,
+      chunk->end,
+      chunk->fast_scan_mode,
+      NULL,
+      chunk->unsatisfied_namespaces);
+}
+
+
+#ifdef WIN32
+DWORD WINAPI _yr_scan_chunk_thread(
+    LPVOID param)
+#else
+void* _yr_scan_chunk_thread(
+    void* param)
+#endif
+{
+  _yr_scan_chunk((SCAN_CHUNK*) param);
+
+  // Release regexp engine's storage for this thread.
+  yr_finalize_thread();
+
+  return 0;
+}
+
+
+//
+// _yr_scan_mem_block_parallel
+//
+// Splits the block into as many chunks as scan threads, each of them at
+// least PARALLEL_SCAN_MIN_CHUNK_SIZE bytes long. The calling thread scans
+// the first chunk and new threads scan the others, logging their matches.
+// When all of them are done the logged matches are added chunk by chunk,
+// which is the order they would have been found by a single thread.
+//
+
+int _yr_scan_mem_block_parallel(
+    YR_SCAN_CONTEXT* context,
+    uint8_t* data,
+    size_t data_size,
+    int fast_scan_mode,
+    YR_ARENA* matches_arena,
+    int unsatisfied_namespaces)
+{
+  YR_RULES* rules = context->rules;
+  SCAN_CHUNK* chunks;
+  SCAN_CHUNK* chunk;
+  MATCH_LOG_ENTRY* entry;
+
+  size_t chunk_size;
+
+  int chunks_count;
+  int result;
+  int i, j;
+
+  chunks_count = (int) min(
+      (size_t) rules->scan_threads,
+      data_size / PARALLEL_SCAN_MIN_CHUNK_SIZE);
+
+  chunks = (SCAN_CHUNK*) yr_malloc(chunks_count * sizeof(SCAN_CHUNK));
+
+  if (chunks == NULL)
+    return _yr_scan_mem_block(
+        context,
+        data,
+        data_size,
+        0,
+        data_size,
+        fast_scan_mode,
+        matches_arena,
+        unsatisfied_namespaces);
+
+  chunk_size = data_size / chunks_count;
+
+  for (i = 1; i < chunks_count; i++)
+  {
+    chunk = &chunks[i];
+    chunk->context = *context;
+    chunk->context.profiling_info = NULL;
+    chunk->context.match_log = &chunk->match_log;
+    chunk->match_log.entries = NULL;
+    chunk->match_log.count = 0;
+    chunk->match_log.size = 0;
+    chunk->match_log.result = ERROR_SUCCESS;
+    chunk->data = data;
+    chunk->data_size = data_size;
+    chunk->start = i * chunk_size;
+    chunk->end = (i < chunks_count - 1) ? (i + 1) * chunk_size : data_size;
+    chunk->fast_scan_mode = fast_scan_mode;
+    chunk->unsatisfied_namespaces = unsatisfied_namespaces;
+
+    memset(&chunk->context.re_stats, 0, sizeof(YR_RE_STATS));
+
+    // Profiling information for the chunk is lost if it can't be allocated,
+    // but that's not a reason for failing the scan.
+
+    if (context->profiling_info != NULL)
+      _yr_rules_create_profiling_info(rules, &chunk->context.profiling_info);
+
+    #ifdef WIN32
+    chunk->thread = CreateThread(
+        NULL, 0, _yr_scan_chunk_thread, chunk, 0, NULL);
+    chunk->thread_created = (chunk->thread != NULL);
+    #else
+    chunk->thread_created = (pthread_create(
+        &chunk->thread, NULL, _yr_scan_chunk_thread, chunk) == 0);
+    #endif
+  }
+
+  result = _yr_scan_mem_block(
+      context,
+      data,
+      data_size,
+      0,
+      chunk_size,
+      fast_scan_mode,
+      matches_arena,
+      unsatisfied_namespaces);
+
+  for (i = 1; i < chunks_count; i++)
+  {
+    chunk = &chunks[i];
+
+    if (chunk->thread_created)
+    {
+      #ifdef WIN32
+      WaitForSingleObject(chunk->thread, INFINITE);
+      CloseHandle(chunk->thread);
+      #else
+      pthread_join(chunk->thread, NULL);
+      #endif
+    }
+    else
+    {
+      _yr_scan_chunk(chunk);
+    }
+
+    if (result == ERROR_SUCCESS)
+      result = chunk->result;
+
+    if (result == ERROR_SUCCESS)
+      result = chunk->match_log.result;
+
+    for (j = 0; j < chunk->match_log.count && result == ERROR_SUCCESS; j++)
+    {
+      entry = &chunk->match_log.entries[j];
+
+      _yr_scan_add_match(
+          context,
+          entry->string,
+          matches_arena,
+          entry->match_data,
+          entry->match_offset,
+          entry->match_length);
+    }
+
+    context->re_stats.executions += chunk->context.re_stats.executions;
+    context->re_stats.jit_executions +=
+        chunk->context.re_stats.jit_executions;
+    context->re_stats.scan_limit_exceeded +=
+        chunk->context.re_stats.scan_limit_exceeded;
+    context->re_stats.cost_budget_exceeded +=
+        chunk->context.re_stats.cost_budget_exceeded;
+
+    if (chunk->context.profiling_info != NULL)
+    {
+      _yr_rules_add_profiling_info(
+          rules, context->profiling_info, chunk->context.profiling_info);
+
+      yr_free(chunk->context.profiling_info);
+    }
+
+    if (chunk->match_log.entries != NULL)
+      yr_free(chunk->match_log.entries);
+  }
+
+  yr_free(chunks);
+
+  return result;
+}
+
+
+int yr_scan_context_scan_mem_blocks(
+    YR_SCAN_CONTEXT* scan_context,
     YR_MEMORY_BLOCK* block,
     int scanning_process_memory,
     YR_CALLBACK_FUNC callback,
@@ -886,71 +2434,139 @@ int yr_rules_scan_mem_blocks(
     int fast_scan_mode,
     int timeout)
 {
+  YR_RULES* rules = scan_context->rules;
   YR_RULE* rule;
+  YR_SCAN_CONTEXT* previous_scan_context;
   EVALUATION_CONTEXT context;
   YR_ARENA* matches_arena = NULL;
+  YR_MEMORY_BLOCK* first_block = block;
+  YR_SCAN_CONTROL* control = scan_context->control;
 
-  time_t start_time;
+  uint64_t timeout_us;
+
+  int32_t* rules_flags = scan_context->rules_flags;
+  int32_t* namespaces_flags = scan_context->namespaces_flags;
 
   int message;
-  int tidx;
+  int unsatisfied_namespaces = FALSE;
   int result = ERROR_SUCCESS;
 
   context.file_size = block->size;
   context.mem_block = block;
   context.entry_point = UNDEFINED;
+  context.scan_context = scan_context;
+  context.matches_arena = NULL;
+  context.mem_blocks_index = NULL;
+  context.mem_blocks_count = 0;
+  context.last_mem_block = NULL;
 
-  tidx = yr_get_tidx();
+  memset(&scan_context->re_stats, 0, sizeof(YR_RE_STATS));
 
-  if (tidx == -1)
-  {
-    _yr_rules_lock(rules);
+  timeout_us = control->timeout_us;
 
-    tidx = rules->threads_count;
+  if (timeout > 0 && (timeout_us == 0 || timeout * 1000000ULL < timeout_us))
+    timeout_us = timeout * 1000000ULL;
 
-    if (tidx < MAX_THREADS)
-      rules->threads_count++;
-    else
-      result = ERROR_TOO_MANY_SCAN_THREADS;
+  control->deadline = (timeout_us > 0) ?
+      _yr_scan_monotonic_time() + timeout_us : 0;
 
-    _yr_rules_unlock(rules);
+  control->bytes_scanned = 0;
+  control->bytes_total = 0;
+
+  while (block != NULL)
+  {
+    control->bytes_total += block->size;
+    block = block->next;
+  }
+
+  block = first_block;
+
+  if (rules->profiling_enabled && scan_context->profiling_info == NULL)
+  {
+    result = _yr_rules_create_profiling_info(
+        rules, &scan_context->profiling_info);
 
     if (result != ERROR_SUCCESS)
       return result;
-
-    yr_set_tidx(tidx);
   }
 
+  // Scan callbacks look for matches in the current thread's scan context,
+  // the previous one is restored when done in case this is a scan started
+  // from within another scan's callback.
+
+  previous_scan_context = yr_get_scan_context();
+  yr_set_scan_context(scan_context);
+
   result = yr_arena_create(1024, 0, &matches_arena);
 
   if (result != ERROR_SUCCESS)
     goto _exit;
 
-  start_time = time(NULL);
+  context.matches_arena = matches_arena;
 
-  while (block != NULL)
+  while (block != NULL && context.entry_point == UNDEFINED)
+  {
+    if (scanning_process_memory)
+      context.entry_point = yr_get_entry_point_address(
+          block->data,
+          block->size,
+          block->base);
+    else
+      context.entry_point = yr_get_entry_point_offset(
+          block->data,
+          block->size);
+
+    block = block->next;
+  }
+
+  // Global rules not depending on strings are evaluated before scanning,
+  // when one of them fails nothing else in its namespace needs to be
+  // evaluated nor its strings verified.
+
+  context.stage = EVALUATION_STAGE_EARLY_GLOBALS;
+
+  result = yr_execute_code(rules, &context);
+
+  if (result != ERROR_SUCCESS)
+    goto _exit;
+
+  rule = rules->rules_list_head;
+
+  while (!RULE_IS_NULL(rule))
   {
-    if (context.entry_point == UNDEFINED)
+    if (RULE_IS_EARLY_GLOBAL(rule) &&
+        !(rules_flags[rule->idx] & RULE_TFLAGS_MATCH))
     {
-      if (scanning_process_memory)
-        context.entry_point = yr_get_entry_point_address(
-            block->data,
-            block->size,
-            block->base);
-      else
-        context.entry_point = yr_get_entry_point_offset(
-            block->data,
-            block->size);
+      namespaces_flags[rule->ns->idx] |= NAMESPACE_TFLAGS_UNSATISFIED_GLOBAL;
+      unsatisfied_namespaces = TRUE;
     }
 
-    result = yr_rules_scan_mem_block(
-        rules,
-        block->data,
-        block->size,
-        fast_scan_mode,
-        timeout,
-        start_time,
-        matches_arena);
+    rule++;
+  }
+
+  block = context.mem_block;
+
+  while (block != NULL)
+  {
+    if (rules->scan_threads > 1 &&
+        block->size >= 2 * PARALLEL_SCAN_MIN_CHUNK_SIZE)
+      result = _yr_scan_mem_block_parallel(
+          scan_context,
+          block->data,
+          block->size,
+          fast_scan_mode,
+          matches_arena,
+          unsatisfied_namespaces);
+    else
+      result = _yr_scan_mem_block(
+          scan_context,
+          block->data,
+          block->size,
+          0,
+          block->size,
+          fast_scan_mode,
+          matches_arena,
+          unsatisfied_namespaces);
 
     if (result != ERROR_SUCCESS)
       goto _exit;
@@ -958,6 +2574,15 @@ int yr_rules_scan_mem_blocks(
     block = block->next;
   }
 
+  // Report the scan as complete to the progress callback, if any.
+
+  result = _yr_scan_check_control(scan_context, 0);
+
+  if (result != ERROR_SUCCESS)
+    goto _exit;
+
+  context.stage = EVALUATION_STAGE_REMAINING_RULES;
+
   result = yr_execute_code(rules, &context);
 
   if (result != ERROR_SUCCESS)
@@ -967,9 +2592,9 @@ int yr_rules_scan_mem_blocks(
 
   while (!RULE_IS_NULL(rule))
   {
-    if (RULE_IS_GLOBAL(rule) && !(rule->t_flags[tidx] & RULE_TFLAGS_MATCH))
+    if (RULE_IS_GLOBAL(rule) && !(rules_flags[rule->idx] & RULE_TFLAGS_MATCH))
     {
-      rule->ns->t_flags[tidx] |= NAMESPACE_TFLAGS_UNSATISFIED_GLOBAL;
+      namespaces_flags[rule->ns->idx] |= NAMESPACE_TFLAGS_UNSATISFIED_GLOBAL;
     }
 
     rule++;
@@ -979,8 +2604,9 @@ int yr_rules_scan_mem_blocks(
 
   while (!RULE_IS_NULL(rule))
   {
-    if (rule->t_flags[tidx] & RULE_TFLAGS_MATCH &&
-        !(rule->ns->t_flags[tidx] & NAMESPACE_TFLAGS_UNSATISFIED_GLOBAL))
+    if (rules_flags[rule->idx] & RULE_TFLAGS_MATCH &&
+        !(namespaces_flags[rule->ns->idx] &
+            NAMESPACE_TFLAGS_UNSATISFIED_GLOBAL))
     {
       message = CALLBACK_MSG_RULE_MATCHING;
     }
@@ -1009,12 +2635,151 @@ int yr_rules_scan_mem_blocks(
   callback(CALLBACK_MSG_SCAN_FINISHED, NULL, user_data);
 
 _exit:
-  _yr_rules_clean_matches(rules);
+  _yr_scan_context_clean_matches(scan_context);
+
+  control->cancelled = FALSE;
 
   if (matches_arena != NULL)
     yr_arena_destroy(matches_arena);
 
-  return result;
+  yr_set_scan_context(previous_scan_context);
+
+  return result;
+}
+
+
+int yr_scan_context_scan_mem(
+    YR_SCAN_CONTEXT* context,
+    uint8_t* buffer,
+    size_t buffer_size,
+    YR_CALLBACK_FUNC callback,
+    void* user_data,
+    int fast_scan_mode,
+    int timeout)
+{
+  YR_MEMORY_BLOCK block;
+
+  block.data = buffer;
+  block.size = buffer_size;
+  block.base = 0;
+  block.next = NULL;
+
+  return yr_scan_context_scan_mem_blocks(
+      context,
+      &block,
+      FALSE,
+      callback,
+      user_data,
+      fast_scan_mode,
+      timeout);
+}
+
+
+int yr_scan_context_scan_file(
+    YR_SCAN_CONTEXT* context,
+    const char* filename,
+    YR_CALLBACK_FUNC callback,
+    void* user_data,
+    int fast_scan_mode,
+    int timeout)
+{
+  MAPPED_FILE mfile;
+  int result;
+
+  result = yr_filemap_map(filename, &mfile);
+
+  if (result == ERROR_SUCCESS)
+  {
+    result = yr_scan_context_scan_mem(
+        context,
+        mfile.data,
+        mfile.size,
+        callback,
+        user_data,
+        fast_scan_mode,
+        timeout);
+
+    yr_filemap_unmap(&mfile);
+  }
+
+  return result;
+}
+
+
+int yr_scan_context_scan_proc(
+    YR_SCAN_CONTEXT* context,
+    int pid,
+    YR_CALLBACK_FUNC callback,
+    void* user_data,
+    int fast_scan_mode,
+    int timeout)
+{
+  YR_MEMORY_BLOCK* first_block;
+  YR_MEMORY_BLOCK* next_block;
+  YR_MEMORY_BLOCK* block;
+
+  int result;
+
+  result = yr_process_get_memory(pid, &first_block);
+
+  if (result == ERROR_SUCCESS)
+    result = yr_scan_context_scan_mem_blocks(
+        context,
+        first_block,
+        TRUE,
+        callback,
+        user_data,
+        fast_scan_mode,
+        timeout);
+
+  block = first_block;
+
+  while (block != NULL)
+  {
+    next_block = block->next;
+
+    yr_free(block->data);
+    yr_free(block);
+
+    block = next_block;
+  }
+
+  return result;
+}
+
+
+//
+// _yr_rules_get_thread_context
+//
+// Returns the scan context used by the calling thread for scanning with
+// yr_rules_scan_* functions. Each thread takes a tidx the first time it
+// scans and keeps it until yr_finalize_thread, the tidx is the slot where
+// its context is kept.
+//
+
+int _yr_rules_get_thread_context(
+    YR_RULES* rules,
+    YR_SCAN_CONTEXT** context)
+{
+  int tidx;
+  int result;
+
+  tidx = yr_acquire_tidx();
+
+  if (tidx == -1)
+    return ERROR_TOO_MANY_SCAN_THREADS;
+
+  if (rules->thread_contexts[tidx] == NULL)
+  {
+    result = yr_scan_context_create(rules, &rules->thread_contexts[tidx]);
+
+    if (result != ERROR_SUCCESS)
+      return result;
+  }
+
+  *context = rules->thread_contexts[tidx];
+
+  return ERROR_SUCCESS;
 }
 
 
@@ -1027,21 +2792,22 @@ int yr_rules_scan_mem(
     int fast_scan_mode,
     int timeout)
 {
-  YR_MEMORY_BLOCK block;
+  YR_SCAN_CONTEXT* context;
+  int result;
 
-  block.data = buffer;
-  block.size = buffer_size;
-  block.base = 0;
-  block.next = NULL;
+  result = _yr_rules_get_thread_context(rules, &context);
 
-  return yr_rules_scan_mem_blocks(
-      rules,
-      &block,
-      FALSE,
-      callback,
-      user_data,
-      fast_scan_mode,
-      timeout);
+  if (result == ERROR_SUCCESS)
+    result = yr_scan_context_scan_mem(
+        context,
+        buffer,
+        buffer_size,
+        callback,
+        user_data,
+        fast_scan_mode,
+        timeout);
+
+  return result;
 }
 
 
@@ -1053,25 +2819,20 @@ int yr_rules_scan_file(
     int fast_scan_mode,
     int timeout)
 {
-  MAPPED_FILE mfile;
+  YR_SCAN_CONTEXT* context;
   int result;
 
-  result = yr_filemap_map(filename, &mfile);
+  result = _yr_rules_get_thread_context(rules, &context);
 
   if (result == ERROR_SUCCESS)
-  {
-    result = yr_rules_scan_mem(
-        rules,
-        mfile.data,
-        mfile.size,
+    result = yr_scan_context_scan_file(
+        context,
+        filename,
         callback,
         user_data,
         fast_scan_mode,
         timeout);
 
-    yr_filemap_unmap(&mfile);
-  }
-
   return result;
 }
 
@@ -1084,36 +2845,20 @@ int yr_rules_scan_proc(
     int fast_scan_mode,
     int timeout)
 {
-  YR_MEMORY_BLOCK* first_block;
-  YR_MEMORY_BLOCK* next_block;
-  YR_MEMORY_BLOCK* block;
-
+  YR_SCAN_CONTEXT* context;
   int result;
 
-  result = yr_process_get_memory(pid, &first_block);
+  result = _yr_rules_get_thread_context(rules, &context);
 
   if (result == ERROR_SUCCESS)
-    result = yr_rules_scan_mem_blocks(
-        rules,
-        first_block,
-        TRUE,
+    result = yr_scan_context_scan_proc(
+        context,
+        pid,
         callback,
         user_data,
         fast_scan_mode,
         timeout);
 
-  block = first_block;
-
-  while (block != NULL)
-  {
-    next_block = block->next;
-
-    yr_free(block->data);
-    yr_free(block);
-
-    block = next_block;
-  }
-
   return result;
 }
 
@@ -1122,7 +2867,6 @@ int yr_rules_save(
     YR_RULES* rules,
     const char* filename)
 {
-  assert(rules->threads_count == 0);
   return yr_arena_save(rules->arena, filename);
 }
 
@@ -1155,7 +2899,27 @@ int yr_rules_load(
   new_rules->code_start = header->code_start;
   new_rules->externals_list_head = header->externals_list_head;
   new_rules->rules_list_head = header->rules_list_head;
-  new_rules->threads_count = 0;
+  new_rules->re_limits.scan_limit = RE_DEFAULT_SCAN_LIMIT;
+  new_rules->re_limits.cost_budget = 0;
+  new_rules->strings_re_limits = NULL;
+  new_rules->scan_threads = 1;
+  new_rules->rules_count = header->rules_count;
+  new_rules->strings_count = header->strings_count;
+  new_rules->namespaces_count = header->namespaces_count;
+  new_rules->externals_count = header->externals_count;
+  new_rules->profiling_enabled = FALSE;
+  new_rules->profiling_info = NULL;
+
+  memset(new_rules->thread_contexts, 0, sizeof(new_rules->thread_contexts));
+
+  result = yr_re_jit_create(new_rules->automaton, &new_rules->re_jit);
+
+  if (result != ERROR_SUCCESS)
+  {
+    yr_arena_destroy(new_rules->arena);
+    yr_free(new_rules);
+    return result;
+  }
 
   #if WIN32
   new_rules->mutex = CreateMutex(NULL, FALSE, NULL);
@@ -1170,10 +2934,113 @@ int yr_rules_load(
 }
 
 
+
+//
+// yr_rules_duplicate
+//
+// Creates an independent copy of the rules, including the values currently
+// assigned to external variables. As memory is usually placed in the NUMA
+// node of the thread that touches it first, calling this function from a
+// thread running in a given node produces a copy of the rules local to that
+// node.
+//
+
+int yr_rules_duplicate(
+    YR_RULES* rules,
+    YR_RULES** duplicated_rules)
+{
+  YR_RULES* new_rules;
+  YR_EXTERNAL_VARIABLE* external;
+  YARA_RULES_FILE_HEADER* header;
+
+  int result;
+
+  new_rules = yr_malloc(sizeof(YR_RULES));
+
+  if (new_rules == NULL)
+    return ERROR_INSUFICIENT_MEMORY;
+
+  result = yr_arena_duplicate(rules->arena, &new_rules->arena);
+
+  if (result != ERROR_SUCCESS)
+  {
+    yr_free(new_rules);
+    return result;
+  }
+
+  header = (YARA_RULES_FILE_HEADER*) yr_arena_base_address(new_rules->arena);
+  new_rules->automaton = header->automaton;
+  new_rules->code_start = header->code_start;
+  new_rules->externals_list_head = header->externals_list_head;
+  new_rules->rules_list_head = header->rules_list_head;
+  new_rules->re_limits = rules->re_limits;
+  new_rules->strings_re_limits = NULL;
+  new_rules->scan_threads = rules->scan_threads;
+  new_rules->rules_count = header->rules_count;
+  new_rules->strings_count = header->strings_count;
+  new_rules->namespaces_count = header->namespaces_count;
+  new_rules->externals_count = header->externals_count;
+  new_rules->profiling_enabled = rules->profiling_enabled;
+  new_rules->profiling_info = NULL;
+
+  memset(new_rules->thread_contexts, 0, sizeof(new_rules->thread_contexts));
+
+  result = yr_re_jit_create(new_rules->automaton, &new_rules->re_jit);
+
+  if (result == ERROR_SUCCESS && rules->strings_re_limits != NULL)
+  {
+    new_rules->strings_re_limits = (YR_RE_LIMITS*) yr_malloc(
+        rules->strings_count * sizeof(YR_RE_LIMITS));
+
+    if (new_rules->strings_re_limits != NULL)
+      memcpy(
+          new_rules->strings_re_limits,
+          rules->strings_re_limits,
+          rules->strings_count * sizeof(YR_RE_LIMITS));
+    else
+      result = ERROR_INSUFICIENT_MEMORY;
+
+    if (result != ERROR_SUCCESS)
+      yr_re_jit_destroy(new_rules->re_jit);
+  }
+
+  if (result != ERROR_SUCCESS)
+  {
+    yr_arena_destroy(new_rules->arena);
+    yr_free(new_rules);
+    return result;
+  }
+
+  // String values set with yr_rules_define_string_variable live outside the
+  // arena, the copy needs its own ones.
+
+  external = new_rules->externals_list_head;
+
+  while (!EXTERNAL_VARIABLE_IS_NULL(external))
+  {
+    if (external->type == EXTERNAL_VARIABLE_TYPE_MALLOC_STRING)
+      external->string = yr_strdup(external->string);
+
+    external++;
+  }
+
+  #if WIN32
+  new_rules->mutex = CreateMutex(NULL, FALSE, NULL);
+  #else
+  pthread_mutex_init(&new_rules->mutex, NULL);
+  #endif
+
+  *duplicated_rules = new_rules;
+
+  return ERROR_SUCCESS;
+}
+
+
 int yr_rules_destroy(
     YR_RULES* rules)
 {
   YR_EXTERNAL_VARIABLE* external;
+  int i;
 
   external = rules->externals_list_head;
 
@@ -1185,8 +3052,259 @@ int yr_rules_destroy(
     external++;
   }
 
+  for (i = 0; i < MAX_THREADS; i++)
+  {
+    if (rules->thread_contexts[i] != NULL)
+      yr_scan_context_destroy(rules->thread_contexts[i]);
+  }
+
+  if (rules->profiling_info != NULL)
+    yr_free(rules->profiling_info);
+
+  if (rules->strings_re_limits != NULL)
+    yr_free(rules->strings_re_limits);
+
+  yr_re_jit_destroy(rules->re_jit);
   yr_arena_destroy(rules->arena);
   yr_free(rules);
 
   return ERROR_SUCCESS;
 }
+
+
+typedef struct _YR_RETIRED_RULES
+{
+  YR_RULES* rules;
+  struct _YR_RETIRED_RULES* next;
+
+} YR_RETIRED_RULES;
+
+
+void _yr_rules_handle_lock(
+    YR_RULES_HANDLE* handle)
+{
+  #ifdef WIN32
+  WaitForSingleObject(handle->mutex, INFINITE);
+  #else
+  pthread_mutex_lock(&handle->mutex);
+  #endif
+}
+
+
+void _yr_rules_handle_unlock(
+    YR_RULES_HANDLE* handle)
+{
+  #ifdef WIN32
+  ReleaseMutex(handle->mutex);
+  #else
+  pthread_mutex_unlock(&handle->mutex);
+  #endif
+}
+
+
+//
+// _yr_rules_handle_reclaim
+//
+// Destroys the retired rules not published by any thread. Must be called
+// with the handle locked.
+//
+
+void _yr_rules_handle_reclaim(
+    YR_RULES_HANDLE* handle)
+{
+  YR_RETIRED_RULES* retired;
+  YR_RETIRED_RULES** prev;
+  int in_use;
+  int i;
+
+  prev = (YR_RETIRED_RULES**) &handle->retired;
+  retired = handle->retired;
+
+  while (retired != NULL)
+  {
+    in_use = FALSE;
+
+    for (i = 0; i < MAX_THREADS && !in_use; i++)
+      in_use = (handle->hazards[i] == retired->rules);
+
+    if (in_use)
+    {
+      prev = &retired->next;
+      retired = retired->next;
+    }
+    else
+    {
+      *prev = retired->next;
+      yr_rules_destroy(retired->rules);
+      yr_free(retired);
+      retired = *prev;
+    }
+  }
+}
+
+
+//
+// yr_rules_handle_create
+//
+// Creates a handle for replacing rules while they are being used by other
+// threads. The handle takes ownership of the rules.
+//
+
+int yr_rules_handle_create(
+    YR_RULES* rules,
+    YR_RULES_HANDLE** handle)
+{
+  YR_RULES_HANDLE* new_handle;
+
+  new_handle = (YR_RULES_HANDLE*) yr_malloc(sizeof(YR_RULES_HANDLE));
+
+  if (new_handle == NULL)
+    return ERROR_INSUFICIENT_MEMORY;
+
+  memset(new_handle, 0, sizeof(YR_RULES_HANDLE));
+
+  new_handle->current = rules;
+
+  #if WIN32
+  new_handle->mutex = CreateMutex(NULL, FALSE, NULL);
+  #else
+  pthread_mutex_init(&new_handle->mutex, NULL);
+  #endif
+
+  *handle = new_handle;
+
+  return ERROR_SUCCESS;
+}
+
+
+//
+// yr_rules_handle_destroy
+//
+// Destroys the handle along with its current and retired rules. No thread
+// can be using rules from the handle at this point.
+//
+
+void yr_rules_handle_destroy(
+    YR_RULES_HANDLE* handle)
+{
+  YR_RETIRED_RULES* retired = handle->retired;
+  YR_RETIRED_RULES* next;
+
+  while (retired != NULL)
+  {
+    next = retired->next;
+    yr_rules_destroy(retired->rules);
+    yr_free(retired);
+    retired = next;
+  }
+
+  yr_rules_destroy(handle->current);
+
+  #if WIN32
+  CloseHandle(handle->mutex);
+  #else
+  pthread_mutex_destroy(&handle->mutex);
+  #endif
+
+  yr_free(handle);
+}
+
+
+//
+// yr_rules_handle_acquire
+//
+// Returns the handle's current rules, which won't be destroyed until the
+// calling thread calls yr_rules_handle_release, even if they are replaced
+// in the meantime. A thread can hold only one rules from the same handle
+// at a time. Returns NULL if the thread can't get a tidx.
+//
+
+YR_RULES* yr_rules_handle_acquire(
+    YR_RULES_HANDLE* handle)
+{
+  YR_RULES* rules;
+  int tidx;
+
+  tidx = yr_acquire_tidx();
+
+  if (tidx == -1)
+    return NULL;
+
+  // The rules could be retired and reclaimed between reading them and
+  // publishing them, retry until they are still current once published.
+
+  do
+  {
+    rules = handle->current;
+    handle->hazards[tidx] = rules;
+    memory_barrier();
+  }
+  while (rules != handle->current);
+
+  return rules;
+}
+
+
+//
+// yr_rules_handle_release
+//
+// Releases the rules obtained with yr_rules_handle_acquire. If they were
+// replaced and this was their last user they are destroyed.
+//
+
+void yr_rules_handle_release(
+    YR_RULES_HANDLE* handle)
+{
+  int tidx = yr_get_tidx();
+
+  if (tidx == -1)
+    return;
+
+  handle->hazards[tidx] = NULL;
+  memory_barrier();
+
+  if (handle->retired != NULL)
+  {
+    _yr_rules_handle_lock(handle);
+    _yr_rules_handle_reclaim(handle);
+    _yr_rules_handle_unlock(handle);
+  }
+}
+
+
+//
+// yr_rules_handle_swap
+//
+// Makes the given rules the current ones for the handle, which takes their
+// ownership. Threads acquiring rules from now on get the new ones, while
+// those already scanning keep using the old rules until they release them.
+//
+
+int yr_rules_handle_swap(
+    YR_RULES_HANDLE* handle,
+    YR_RULES* rules)
+{
+  YR_RETIRED_RULES* retired;
+
+  retired = (YR_RETIRED_RULES*) yr_malloc(sizeof(YR_RETIRED_RULES));
+
+  if (retired == NULL)
+    return ERROR_INSUFICIENT_MEMORY;
+
+  _yr_rules_handle_lock(handle);
+
+  // Swaps are serialized by the lock, readers never write current.
+
+  retired->rules = handle->current;
+  handle->current = rules;
+
+  retired->next = handle->retired;
+  handle->retired = retired;
+
+  memory_barrier();
+
+  _yr_rules_handle_reclaim(handle);
+  _yr_rules_handle_unlock(handle);
+
+  return ERROR_SUCCESS;
+}
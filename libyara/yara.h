@@ -88,6 +88,7 @@ typedef pthread_mutex_t mutex_t;
 #define ERROR_LOOP_NESTING_LIMIT_EXCEEDED       32
 #define ERROR_DUPLICATE_LOOP_IDENTIFIER         33
 #define ERROR_TOO_MANY_SCAN_THREADS             34
+#define ERROR_SCAN_CANCELLED                    35
 
 
 #define CALLBACK_MSG_RULE_MATCHING            1
@@ -102,8 +103,10 @@ typedef pthread_mutex_t mutex_t;
 #define MAX_ATOM_LENGTH 4
 #define LOOP_LOCAL_VARS 4
 #define MAX_LOOP_NESTING 4
+#define MAX_PENDING_JUMPS 16
 #define MAX_INCLUDE_DEPTH 16
 #define MAX_THREADS 32
+#define RE_DEFAULT_SCAN_LIMIT 65535
 #define LEX_BUF_SIZE  1024
 
 
@@ -216,15 +219,19 @@ typedef pthread_mutex_t mutex_t;
     (((x)->g_flags) & STRING_GFLAGS_FITS_IN_ATOM)
 
 #define STRING_FOUND(x) \
-    ((x)->matches[yr_get_tidx()].tail != NULL)
+    (STRING_MATCHES(x).tail != NULL)
 
 
 #define RULE_TFLAGS_MATCH                0x01
+#define RULE_TFLAGS_DIRTY                0x02
 
 #define RULE_GFLAGS_PRIVATE              0x01
 #define RULE_GFLAGS_GLOBAL               0x02
 #define RULE_GFLAGS_REQUIRE_EXECUTABLE   0x04
 #define RULE_GFLAGS_REQUIRE_FILE         0x08
+#define RULE_GFLAGS_REQUIRE_STRINGS      0x10
+#define RULE_GFLAGS_REFERENCES_RULES     0x20
+#define RULE_GFLAGS_EARLY_GLOBAL         0x40
 #define RULE_GFLAGS_NULL                 0x1000
 
 #define RULE_IS_PRIVATE(x) \
@@ -236,15 +243,25 @@ typedef pthread_mutex_t mutex_t;
 #define RULE_IS_NULL(x) \
     (((x)->g_flags) & RULE_GFLAGS_NULL)
 
+#define RULE_REQUIRES_STRINGS(x) \
+    (((x)->g_flags) & RULE_GFLAGS_REQUIRE_STRINGS)
+
+// Global rules without strings nor references to other rules can be
+// evaluated before scanning.
+
+#define RULE_IS_EARLY_GLOBAL(x) \
+    (((x)->g_flags) & RULE_GFLAGS_EARLY_GLOBAL)
+
 #define RULE_MATCHES(x) \
-    ((x)->t_flags[yr_get_tidx()] & RULE_TFLAGS_MATCH)
+    (yr_get_scan_context()->rules_flags[(x)->idx] & RULE_TFLAGS_MATCH)
 
 
 
 #define NAMESPACE_TFLAGS_UNSATISFIED_GLOBAL      0x01
 
 #define NAMESPACE_HAS_UNSATISFIED_GLOBAL(x) \
-    ((x)->t_flags[yr_get_tidx()] & NAMESPACE_TFLAGS_UNSATISFIED_GLOBAL)
+    (yr_get_scan_context()->namespaces_flags[(x)->idx] & \
+        NAMESPACE_TFLAGS_UNSATISFIED_GLOBAL)
 
 
 
@@ -260,7 +277,10 @@ typedef pthread_mutex_t mutex_t;
 
 #define PTR_TO_UINT64(x)  ((uint64_t) (size_t) x)
 
-#define STRING_MATCHES(x) (x->matches[yr_get_tidx()])
+// Matches found in the scan being performed by the current thread. These
+// are meant to be used from the scan callback.
+
+#define STRING_MATCHES(x) (yr_get_scan_context()->matches[(x)->idx])
 
 
 typedef struct _YR_RELOC
@@ -317,9 +337,25 @@ typedef struct _YR_MATCH
 } YR_MATCH;
 
 
+// Random access index over the matches of a string, built during the
+// evaluation of conditions if needed. Matches are stored in runs of
+// consecutive offsets, the arrays have an entry per run.
+
+typedef struct _YR_MATCH_INDEX
+{
+  int32_t runs_count;
+
+  int64_t* first_offset;
+  int64_t* max_first_offset;     // Maximum first_offset up to each run
+  int64_t* max_last_offset;      // Maximum last_offset up to each run
+  int64_t* preceding_matches;    // Matches in previous runs, runs_count + 1
+
+} YR_MATCH_INDEX;
+
+
 typedef struct _YR_NAMESPACE
 {
-  int32_t t_flags[MAX_THREADS];     // Thread-specific flags
+  int32_t idx;                   // Index of the namespace in scan contexts
   DECLARE_REFERENCE(char*, name);
 
 } YR_NAMESPACE;
@@ -340,14 +376,11 @@ typedef struct _YR_STRING
 {
   int32_t g_flags;
   int32_t length;
+  int32_t idx;                   // Index of the string in scan contexts
 
   DECLARE_REFERENCE(char*, identifier);
   DECLARE_REFERENCE(uint8_t*, string);
-
-  struct {
-    DECLARE_REFERENCE(YR_MATCH*, head);
-    DECLARE_REFERENCE(YR_MATCH*, tail);
-  } matches[MAX_THREADS];
+  DECLARE_REFERENCE(struct _YR_RULE*, rule);
 
 } YR_STRING;
 
@@ -355,7 +388,7 @@ typedef struct _YR_STRING
 typedef struct _YR_RULE
 {
   int32_t g_flags;               // Global flags
-  int32_t t_flags[MAX_THREADS];  // Thread-specific flags
+  int32_t idx;                   // Index of the rule in scan contexts
 
   DECLARE_REFERENCE(char*, identifier);
   DECLARE_REFERENCE(char*, tags);
@@ -366,6 +399,21 @@ typedef struct _YR_RULE
 } YR_RULE;
 
 
+// A set of strings used in a "N of" expression, as a mask over the bitmap
+// of matching strings in the scan context. The mask starts at the word
+// holding the bit for the first string of the rule.
+
+typedef struct _YR_STRING_SET
+{
+  int32_t count;
+  int32_t first_word;
+  int32_t words;
+
+  DECLARE_REFERENCE(uint64_t*, mask);
+
+} YR_STRING_SET;
+
+
 typedef struct _YR_EXTERNAL_VARIABLE
 {
   int32_t type;
@@ -381,6 +429,10 @@ typedef struct _YR_AC_MATCH
 {
   uint16_t backtrack;
 
+  // STRING_GFLAGS_ASCII and/or STRING_GFLAGS_WIDE, depending on the
+  // encoding of the atom that produced this match.
+  uint16_t flags;
+
   DECLARE_REFERENCE(YR_STRING*, string);
   DECLARE_REFERENCE(uint8_t*, forward_code);
   DECLARE_REFERENCE(uint8_t*, backward_code);
@@ -442,6 +494,11 @@ typedef struct _YARA_RULES_FILE_HEADER
 {
   uint32_t version;
 
+  int32_t rules_count;
+  int32_t strings_count;
+  int32_t namespaces_count;
+  int32_t externals_count;
+
   DECLARE_REFERENCE(YR_RULE*, rules_list_head);
   DECLARE_REFERENCE(YR_EXTERNAL_VARIABLE*, externals_list_head);
   DECLARE_REFERENCE(uint8_t*, code_start);
@@ -478,6 +535,7 @@ typedef struct _YR_ATOM_LIST_ITEM
   uint8_t atom[MAX_ATOM_LENGTH];
 
   uint16_t backtrack;
+  uint16_t flags;
 
   void* forward_code;
   void* backward_code;
@@ -504,6 +562,40 @@ typedef int (*YR_CALLBACK_FUNC)(
     void* data);
 
 
+typedef int (*YR_PROGRESS_FUNC)(
+    uint64_t bytes_scanned,
+    uint64_t bytes_total,
+    void* data);
+
+
+// Controls how long a scan can run. It's shared by a scan context and the
+// threads scanning chunks of a block on its behalf, all of them check it
+// periodically while scanning.
+
+typedef struct _YR_SCAN_CONTROL
+{
+  volatile int cancelled;
+
+  uint64_t timeout_us;              // Set by yr_scan_context_set_timeout
+  uint64_t deadline;                // Monotonic clock in microseconds
+
+  YR_PROGRESS_FUNC progress_callback;
+  void* progress_data;
+
+  uint64_t bytes_total;
+  volatile uint64_t bytes_scanned;
+
+} YR_SCAN_CONTROL;
+
+
+typedef struct _YR_CODE_STATS
+{
+  uint32_t size;
+  uint32_t optimized_size;
+
+} YR_CODE_STATS;
+
+
 typedef struct _YR_COMPILER
 {
   int                 last_result;
@@ -528,9 +620,24 @@ typedef struct _YR_COMPILER
   YR_NAMESPACE*       current_namespace;
   YR_STRING*          current_rule_strings;
 
+  YR_STRING**         string_set;
+  int                 string_set_count;
+  int                 string_set_size;
+
   int                 current_rule_flags;
   int                 externals_count;
   int                 namespaces_count;
+  int                 rules_count;
+  int                 strings_count;
+
+  int8_t*             last_instruction;
+  int                 last_expression_is_boolean;
+
+  int8_t**            pending_jumps[MAX_PENDING_JUMPS];
+  int                 pending_jumps_count;
+
+  YR_RULE**           current_rule_init;
+  int8_t**            current_rule_skip;
 
   int8_t*             loop_address[MAX_LOOP_NESTING];
   char*               loop_identifier[MAX_LOOP_NESTING];
@@ -538,6 +645,8 @@ typedef struct _YR_COMPILER
 
   int                 allow_includes;
 
+  YR_CODE_STATS       code_stats;
+
   char*               file_name_stack[MAX_INCLUDE_DEPTH];
   int                 file_name_stack_ptr;
 
@@ -566,9 +675,54 @@ typedef struct _YR_MEMORY_BLOCK
 } YR_MEMORY_BLOCK;
 
 
+typedef struct _YR_RE_LIMITS
+{
+  size_t scan_limit;      // Max bytes examined by a single regexp execution
+  uint32_t cost_budget;   // Max thread steps per execution, 0 means no limit
+
+} YR_RE_LIMITS;
+
+
+typedef struct _YR_RE_STATS
+{
+  uint32_t executions;
+  uint32_t jit_executions;    // Executions of native code, hex strings too
+  uint32_t scan_limit_exceeded;
+  uint32_t cost_budget_exceeded;
+
+} YR_RE_STATS;
+
+
+typedef struct _YR_RULE_PROFILE
+{
+  YR_RULE* rule;
+  uint64_t instructions;    // Condition instructions executed
+  uint64_t cycles;          // Time spent evaluating the condition
+
+} YR_RULE_PROFILE;
+
+
+typedef struct _YR_STRING_PROFILE
+{
+  YR_STRING* string;
+  uint64_t atom_hits;       // Times an atom of the string was found
+  uint64_t verifications;   // Times the string was verified
+  uint64_t matches;         // Matches found by verifications
+  uint64_t cycles;          // Time spent verifying the string
+
+} YR_STRING_PROFILE;
+
+
+typedef struct _YR_PROFILING_INFO
+{
+  YR_RULE_PROFILE* rules;
+  YR_STRING_PROFILE* strings;
+
+} YR_PROFILING_INFO;
+
+
 typedef struct _YR_RULES {
 
-  int threads_count;
   uint8_t* code_start;
   mutex_t mutex;
 
@@ -577,9 +731,107 @@ typedef struct _YR_RULES {
   YR_EXTERNAL_VARIABLE* externals_list_head;
   YR_AC_AUTOMATON* automaton;
 
+  struct _RE_JIT* re_jit;
+
+  YR_RE_LIMITS re_limits;
+
+  // Limits for strings set with yr_rules_set_string_re_limits, indexed by
+  // the idx of strings. NULL until some string gets its own limits.
+
+  YR_RE_LIMITS* strings_re_limits;
+
+  // Number of threads scanning large memory blocks in parallel, each of
+  // them takes a chunk of the block (see yr_rules_set_scan_threads).
+
+  int scan_threads;
+
+  int rules_count;
+  int strings_count;
+  int namespaces_count;
+  int externals_count;
+
+  // Scan contexts used by the yr_rules_scan_* functions, one for each
+  // tidx. They outlive the threads, a thread taking a tidx released by
+  // another one reuses its context.
+
+  struct _YR_SCAN_CONTEXT* thread_contexts[MAX_THREADS];
+
+  // Profiling information is collected by each scan context once profiling
+  // is enabled, and added up here when the context is destroyed.
+
+  int profiling_enabled;
+  YR_PROFILING_INFO* profiling_info;
+
 } YR_RULES;
 
 
+// A rules handle holds the rules new scans should use, which can be
+// replaced at any time while other threads are scanning. Threads scanning
+// with rules obtained from the handle publish them in hazards[tidx] until
+// they are done, replaced rules are kept in the retired list until no
+// thread has them published.
+
+typedef struct _YR_RULES_HANDLE
+{
+  YR_RULES* volatile current;
+  YR_RULES* volatile hazards[MAX_THREADS];
+
+  struct _YR_RETIRED_RULES* volatile retired;
+  mutex_t mutex;
+
+} YR_RULES_HANDLE;
+
+
+typedef struct _YR_MATCHES
+{
+  YR_MATCH* head;
+  YR_MATCH* tail;
+  YR_MATCH_INDEX* index;
+  int32_t count;
+
+} YR_MATCHES;
+
+
+// Everything modified while scanning. Flags and matches are kept in arrays
+// indexed by the idx of rules, namespaces and strings, which leaves the
+// rules untouched. A context can't be used by two scans at the same time,
+// but any number of contexts can scan concurrently with the same rules.
+
+typedef struct _YR_SCAN_CONTEXT
+{
+  YR_RULES* rules;
+
+  int32_t* rules_flags;             // RULE_TFLAGS_* for each rule
+  int32_t* namespaces_flags;        // NAMESPACE_TFLAGS_* for each namespace
+  uint64_t* matched_strings;        // A bit for each string that matched
+  YR_MATCHES* matches;              // Matches found for each string
+
+  // Indexes of the rules with flags set and of the strings with matches in
+  // the current scan. Only these are cleaned when the scan ends.
+
+  int32_t* dirty_rules;
+  int32_t* dirty_strings;
+  int32_t dirty_rules_count;
+  int32_t dirty_strings_count;
+
+  // Values of external variables for scans with this context, indexed like
+  // the rules' externals list. Variables with EXTERNAL_VARIABLE_TYPE_NULL
+  // here take the value defined in the rules.
+
+  YR_EXTERNAL_VARIABLE* externals;
+
+  YR_RE_STATS re_stats;             // Regexp stats for the last scan
+  YR_PROFILING_INFO* profiling_info;
+  YR_SCAN_CONTROL* control;
+
+  // Matches found while scanning a chunk of a block in parallel with other
+  // threads are logged here instead of being added to the lists.
+
+  struct _MATCH_LOG* match_log;
+
+} YR_SCAN_CONTEXT;
+
+
 extern char lowercase[256];
 extern char altercase[256];
 
@@ -598,6 +850,18 @@ int yr_get_tidx(void);
 void yr_set_tidx(int);
 
 
+int yr_acquire_tidx(void);
+
+
+void yr_release_tidx(int);
+
+
+YR_SCAN_CONTEXT* yr_get_scan_context(void);
+
+
+void yr_set_scan_context(YR_SCAN_CONTEXT*);
+
+
 int yr_compiler_create(
     YR_COMPILER** compiler);
 
@@ -660,6 +924,11 @@ int yr_compiler_get_rules(
     YR_RULES** rules);
 
 
+void yr_compiler_get_code_stats(
+    YR_COMPILER* compiler,
+    YR_CODE_STATS* stats);
+
+
 int yr_rules_scan_mem(
     YR_RULES* rules,
     uint8_t* buffer,
@@ -688,6 +957,80 @@ int yr_rules_scan_proc(
     int timeout);
 
 
+int yr_scan_context_create(
+    YR_RULES* rules,
+    YR_SCAN_CONTEXT** context);
+
+
+void yr_scan_context_destroy(
+    YR_SCAN_CONTEXT* context);
+
+
+int yr_scan_context_set_integer_variable(
+    YR_SCAN_CONTEXT* context,
+    int index,
+    int64_t value);
+
+
+int yr_scan_context_set_boolean_variable(
+    YR_SCAN_CONTEXT* context,
+    int index,
+    int value);
+
+
+int yr_scan_context_set_string_variable(
+    YR_SCAN_CONTEXT* context,
+    int index,
+    const char* value);
+
+
+void yr_scan_context_reset_variables(
+    YR_SCAN_CONTEXT* context);
+
+
+void yr_scan_context_cancel(
+    YR_SCAN_CONTEXT* context);
+
+
+void yr_scan_context_set_timeout(
+    YR_SCAN_CONTEXT* context,
+    uint64_t timeout_us);
+
+
+void yr_scan_context_set_progress_callback(
+    YR_SCAN_CONTEXT* context,
+    YR_PROGRESS_FUNC callback,
+    void* user_data);
+
+
+int yr_scan_context_scan_mem(
+    YR_SCAN_CONTEXT* context,
+    uint8_t* buffer,
+    size_t buffer_size,
+    YR_CALLBACK_FUNC callback,
+    void* user_data,
+    int fast_scan_mode,
+    int timeout);
+
+
+int yr_scan_context_scan_file(
+    YR_SCAN_CONTEXT* context,
+    const char* filename,
+    YR_CALLBACK_FUNC callback,
+    void* user_data,
+    int fast_scan_mode,
+    int timeout);
+
+
+int yr_scan_context_scan_proc(
+    YR_SCAN_CONTEXT* context,
+    int pid,
+    YR_CALLBACK_FUNC callback,
+    void* user_data,
+    int fast_scan_mode,
+    int timeout);
+
+
 int yr_rules_save(
     YR_RULES* rules,
     const char* filename);
@@ -698,10 +1041,37 @@ int yr_rules_load(
     YR_RULES** rules);
 
 
+int yr_rules_duplicate(
+    YR_RULES* rules,
+    YR_RULES** duplicated_rules);
+
+
 int yr_rules_destroy(
     YR_RULES* rules);
 
 
+int yr_rules_handle_create(
+    YR_RULES* rules,
+    YR_RULES_HANDLE** handle);
+
+
+void yr_rules_handle_destroy(
+    YR_RULES_HANDLE* handle);
+
+
+YR_RULES* yr_rules_handle_acquire(
+    YR_RULES_HANDLE* handle);
+
+
+void yr_rules_handle_release(
+    YR_RULES_HANDLE* handle);
+
+
+int yr_rules_handle_swap(
+    YR_RULES_HANDLE* handle,
+    YR_RULES* rules);
+
+
 int yr_rules_define_integer_variable(
     YR_RULES* rules,
     const char* identifier,
@@ -719,5 +1089,49 @@ int yr_rules_define_string_variable(
     const char* identifier,
     const char* value);
 
+
+int yr_rules_get_variable_index(
+    YR_RULES* rules,
+    const char* identifier);
+
+
+void yr_rules_set_re_limits(
+    YR_RULES* rules,
+    size_t scan_limit,
+    uint32_t cost_budget);
+
+
+int yr_rules_set_string_re_limits(
+    YR_RULES* rules,
+    YR_STRING* string,
+    size_t scan_limit,
+    uint32_t cost_budget);
+
+
+void yr_rules_set_scan_threads(
+    YR_RULES* rules,
+    int threads);
+
+
+void yr_rules_get_re_stats(
+    YR_RULES* rules,
+    YR_RE_STATS* stats);
+
+
+int yr_rules_enable_profiling(
+    YR_RULES* rules);
+
+
+int yr_rules_get_slowest_rules(
+    YR_RULES* rules,
+    YR_RULE_PROFILE* profiles,
+    int* count);
+
+
+int yr_rules_get_slowest_strings(
+    YR_RULES* rules,
+    YR_STRING_PROFILE* profiles,
+    int* count);
+
 #endif
 
@@ -14,7 +14,23 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
 #include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(WIN32)
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
 
 #include "threading.h"
 
@@ -139,5 +155,257 @@ void thread_join(
 }
 
 
+//
+// cgroup_cpu_limit
+//
+// Returns the number of CPUs the process is allowed to use according to the
+// CPU quota of its control group, or zero if there's no quota.
+//
+
+int cgroup_cpu_limit()
+{
+  #if defined(__linux__)
+
+  FILE* fh;
+  char quota_str[32];
+  long quota = -1;
+  long period = 0;
+
+  // cgroup v2 exposes both quota and period in cpu.max, being the quota
+  // "max" when unlimited. Try cgroup v1 files if cpu.max doesn't exist.
+
+  fh = fopen("/sys/fs/cgroup/cpu.max", "r");
+
+  if (fh != NULL)
+  {
+    if (fscanf(fh, "%31s %ld", quota_str, &period) == 2 &&
+        strcmp(quota_str, "max") != 0)
+      quota = atol(quota_str);
+
+    fclose(fh);
+  }
+  else
+  {
+    fh = fopen("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", "r");
+
+    if (fh != NULL)
+    {
+      if (fscanf(fh, "%ld", &quota) != 1)
+        quota = -1;
+
+      fclose(fh);
+    }
+
+    fh = fopen("/sys/fs/cgroup/cpu/cpu.cfs_period_us", "r");
+
+    if (fh != NULL)
+    {
+      if (fscanf(fh, "%ld", &period) != 1)
+        period = 0;
+
+      fclose(fh);
+    }
+  }
+
+  if (quota > 0 && period > 0)
+    return (int) ((quota + period - 1) / period);
+
+  #endif
+
+  return 0;
+}
+
+
+//
+// get_available_cpus
+//
+// Fills cpus with the identifiers of the CPUs the process can run on and
+// returns how many of them there are. cpus can be NULL for just counting.
+//
+
+int get_available_cpus(
+    int* cpus,
+    int max_cpus)
+{
+  int count = 0;
+  int i;
+
+  #if defined(WIN32)
+
+  DWORD_PTR process_mask;
+  DWORD_PTR system_mask;
+
+  if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask))
+  {
+    for (i = 0; i < sizeof(DWORD_PTR) * 8 && count < max_cpus; i++)
+    {
+      if (process_mask & ((DWORD_PTR) 1 << i))
+      {
+        if (cpus != NULL)
+          cpus[count] = i;
+
+        count++;
+      }
+    }
+  }
+
+  #elif defined(__linux__)
+
+  cpu_set_t cpu_set;
+
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0)
+  {
+    for (i = 0; i < CPU_SETSIZE && count < max_cpus; i++)
+    {
+      if (CPU_ISSET(i, &cpu_set))
+      {
+        if (cpus != NULL)
+          cpus[count] = i;
+
+        count++;
+      }
+    }
+  }
+
+  #endif
+
+  #if !defined(WIN32)
+
+  if (count == 0)
+  {
+    long online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (i = 0; i < online_cpus && count < max_cpus; i++)
+    {
+      if (cpus != NULL)
+        cpus[count] = i;
+
+      count++;
+    }
+  }
+
+  #endif
+
+  return count;
+}
+
+
+//
+// get_cpu_count
+//
+// Returns the number of available CPUs limited by the CPU quota of the
+// process' control group, if any.
+//
+
+int get_cpu_count()
+{
+  int count = get_available_cpus(NULL, MAX_CPUS);
+  int limit = cgroup_cpu_limit();
+
+  if (limit > 0 && limit < count)
+    count = limit;
+
+  return count > 0 ? count : 1;
+}
+
+
+//
+// get_cpu_numa_node
+//
+// Returns the NUMA node of the given CPU, or zero if unknown.
+//
+
+int get_cpu_numa_node(
+    int cpu)
+{
+  #if defined(WIN32)
+
+  UCHAR node;
+
+  if (GetNumaProcessorNode((UCHAR) cpu, &node))
+    return node;
+
+  #elif defined(__linux__)
+
+  DIR* dp;
+  struct dirent* de;
+  char cpu_path[64];
+  int node = -1;
+
+  // Each CPU directory in sysfs contains a link named "node<N>" pointing to
+  // the NUMA node the CPU belongs to.
+
+  snprintf(cpu_path, sizeof(cpu_path), "/sys/devices/system/cpu/cpu%d", cpu);
+
+  dp = opendir(cpu_path);
+
+  if (dp != NULL)
+  {
+    de = readdir(dp);
+
+    while (de != NULL && node < 0)
+    {
+      if (strncmp(de->d_name, "node", 4) == 0 &&
+          de->d_name[4] >= '0' && de->d_name[4] <= '9')
+        node = atoi(de->d_name + 4);
+
+      de = readdir(dp);
+    }
+
+    closedir(dp);
+  }
 
+  if (node >= 0)
+    return node;
 
+  #endif
+
+  return 0;
+}
+
+
+//
+// thread_set_affinity
+//
+// Restricts the calling thread to run in the given CPUs. Returns 0 on
+// success.
+//
+
+int thread_set_affinity(
+    int* cpus,
+    int cpus_count)
+{
+  int i;
+
+  #if defined(WIN32)
+
+  DWORD_PTR mask = 0;
+
+  for (i = 0; i < cpus_count; i++)
+  {
+    if (cpus[i] < sizeof(DWORD_PTR) * 8)
+      mask |= (DWORD_PTR) 1 << cpus[i];
+  }
+
+  if (mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0)
+    return 0;
+
+  #elif defined(__linux__)
+
+  cpu_set_t cpu_set;
+
+  CPU_ZERO(&cpu_set);
+
+  for (i = 0; i < cpus_count; i++)
+  {
+    if (cpus[i] < CPU_SETSIZE)
+      CPU_SET(cpus[i], &cpu_set);
+  }
+
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0)
+    return 0;
+
+  #endif
+
+  return -1;
+}
@@ -43,6 +43,8 @@ typedef void *(*THREAD_START_ROUTINE) (void *);
 
 #endif
 
+#define MAX_CPUS  1024
+
 void mutex_init(
     MUTEX* mutex);
 
@@ -76,4 +78,17 @@ int create_thread(
 void thread_join(
     THREAD* thread);
 
+int get_available_cpus(
+    int* cpus,
+    int max_cpus);
+
+int get_cpu_count();
+
+int get_cpu_numa_node(
+    int cpu);
+
+int thread_set_affinity(
+    int* cpus,
+    int cpus_count);
+
 #endif
\ No newline at end of file
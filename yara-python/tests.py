@@ -1,6 +1,10 @@
 import tempfile
 import binascii
 import os
+import shutil
+import subprocess
+import threading
+import time
 import unittest
 import yara
 
@@ -176,6 +180,53 @@ class TestYara(unittest.TestCase):
           else:
             self.assertFalse(matches)
 
+    def runCommandLine(self, *args):
+
+        # The command-line tool is found next to yara-python in the source
+        # tree, tests using it are skipped if it wasn't built.
+
+        path = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'yara')
+
+        if not os.path.isfile(path):
+            self.skipTest('yara command-line tool not built')
+
+        p = subprocess.Popen(
+            [path] + list(args), stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+
+        out, err = p.communicate()
+
+        return out.splitlines(), err.splitlines()
+
+    def makeScanTree(self):
+
+        # Files matching "ssi" at different offsets, some that don't match,
+        # an empty one, one larger than a batch and two levels of
+        # subdirectories.
+
+        root = tempfile.mkdtemp()
+        os.makedirs(os.path.join(root, 'sub', 'sub2'))
+
+        def write(name, data):
+            f = open(os.path.join(root, name), 'wb')
+            f.write(data)
+            f.close()
+
+        for i in range(60):
+            write('f%d' % i, ' ' * i + 'mississippi')
+
+        for i in range(5):
+            write('n%d' % i, 'hello')
+            write(os.path.join('sub', 's%d' % i), 'mississippi')
+            write(os.path.join('sub', 'sub2', 't%d' % i), 'mississippi')
+
+        write('empty', '')
+        write('big', '\x00' * 2000000 + 'mississippi')
+
+        rules_path = os.path.join(root, 'rules')
+        write('rules', 'rule test { strings: $a = "ssi" condition: $a }')
+
+        return root, rules_path
+
     def testBooleanOperators(self):
 
         self.assertTrueRules([
@@ -273,6 +324,28 @@ class TestYara(unittest.TestCase):
             'rule test { strings: $a = "abc" wide fullword condition: $a }',
         ], "x\x01a\x00b\x00c\x00")
 
+        self.assertTrueRules([
+            'rule test { strings: $a = "c" wide fullword condition: $a }',
+            'rule test { strings: $a = "C" wide nocase fullword condition: $a }',
+        ], "\x00xc\x00 ")
+
+        self.assertFalseRules([
+            'rule test { strings: $a = "c" wide fullword condition: $a }',
+            'rule test { strings: $a = "C" wide nocase fullword condition: $a }',
+        ], "x\x00c\x00 ")
+
+        self.assertTrueRules([
+            'rule test { strings: $a = "c" ascii wide condition: #a == 1 and $a at 1 }',
+            'rule test { strings: $a = "C" ascii wide nocase condition: #a == 1 and $a at 1 }',
+            'rule test { strings: $a = /c[^x]/ ascii wide condition: #a == 1 and $a at 1 }',
+            'rule test { strings: $a = /C/ ascii wide nocase condition: #a == 1 and $a at 1 }',
+        ], "xc\x00y")
+
+        self.assertTrueRules([
+            'rule test { strings: $a = "abc" ascii wide condition: #a == 2 and @a[1] == 0 and @a[2] == 6 }',
+            'rule test { strings: $a = /ab[a-z]/ ascii wide condition: #a == 2 and @a[1] == 0 and @a[2] == 6 }',
+        ], "a\x00b\x00c\x00abc\x00")
+
         self.assertTrueRules([
             'rule test {\
                 strings:\
@@ -303,20 +376,65 @@ class TestYara(unittest.TestCase):
             'rule test { strings: $a = { 64 0? 00 00 ?0 01 } condition: $a }',
             'rule test { strings: $a = { 64 01 [1-3] 60 01 } condition: $a }',
             'rule test { strings: $a = { 64 01 [1-3] (60|61) 01 } condition: $a }',
+            'rule test { strings: $a = { 4d 5a [58] 40 00 00 00 50 45 } condition: $a }',
+            'rule test { strings: $a = { 4d 5a [0-62] 50 45 00 00 } condition: $a }',
+            'rule test { strings: $a = { 50 45 00 00 ( 4c 01 | 64 86 ) } condition: $a }',
+            'rule test { strings: $a = { 50 ( 45 | 46 ) ( 00 ( 00 | 01 ) | 01 ) 4c } condition: $a }',
+            'rule test { strings: $a = { 6a ?a 58 [0-2] c3 } condition: $a }',
+            'rule test { strings: $a = { 2e 74 65 78 74 [1-4] ( 04 | 05 ) 00 00 00 } condition: $a }',
         ], PE32_FILE)
 
+        self.assertFalseRules([
+            'rule test { strings: $a = { 4d 5a [0-61] 50 45 00 00 } condition: $a }',
+            'rule test { strings: $a = { 4d 5a [63-70] 50 45 00 00 } condition: $a }',
+            'rule test { strings: $a = { 50 45 00 00 ( 64 86 | 00 02 ) } condition: $a }',
+            'rule test { strings: $a = { 6a ?b 58 [0-2] c3 } condition: $a }',
+        ], PE32_FILE)
+
+        self.assertTrueRules([
+            'rule test { strings: $a = { 73 [0-5] 70 70 69 } condition: #a == 4 and @a[1] == 2 and @a[4] == 6 }',
+            'rule test { strings: $a = { ( 6d | 73 ) [1-3] 73 69 70 70 } condition: #a == 2 and @a[2] == 3 }',
+            'rule test { strings: $a = { ?? 69 [2] 69 73 73 69 } condition: #a == 1 and $a at 0 }',
+            'rule test { strings: $a = { 6d [0-5] 73 69 70 } condition: $a at 0 }',
+        ], 'mississippi')
+
+        self.assertFalseRules([
+            'rule test { strings: $a = { 6d [0-4] 73 69 70 } condition: $a }',
+            'rule test { strings: $a = { 6d [1-3] 73 69 70 70 } condition: $a }',
+        ], 'mississippi')
+
+        self.assertTrueRules([
+            'rule test { strings: $a = { 61 [1-2] 61 [1-2] 62 63 64 65 } condition: #a == 3 and @a[3] == 2 }',
+            'rule test { strings: $a = { 61 ?? 61 [0-1] 62 63 64 65 } condition: #a == 2 and @a[1] == 2 }',
+        ], 'aaaaaabcde')
+
     def testCount(self):
 
         self.assertTrueRules([
             'rule test { strings: $a = "ssi" condition: #a == 2 }',
         ], 'mississippi')
 
+        self.assertTrueRules([
+            'rule test { strings: $a = "a" condition: #a == 40 }',
+            'rule test { strings: $a = "ab" condition: #a == 21 }',
+        ], 'a' * 20 + 'b' + 'ab' * 20)
+
     def testAt(self):
 
         self.assertTrueRules([
             'rule test { strings: $a = "ssi" condition: $a at 2 and $a at 5 }',
         ], 'mississippi')
 
+        self.assertTrueRules([
+            'rule test { strings: $a = "a" condition: $a at 10 and $a at 19 and $a at 21 and $a at 59 }',
+            'rule test { strings: $a = "a" condition: $a in (20..21) and $a in (41..41) and $a in (58..70) }',
+        ], 'a' * 20 + 'b' + 'ab' * 20)
+
+        self.assertFalseRules([
+            'rule test { strings: $a = "a" condition: $a at 20 or $a at 22 or $a at 60 }',
+            'rule test { strings: $a = "a" condition: $a in (20..20) or $a in (42..42) or $a in (60..100) }',
+        ], 'a' * 20 + 'b' + 'ab' * 20)
+
     def testOffset(self):
 
         self.assertTrueRules([
@@ -325,6 +443,16 @@ class TestYara(unittest.TestCase):
             'rule test { strings: $a = "ssi" condition: @a[2] == 5 }'
         ], 'mississippi')
 
+        self.assertTrueRules([
+            'rule test { strings: $a = "a" condition: @a[1] == 0 and @a[20] == 19 and @a[21] == 21 and @a[40] == 59 }',
+            'rule test { strings: $a = "a" condition: for all i in (21..40) : (@a[i] == 2 * i - 21) }',
+            'rule test { strings: $a = "ab" condition: @a[1] == 19 and @a[21] == 59 }',
+        ], 'a' * 20 + 'b' + 'ab' * 20)
+
+        self.assertFalseRules([
+            'rule test { strings: $a = "a" condition: @a[41] == 61 or @a[0] == 0 }',
+        ], 'a' * 20 + 'b' + 'ab' * 20)
+
     def testOf(self):
 
         self.assertTrueRules([
@@ -370,6 +498,42 @@ class TestYara(unittest.TestCase):
             'rule test { strings: $a = /ssissi/ fullword condition: $a }'
         ], 'mississippi')
 
+        self.assertTrueRules([
+            'rule test { strings: $a = /MZ\\x00+@\\x00\\x00\\x00PE/ condition: $a }',
+            'rule test { strings: $a = /MZ\\x00{58}@/ condition: $a }',
+            'rule test { strings: $a = /P[A-F]\\x00\\x00[Ll]\\x01/ condition: $a }',
+            'rule test { strings: $a = /\\.te(x|s)t\\x00/ condition: $a }',
+        ], PE32_FILE)
+
+        self.assertFalseRules([
+            'rule test { strings: $a = /P[^E]\\x00\\x00L/ condition: $a }',
+        ], PE32_FILE)
+
+        self.assertTrueRules([
+            'rule test { strings: $a = /ss(i|a)[a-z]{2}/ condition: #a == 2 and @a[2] == 5 }',
+            'rule test { strings: $a = /s[^s]p/ condition: @a == 6 }',
+        ], 'mississippi')
+
+        self.assertTrueRules([
+            'rule test { strings: $a = /s[si]*p/ wide condition: #a == 4 and @a[1] == 4 }',
+            'rule test { strings: $a = /MIS+I(S|P)/ wide nocase condition: $a }',
+        ], 'm\x00i\x00s\x00s\x00i\x00s\x00s\x00i\x00p\x00p\x00i\x00')
+
+        self.assertFalseRules([
+            'rule test { strings: $a = /s[si]*p/ wide condition: $a }',
+            'rule test { strings: $a = /M[^a-h]SS[I-J]p+/ nocase condition: $a }',
+        ], 'mississippi')
+
+        self.assertTrueRules([
+            'rule test { strings: $a = /[a-c][0-9]/ condition: #a == 3 and @a[3] == 10 }',
+            'rule test { strings: $a = /(x|y)+[0-9]/ condition: #a == 4 and @a[4] == 18 }',
+            'rule test { strings: $a = /[A-Z]x[0-9]/ nocase condition: #a == 2 and @a[2] == 17 }',
+        ], 'a1 xyy9 b2c3 BX2 ax1')
+
+        self.assertFalseRules([
+            'rule test { strings: $a = /[a-c][0-9]/ condition: $a }',
+        ], 'd1 xx e2 f3')
+
         for test in RE_TESTS:
             try:
                 self.runReTest(test)
@@ -377,6 +541,154 @@ class TestYara(unittest.TestCase):
                 print '\nFailed test: %s\n' % str(test)
                 raise e
 
+    def testReLimits(self):
+
+        data = 'abc' + 'q' * 70000 + 'xyz'
+
+        r = yara.compile(source='rule test { strings: $a = /abc[^z]*xyz/ condition: $a }')
+        self.assertFalse(r.match(data=data))
+        self.assertTrue(r.re_stats()['scan_limit_exceeded'] == 1)
+
+        r.set_re_limits(100000)
+        self.assertTrue(r.match(data=data))
+        self.assertTrue(r.re_stats()['scan_limit_exceeded'] == 0)
+
+        data = 'abc' + 'q' * 1000 + 'xyz'
+
+        r.set_re_limits(65535, 10)
+        self.assertFalse(r.match(data=data))
+        self.assertTrue(r.re_stats()['cost_budget_exceeded'] == 1)
+
+        r.set_re_limits(65535, 0)
+        self.assertTrue(r.match(data=data))
+        self.assertTrue(r.re_stats()['cost_budget_exceeded'] == 0)
+
+        r = yara.compile(source='rule test { strings: $a = /abc[^z]*xyz/ $b = /abc[^y]*xyz/ condition: $b and not $a }')
+        r.set_re_limits(65535, 10)
+        self.assertFalse(r.match(data=data))
+        self.assertTrue(r.re_stats()['cost_budget_exceeded'] == 2)
+
+        r.set_string_re_limits('test', '$b', 65535, 0)
+        self.assertTrue(r.match(data=data))
+        self.assertTrue(r.re_stats()['cost_budget_exceeded'] == 1)
+
+        r.set_string_re_limits('test', '$b', 0)
+        self.assertFalse(r.match(data=data))
+
+        self.assertRaises(ValueError, r.set_string_re_limits, 'test', '$c', 1000)
+
+        self.assertRaises(yara.SyntaxError, yara.compile, source='rule test { strings: $a = /MZ.{0,200000}PE/ condition: $a }')
+
+    def testProfiling(self):
+
+        r = yara.compile(source='rule test1 { strings: $a = "ssi" condition: $a } rule test2 { strings: $b = /s+i/ condition: #b > 10 }')
+        self.assertEqual(r.slowest_rules(), [])
+
+        r.enable_profiling()
+        r.match(data='mississippi')
+        r.match(data='mississippi')
+
+        profiles = r.slowest_rules()
+        self.assertEqual(sorted(p['rule'] for p in profiles), ['test1', 'test2'])
+        self.assertTrue(all(p['instructions'] > 0 for p in profiles))
+        self.assertEqual(len(r.slowest_rules(1)), 1)
+
+        profiles = dict((p['string'], p) for p in r.slowest_strings())
+        self.assertEqual(profiles['$a']['rule'], 'test1')
+        self.assertEqual(profiles['$a']['matches'], 4)
+        self.assertEqual(profiles['$b']['rule'], 'test2')
+        self.assertEqual(profiles['$b']['matches'], 8)
+        self.assertTrue(profiles['$b']['verifications'] >= 4)
+
+    def testScanThreads(self):
+
+        # With two threads the data is split in two chunks of 1MB, these
+        # strings match across or right after the boundary between them.
+
+        chunk_size = 1024 * 1024
+        data = '\x00' * (chunk_size - 6) + 'mississippi' + 'ab' * 10 + '\x00' * (chunk_size - 25)
+
+        rules = [
+            'rule test { strings: $a = "mississippi" condition: #a == 1 and $a at %d }' % (chunk_size - 6),
+            'rule test { strings: $a = "ssi" condition: #a == 2 and @a[1] == %d and @a[2] == %d }' % (chunk_size - 4, chunk_size - 1),
+            'rule test { strings: $a = /s+i/ condition: #a == 4 and $a at %d and $a at %d }' % (chunk_size - 3, chunk_size),
+            'rule test { strings: $a = { 73 73 69 [1-4] 69 } condition: #a == 2 and $a at %d and $a at %d }' % (chunk_size - 4, chunk_size - 1),
+            'rule test { strings: $a = "ab" condition: #a == 10 and @a[10] == %d }' % (chunk_size + 23),
+            'rule test { strings: $a = "ppiab" condition: $a in (%d..%d) }' % (chunk_size, chunk_size + 5),
+        ]
+
+        for source in rules:
+            r = yara.compile(source=source)
+            self.assertTrue(r.match(data=data))
+            r.set_scan_threads(2)
+            self.assertTrue(r.match(data=data), msg=source)
+            r.set_scan_threads(1)
+            self.assertTrue(r.match(data=data))
+
+    def testThreads(self):
+
+        r = yara.compile(source='rule test { strings: $a = "ssi" condition: $a }')
+        results = []
+
+        def match():
+            try:
+                results.append(bool(r.match(data='mississippi')))
+            except yara.Error, e:
+                results.append(str(e))
+
+        # Threads exiting release their thread index, more threads than
+        # MAX_THREADS can scan one after the other.
+
+        for i in range(40):
+            t = threading.Thread(target=match)
+            t.start()
+            t.join()
+
+        self.assertEqual(results, [True] * 40)
+
+    def testRulesHandle(self):
+
+        r1 = yara.compile(source='rule test1 { strings: $a = "ssi" condition: $a }')
+        r2 = yara.compile(source='rule test2 { strings: $a = "ppi" condition: $a }')
+
+        h = r1.handle()
+        self.assertEqual([m.rule for m in h.match('mississippi')], ['test1'])
+
+        h.swap(r2)
+        self.assertEqual([m.rule for m in h.match('mississippi')], ['test2'])
+        self.assertEqual([m.rule for m in r1.match(data='mississippi')], ['test1'])
+
+        self.assertRaises(TypeError, h.swap, 'test')
+
+        # Threads scanning while the rules are swapped get either of them,
+        # the replaced ones are destroyed only when no thread uses them.
+
+        results = []
+        done = []
+
+        def match():
+            while not done:
+                try:
+                    results.append(tuple(m.rule for m in h.match('mississippi' * 1000)))
+                except yara.Error, e:
+                    results.append(str(e))
+
+        threads = [threading.Thread(target=match) for i in range(4)]
+
+        for t in threads:
+            t.start()
+
+        for i in range(200):
+            h.swap(r1 if i % 2 else r2)
+
+        done.append(True)
+
+        for t in threads:
+            t.join()
+
+        self.assertTrue(len(results) > 0)
+        self.assertEqual(set(results) - set([('test1',), ('test2',)]), set())
+
     def testEntrypoint(self):
 
         self.assertTrueRules([
@@ -401,6 +713,25 @@ class TestYara(unittest.TestCase):
             'rule test { condition: filesize == %d }' % len(PE32_FILE),
         ], PE32_FILE)
 
+    def testIntFunctions(self):
+
+        self.assertTrueRules([
+            'rule test { condition: uint8(0) == 0x4d and uint16(0) == 0x5a4d and uint32(0x3c) == 0x40 }',
+            'rule test { condition: int8(1) == 0x5a and int16(0x40) == 0x4550 and int32(0x40) == 0x4550 }',
+        ], PE32_FILE)
+
+        self.assertTrueRules([
+            'rule test { condition: uint8(filesize - 1) == 0x69 and uint16(filesize - 2) == 0x6970 }',
+        ], 'mississippi')
+
+        self.assertFalseRules([
+            'rule test { condition: uint16(filesize - 1) == 0x69 or uint32(filesize - 3) == 0 or uint8(filesize) == 0 }',
+        ], 'mississippi')
+
+        self.assertTrueRules([
+            'rule test { condition: int8(0) < 0 and int16(0) < 0 and int32(0) < 0 and int8(0) == int32(0) }',
+        ], '\xff' * 4)
+
     def testCompileFile(self):
 
         f = tempfile.TemporaryFile('wt')
@@ -440,6 +771,28 @@ class TestYara(unittest.TestCase):
         os.remove(p1)
         os.remove(p2)
 
+    def testGlobalRules(self):
+
+        r = yara.compile(sources={
+            'ns1': 'global rule g { condition: filesize > 100 } rule a { strings: $a = "ssi" condition: $a } rule b { condition: true }',
+            'ns2': 'global rule g { condition: filesize < 100 } rule a { strings: $a = "ssi" condition: $a }',
+            'ns3': 'global rule g { condition: entrypoint == 0x400 or filesize < 100 } global rule h { strings: $a = "ppi" condition: $a } rule a { condition: true }',
+            'ns4': 'global rule g { condition: ext_int == 1 } rule a { strings: $a = "ssi" condition: $a }',
+            'ns5': 'rule x { condition: filesize < 100 } global rule g { condition: not x } rule a { condition: true }',
+        }, externals={'ext_int': 1})
+
+        def matches(**kwargs):
+            return sorted((m.namespace, m.rule) for m in r.match(**kwargs))
+
+        self.assertEqual(matches(data='mississippi'), [
+            ('ns2', 'a'), ('ns2', 'g'), ('ns3', 'a'), ('ns3', 'g'), ('ns3', 'h'), ('ns4', 'a'), ('ns4', 'g')])
+
+        self.assertEqual(matches(data=PE32_FILE), [
+            ('ns1', 'b'), ('ns1', 'g'), ('ns4', 'g'), ('ns5', 'a'), ('ns5', 'g')])
+
+        self.assertEqual(matches(data='mississippi', externals={'ext_int': 2}), [
+            ('ns2', 'a'), ('ns2', 'g'), ('ns3', 'a'), ('ns3', 'g'), ('ns3', 'h')])
+
     def testIncludeFiles(self):
 
         tmpdir = tempfile.gettempdir()
@@ -489,6 +842,155 @@ class TestYara(unittest.TestCase):
         r = yara.compile(source='rule test { condition: ext_str matches /ssi$/ }', externals={'ext_str': 'mississippi'})
         self.assertFalse(r.match(data='dummy'))
 
+        r = yara.compile(source='rule test { condition: ext_str matches /ssi(s|p)pi/ }', externals={'ext_str': 'mississippi'})
+        self.assertTrue(r.match(data='dummy'))
+
+        r = yara.compile(source='rule test { condition: ext_str matches /[p]{2}i/ }', externals={'ext_str': 'mississippi'})
+        self.assertTrue(r.match(data='dummy'))
+
+        r = yara.compile(source='rule test { condition: ext_str matches /ssiq/ }', externals={'ext_str': 'mississippi'})
+        self.assertFalse(r.match(data='dummy'))
+
+        r = yara.compile(source='rule test { condition: ext_str matches /[x-z]ss/ }', externals={'ext_str': 'mississippi'})
+        self.assertFalse(r.match(data='dummy'))
+
+    def testMatchExternals(self):
+
+        r = yara.compile(source='rule test { condition: ext_int == 15 }', externals={'ext_int': 15})
+        self.assertTrue(r.match(data='dummy'))
+        self.assertFalse(r.match(data='dummy', externals={'ext_int': 16}))
+        self.assertTrue(r.match(data='dummy'))
+
+        r = yara.compile(source='rule test { condition: ext_bool }', externals={'ext_bool': False})
+        self.assertTrue(r.match(data='dummy', externals={'ext_bool': True}))
+        self.assertFalse(r.match(data='dummy'))
+
+        r = yara.compile(source='rule test { condition: ext_str contains "ssi" }', externals={'ext_str': 'foo'})
+        self.assertTrue(r.match(data='dummy', externals={'ext_str': 'mississippi'}))
+        self.assertFalse(r.match(data='dummy'))
+
+        r = yara.compile(source='rule test { condition: ext_int == 15 and ext_str contains "foo" }', externals={'ext_int': 15, 'ext_str': 'foo'})
+        self.assertTrue(r.match(data='dummy', externals={'ext_str': 'foo'}))
+        self.assertFalse(r.match(data='dummy', externals={'ext_int': 0}))
+
+        self.assertRaises(TypeError, r.match, data='dummy', externals={'ext_int': 'foo'})
+        self.assertRaises(TypeError, r.match, data='dummy', externals={'ext_str': 15})
+        self.assertRaises(TypeError, r.match, data='dummy', externals={'ext_int': 1.5})
+        self.assertRaises(TypeError, r.match, data='dummy', externals=[])
+        self.assertTrue(r.match(data='dummy'))
+        self.assertTrue(r.match(data='dummy', externals={'ext_unknown': 1}))
+
+    def testNoStringMatches(self):
+
+        # Conditions of rules whose strings didn't match are skipped only
+        # when they are known to be false without them.
+
+        self.assertTrueRules([
+            'rule test { strings: $a = "foo" condition: not $a }',
+            'rule test { strings: $a = "foo" condition: #a == 0 }',
+            'rule test { strings: $a = "foo" condition: $a or filesize == 11 }',
+        ], 'mississippi')
+
+        self.assertFalseRules([
+            'rule test { strings: $a = "foo" condition: for all i in (1..#a) : (@a[i] > 0) }',
+            'rule test { strings: $a = "foo" condition: $a and filesize == 11 }',
+            'rule test { strings: $a = "foo" $b = "ssi" condition: $a and $b }',
+            'rule test { strings: $a = "foo" condition: 1 of them }',
+            'rule test { strings: $a = "foo" condition: $a at 0 }',
+            'rule test { strings: $a = "foo" condition: all of them }',
+        ], 'mississippi')
+
+    def testShortCircuit(self):
+
+        self.assertTrueRules([
+            'rule test { strings: $a = "ssi" condition: true or @a[3] == 0 }',
+            'rule test { condition: false or (true and true) }',
+            'rule test { condition: (false and false) or true }',
+            'rule test { strings: $a = "ssi" condition: $a or $a at 100 }',
+            'rule test { strings: $a = "ssi" $b = "foo" condition: not $b and $a }',
+            'rule test { strings: $a = "ssi" $b = "foo" condition: $b or #a == 2 }',
+        ], 'mississippi')
+
+        self.assertFalseRules([
+            'rule test { strings: $a = "ssi" condition: false and @a[1] == 2 }',
+            'rule test { condition: true and (false or false) }',
+            'rule test { strings: $a = "ssi" $b = "foo" condition: $b and $a }',
+            'rule test { strings: $a = "ssi" $b = "foo" condition: $a and ($b or $a at 100) }',
+        ], 'mississippi')
+
+        # Integer externals used as booleans take part in "and" and "or" with
+        # their whole value, not just as 0 or 1.
+
+        r = yara.compile(source='rule test { condition: ext_int and true }', externals={'ext_int': 2})
+        self.assertFalse(r.match(data='dummy'))
+        self.assertTrue(r.match(data='dummy', externals={'ext_int': 3}))
+
+        r = yara.compile(source='rule test { condition: (ext_int or true) and true }', externals={'ext_int': 2})
+        self.assertTrue(r.match(data='dummy'))
+
+        r = yara.compile(source='rule test { condition: (true or ext_int) and ext_int }', externals={'ext_int': 2})
+        self.assertTrue(r.match(data='dummy'))
+
+    def testConstantFolding(self):
+
+        self.assertTrueRules([
+            'rule test { condition: 1 + 2 * 3 == 7 }',
+            'rule test { condition: (10 - 4) \\ 3 == 2 and 7 % 4 == 3 }',
+            'rule test { condition: 1 << 4 | 1 == 17 }',
+            'rule test { condition: not (1 > 2) }',
+            'rule test { condition: filesize > 1 + 1 }',
+            'rule test { condition: true and filesize == 11 }',
+            'rule test { strings: $a = "ssi" condition: $a and 2 + 2 == 4 }',
+            'rule test { strings: $a = "ssi" $b = "foo" condition: (true and $b) or (false or $a) }',
+        ], 'mississippi')
+
+        self.assertFalseRules([
+            'rule test { condition: 1 + 2 * 3 == 9 }',
+            'rule test { condition: false and filesize == 11 }',
+            'rule test { condition: filesize < 2 * 2 }',
+            'rule test { strings: $a = "ssi" condition: $a and 2 + 2 == 5 }',
+            'rule test { strings: $a = "ssi" condition: false and $a }',
+        ], 'mississippi')
+
+    def testOperandOrder(self):
+
+        self.assertTrueRules([
+            'rule test { strings: $a = "ssi" condition: @a[10] == 0 or filesize == 11 }',
+            'rule test { strings: $a = "ssi" condition: not (@a[10] == 0 and filesize == 11) }',
+            'rule test { strings: $a = "ssi" condition: not (@a[10] == 0 or filesize == 10) }',
+            'rule test { strings: $a = "ssi" condition: for any i in (1..#a) : (@a[i] == 5 and filesize == 11) }',
+            'rule test { strings: $a = "ssi" $b = "ppi" condition: ($a at 5 or $b) and (filesize > 100 or $b in (8..8)) }',
+        ], 'mississippi')
+
+        self.assertFalseRules([
+            'rule test { strings: $a = "ssi" $b = "ppi" condition: ($a at 4 or @b[2] == 8) and filesize > 1 }',
+            'rule test { strings: $a = "ssi" $b = "ppi" condition: $a at 4 or @b[2] == 8 or filesize > 100 }',
+        ], 'mississippi')
+
+        r = yara.compile(source='rule test { strings: $a = "ssi" condition: ext_str matches /ssi/ and #a == 2 and filesize == 11 }', externals={'ext_str': 'mississippi'})
+        self.assertTrue(r.match(data='mississippi'))
+
+        r = yara.compile(source='rule test { strings: $a = "ssi" condition: ext_str contains "ssi" or @a[10] == 0 }', externals={'ext_str': 'mississippi'})
+        self.assertTrue(r.match(data='mississippi'))
+
+    def testOfMasks(self):
+
+        self.assertTrueRules([
+            'rule test { strings: $a1 = "ssi" $a2 = "ppi" condition: all of ($a*) }',
+            'rule test { strings: $a1 = "ssi" $a2 = "ppi" $b = "foo" condition: 2 of ($a1, $b, $a2) }',
+            'rule test { strings: $a1 = "ssi" $a2 = "ppi" $b = "foo" condition: any of ($b, $a2) and $a1 }',
+            'rule test { strings: $a1 = "ssi" $a2 = "ppi" $b = "foo" condition: not all of them }',
+            'rule test { strings: $a1 = "ssi" condition: 2 of ($a1, $a1) }',
+            'rule test { strings: $a1 = "ssi" $a2 = "ppi" condition: for all of ($a*) : ($ at 2 or $ at 8) }',
+        ], 'mississippi')
+
+        self.assertFalseRules([
+            'rule test { strings: $a1 = "ssi" $a2 = "ppi" $b = "foo" condition: all of them }',
+            'rule test { strings: $a1 = "ssi" $a2 = "ppi" $b = "foo" condition: 3 of ($a1, $b, $a2) }',
+            'rule test { strings: $a1 = "ssi" $b = "foo" condition: $a1 and any of ($b) }',
+            'rule test { strings: $a1 = "ssi" $b = "foo" condition: $a1 and 2 of ($b, $b) }',
+        ], 'mississippi')
+
     def testCallback(self):
 
         global rule_data
@@ -505,6 +1007,50 @@ class TestYara(unittest.TestCase):
         self.assertTrue(rule_data['matches'])
         self.assertTrue(rule_data['rule'] == 'test')
 
+    def testProgress(self):
+
+        r = yara.compile(source='rule test { strings: $a = "ssi" condition: $a }')
+        data = '\x00' * 256 * 1024 + 'mississippi'
+        calls = []
+
+        def progress(bytes_scanned, bytes_total):
+            calls.append((bytes_scanned, bytes_total))
+            return yara.CALLBACK_CONTINUE
+
+        self.assertTrue(r.match(data=data, progress=progress))
+        self.assertTrue(len(calls) > 1)
+        self.assertEqual(calls, sorted(calls))
+        self.assertTrue(all(total == len(data) for scanned, total in calls))
+
+        def abort(bytes_scanned, bytes_total):
+            return yara.CALLBACK_ABORT
+
+        self.assertRaises(yara.Error, r.match, data=data, progress=abort)
+
+        try:
+            r.match(data=data, progress=abort)
+        except yara.TimeoutError:
+            self.fail('cancelled scan raised TimeoutError')
+        except yara.Error, e:
+            self.assertEqual(str(e), 'scanning cancelled')
+
+        def fail(bytes_scanned, bytes_total):
+            raise ValueError('progress failed')
+
+        self.assertRaises(ValueError, r.match, data=data, progress=fail)
+        self.assertRaises(yara.Error, r.match, data=data, progress=1)
+
+        # The deadline is taken from a monotonic clock when the scan starts,
+        # the time spent in the progress function counts too.
+
+        def slow(bytes_scanned, bytes_total):
+            if bytes_scanned == 0:
+                time.sleep(1.1)
+            return yara.CALLBACK_CONTINUE
+
+        self.assertRaises(yara.TimeoutError, r.match, data=data, timeout=1, progress=slow)
+        self.assertTrue(r.match(data=data, timeout=10, progress=slow))
+
     def testCompare(self):
 
         r = yara.compile(sources={
@@ -536,6 +1082,67 @@ class TestYara(unittest.TestCase):
             """,
         ])
 
+    def testScanDirectory(self):
+
+        root, rules_path = self.makeScanTree()
+
+        try:
+            expected = ['test ' + os.path.join(root, 'f%d' % i) for i in range(60)]
+            expected += ['test ' + os.path.join(root, 'big'), 'test ' + rules_path]
+
+            for threads in ('1', '4', '16'):
+                out, err = self.runCommandLine('-j', threads, rules_path, root)
+                self.assertEqual(sorted(out), sorted(expected))
+                self.assertEqual(err, ['Error scanning %s: zero length file' % os.path.join(root, 'empty')])
+        finally:
+            shutil.rmtree(root)
+
+    def testScanDirectoryRecursive(self):
+
+        root, rules_path = self.makeScanTree()
+
+        try:
+            expected = ['test ' + os.path.join(root, 'f%d' % i) for i in range(60)]
+            expected += ['test ' + os.path.join(root, 'big'), 'test ' + rules_path]
+            expected += ['test ' + os.path.join(root, 'sub', 's%d' % i) for i in range(5)]
+            expected += ['test ' + os.path.join(root, 'sub', 'sub2', 't%d' % i) for i in range(5)]
+
+            for threads in ('1', '4', '16'):
+                out, err = self.runCommandLine('-r', '-j', threads, rules_path, root)
+                self.assertEqual(sorted(out), sorted(expected))
+                self.assertEqual(len(err), 1)
+
+            out, err = self.runCommandLine('-r', '-j', '4', rules_path, os.path.join(root, 'sub'))
+            self.assertEqual(sorted(out), sorted(expected[-10:]))
+        finally:
+            shutil.rmtree(root)
+
+    def testScanDirectoryOrdered(self):
+
+        root, rules_path = self.makeScanTree()
+
+        try:
+            # With -o results come in the order files are found, which
+            # doesn't depend on the number of threads.
+
+            ordered, err = self.runCommandLine('-o', '-r', '-j', '1', rules_path, root)
+            self.assertEqual(len(ordered), 72)
+
+            for threads in ('4', '16'):
+                out, err = self.runCommandLine('-o', '-r', '-j', threads, rules_path, root)
+                self.assertEqual(out, ordered)
+
+            # Matching strings are printed right after their file.
+
+            ordered, err = self.runCommandLine('-o', '-s', '-j', '1', rules_path, root)
+            out, err = self.runCommandLine('-o', '-s', '-j', '4', rules_path, root)
+            self.assertEqual(out, ordered)
+
+            i = ordered.index('test ' + os.path.join(root, 'f0'))
+            self.assertEqual(ordered[i + 1:i + 3], ['0x2:$a: ssi', '0x5:$a: ssi'])
+        finally:
+            shutil.rmtree(root)
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -210,6 +210,38 @@ static PyObject * Rules_save(
     PyObject *self,
     PyObject *args);
 
+static PyObject * Rules_set_re_limits(
+    PyObject *self,
+    PyObject *args);
+
+static PyObject * Rules_set_string_re_limits(
+    PyObject *self,
+    PyObject *args);
+
+static PyObject * Rules_set_scan_threads(
+    PyObject *self,
+    PyObject *args);
+
+static PyObject * Rules_handle(
+    PyObject *self,
+    PyObject *args);
+
+static PyObject * Rules_re_stats(
+    PyObject *self,
+    PyObject *args);
+
+static PyObject * Rules_enable_profiling(
+    PyObject *self,
+    PyObject *args);
+
+static PyObject * Rules_slowest_rules(
+    PyObject *self,
+    PyObject *args);
+
+static PyObject * Rules_slowest_strings(
+    PyObject *self,
+    PyObject *args);
+
 static PyObject * Rules_getattro(
     PyObject *self,
     PyObject *name);
@@ -226,6 +258,46 @@ static PyMethodDef Rules_methods[] =
     (PyCFunction) Rules_save,
     METH_VARARGS
   },
+  {
+    "set_re_limits",
+    (PyCFunction) Rules_set_re_limits,
+    METH_VARARGS
+  },
+  {
+    "set_string_re_limits",
+    (PyCFunction) Rules_set_string_re_limits,
+    METH_VARARGS
+  },
+  {
+    "set_scan_threads",
+    (PyCFunction) Rules_set_scan_threads,
+    METH_VARARGS
+  },
+  {
+    "handle",
+    (PyCFunction) Rules_handle,
+    METH_NOARGS
+  },
+  {
+    "re_stats",
+    (PyCFunction) Rules_re_stats,
+    METH_NOARGS
+  },
+  {
+    "enable_profiling",
+    (PyCFunction) Rules_enable_profiling,
+    METH_NOARGS
+  },
+  {
+    "slowest_rules",
+    (PyCFunction) Rules_slowest_rules,
+    METH_VARARGS
+  },
+  {
+    "slowest_strings",
+    (PyCFunction) Rules_slowest_strings,
+    METH_VARARGS
+  },
   {
     NULL,
     NULL
@@ -274,10 +346,125 @@ static PyTypeObject Rules_Type = {
 };
 
 
+// RulesHandle object
+
+typedef struct
+{
+  PyObject_HEAD
+  YR_RULES_HANDLE* handle;
+
+} RulesHandle;
+
+static void RulesHandle_dealloc(
+    PyObject *self);
+
+static PyObject * RulesHandle_match(
+    PyObject *self,
+    PyObject *args,
+    PyObject *keywords);
+
+static PyObject * RulesHandle_swap(
+    PyObject *self,
+    PyObject *args);
+
+static PyMethodDef RulesHandle_methods[] =
+{
+  {
+    "match",
+    (PyCFunction) RulesHandle_match,
+    METH_VARARGS | METH_KEYWORDS
+  },
+  {
+    "swap",
+    (PyCFunction) RulesHandle_swap,
+    METH_VARARGS
+  },
+  {
+    NULL,
+    NULL
+  }
+};
+
+static PyTypeObject RulesHandle_Type = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  "yara.RulesHandle",         /*tp_name*/
+  sizeof(RulesHandle),        /*tp_basicsize*/
+  0,                          /*tp_itemsize*/
+  (destructor)RulesHandle_dealloc, /*tp_dealloc*/
+  0,                          /*tp_print*/
+  0,                          /*tp_getattr*/
+  0,                          /*tp_setattr*/
+  0,                          /*tp_compare*/
+  0,                          /*tp_repr*/
+  0,                          /*tp_as_number*/
+  0,                          /*tp_as_sequence*/
+  0,                          /*tp_as_mapping*/
+  0,                          /*tp_hash */
+  0,                          /*tp_call*/
+  0,                          /*tp_str*/
+  0,                          /*tp_getattro*/
+  0,                          /*tp_setattro*/
+  0,                          /*tp_as_buffer*/
+  Py_TPFLAGS_DEFAULT,         /*tp_flags*/
+  "RulesHandle class",        /* tp_doc */
+  0,                          /* tp_traverse */
+  0,                          /* tp_clear */
+  0,                          /* tp_richcompare */
+  0,                          /* tp_weaklistoffset */
+  0,                          /* tp_iter */
+  0,                          /* tp_iternext */
+  RulesHandle_methods,        /* tp_methods */
+};
+
+
+// ThreadFinalizer object
+//
+// Scanning gives the calling thread one of the MAX_THREADS thread indexes
+// of libyara, which the thread keeps until it calls yr_finalize_thread.
+// Python threads don't call it by themselves, so the first match() in each
+// thread leaves one of these objects in the thread's state dictionary. It
+// calls yr_finalize_thread when the dictionary is cleared as the thread
+// exits.
+
+typedef struct
+{
+  PyObject_HEAD
+
+} ThreadFinalizer;
+
+static void ThreadFinalizer_dealloc(
+    PyObject *self);
+
+static PyTypeObject ThreadFinalizer_Type = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  "yara.ThreadFinalizer",     /*tp_name*/
+  sizeof(ThreadFinalizer),    /*tp_basicsize*/
+  0,                          /*tp_itemsize*/
+  (destructor)ThreadFinalizer_dealloc, /*tp_dealloc*/
+  0,                          /*tp_print*/
+  0,                          /*tp_getattr*/
+  0,                          /*tp_setattr*/
+  0,                          /*tp_compare*/
+  0,                          /*tp_repr*/
+  0,                          /*tp_as_number*/
+  0,                          /*tp_as_sequence*/
+  0,                          /*tp_as_mapping*/
+  0,                          /*tp_hash */
+  0,                          /*tp_call*/
+  0,                          /*tp_str*/
+  0,                          /*tp_getattro*/
+  0,                          /*tp_setattro*/
+  0,                          /*tp_as_buffer*/
+  Py_TPFLAGS_DEFAULT,         /*tp_flags*/
+  "ThreadFinalizer class",    /* tp_doc */
+};
+
+
 typedef struct _CALLBACK_DATA
 {
   PyObject *matches;
   PyObject *callback;
+  PyObject *progress;
 
 } CALLBACK_DATA;
 
@@ -472,6 +659,52 @@ int yara_callback(
 }
 
 
+int yara_progress_callback(
+    uint64_t bytes_scanned,
+    uint64_t bytes_total,
+    void* data)
+{
+  PyObject* progress = ((CALLBACK_DATA*) data)->progress;
+  PyObject* progress_result;
+  PyGILState_STATE gil_state;
+
+  int result = CALLBACK_CONTINUE;
+
+  gil_state = PyGILState_Ensure();
+
+  progress_result = PyObject_CallFunction(
+      progress,
+      "KK",
+      (unsigned PY_LONG_LONG) bytes_scanned,
+      (unsigned PY_LONG_LONG) bytes_total);
+
+  if (progress_result != NULL)
+  {
+    #if PY_MAJOR_VERSION >= 3
+    if (PyLong_Check(progress_result))
+    #else
+    if (PyLong_Check(progress_result) || PyInt_Check(progress_result))
+    #endif
+    {
+      result = (int) PyLong_AsLong(progress_result);
+    }
+
+    Py_DECREF(progress_result);
+  }
+  else
+  {
+    // The exception raised by the progress function is kept and raised
+    // by match() once the scan is cancelled.
+
+    result = CALLBACK_ABORT;
+  }
+
+  PyGILState_Release(gil_state);
+
+  return result;
+}
+
+
 int process_compile_externals(
     PyObject* externals,
     YR_COMPILER* compiler)
@@ -522,22 +755,28 @@ int process_compile_externals(
 
 int process_match_externals(
     PyObject* externals,
-    YR_RULES* rules)
+    YR_SCAN_CONTEXT* context)
 {
   PyObject *key, *value;
   Py_ssize_t pos = 0;
 
   char* identifier = NULL;
+  int index;
+  int result;
 
   while (PyDict_Next(externals, &pos, &key, &value))
   {
     identifier = PY_STRING_TO_C(key);
+    index = yr_rules_get_variable_index(context->rules, identifier);
+
+    if (index < 0)
+      continue;
 
     if (PyBool_Check(value))
     {
-      yr_rules_define_boolean_variable(
-          rules,
-          identifier,
+      result = yr_scan_context_set_boolean_variable(
+          context,
+          index,
           PyObject_IsTrue(value));
     }
 #if PY_MAJOR_VERSION >= 3
@@ -546,20 +785,34 @@ int process_match_externals(
     else if (PyLong_Check(value) || PyInt_Check(value))
 #endif
     {
-      yr_rules_define_integer_variable(
-          rules,
-          identifier,
+      result = yr_scan_context_set_integer_variable(
+          context,
+          index,
           PyLong_AsLong(value));
     }
     else if (PY_STRING_CHECK(value))
     {
-      yr_rules_define_string_variable(
-          rules,
-          identifier,
+      result = yr_scan_context_set_string_variable(
+          context,
+          index,
           PY_STRING_TO_C(value));
     }
     else
     {
+      PyErr_Format(
+          PyExc_TypeError,
+          "external values must be of type integer, boolean or string");
+
+      return FALSE;
+    }
+
+    if (result != ERROR_SUCCESS)
+    {
+      PyErr_Format(
+          PyExc_TypeError,
+          "incorrect type for external variable \"%s\"",
+          identifier);
+
       return FALSE;
     }
   }
@@ -609,6 +862,10 @@ PyObject* handle_error(
       return PyErr_Format(
           YaraTimeoutError,
           "scanning timed out");
+    case ERROR_SCAN_CANCELLED:
+      return PyErr_Format(
+          YaraError,
+          "scanning cancelled");
     default:
       return PyErr_Format(
           YaraError,
@@ -745,6 +1002,166 @@ static long Match_hash(
 ////////////////////////////////////////////////////////////////////////////////
 
 
+static void ThreadFinalizer_dealloc(
+    PyObject *self)
+{
+  yr_finalize_thread();
+  PyObject_Del(self);
+}
+
+
+static int track_thread(void)
+{
+  PyObject* dict = PyThreadState_GetDict();
+  PyObject* finalizer;
+
+  int result;
+
+  if (dict == NULL)
+    return TRUE;
+
+  if (PyDict_GetItemString(dict, "yara.thread_finalizer") != NULL)
+    return TRUE;
+
+  finalizer = (PyObject*) PyObject_NEW(ThreadFinalizer, &ThreadFinalizer_Type);
+
+  if (finalizer == NULL)
+    return FALSE;
+
+  result = PyDict_SetItemString(dict, "yara.thread_finalizer", finalizer);
+  Py_DECREF(finalizer);
+
+  return result == 0;
+}
+
+
+static void RulesHandle_dealloc(
+    PyObject *self)
+{
+  RulesHandle* object = (RulesHandle*) self;
+
+  if (object->handle != NULL)
+    yr_rules_handle_destroy(object->handle);
+
+  PyObject_Del(self);
+}
+
+
+static PyObject * RulesHandle_match(
+    PyObject *self,
+    PyObject *args,
+    PyObject *keywords)
+{
+  static char *kwlist[] = {"data", "timeout", NULL};
+
+  char* data = NULL;
+
+  int timeout = 0;
+  int length;
+  int error;
+
+  RulesHandle* object = (RulesHandle*) self;
+  YR_RULES* rules;
+
+  CALLBACK_DATA callback_data;
+
+  callback_data.matches = NULL;
+  callback_data.callback = NULL;
+  callback_data.progress = NULL;
+
+  if (!track_thread())
+    return NULL;
+
+  if (!PyArg_ParseTupleAndKeywords(
+        args,
+        keywords,
+        "s#|i",
+        kwlist,
+        &data,
+        &length,
+        &timeout))
+  {
+    return NULL;
+  }
+
+  callback_data.matches = PyList_New(0);
+
+  if (callback_data.matches == NULL)
+    return NULL;
+
+  Py_BEGIN_ALLOW_THREADS
+
+  // The rules acquired are kept alive until released even if another
+  // thread swaps them in the meantime.
+
+  rules = yr_rules_handle_acquire(object->handle);
+
+  if (rules != NULL)
+  {
+    error = yr_rules_scan_mem(
+        rules,
+        (unsigned char*) data,
+        (unsigned int) length,
+        yara_callback,
+        &callback_data,
+        FALSE,
+        timeout);
+
+    yr_rules_handle_release(object->handle);
+  }
+  else
+  {
+    error = ERROR_TOO_MANY_SCAN_THREADS;
+  }
+
+  Py_END_ALLOW_THREADS
+
+  if (error != ERROR_SUCCESS)
+  {
+    Py_DECREF(callback_data.matches);
+
+    if (error == ERROR_CALLBACK_ERROR)
+      return NULL;
+    else
+      return handle_error(error, NULL);
+  }
+
+  return callback_data.matches;
+}
+
+
+static PyObject * RulesHandle_swap(
+    PyObject *self,
+    PyObject *args)
+{
+  PyObject* rules;
+  YR_RULES* yara_rules;
+
+  int error;
+
+  RulesHandle* object = (RulesHandle*) self;
+
+  if (!PyArg_ParseTuple(args, "O!", &Rules_Type, &rules))
+    return NULL;
+
+  error = yr_rules_duplicate(((Rules*) rules)->rules, &yara_rules);
+
+  if (error == ERROR_SUCCESS)
+  {
+    error = yr_rules_handle_swap(object->handle, yara_rules);
+
+    if (error != ERROR_SUCCESS)
+      yr_rules_destroy(yara_rules);
+  }
+
+  if (error != ERROR_SUCCESS)
+    return handle_error(error, NULL);
+
+  Py_INCREF(Py_None);
+  return Py_None;
+}
+
+
 static void Rules_dealloc(PyObject *self)
 {
   yr_rules_destroy(((Rules*) self)->rules);
@@ -759,7 +1176,7 @@ static PyObject * Rules_match(
 {
   static char *kwlist[] = {
       "filepath", "pid", "data", "externals",
-      "callback", "fast", "timeout", NULL
+      "callback", "fast", "timeout", "progress", NULL
       };
 
   char* filepath = NULL;
@@ -775,15 +1192,21 @@ static PyObject * Rules_match(
   PyObject *fast = NULL;
   Rules* object = (Rules*) self;
 
+  YR_SCAN_CONTEXT* context = NULL;
+
   CALLBACK_DATA callback_data;
 
   callback_data.matches = NULL;
   callback_data.callback = NULL;
+  callback_data.progress = NULL;
+
+  if (!track_thread())
+    return NULL;
 
   if (PyArg_ParseTupleAndKeywords(
         args,
         keywords,
-        "|sis#OOOi",
+        "|sis#OOOiO",
         kwlist,
         &filepath,
         &pid,
@@ -792,25 +1215,14 @@ static PyObject * Rules_match(
         &externals,
         &callback_data.callback,
         &fast,
-        &timeout))
+        &timeout,
+        &callback_data.progress))
   {
-    if (externals != NULL)
+    if (externals != NULL && !PyDict_Check(externals))
     {
-      if (PyDict_Check(externals))
-      {
-        if (!process_match_externals(externals, object->rules))
-        {
-          return PyErr_Format(
-              PyExc_TypeError,
-              "external values must be of type integer, boolean or string");
-        }
-      }
-      else
-      {
-        return PyErr_Format(
-            PyExc_TypeError,
-            "'externals' must be a dictionary");
-      }
+      return PyErr_Format(
+          PyExc_TypeError,
+          "'externals' must be a dictionary");
     }
 
     if (callback_data.callback != NULL)
@@ -823,6 +1235,41 @@ static PyObject * Rules_match(
       }
     }
 
+    if (callback_data.progress != NULL)
+    {
+      if (!PyCallable_Check(callback_data.progress))
+      {
+        return PyErr_Format(
+            YaraError,
+            "progress must be callable");
+      }
+    }
+
+    if (externals != NULL || callback_data.progress != NULL)
+    {
+      // External values and progress functions passed to match() apply to
+      // this scan only, they are set in a scan context of its own instead
+      // of in the rules, which could be in use by other threads.
+
+      error = yr_scan_context_create(object->rules, &context);
+
+      if (error != ERROR_SUCCESS)
+        return handle_error(error, NULL);
+
+      if (externals != NULL &&
+          !process_match_externals(externals, context))
+      {
+        yr_scan_context_destroy(context);
+        return NULL;
+      }
+
+      if (callback_data.progress != NULL)
+        yr_scan_context_set_progress_callback(
+            context,
+            yara_progress_callback,
+            &callback_data);
+    }
+
     if (fast != NULL)
     {
       fast_mode = (PyObject_IsTrue(fast) == 1);
@@ -834,21 +1281,34 @@ static PyObject * Rules_match(
 
       Py_BEGIN_ALLOW_THREADS
 
-      error = yr_rules_scan_file(
-          object->rules,
-          filepath,
-          yara_callback,
-          &callback_data,
-          fast_mode,
-          timeout);
+      if (context != NULL)
+        error = yr_scan_context_scan_file(
+            context,
+            filepath,
+            yara_callback,
+            &callback_data,
+            fast_mode,
+            timeout);
+      else
+        error = yr_rules_scan_file(
+            object->rules,
+            filepath,
+            yara_callback,
+            &callback_data,
+            fast_mode,
+            timeout);
 
       Py_END_ALLOW_THREADS
 
+      if (context != NULL)
+        yr_scan_context_destroy(context);
+
       if (error != ERROR_SUCCESS)
       {
         Py_DECREF(callback_data.matches);
 
-        if (error == ERROR_CALLBACK_ERROR)
+        if (error == ERROR_CALLBACK_ERROR ||
+            (error == ERROR_SCAN_CANCELLED && PyErr_Occurred()))
           return NULL;
         else
           return handle_error(error, filepath);
@@ -860,22 +1320,36 @@ static PyObject * Rules_match(
 
       Py_BEGIN_ALLOW_THREADS
 
-      error = yr_rules_scan_mem(
-          object->rules,
-          (unsigned char*) data,
-          (unsigned int) length,
-          yara_callback,
-          &callback_data,
-          fast_mode,
-          timeout);
+      if (context != NULL)
+        error = yr_scan_context_scan_mem(
+            context,
+            (unsigned char*) data,
+            (unsigned int) length,
+            yara_callback,
+            &callback_data,
+            fast_mode,
+            timeout);
+      else
+        error = yr_rules_scan_mem(
+            object->rules,
+            (unsigned char*) data,
+            (unsigned int) length,
+            yara_callback,
+            &callback_data,
+            fast_mode,
+            timeout);
 
       Py_END_ALLOW_THREADS
 
+      if (context != NULL)
+        yr_scan_context_destroy(context);
+
       if (error != ERROR_SUCCESS)
       {
         Py_DECREF(callback_data.matches);
 
-        if (error == ERROR_CALLBACK_ERROR)
+        if (error == ERROR_CALLBACK_ERROR ||
+            (error == ERROR_SCAN_CANCELLED && PyErr_Occurred()))
           return NULL;
         else
           return handle_error(error, NULL);
@@ -887,21 +1361,34 @@ static PyObject * Rules_match(
 
       Py_BEGIN_ALLOW_THREADS
 
-      error = yr_rules_scan_proc(
-          object->rules,
-          pid,
-          yara_callback,
-          &callback_data,
-          fast_mode,
-          timeout);
+      if (context != NULL)
+        error = yr_scan_context_scan_proc(
+            context,
+            pid,
+            yara_callback,
+            &callback_data,
+            fast_mode,
+            timeout);
+      else
+        error = yr_rules_scan_proc(
+            object->rules,
+            pid,
+            yara_callback,
+            &callback_data,
+            fast_mode,
+            timeout);
 
       Py_END_ALLOW_THREADS
 
+      if (context != NULL)
+        yr_scan_context_destroy(context);
+
       if (error != ERROR_SUCCESS)
       {
         Py_DECREF(callback_data.matches);
 
-        if (error == ERROR_CALLBACK_ERROR)
+        if (error == ERROR_CALLBACK_ERROR ||
+            (error == ERROR_SCAN_CANCELLED && PyErr_Occurred()))
           return NULL;
         else
           return handle_error(error, NULL);
@@ -909,6 +1396,9 @@ static PyObject * Rules_match(
     }
     else
     {
+      if (context != NULL)
+        yr_scan_context_destroy(context);
+
       return PyErr_Format(
           PyExc_TypeError,
           "match() takes 1 argument");
@@ -948,6 +1438,340 @@ static PyObject * Rules_save(
 }
 
 
+static PyObject * Rules_set_re_limits(
+    PyObject *self,
+    PyObject *args)
+{
+  unsigned long scan_limit;
+  unsigned int cost_budget = 0;
+  Rules* rules = (Rules*) self;
+
+  if (PyArg_ParseTuple(args, "k|I", &scan_limit, &cost_budget))
+  {
+    yr_rules_set_re_limits(rules->rules, scan_limit, cost_budget);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+  else
+  {
+    return PyErr_Format(
+        PyExc_TypeError,
+          "set_re_limits() takes 1 or 2 integer arguments");
+  }
+}
+
+
+static PyObject * Rules_set_string_re_limits(
+    PyObject *self,
+    PyObject *args)
+{
+  char* rule_identifier;
+  char* string_identifier;
+  unsigned long scan_limit;
+  unsigned int cost_budget = 0;
+  int error;
+
+  Rules* rules = (Rules*) self;
+  YR_RULE* rule;
+  YR_STRING* string;
+
+  if (!PyArg_ParseTuple(
+        args,
+        "ssk|I",
+        &rule_identifier,
+        &string_identifier,
+        &scan_limit,
+        &cost_budget))
+  {
+    return PyErr_Format(
+        PyExc_TypeError,
+          "set_string_re_limits() takes a rule, a string and 1 or 2 integers");
+  }
+
+  rule = rules->rules->rules_list_head;
+
+  while (!RULE_IS_NULL(rule))
+  {
+    if (strcmp(rule->identifier, rule_identifier) == 0)
+    {
+      string = rule->strings;
+
+      while (!STRING_IS_NULL(string))
+      {
+        if (strcmp(string->identifier, string_identifier) == 0)
+        {
+          error = yr_rules_set_string_re_limits(
+              rules->rules, string, scan_limit, cost_budget);
+
+          if (error != ERROR_SUCCESS)
+            return handle_error(error, NULL);
+
+          Py_INCREF(Py_None);
+          return Py_None;
+        }
+
+        string++;
+      }
+    }
+
+    rule++;
+  }
+
+  return PyErr_Format(
+      PyExc_ValueError,
+      "string \"%s\" not found in rule \"%s\"",
+      string_identifier,
+      rule_identifier);
+}
+
+
+static PyObject * Rules_set_scan_threads(
+    PyObject *self,
+    PyObject *args)
+{
+  int threads;
+  Rules* rules = (Rules*) self;
+
+  if (PyArg_ParseTuple(args, "i", &threads))
+  {
+    yr_rules_set_scan_threads(rules->rules, threads);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+  else
+  {
+    return PyErr_Format(
+        PyExc_TypeError,
+          "set_scan_threads() takes 1 integer argument");
+  }
+}
+
+
+static PyObject * Rules_handle(
+    PyObject *self,
+    PyObject *args)
+{
+  YR_RULES* yara_rules;
+  RulesHandle* handle;
+
+  int error;
+
+  Rules* rules = (Rules*) self;
+
+  // The handle owns the rules it holds, it gets a copy of these ones.
+
+  error = yr_rules_duplicate(rules->rules, &yara_rules);
+
+  if (error != ERROR_SUCCESS)
+    return handle_error(error, NULL);
+
+  handle = PyObject_NEW(RulesHandle, &RulesHandle_Type);
+
+  if (handle == NULL)
+  {
+    yr_rules_destroy(yara_rules);
+    return NULL;
+  }
+
+  error = yr_rules_handle_create(yara_rules, &handle->handle);
+
+  if (error != ERROR_SUCCESS)
+  {
+    yr_rules_destroy(yara_rules);
+    handle->handle = NULL;
+    Py_DECREF(handle);
+
+    return handle_error(error, NULL);
+  }
+
+  return (PyObject*) handle;
+}
+
+
+static PyObject * Rules_re_stats(
+    PyObject *self,
+    PyObject *args)
+{
+  YR_RE_STATS stats;
+  Rules* rules = (Rules*) self;
+
+  // Stats are those of the last match() called by the current thread
+  // without externals, the scan context is then the thread's own.
+
+  yr_rules_get_re_stats(rules->rules, &stats);
+
+  return Py_BuildValue(
+      "{s:I,s:I,s:I,s:I}",
+      "executions", stats.executions,
+      "jit_executions", stats.jit_executions,
+      "scan_limit_exceeded", stats.scan_limit_exceeded,
+      "cost_budget_exceeded", stats.cost_budget_exceeded);
+}
+
+
+static PyObject * Rules_enable_profiling(
+    PyObject *self,
+    PyObject *args)
+{
+  Rules* rules = (Rules*) self;
+
+  yr_rules_enable_profiling(rules->rules);
+
+  Py_INCREF(Py_None);
+  return Py_None;
+}
+
+
+static PyObject * Rules_slowest_rules(
+    PyObject *self,
+    PyObject *args)
+{
+  YR_RULE_PROFILE* profiles;
+  PyObject* list;
+  PyObject* object;
+
+  int count = 10;
+  int error;
+  int i;
+
+  Rules* rules = (Rules*) self;
+
+  if (!PyArg_ParseTuple(args, "|i", &count) || count < 0)
+  {
+    return PyErr_Format(
+        PyExc_TypeError,
+          "slowest_rules() takes an optional non-negative integer");
+  }
+
+  profiles = (YR_RULE_PROFILE*) PyMem_Malloc(
+      (count + 1) * sizeof(YR_RULE_PROFILE));
+
+  if (profiles == NULL)
+    return PyErr_NoMemory();
+
+  error = yr_rules_get_slowest_rules(rules->rules, profiles, &count);
+
+  if (error != ERROR_SUCCESS)
+  {
+    PyMem_Free(profiles);
+    return handle_error(error, NULL);
+  }
+
+  list = PyList_New(0);
+
+  for (i = 0; i < count && list != NULL; i++)
+  {
+    object = Py_BuildValue(
+        "{s:s,s:K,s:K}",
+        "rule", profiles[i].rule->identifier,
+        "instructions", profiles[i].instructions,
+        "cycles", profiles[i].cycles);
+
+    if (object == NULL || PyList_Append(list, object) != 0)
+    {
+      Py_XDECREF(object);
+      Py_DECREF(list);
+      list = NULL;
+    }
+    else
+    {
+      Py_DECREF(object);
+    }
+  }
+
+  PyMem_Free(profiles);
+
+  return list;
+}
+
+
+static PyObject * Rules_slowest_strings(
+    PyObject *self,
+    PyObject *args)
+{
+  YR_STRING_PROFILE* profiles;
+  YR_RULE* rule;
+  YR_STRING* string;
+  PyObject* list;
+  PyObject* object;
+
+  int count = 10;
+  int error;
+  int i;
+
+  Rules* rules = (Rules*) self;
+
+  if (!PyArg_ParseTuple(args, "|i", &count) || count < 0)
+  {
+    return PyErr_Format(
+        PyExc_TypeError,
+          "slowest_strings() takes an optional non-negative integer");
+  }
+
+  profiles = (YR_STRING_PROFILE*) PyMem_Malloc(
+      (count + 1) * sizeof(YR_STRING_PROFILE));
+
+  if (profiles == NULL)
+    return PyErr_NoMemory();
+
+  error = yr_rules_get_slowest_strings(rules->rules, profiles, &count);
+
+  if (error != ERROR_SUCCESS)
+  {
+    PyMem_Free(profiles);
+    return handle_error(error, NULL);
+  }
+
+  list = PyList_New(0);
+
+  for (i = 0; i < count && list != NULL; i++)
+  {
+    // Strings don't point to their rules, look for the rule having it.
+
+    rule = rules->rules->rules_list_head;
+
+    while (!RULE_IS_NULL(rule))
+    {
+      string = rule->strings;
+
+      while (!STRING_IS_NULL(string) && string != profiles[i].string)
+        string++;
+
+      if (!STRING_IS_NULL(string))
+        break;
+
+      rule++;
+    }
+
+    object = Py_BuildValue(
+        "{s:s,s:s,s:K,s:K,s:K,s:K}",
+        "rule", RULE_IS_NULL(rule) ? "" : rule->identifier,
+        "string", profiles[i].string->identifier,
+        "atom_hits", profiles[i].atom_hits,
+        "verifications", profiles[i].verifications,
+        "matches", profiles[i].matches,
+        "cycles", profiles[i].cycles);
+
+    if (object == NULL || PyList_Append(list, object) != 0)
+    {
+      Py_XDECREF(object);
+      Py_DECREF(list);
+      list = NULL;
+    }
+    else
+    {
+      Py_DECREF(object);
+    }
+  }
+
+  PyMem_Free(profiles);
+
+  return list;
+}
+
+
 static PyObject * Rules_getattro(
     PyObject *self,
     PyObject *name)
@@ -1325,6 +2149,12 @@ MOD_INIT(yara)
   if (PyType_Ready(&Match_Type) < 0)
     return MOD_ERROR_VAL;
 
+  if (PyType_Ready(&RulesHandle_Type) < 0)
+    return MOD_ERROR_VAL;
+
+  if (PyType_Ready(&ThreadFinalizer_Type) < 0)
+    return MOD_ERROR_VAL;
+
   PyModule_AddObject(m, "Error", YaraError);
   PyModule_AddObject(m, "SyntaxError", YaraSyntaxError);
   PyModule_AddObject(m, "TimeoutError", YaraTimeoutError);
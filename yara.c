@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <sys/stat.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <time.h>
 #include <inttypes.h>
@@ -28,11 +29,13 @@ limitations under the License.
 #include "getopt.h"
 
 #define PRIx64 "llx"
+#define PRIu64 "llu"
 
 #endif
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
 #include <ctype.h>
 #include <yara.h>
@@ -53,6 +56,10 @@ limitations under the License.
 "  -a <seconds>             abort scanning after a number of seconds has elapsed.\n"\
 "  -d <identifier>=<value>  define external variable.\n"\
 "  -r                       recursively search directories.\n"\
+"  -p <number>              print the <number> slowest rules and strings.\n"\
+"  -j <number>              use <number> scanning threads (default: CPU count).\n"\
+"  -A                       pin threads to CPUs and copy rules to NUMA nodes.\n"\
+"  -o                       print results in the same order files are found.\n"\
 "  -v                       show version information.\n"
 
 #define EXTERNAL_TYPE_INTEGER   1
@@ -61,16 +68,21 @@ limitations under the License.
 
 #define ERROR_COULD_NOT_CREATE_THREAD  100
 
+#define MAX_NUMA_NODES  64
+
 #ifndef MAX_PATH
 #define MAX_PATH 255
 #endif
 
 #ifdef _MSC_VER
 #define snprintf _snprintf
+#define vsnprintf _vsnprintf
 #define strdup _strdup
 #endif
 
-#define MAX_QUEUED_FILES 64
+// Maximum number of files and accumulated size in bytes of a batch of files.
+#define MAX_BATCH_FILES  32
+#define MAX_BATCH_SIZE   (1024 * 1024)
 
 
 typedef struct _TAG
@@ -103,11 +115,88 @@ typedef struct _EXTERNAL
 } EXTERNAL;
 
 
-typedef struct _QUEUED_FILE {
+// Directory scans are scheduled with one deque of file batches per scanning
+// thread. The directory walker appends batches to the deques in round-robin
+// order and never waits for the scanning threads, as deques grow as needed.
+// Each thread takes batches from the head of its own deque and, when it runs
+// out of work, steals them from the tail of other threads' deques. Small
+// files are grouped in batches so that the scheduling cost is paid once per
+// batch instead of once per file, while large files go in a batch on their
+// own. The work_available semaphore is released every time a batch is
+// queued and is only used for waking up idle threads, a thread always tries
+// to get more work before waiting on it.
+
+typedef struct _FILE_BATCH
+{
+  uint64_t seq;
+  int count;
+  char* paths[MAX_BATCH_FILES];
+
+  char* output;
+  size_t output_length;
+  struct _FILE_BATCH* next;
+
+} FILE_BATCH;
+
+
+// Results are formatted in memory by the scanning threads and passed to a
+// single writer thread, so they don't compete for stdout. Once a batch of
+// files is scanned its output is attached to it and the batch is handed to
+// the writer, which uses the batches' sequence numbers for printing them in
+// the order files were found when ordered_output is set.
+
+typedef struct _OUTPUT_BUFFER
+{
+  char* data;
+  size_t length;
+  size_t size;
+
+} OUTPUT_BUFFER;
+
+
+typedef struct _CALLBACK_ARGS
+{
+  const char* file_path;
+  OUTPUT_BUFFER* output;
+
+} CALLBACK_ARGS;
+
 
+typedef struct _SCAN_WORKER
+{
+  int index;
+  int cpu;
+  YR_RULES* rules;
+  OUTPUT_BUFFER output;
+
+  MUTEX mutex;
+  FILE_BATCH** deque;
+  int deque_size;
+  int deque_head;
+  int deque_count;
+
+} SCAN_WORKER;
+
+
+// Each thread walking directories accumulates files in its own pending batch
+// and hands complete batches to the scanning threads in round-robin order.
+
+typedef struct _DIR_WALKER
+{
+  FILE_BATCH* pending_batch;
+  uint64_t pending_batch_size;
+  uint64_t batches_count;
+  int next_worker;
+
+} DIR_WALKER;
+
+
+typedef struct _QUEUED_DIR
+{
   char* path;
+  struct _QUEUED_DIR* next;
 
-} QUEUED_FILE;
+} QUEUED_DIR;
 
 
 int recursive_search = FALSE;
@@ -121,7 +210,10 @@ int negate = FALSE;
 int count = 0;
 int limit = 0;
 int timeout = 0;
-int threads = 8;
+int threads = 0;
+int pin_threads = FALSE;
+int ordered_output = FALSE;
+int profile = 0;
 
 
 TAG* specified_tags_list = NULL;
@@ -129,87 +221,515 @@ IDENTIFIER* specified_rules_list = NULL;
 EXTERNAL* externals_list = NULL;
 
 
-// file_queue is size-limited queue stored as a circular array, files are
-// removed from queue_head position and new files are added at queue_tail
-// position. The array has room for one extra element to avoid queue_head
-// being equal to queue_tail in a full queue. The only situation where
-// queue_head == queue_tail is when queue is empty.
+SCAN_WORKER workers[MAX_THREADS];
+
+YR_RULES* node_rules[MAX_NUMA_NODES];
+
+int workers_count;
 
-QUEUED_FILE file_queue[MAX_QUEUED_FILES + 1];
+SEMAPHORE work_available;
 
-int queue_head;
-int queue_tail;
+volatile int walk_finished;
 
-SEMAPHORE used_slots;
-SEMAPHORE unused_slots;
+FILE_BATCH* output_queue_head;
+FILE_BATCH* output_queue_tail;
+
+MUTEX output_queue_mutex;
+SEMAPHORE output_available;
+
+int output_finished;
 
-MUTEX queue_mutex;
 MUTEX output_mutex;
 
 
-void file_queue_init()
+//
+// output_reserve
+//
+// Makes room in the buffer for at least the given number of bytes. Returns
+// FALSE if there's not enough memory.
+//
+
+int output_reserve(
+    OUTPUT_BUFFER* output,
+    size_t length)
+{
+  size_t new_size;
+  char* new_data;
+
+  if (output->size - output->length >= length)
+    return TRUE;
+
+  new_size = output->size > 0 ? output->size * 2 : 4096;
+
+  while (new_size - output->length < length)
+    new_size *= 2;
+
+  new_data = (char*) realloc(output->data, new_size);
+
+  if (new_data == NULL)
+    return FALSE;
+
+  output->data = new_data;
+  output->size = new_size;
+
+  return TRUE;
+}
+
+
+void output_printf(
+    OUTPUT_BUFFER* output,
+    const char* format,
+    ...)
+{
+  va_list args;
+  int length;
+
+  if (!output_reserve(output, 256))
+    return;
+
+  while (TRUE)
+  {
+    va_start(args, format);
+
+    length = vsnprintf(
+        output->data + output->length,
+        output->size - output->length,
+        format,
+        args);
+
+    va_end(args);
+
+    if (length >= 0 && output->length + length < output->size)
+    {
+      output->length += length;
+      return;
+    }
+
+    // Some vsnprintf implementations return -1 instead of the required
+    // length when the output is truncated.
+
+    if (!output_reserve(output, length >= 0 ? length + 1 : output->size * 2))
+      return;
+  }
+}
+
+
+void output_flush(
+    OUTPUT_BUFFER* output)
+{
+  if (output->length > 0)
+    fwrite(output->data, 1, output->length, stdout);
+
+  output->length = 0;
+}
+
+
+void output_queue_init()
+{
+  output_queue_head = NULL;
+  output_queue_tail = NULL;
+  output_finished = FALSE;
+
+  mutex_init(&output_queue_mutex);
+  semaphore_init(&output_available, 0);
+}
+
+
+void output_queue_destroy()
+{
+  mutex_destroy(&output_queue_mutex);
+  semaphore_destroy(&output_available);
+}
+
+
+//
+// output_queue_put
+//
+// Passes the batch to the writer thread along with the contents of the
+// buffer, which is left empty. In ordered mode batches are queued even if
+// they didn't produce any output, as the writer needs all of them to keep
+// the order.
+//
+
+void output_queue_put(
+    FILE_BATCH* batch,
+    OUTPUT_BUFFER* output)
+{
+  if (output->length == 0 && !ordered_output)
+  {
+    free(batch);
+    return;
+  }
+
+  batch->output = output->data;
+  batch->output_length = output->length;
+  batch->next = NULL;
+
+  output->data = NULL;
+  output->length = 0;
+  output->size = 0;
+
+  mutex_lock(&output_queue_mutex);
+
+  if (output_queue_tail != NULL)
+    output_queue_tail->next = batch;
+  else
+    output_queue_head = batch;
+
+  output_queue_tail = batch;
+
+  mutex_unlock(&output_queue_mutex);
+  semaphore_release(&output_available);
+}
+
+
+void output_queue_finish()
+{
+  mutex_lock(&output_queue_mutex);
+  output_finished = TRUE;
+  mutex_unlock(&output_queue_mutex);
+
+  semaphore_release(&output_available);
+}
+
+
+#ifdef WIN32
+DWORD WINAPI writing_thread(LPVOID param)
+#else
+void* writing_thread(void* param)
+#endif
+{
+  FILE_BATCH* batches;
+  FILE_BATCH* batch;
+  FILE_BATCH* pending = NULL;
+  FILE_BATCH** insert_at;
+
+  uint64_t next_seq = 0;
+  int finished = FALSE;
+
+  while (!finished)
+  {
+    semaphore_wait(&output_available);
+
+    // Take all the queued batches at once, the semaphore may have been
+    // released more times than needed but that's harmless.
+
+    mutex_lock(&output_queue_mutex);
+    batches = output_queue_head;
+    output_queue_head = NULL;
+    output_queue_tail = NULL;
+    finished = output_finished;
+    mutex_unlock(&output_queue_mutex);
+
+    while (batches != NULL)
+    {
+      batch = batches;
+      batches = batches->next;
+
+      if (!ordered_output)
+      {
+        fwrite(batch->output, 1, batch->output_length, stdout);
+        free(batch->output);
+        free(batch);
+        continue;
+      }
+
+      // Keep batches sorted by sequence number until the next one to be
+      // printed arrives.
+
+      insert_at = &pending;
+
+      while (*insert_at != NULL && (*insert_at)->seq < batch->seq)
+        insert_at = &(*insert_at)->next;
+
+      batch->next = *insert_at;
+      *insert_at = batch;
+
+      while (pending != NULL && pending->seq == next_seq)
+      {
+        batch = pending;
+        pending = pending->next;
+
+        if (batch->output_length > 0)
+          fwrite(batch->output, 1, batch->output_length, stdout);
+
+        free(batch->output);
+        free(batch);
+        next_seq++;
+      }
+    }
+  }
+
+  fflush(stdout);
+
+  return 0;
+}
+
+
+void file_queue_init(
+    YR_RULES* rules,
+    int threads_count)
 {
-  queue_tail = 0;
-  queue_head = 0;
+  int i;
 
-  mutex_init(&queue_mutex);
-  semaphore_init(&used_slots, 0);
-  semaphore_init(&unused_slots, MAX_QUEUED_FILES);
+  for (i = 0; i < threads_count; i++)
+  {
+    workers[i].index = i;
+    workers[i].cpu = -1;
+    workers[i].output.data = NULL;
+    workers[i].output.length = 0;
+    workers[i].output.size = 0;
+    workers[i].rules = rules;
+    workers[i].deque = NULL;
+    workers[i].deque_size = 0;
+    workers[i].deque_head = 0;
+    workers[i].deque_count = 0;
+
+    mutex_init(&workers[i].mutex);
+  }
+
+  workers_count = threads_count;
+  walk_finished = FALSE;
+
+  semaphore_init(&work_available, 0);
 }
 
 
 void file_queue_destroy()
 {
-  mutex_destroy(&queue_mutex);
-  semaphore_destroy(&unused_slots);
-  semaphore_destroy(&used_slots);
+  int i;
+
+  for (i = 0; i < workers_count; i++)
+  {
+    mutex_destroy(&workers[i].mutex);
+    free(workers[i].deque);
+    free(workers[i].output.data);
+  }
+
+  semaphore_destroy(&work_available);
 }
 
 
-void file_queue_finish()
+//
+// worker_push
+//
+// Appends a batch at the tail of the worker's deque, growing the deque if
+// it's full. Returns FALSE if there's not enough memory to do so.
+//
+
+int worker_push(
+    SCAN_WORKER* worker,
+    FILE_BATCH* batch)
 {
+  FILE_BATCH** deque;
+  int deque_size;
   int i;
 
-  for (i = 0; i < MAX_THREADS; i++)
-    semaphore_release(&used_slots);
+  mutex_lock(&worker->mutex);
+
+  if (worker->deque_count == worker->deque_size)
+  {
+    deque_size = worker->deque_size > 0 ? worker->deque_size * 2 : 16;
+    deque = (FILE_BATCH**) malloc(deque_size * sizeof(FILE_BATCH*));
+
+    if (deque == NULL)
+    {
+      mutex_unlock(&worker->mutex);
+      return FALSE;
+    }
+
+    for (i = 0; i < worker->deque_count; i++)
+      deque[i] = worker->deque[
+          (worker->deque_head + i) % worker->deque_size];
+
+    free(worker->deque);
+
+    worker->deque = deque;
+    worker->deque_size = deque_size;
+    worker->deque_head = 0;
+  }
+
+  worker->deque[
+      (worker->deque_head + worker->deque_count) % worker->deque_size] = batch;
+
+  worker->deque_count++;
+
+  mutex_unlock(&worker->mutex);
+
+  return TRUE;
 }
 
 
-void file_queue_put(
-    const char* file_path)
+//
+// worker_pop
+//
+// Removes a batch from the worker's deque. The owner of the deque takes the
+// oldest batch from the head, so that files are scanned roughly in the same
+// order they were found, while other threads steal the newest one from the
+// tail. Returns NULL if the deque is empty.
+//
+
+FILE_BATCH* worker_pop(
+    SCAN_WORKER* worker,
+    int steal)
 {
-  semaphore_wait(&unused_slots);
-  mutex_lock(&queue_mutex);
+  FILE_BATCH* batch = NULL;
 
-  file_queue[queue_tail].path = strdup(file_path);
-  queue_tail = (queue_tail + 1) % (MAX_QUEUED_FILES + 1);
+  mutex_lock(&worker->mutex);
 
-  mutex_unlock(&queue_mutex);
-  semaphore_release(&used_slots);
+  if (worker->deque_count > 0)
+  {
+    worker->deque_count--;
+
+    if (steal)
+    {
+      batch = worker->deque[
+          (worker->deque_head + worker->deque_count) % worker->deque_size];
+    }
+    else
+    {
+      batch = worker->deque[worker->deque_head];
+      worker->deque_head = (worker->deque_head + 1) % worker->deque_size;
+    }
+  }
+
+  mutex_unlock(&worker->mutex);
+
+  return batch;
 }
 
 
-char* file_queue_get()
+void file_queue_flush(
+    DIR_WALKER* walker)
 {
-  char* result;
+  FILE_BATCH* batch = walker->pending_batch;
+  int i;
+
+  if (batch == NULL)
+    return;
+
+  batch->seq = walker->batches_count++;
+
+  // If the deque of the next worker can't grow try with the other ones
+  // before giving up.
+
+  for (i = 0; i < workers_count; i++)
+  {
+    if (worker_push(&workers[walker->next_worker], batch))
+      break;
 
-  semaphore_wait(&used_slots);
-  mutex_lock(&queue_mutex);
+    walker->next_worker = (walker->next_worker + 1) % workers_count;
+  }
 
-  if (queue_head == queue_tail) // queue is empty
+  if (i == workers_count)
   {
-    result = NULL;
+    fprintf(stderr, "Not enough memory.\n");
+
+    for (i = 0; i < batch->count; i++)
+      free(batch->paths[i]);
+
+    free(batch);
+    walker->batches_count--;
   }
   else
   {
-    result = file_queue[queue_head].path;
-    queue_head = (queue_head + 1) % (MAX_QUEUED_FILES + 1);
+    walker->next_worker = (walker->next_worker + 1) % workers_count;
+    semaphore_release(&work_available);
+  }
+
+  walker->pending_batch = NULL;
+  walker->pending_batch_size = 0;
+}
+
+
+void file_queue_finish()
+{
+  int i;
+
+  walk_finished = TRUE;
+
+  for (i = 0; i < workers_count; i++)
+    semaphore_release(&work_available);
+}
+
+
+void file_queue_put(
+    DIR_WALKER* walker,
+    const char* file_path,
+    uint64_t file_size)
+{
+  char* path;
+
+  // Large files are queued alone, otherwise a thread could end up scanning
+  // a batch of several large files while the others are idle.
+
+  if (file_size >= MAX_BATCH_SIZE)
+    file_queue_flush(walker);
+
+  if (walker->pending_batch == NULL)
+  {
+    walker->pending_batch = (FILE_BATCH*) malloc(sizeof(FILE_BATCH));
+
+    if (walker->pending_batch == NULL)
+    {
+      fprintf(stderr, "Not enough memory.\n");
+      return;
+    }
+
+    walker->pending_batch->count = 0;
+  }
+
+  path = strdup(file_path);
+
+  if (path == NULL)
+  {
+    fprintf(stderr, "Not enough memory.\n");
+    return;
   }
 
-  mutex_unlock(&queue_mutex);
-  semaphore_release(&unused_slots);
+  walker->pending_batch->paths[walker->pending_batch->count++] = path;
+  walker->pending_batch_size += file_size;
+
+  if (walker->pending_batch->count == MAX_BATCH_FILES ||
+      walker->pending_batch_size >= MAX_BATCH_SIZE)
+    file_queue_flush(walker);
+}
+
 
-  return result;
+//
+// file_queue_get
+//
+// Returns the next batch of files to be scanned by the given worker, taken
+// from its own deque or stolen from another worker. Blocks until there's
+// some work available and returns NULL when all files have been scanned.
+//
+
+FILE_BATCH* file_queue_get(
+    SCAN_WORKER* worker)
+{
+  FILE_BATCH* batch;
+  int finished;
+  int i;
+
+  while (TRUE)
+  {
+    // Read the flag before looking into the deques, if it's set all the
+    // batches were already queued and empty deques mean there's no work
+    // left.
+
+    finished = walk_finished;
+
+    batch = worker_pop(worker, FALSE);
+
+    for (i = 1; i < workers_count && batch == NULL; i++)
+      batch = worker_pop(
+          &workers[(worker->index + i) % workers_count], TRUE);
+
+    if (batch != NULL || finished)
+      return batch;
+
+    semaphore_wait(&work_available);
+  }
 }
 
 
@@ -224,11 +744,10 @@ int is_directory(
     return FALSE;
 }
 
-void scan_dir(
+void walk_dir(
+    DIR_WALKER* walker,
     const char* dir,
-    int recursive,
-    YR_RULES* rules,
-    YR_CALLBACK_FUNC callback)
+    int recursive)
 {
   WIN32_FIND_DATA FindFileData;
   HANDLE hFind;
@@ -249,11 +768,15 @@ void scan_dir(
 
       if (!(FindFileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
       {
-        file_queue_put(full_path);
+        file_queue_put(
+            walker,
+            full_path,
+            ((uint64_t) FindFileData.nFileSizeHigh << 32) |
+                FindFileData.nFileSizeLow);
       }
       else if (recursive && FindFileData.cFileName[0] != '.' )
       {
-        scan_dir(full_path, recursive, rules, callback);
+        walk_dir(walker, full_path, recursive);
       }
 
     } while (FindNextFile(hFind, &FindFileData));
@@ -262,8 +785,40 @@ void scan_dir(
   }
 }
 
+void scan_dir(
+    const char* dir,
+    int recursive)
+{
+  DIR_WALKER walker;
+
+  walker.pending_batch = NULL;
+  walker.pending_batch_size = 0;
+  walker.batches_count = 0;
+  walker.next_worker = 0;
+
+  walk_dir(&walker, dir, recursive);
+  file_queue_flush(&walker);
+}
+
 #else
 
+// Directories are walked by several threads in parallel. Subdirectories
+// found while walking a directory are put in dir_queue for other threads to
+// take them, unless the queue already has enough directories to keep all
+// of them busy, in which case the thread descends into the subdirectory by
+// itself. The walk is complete when dirs_pending, the number of directories
+// queued or being walked, drops to zero.
+
+QUEUED_DIR* dir_queue;
+
+int dir_queue_length;
+int dirs_pending;
+int walkers_count;
+
+MUTEX dir_queue_mutex;
+SEMAPHORE dirs_available;
+
+
 int is_directory(
     const char* path)
 {
@@ -275,83 +830,334 @@ int is_directory(
   return 0;
 }
 
-void scan_dir(
+
+int dir_queue_put(
+    const char* path)
+{
+  QUEUED_DIR* queued_dir;
+
+  mutex_lock(&dir_queue_mutex);
+
+  if (dir_queue_length >= walkers_count)
+  {
+    mutex_unlock(&dir_queue_mutex);
+    return FALSE;
+  }
+
+  queued_dir = (QUEUED_DIR*) malloc(sizeof(QUEUED_DIR));
+
+  if (queued_dir != NULL)
+    queued_dir->path = strdup(path);
+
+  if (queued_dir == NULL || queued_dir->path == NULL)
+  {
+    mutex_unlock(&dir_queue_mutex);
+    free(queued_dir);
+    return FALSE;
+  }
+
+  queued_dir->next = dir_queue;
+  dir_queue = queued_dir;
+  dir_queue_length++;
+  dirs_pending++;
+
+  mutex_unlock(&dir_queue_mutex);
+  semaphore_release(&dirs_available);
+
+  return TRUE;
+}
+
+
+//
+// dir_queue_get
+//
+// Returns the next directory to be walked, blocking until there's one
+// available. Returns NULL when the whole tree has been walked.
+//
+
+QUEUED_DIR* dir_queue_get()
+{
+  QUEUED_DIR* queued_dir;
+  int finished;
+
+  while (TRUE)
+  {
+    mutex_lock(&dir_queue_mutex);
+
+    queued_dir = dir_queue;
+
+    if (queued_dir != NULL)
+    {
+      dir_queue = queued_dir->next;
+      dir_queue_length--;
+    }
+
+    finished = (dirs_pending == 0);
+
+    mutex_unlock(&dir_queue_mutex);
+
+    if (queued_dir != NULL || finished)
+      return queued_dir;
+
+    semaphore_wait(&dirs_available);
+  }
+}
+
+
+void dir_queue_done(
+    QUEUED_DIR* queued_dir)
+{
+  int finished;
+  int i;
+
+  free(queued_dir->path);
+  free(queued_dir);
+
+  mutex_lock(&dir_queue_mutex);
+  finished = (--dirs_pending == 0);
+  mutex_unlock(&dir_queue_mutex);
+
+  if (finished)
+  {
+    for (i = 0; i < walkers_count; i++)
+      semaphore_release(&dirs_available);
+  }
+}
+
+
+//
+// walk_dir
+//
+// Queues the files in the directory opened as fd, which is closed before
+// returning. The file type reported by readdir is used when available,
+// fstatat is called for file systems that don't report it and for regular
+// files, whose size is needed for batching them.
+//
+
+void walk_dir(
+    DIR_WALKER* walker,
+    int fd,
     const char* dir,
-    int recursive,
-    YR_RULES* rules,
-    YR_CALLBACK_FUNC callback)
+    int recursive)
 {
   DIR *dp;
   struct dirent *de;
   struct stat st;
   char full_path[MAX_PATH];
+  uint64_t file_size;
+  int file_type;
+  int subdir_fd;
 
-  dp = opendir(dir);
+  dp = fdopendir(fd);
 
-  if (dp)
+  if (dp == NULL)
   {
-    de = readdir(dp);
+    close(fd);
+    return;
+  }
+
+  de = readdir(dp);
+
+  while (de)
+  {
+    snprintf(full_path, sizeof(full_path), "%s/%s", dir, de->d_name);
+
+    file_type = de->d_type;
+    file_size = 0;
 
-    while (de)
+    if ((file_type == DT_UNKNOWN || file_type == DT_REG) &&
+        fstatat(dirfd(dp), de->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0)
     {
-      snprintf(full_path, sizeof(full_path), "%s/%s", dir, de->d_name);
+      if (S_ISREG(st.st_mode))
+        file_type = DT_REG;
+      else if (S_ISDIR(st.st_mode))
+        file_type = DT_DIR;
+      else
+        file_type = DT_UNKNOWN;
+
+      file_size = st.st_size;
+    }
 
-      int err = lstat(full_path, &st);
+    if (file_type == DT_REG)
+    {
+      file_queue_put(walker, full_path, file_size);
+    }
+    else if (recursive &&
+             file_type == DT_DIR &&
+             de->d_name[0] != '.' &&
+             !dir_queue_put(full_path))
+    {
+      subdir_fd = openat(
+          dirfd(dp),
+          de->d_name,
+          O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
 
-      if (err == 0)
-      {
-        if(S_ISREG(st.st_mode))
-        {
-          file_queue_put(full_path);
-        }
-        else if(recursive &&
-                S_ISDIR(st.st_mode) &&
-                !S_ISLNK(st.st_mode) &&
-                de->d_name[0] != '.')
-        {
-          scan_dir(full_path, recursive, rules, callback);
-        }
-      }
+      if (subdir_fd >= 0)
+        walk_dir(walker, subdir_fd, full_path, recursive);
+    }
+
+    de = readdir(dp);
+  }
+
+  closedir(dp);
+}
+
+
+void* walking_thread(
+    void* param)
+{
+  DIR_WALKER* walker = (DIR_WALKER*) param;
+  QUEUED_DIR* queued_dir;
+  int fd;
+
+  queued_dir = dir_queue_get();
+
+  while (queued_dir != NULL)
+  {
+    fd = open(queued_dir->path, O_RDONLY | O_DIRECTORY);
+
+    if (fd >= 0)
+      walk_dir(walker, fd, queued_dir->path, TRUE);
+
+    dir_queue_done(queued_dir);
+    queued_dir = dir_queue_get();
+  }
+
+  file_queue_flush(walker);
+
+  return 0;
+}
+
+
+void scan_dir(
+    const char* dir,
+    int recursive)
+{
+  DIR_WALKER walkers[MAX_THREADS];
+  THREAD thread[MAX_THREADS];
+
+  int fd;
+  int i;
+
+  for (i = 0; i < workers_count; i++)
+  {
+    walkers[i].pending_batch = NULL;
+    walkers[i].pending_batch_size = 0;
+    walkers[i].batches_count = 0;
+    walkers[i].next_worker = i;
+  }
+
+  dir_queue = NULL;
+  dir_queue_length = 0;
+  dirs_pending = 0;
+
+  mutex_init(&dir_queue_mutex);
+  semaphore_init(&dirs_available, 0);
+
+  // Printing results in the order files are found requires a single thread
+  // walking the tree. With no walking threads dir_queue_put always fails
+  // and walk_dir descends into subdirectories by itself.
+
+  if (!recursive || ordered_output)
+  {
+    walkers_count = 0;
+
+    fd = open(dir, O_RDONLY | O_DIRECTORY);
+
+    if (fd >= 0)
+      walk_dir(&walkers[0], fd, dir, recursive);
+
+    file_queue_flush(&walkers[0]);
+  }
+  else
+  {
+    walkers_count = workers_count;
 
-      de = readdir(dp);
+    dir_queue_put(dir);
+
+    // This thread acts as a walking thread too, so the walk still completes
+    // if some of the other threads can't be created.
+
+    for (i = 1; i < walkers_count; i++)
+    {
+      if (create_thread(&thread[i], walking_thread, &walkers[i]) != 0)
+        break;
     }
 
-    closedir(dp);
+    walking_thread(&walkers[0]);
+
+    while (--i > 0)
+      thread_join(&thread[i]);
   }
+
+  mutex_destroy(&dir_queue_mutex);
+  semaphore_destroy(&dirs_available);
 }
 
 #endif
 
 void print_string(
+    OUTPUT_BUFFER* output,
     uint8_t* data,
     int length)
 {
-  int i;
+  static const char hex_digits[] = "0123456789ABCDEF";
+
   char* str;
+  int i;
+
+  // Each byte takes up to four characters when escaped, plus the new line.
 
-  str = (char*) (data);
+  if (!output_reserve(output, length * 4 + 1))
+    return;
+
+  str = output->data + output->length;
 
   for (i = 0; i < length; i++)
   {
-    if (str[i] >= 32 && str[i] <= 126)
-      printf("%c", str[i]);
+    if (data[i] >= 32 && data[i] <= 126)
+    {
+      *str++ = data[i];
+    }
     else
-      printf("\\x%02X", (uint8_t) str[i]);
+    {
+      *str++ = '\\';
+      *str++ = 'x';
+      *str++ = hex_digits[data[i] >> 4];
+      *str++ = hex_digits[data[i] & 0x0F];
+    }
   }
 
-  printf("\n");
+  *str++ = '\n';
+
+  output->length = str - output->data;
 }
 
 void print_hex_string(
+    OUTPUT_BUFFER* output,
     uint8_t* data,
     int length)
 {
+  static const char hex_digits[] = "0123456789ABCDEF";
+
+  char* str;
   int i;
 
+  if (!output_reserve(output, length * 3 + 1))
+    return;
+
+  str = output->data + output->length;
+
   for (i = 0; i < length; i++)
-    printf("%02X ", (uint8_t) data[i]);
+  {
+    *str++ = hex_digits[data[i] >> 4];
+    *str++ = hex_digits[data[i] & 0x0F];
+    *str++ = ' ';
+  }
+
+  *str++ = '\n';
 
-  printf("\n");
+  output->length = str - output->data;
 }
 
 
@@ -370,6 +1176,9 @@ void print_scanning_error(int error)
     case ERROR_SCAN_TIMEOUT:
       fprintf(stderr, "scanning timed out\n");
       break;
+    case ERROR_SCAN_CANCELLED:
+      fprintf(stderr, "scanning cancelled\n");
+      break;
     case ERROR_COULD_NOT_OPEN_FILE:
       fprintf(stderr, "could not open file\n");
       break;
@@ -377,7 +1186,7 @@ void print_scanning_error(int error)
       fprintf(stderr, "zero length file\n");
       break;
     case ERROR_UNSUPPORTED_FILE_VERSION:
-      fprintf(stderr, "rules were compiled with a newer version of YARA.\n");
+      fprintf(stderr, "rules were compiled with a different version of YARA.\n");
       break;
     case ERROR_CORRUPT_FILE:
       fprintf(stderr, "corrupt compiled rules file.\n");
@@ -410,6 +1219,9 @@ int handle_message(int message, YR_RULE* rule, void* data)
   YR_MATCH* match;
   YR_META* meta;
 
+  CALLBACK_ARGS* args = (CALLBACK_ARGS*) data;
+  OUTPUT_BUFFER* output = args->output;
+
   char* tag_name;
   size_t tag_length;
   int is_matching;
@@ -465,27 +1277,26 @@ int handle_message(int message, YR_RULE* rule, void* data)
 
   if (show)
   {
-    mutex_lock(&output_mutex);
-    printf("%s ", rule->identifier);
+    output_printf(output, "%s ", rule->identifier);
 
     if (show_tags)
     {
-      printf("[");
+      output_printf(output, "[");
 
       tag_name = rule->tags;
       tag_length = tag_name != NULL ? strlen(tag_name) : 0;
 
       while (tag_length > 0)
       {
-        printf("%s", tag_name);
+        output_printf(output, "%s", tag_name);
         tag_name += tag_length + 1;
         tag_length = strlen(tag_name);
 
         if (tag_length > 0)
-          printf(",");
+          output_printf(output, ",");
       }
 
-      printf("] ");
+      output_printf(output, "] ");
     }
 
     // Show meta-data.
@@ -494,27 +1305,31 @@ int handle_message(int message, YR_RULE* rule, void* data)
     {
       meta = rule->metas;
 
-      printf("[");
+      output_printf(output, "[");
 
       while(!META_IS_NULL(meta))
       {
         if (meta->type == META_TYPE_INTEGER)
-          printf("%s=%d", meta->identifier, meta->integer);
+          output_printf(
+              output, "%s=%d", meta->identifier, meta->integer);
         else if (meta->type == META_TYPE_BOOLEAN)
-          printf("%s=%s", meta->identifier, meta->integer ? "true" : "false");
+          output_printf(
+              output, "%s=%s", meta->identifier,
+              meta->integer ? "true" : "false");
         else
-          printf("%s=\"%s\"", meta->identifier, meta->string);
+          output_printf(
+              output, "%s=\"%s\"", meta->identifier, meta->string);
 
         meta++;
 
         if (!META_IS_NULL(meta))
-          printf(",");
+          output_printf(output, ",");
       }
 
-      printf("] ");
+      output_printf(output, "] ");
     }
 
-    printf("%s\n", (char*) data);
+    output_printf(output, "%s\n", args->file_path);
 
     // Show matched strings.
 
@@ -532,15 +1347,19 @@ int handle_message(int message, YR_RULE* rule, void* data)
 
           while (match != NULL)
           {
-            printf("0x%" PRIx64 ":%s: ", match->first_offset, string->identifier);
+            output_printf(
+                output,
+                "0x%" PRIx64 ":%s: ",
+                match->first_offset,
+                string->identifier);
 
             if (STRING_IS_HEX(string))
             {
-              print_hex_string(match->data, match->length);
+              print_hex_string(output, match->data, match->length);
             }
             else
             {
-              print_string(match->data, match->length);
+              print_string(output, match->data, match->length);
             }
 
             match = match->next;
@@ -550,8 +1369,6 @@ int handle_message(int message, YR_RULE* rule, void* data)
         string++;
       }
     }
-
-    mutex_unlock(&output_mutex);
   }
 
   if (is_matching)
@@ -576,38 +1393,122 @@ int callback(int message, YR_RULE* rule, void* data)
   return CALLBACK_ERROR;
 }
 
+//
+// place_workers
+//
+// Assigns one of the CPUs available to the process to each scanning thread.
+// When the threads span several NUMA nodes each node gets its own copy of
+// the rules, which is created while this thread runs in that node so the
+// memory is allocated there.
+//
+
+void place_workers(
+    YR_RULES* rules)
+{
+  int cpus[MAX_CPUS];
+  int node_cpus[MAX_CPUS];
+  int nodes[MAX_THREADS];
+
+  int cpus_count;
+  int node_cpus_count;
+  int multiple_nodes = FALSE;
+  int i, j;
+
+  cpus_count = get_available_cpus(cpus, MAX_CPUS);
+
+  if (cpus_count == 0)
+    return;
+
+  for (i = 0; i < workers_count; i++)
+  {
+    workers[i].cpu = cpus[i % cpus_count];
+    nodes[i] = get_cpu_numa_node(workers[i].cpu);
+
+    if (nodes[i] != nodes[0])
+      multiple_nodes = TRUE;
+  }
+
+  // Profiling information is collected per rules object, copies of the rules
+  // would leave out part of it.
+
+  if (!multiple_nodes || profile > 0)
+    return;
+
+  for (i = 0; i < workers_count; i++)
+  {
+    if (nodes[i] >= MAX_NUMA_NODES || node_rules[nodes[i]] != NULL)
+      continue;
+
+    node_cpus_count = 0;
+
+    for (j = 0; j < cpus_count; j++)
+    {
+      if (get_cpu_numa_node(cpus[j]) == nodes[i])
+        node_cpus[node_cpus_count++] = cpus[j];
+    }
+
+    if (thread_set_affinity(node_cpus, node_cpus_count) == 0)
+      yr_rules_duplicate(rules, &node_rules[nodes[i]]);
+  }
+
+  thread_set_affinity(cpus, cpus_count);
+
+  for (i = 0; i < workers_count; i++)
+  {
+    if (nodes[i] < MAX_NUMA_NODES && node_rules[nodes[i]] != NULL)
+      workers[i].rules = node_rules[nodes[i]];
+  }
+}
+
+
 #ifdef WIN32
 DWORD WINAPI scanning_thread(LPVOID param)
 #else
 void* scanning_thread(void* param)
 #endif
 {
-  YR_RULES* rules = (YR_RULES*) param;
+  SCAN_WORKER* worker = (SCAN_WORKER*) param;
+  FILE_BATCH* batch;
+  CALLBACK_ARGS args;
   char* file_path;
   int result;
+  int i;
 
-  file_path = file_queue_get();
+  args.output = &worker->output;
 
-  while (file_path != NULL)
-  {
-    result = yr_rules_scan_file(
-        rules,
-        file_path,
-        callback,
-        file_path,
-        fast_scan,
-        timeout);
+  if (worker->cpu >= 0)
+    thread_set_affinity(&worker->cpu, 1);
 
-    if (result != ERROR_SUCCESS)
+  batch = file_queue_get(worker);
+
+  while (batch != NULL)
+  {
+    for (i = 0; i < batch->count; i++)
     {
-      mutex_lock(&output_mutex);
-      fprintf(stderr, "Error scanning %s: ", file_path);
-      print_scanning_error(result);
-      mutex_unlock(&output_mutex);
+      file_path = batch->paths[i];
+      args.file_path = file_path;
+
+      result = yr_rules_scan_file(
+          worker->rules,
+          file_path,
+          callback,
+          &args,
+          fast_scan,
+          timeout);
+
+      if (result != ERROR_SUCCESS)
+      {
+        mutex_lock(&output_mutex);
+        fprintf(stderr, "Error scanning %s: ", file_path);
+        print_scanning_error(result);
+        mutex_unlock(&output_mutex);
+      }
+
+      free(file_path);
     }
 
-    free(file_path);
-    file_path = file_queue_get();
+    output_queue_put(batch, &worker->output);
+    batch = file_queue_get(worker);
   }
 
   yr_finalize_thread();
@@ -616,6 +1517,70 @@ void* scanning_thread(void* param)
 }
 
 
+void print_profiling_info(
+    YR_RULES* rules)
+{
+  YR_RULE_PROFILE* rule_profiles;
+  YR_STRING_PROFILE* string_profiles;
+  YR_STRING* string;
+
+  int count;
+  int i;
+
+  rule_profiles = malloc(profile * sizeof(YR_RULE_PROFILE));
+  string_profiles = malloc(profile * sizeof(YR_STRING_PROFILE));
+
+  if (rule_profiles == NULL || string_profiles == NULL)
+  {
+    fprintf(stderr, "Not enough memory.\n");
+    free(rule_profiles);
+    free(string_profiles);
+    return;
+  }
+
+  count = profile;
+
+  if (yr_rules_get_slowest_rules(rules, rule_profiles, &count) == ERROR_SUCCESS)
+  {
+    printf("\n%16s %14s  %s\n", "cycles", "instructions", "rule");
+
+    for (i = 0; i < count; i++)
+    {
+      printf("%16" PRIu64 " %14" PRIu64 "  %s:%s\n",
+          rule_profiles[i].cycles,
+          rule_profiles[i].instructions,
+          rule_profiles[i].rule->ns->name,
+          rule_profiles[i].rule->identifier);
+    }
+  }
+
+  count = profile;
+
+  if (yr_rules_get_slowest_strings(
+          rules, string_profiles, &count) == ERROR_SUCCESS)
+  {
+    printf("\n%16s %14s %14s %14s  %s\n",
+        "cycles", "verifications", "atom hits", "matches", "string");
+
+    for (i = 0; i < count; i++)
+    {
+      string = string_profiles[i].string;
+
+      printf("%16" PRIu64 " %14" PRIu64 " %14" PRIu64 " %14" PRIu64 "  %s:%s\n",
+          string_profiles[i].cycles,
+          string_profiles[i].verifications,
+          string_profiles[i].atom_hits,
+          string_profiles[i].matches,
+          string->rule->identifier,
+          string->identifier);
+    }
+  }
+
+  free(rule_profiles);
+  free(string_profiles);
+}
+
+
 void cleanup()
 {
   IDENTIFIER* identifier;
@@ -681,7 +1646,7 @@ int process_cmd_line(
 
   opterr = 0;
 
-  while ((c = getopt (argc, (char**) argv, "rnsvgma:l:t:i:d:f")) != -1)
+  while ((c = getopt (argc, (char**) argv, "rnsvgmAoa:l:t:i:d:fp:j:")) != -1)
   {
     switch (c)
     {
@@ -794,6 +1759,22 @@ int process_cmd_line(
         timeout = atoi(optarg);
         break;
 
+      case 'p':
+        profile = atoi(optarg);
+        break;
+
+      case 'j':
+        threads = atoi(optarg);
+        break;
+
+      case 'A':
+        pin_threads = TRUE;
+        break;
+
+      case 'o':
+        ordered_output = TRUE;
+        break;
+
       case '?':
         if (optopt == 't')
         {
@@ -834,6 +1815,8 @@ int main(
   YR_RULES* rules;
   FILE* rule_file;
   EXTERNAL* external;
+  CALLBACK_ARGS args;
+  OUTPUT_BUFFER output;
 
   int pid;
   int i;
@@ -841,6 +1824,7 @@ int main(
   int result;
 
   THREAD thread[MAX_THREADS];
+  THREAD writer;
 
   if (!process_cmd_line(argc, argv))
     return 0;
@@ -851,6 +1835,31 @@ int main(
     return 0;
   }
 
+  // Each scanning thread takes one of the MAX_THREADS thread indexes
+  // libyara has for each rules object, more threads would fail to scan.
+
+  if (threads <= 0)
+  {
+    threads = get_cpu_count();
+
+    if (threads > MAX_THREADS)
+    {
+      fprintf(stderr,
+          "warning: found %d CPUs but can't use more than %d threads.\n",
+          threads, MAX_THREADS);
+
+      threads = MAX_THREADS;
+    }
+  }
+  else if (threads > MAX_THREADS)
+  {
+    fprintf(stderr,
+        "warning: can't use more than %d threads, using %d.\n",
+        MAX_THREADS, MAX_THREADS);
+
+    threads = MAX_THREADS;
+  }
+
   yr_initialize();
 
   result = yr_rules_load(argv[optind], &rules);
@@ -960,6 +1969,22 @@ int main(
 
   mutex_init(&output_mutex);
 
+  if (profile > 0)
+    yr_rules_enable_profiling(rules);
+
+  // When scanning a single file or process there's no use for a pool of
+  // scanning threads, use them to scan chunks of it in parallel instead.
+
+  if (!is_directory(argv[argc - 1]))
+    yr_rules_set_scan_threads(rules, threads);
+
+  output.data = NULL;
+  output.length = 0;
+  output.size = 0;
+
+  args.file_path = argv[argc - 1];
+  args.output = &output;
+
   if (is_numeric(argv[argc - 1]))
   {
     pid = atoi(argv[argc - 1]);
@@ -967,28 +1992,33 @@ int main(
         rules,
         pid,
         callback,
-        (void*) argv[argc - 1],
+        &args,
         fast_scan,
         timeout);
 
+    output_flush(&output);
+
     if (result != ERROR_SUCCESS)
       print_scanning_error(result);
   }
   else if (is_directory(argv[argc - 1]))
   {
-    file_queue_init();
+    file_queue_init(rules, threads);
+    output_queue_init();
+
+    if (pin_threads)
+      place_workers(rules);
+
+    if (create_thread(&writer, writing_thread, NULL) != 0)
+      return ERROR_COULD_NOT_CREATE_THREAD;
 
     for (i = 0; i < threads; i++)
     {
-      if (create_thread(&thread[i], scanning_thread, (void*) rules) != 0)
+      if (create_thread(&thread[i], scanning_thread, &workers[i]) != 0)
         return ERROR_COULD_NOT_CREATE_THREAD;
     }
 
-    scan_dir(
-        argv[argc - 1],
-        recursive_search,
-        rules,
-        callback);
+    scan_dir(argv[argc - 1], recursive_search);
 
     file_queue_finish();
 
@@ -996,7 +2026,17 @@ int main(
     for (i = 0; i < threads; i++)
       thread_join(&thread[i]);
 
+    output_queue_finish();
+    thread_join(&writer);
+
+    output_queue_destroy();
     file_queue_destroy();
+
+    for (i = 0; i < MAX_NUMA_NODES; i++)
+    {
+      if (node_rules[i] != NULL)
+        yr_rules_destroy(node_rules[i]);
+    }
   }
   else
   {
@@ -1004,10 +2044,12 @@ int main(
         rules,
         argv[argc - 1],
         callback,
-        (void*) argv[argc - 1],
+        &args,
         fast_scan,
         timeout);
- 
+
+    output_flush(&output);
+
     if (result != ERROR_SUCCESS)
     {
       fprintf(stderr, "Error scanning %s: ", argv[argc - 1]);
@@ -1015,6 +2057,11 @@ int main(
     }
   }
 
+  if (profile > 0)
+    print_profiling_info(rules);
+
+  free(output.data);
+
   yr_rules_destroy(rules);
   yr_finalize();
 
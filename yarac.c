@@ -156,6 +156,7 @@ int main(
 
   YR_COMPILER* compiler;
   YR_RULES* rules;
+  YR_CODE_STATS code_stats;
   FILE* rule_file;
 
   clock_t start, end;
@@ -212,6 +213,13 @@ int main(
 
   printf( "Compiling time: %f s\n", (float)(end - start) / CLOCKS_PER_SEC);
 
+  yr_compiler_get_code_stats(compiler, &code_stats);
+
+  printf(
+      "Code size: %u bytes (%u before optimization)\n",
+      code_stats.optimized_size,
+      code_stats.size);
+
   yr_rules_save(rules, argv[argc - 1]);
 
   yr_rules_destroy(rules);